@@ -50,6 +50,7 @@
 #include "collisionutils.h" // hlstriker: For player avoidance
 #include "history_resource.h" // squeek: For adding grens to the ammo pickups on the right
 #include "ff_mathackman.h" // squeek: For mathack manager update in ClientThink
+#include "ff_playericons.h"
 
 #if defined( CFFPlayer )
 #undef CFFPlayer
@@ -1580,7 +1581,9 @@ void C_FFPlayer::DrawPlayerIcons()
 
 	float flOffset = 0.0f;
 
-	CMatRenderContextPtr pMatRenderContext(g_pMaterialSystem);
+	// Icon materials are cached and the sprites batched up by the icon renderer
+	CFFPlayerIconRenderer *pIcons = FFPlayerIcons();
+
 	// --------------------------------
 	// Check for team mate, never drawn for self or observers
 	// --------------------------------
@@ -1592,11 +1595,8 @@ void C_FFPlayer::DrawPlayerIcons()
 		// If he is cloaked make sure he's on our team or an ally, no cheating
 		if (!IsCloaked() || (IsCloaked() && (FFGameRules()->IsTeam1AlliedToTeam2(pPlayer->GetTeamNumber(), GetTeamNumber()) == GR_TEAMMATE)))
 		{
-			IMaterial* pMaterial = materials->FindMaterial("sprites/ff_sprite_teammate", TEXTURE_GROUP_CLIENT_EFFECTS);
-			if (pMaterial)
+			if (pIcons->IsValid(FF_PLAYERICON_TEAMMATE))
 			{
-				pMatRenderContext->Bind(pMaterial);
-
 				// The color is based on the players real team
 				int iTeam = IsDisguised() ? GetDisguisedTeam() : GetTeamNumber();
 				Color clr = Color(255, 255, 255, 255);
@@ -1605,7 +1605,7 @@ void C_FFPlayer::DrawPlayerIcons()
 					clr.SetColor(g_PR->GetTeamColor(iTeam).r(), g_PR->GetTeamColor(iTeam).g(), g_PR->GetTeamColor(iTeam).b(), 255);
 
 				color32 c = { clr.r(), clr.g(), clr.b(), 255 };
-				DrawSprite(Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f), 15.0f, 15.0f, c);
+				pIcons->AddIcon(FF_PLAYERICON_TEAMMATE, Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f), 15.0f, 15.0f, c);
 
 				// Increment offset
 				flOffset += 16.0f;
@@ -1618,12 +1618,10 @@ void C_FFPlayer::DrawPlayerIcons()
 	// --------------------------------
 	if (IsInSaveMe() && (FFGameRules()->IsTeam1AlliedToTeam2(pPlayer->GetTeamNumber(), GetTeamNumber()) == GR_TEAMMATE))
 	{
-		IMaterial* pMaterial = materials->FindMaterial("sprites/ff_sprite_saveme", TEXTURE_GROUP_CLIENT_EFFECTS);
-		if (pMaterial)
+		if (pIcons->IsValid(FF_PLAYERICON_SAVEME))
 		{
-			pMatRenderContext->Bind(pMaterial);
 			color32 c = { 255, 0, 0, 255 };
-			DrawSprite(Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f + flOffset), 15.0f, 15.0f, c);
+			pIcons->AddIcon(FF_PLAYERICON_SAVEME, Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f + flOffset), 15.0f, 15.0f, c);
 
 			// Increment offset
 			flOffset += 16.0f;
@@ -1635,11 +1633,8 @@ void C_FFPlayer::DrawPlayerIcons()
 	// --------------------------------
 	if (IsInEngyMe() && (FFGameRules()->IsTeam1AlliedToTeam2(pPlayer->GetTeamNumber(), GetTeamNumber()) == GR_TEAMMATE))
 	{
-		IMaterial* pMaterial = materials->FindMaterial("sprites/ff_sprite_engyme", TEXTURE_GROUP_CLIENT_EFFECTS);
-		if (pMaterial)
+		if (pIcons->IsValid(FF_PLAYERICON_ENGYME))
 		{
-			pMatRenderContext->Bind(pMaterial);
-
 			// The color is based on the players real team
 			int iTeam = GetTeamNumber();
 			Color clr = Color(255, 255, 255, 255);
@@ -1648,7 +1643,7 @@ void C_FFPlayer::DrawPlayerIcons()
 				clr.SetColor(g_PR->GetTeamColor(iTeam).r(), g_PR->GetTeamColor(iTeam).g(), g_PR->GetTeamColor(iTeam).b(), 255);
 
 			color32 c = { clr.r(), clr.g(), clr.b(), 255 };
-			DrawSprite(Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f + flOffset), 15.0f, 15.0f, c);
+			pIcons->AddIcon(FF_PLAYERICON_ENGYME, Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f + flOffset), 15.0f, 15.0f, c);
 
 			// Increment offset
 			flOffset += 16.0f;
@@ -1660,11 +1655,8 @@ void C_FFPlayer::DrawPlayerIcons()
 	// --------------------------------
 	if (IsInAmmoMe() && (FFGameRules()->IsTeam1AlliedToTeam2(pPlayer->GetTeamNumber(), GetTeamNumber()) == GR_TEAMMATE))
 	{
-		IMaterial* pMaterial = materials->FindMaterial("sprites/ff_sprite_ammome", TEXTURE_GROUP_CLIENT_EFFECTS);
-		if (pMaterial)
+		if (pIcons->IsValid(FF_PLAYERICON_AMMOME))
 		{
-			pMatRenderContext->Bind(pMaterial);
-
 			// The color is based on the players real team
 			int iTeam = GetTeamNumber();
 			Color clr = Color(255, 255, 255, 255);
@@ -1673,7 +1665,7 @@ void C_FFPlayer::DrawPlayerIcons()
 				clr.SetColor(g_PR->GetTeamColor(iTeam).r(), g_PR->GetTeamColor(iTeam).g(), g_PR->GetTeamColor(iTeam).b(), 255);
 
 			color32 c = { clr.r(), clr.g(), clr.b(), 255 };
-			DrawSprite(Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f + flOffset), 15.0f, 15.0f, c);
+			pIcons->AddIcon(FF_PLAYERICON_AMMOME, Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f + flOffset), 15.0f, 15.0f, c);
 
 			// Increment offset
 			flOffset += 16.0f;
@@ -1694,11 +1686,8 @@ void C_FFPlayer::DrawPlayerIcons()
 			if (FFGameRules()->IsTeam1AlliedToTeam2(pPlayer->GetTeamNumber(), GetDisguisedTeam()) == GR_NOTTEAMMATE)
 			{
 				// Thanks mirv!
-				IMaterial* pMaterial = materials->FindMaterial("sprites/ff_sprite_spy", TEXTURE_GROUP_CLIENT_EFFECTS);
-				if (pMaterial)
+				if (pIcons->IsValid(FF_PLAYERICON_SPY))
 				{
-					pMatRenderContext->Bind(pMaterial);
-
 					// The color is based on the spies' real team
 					int iTeam = GetTeamNumber();
 					Color clr = Color(255, 255, 255, 255);
@@ -1707,7 +1696,7 @@ void C_FFPlayer::DrawPlayerIcons()
 						clr.SetColor(g_PR->GetTeamColor(iTeam).r(), g_PR->GetTeamColor(iTeam).g(), g_PR->GetTeamColor(iTeam).b(), 255);
 
 					color32 c = { clr.r(), clr.g(), clr.b(), clr.a() };
-					DrawSprite(Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f + flOffset), 15.0f, 15.0f, c);
+					pIcons->AddIcon(FF_PLAYERICON_SPY, Vector(GetAbsOrigin().x, GetAbsOrigin().y, EyePosition().z + 16.0f + flOffset), 15.0f, 15.0f, c);
 				}
 			}
 		}
@@ -1719,10 +1708,8 @@ void C_FFPlayer::DrawPlayerIcons()
 		// --------------------------------
 	if (cl_concuss.GetBool() && (IsConcussed() || concuss_alwaysOn.GetBool()) && !IsCloaked())
 	{
-		IMaterial* pMaterial = materials->FindMaterial("sprites/ff_sprite_concussed", TEXTURE_GROUP_CLIENT_EFFECTS);
-		if (pMaterial)
+		if (pIcons->IsValid(FF_PLAYERICON_CONCUSSED))
 		{
-			pMatRenderContext->Bind(pMaterial);
 			color32 c = { concuss_color_r.GetInt(), concuss_color_g.GetInt(), concuss_color_b.GetInt(), concuss_color_a.GetInt() };
 			float time = gpGlobals->curtime;
 			float spriteSize = concuss_spriteSize.GetFloat();
@@ -1783,22 +1770,22 @@ void C_FFPlayer::DrawPlayerIcons()
 				{
 					if (i % 2)
 					{
-						DrawSprite(vecOrigin + vecDirection * radius - vecVerticalOffset, spriteSize, spriteSize, c);
+						pIcons->AddIcon(FF_PLAYERICON_CONCUSSED, vecOrigin + vecDirection * radius - vecVerticalOffset, spriteSize, spriteSize, c);
 					}
 					else
 					{
-						DrawSprite(vecOrigin + vecDirection * radius + vecVerticalOffset2, spriteSize, spriteSize, c);
+						pIcons->AddIcon(FF_PLAYERICON_CONCUSSED, vecOrigin + vecDirection * radius + vecVerticalOffset2, spriteSize, spriteSize, c);
 					}
 				}
 				else
 				{
 					if (i % 2)
 					{
-						DrawSprite(vecOrigin + vecDirection * radius - vecVerticalOffset2, spriteSize, spriteSize, c);
+						pIcons->AddIcon(FF_PLAYERICON_CONCUSSED, vecOrigin + vecDirection * radius - vecVerticalOffset2, spriteSize, spriteSize, c);
 					}
 					else
 					{
-						DrawSprite(vecOrigin + vecDirection * radius + vecVerticalOffset, spriteSize, spriteSize, c);
+						pIcons->AddIcon(FF_PLAYERICON_CONCUSSED, vecOrigin + vecDirection * radius + vecVerticalOffset, spriteSize, spriteSize, c);
 					}
 				}
 			}
@@ -1811,10 +1798,8 @@ void C_FFPlayer::DrawPlayerIcons()
 		// --------------------------------
 	if (cl_tranq.GetBool() && (IsTranqed() || cl_tranq_alwaysOn.GetBool()) && !IsCloaked())
 	{
-		IMaterial* pMaterial = materials->FindMaterial("sprites/ff_sprite_tranquilized", TEXTURE_GROUP_CLIENT_EFFECTS);
-		if (pMaterial)
+		if (pIcons->IsValid(FF_PLAYERICON_TRANQUILIZED))
 		{
-			pMatRenderContext->Bind(pMaterial);
 			float time = gpGlobals->curtime;
 
 			float alpha = (float)((int)(time * 100) % 192) * 4;
@@ -1823,11 +1808,13 @@ void C_FFPlayer::DrawPlayerIcons()
 			color32 c2 = { 255, 255, 255, clamp(alpha - 255,0,255) };
 			color32 c3 = { 255, 255, 255, clamp(alpha - 510,0,255) };
 
-			DrawSprite(Vector(GetAbsOrigin().x + 6.0f, GetAbsOrigin().y + 6.0f, EyePosition().z + 12.0f), 2.0f, 2.0f, c1);
-			DrawSprite(Vector(GetAbsOrigin().x + 8.0f, GetAbsOrigin().y + 8.0f, EyePosition().z + 14.0f), 4.0f, 4.0f, c2);
-			DrawSprite(Vector(GetAbsOrigin().x + 12.0f, GetAbsOrigin().y + 12.0f, EyePosition().z + 18.0f), 8.0f, 8.0f, c3);
+			pIcons->AddIcon(FF_PLAYERICON_TRANQUILIZED, Vector(GetAbsOrigin().x + 6.0f, GetAbsOrigin().y + 6.0f, EyePosition().z + 12.0f), 2.0f, 2.0f, c1);
+			pIcons->AddIcon(FF_PLAYERICON_TRANQUILIZED, Vector(GetAbsOrigin().x + 8.0f, GetAbsOrigin().y + 8.0f, EyePosition().z + 14.0f), 4.0f, 4.0f, c2);
+			pIcons->AddIcon(FF_PLAYERICON_TRANQUILIZED, Vector(GetAbsOrigin().x + 12.0f, GetAbsOrigin().y + 12.0f, EyePosition().z + 18.0f), 8.0f, 8.0f, c3);
 		}
 	}
+	// Draws now unless these are being saved up for the end of the main view
+	pIcons->EndPlayer();
 }
 
 //-----------------------------------------------------------------------------
@@ -64,6 +64,10 @@ void CFFRailEffects::Spawn( void )
 {
 	m_flMaxBeamLength = ffdev_rail_beamlength.GetFloat();
 
+	// Look these up once here rather than every time we draw
+	m_hBeamMaterial.Init( RAIL_BEAM, TEXTURE_GROUP_CLIENT_EFFECTS );
+	m_hGlowMaterial.Init( RAIL_GLOW, TEXTURE_GROUP_CLIENT_EFFECTS );
+
 	SetMoveType(MOVETYPE_NONE);
 	SetSolid(SOLID_NONE);
 
@@ -142,13 +146,12 @@ int CFFRailEffects::DrawModel( int flags )
 			Vector vecBeamControl = (vecBeamStart + vecBeamEnd) * 0.5f + Vector(random->RandomFloat(-flRandom, flRandom), random->RandomFloat(-flRandom, flRandom), random->RandomFloat(-flRandom, flRandom));
 			float flScrollOffset = gpGlobals->curtime - (int) gpGlobals->curtime;
 
-			IMaterial *pMat = materials->FindMaterial(RAIL_BEAM, TEXTURE_GROUP_CLIENT_EFFECTS);
-			materials->Bind(pMat);
+			materials->Bind(m_hBeamMaterial);
 
 			DrawBeamQuadratic(vecBeamStart, vecBeamControl, vecBeamEnd, 1.0f * flRandom, vecColor, flScrollOffset);
 		}
 
-		IMaterial *pMat = materials->FindMaterial(RAIL_GLOW, TEXTURE_GROUP_CLIENT_EFFECTS);
+		IMaterial *pMat = m_hGlowMaterial;
 		materials->Bind(pMat);
 
 		// FF TODO: draw the glows on their own (er...let them die independently)
@@ -19,6 +19,7 @@
 
 #include "cbase.h"
 #include "utlvector.h"
+#include "materialsystem/MaterialSystemUtil.h"
 
 #define CFFRailEffects C_FFRailEffects
 
@@ -81,6 +82,10 @@ public:
 	float m_flMaxBeamLength;
 
 	bool m_bTimeToDie;
+
+private:
+	CMaterialReference m_hBeamMaterial;
+	CMaterialReference m_hGlowMaterial;
 };
 
 #endif // FF_RAIL_EFFECTS_H
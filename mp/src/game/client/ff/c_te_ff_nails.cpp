@@ -0,0 +1,64 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file c_te_ff_nails.cpp
+/// @brief Client side of the batched nail spawn event
+///
+/// REVISIONS
+/// ---------
+/// Nails fired in the same tick by one player are sent to clients
+/// as a single event instead of an effect dispatch each.
+
+#include "cbase.h"
+#include "c_basetempentity.h"
+#include "c_te_legacytempents.h"
+#include "ff_projectile_nail.h"
+
+
+class C_TEFFNails : public C_BaseTempEntity
+{
+public:
+	DECLARE_CLASS( C_TEFFNails, C_BaseTempEntity );
+	DECLARE_CLIENTCLASS();
+
+	virtual void	PostDataUpdate( DataUpdateType_t updateType );
+
+public:
+	int		m_iOwner;
+	int		m_nNails;
+	Vector	m_vecOrigin[FF_NAIL_EVENT_MAX];
+	float	m_flPitch[FF_NAIL_EVENT_MAX];
+	float	m_flYaw[FF_NAIL_EVENT_MAX];
+};
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Replay the nails exactly as the Projectile_Nail effect would have
+//-----------------------------------------------------------------------------
+void C_TEFFNails::PostDataUpdate( DataUpdateType_t updateType )
+{
+	int nNails = min( m_nNails, FF_NAIL_EVENT_MAX );
+
+	for ( int i = 0; i < nNails; i++ )
+	{
+		tempents->FFProjectile( m_vecOrigin[i], QAngle( m_flPitch[i], m_flYaw[i], 0 ), FF_NAIL_SPEED, FF_PROJECTILE_NAIL, m_iOwner );
+	}
+}
+
+
+IMPLEMENT_CLIENTCLASS_EVENT( C_TEFFNails, DT_TEFFNails, CTEFFNails );
+
+
+BEGIN_RECV_TABLE_NOBASE(C_TEFFNails, DT_TEFFNails)
+	RecvPropInt( RECVINFO( m_iOwner ) ),
+	RecvPropInt( RECVINFO( m_nNails ) ),
+	RecvPropArray(
+		RecvPropVector( RECVINFO( m_vecOrigin[0] ) ),
+		m_vecOrigin ),
+	RecvPropArray(
+		RecvPropFloat( RECVINFO( m_flPitch[0] ) ),
+		m_flPitch ),
+	RecvPropArray(
+		RecvPropFloat( RECVINFO( m_flYaw[0] ) ),
+		m_flYaw ),
+END_RECV_TABLE()
@@ -0,0 +1,216 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_boneblend_test.cpp
+/// @brief Checks and times the SSE bone blending in bone_setup
+///
+/// REVISIONS
+/// ---------
+/// Every sequence of each player class model is blended from the same random
+/// start pose with anim_simdblend off and then on. The largest quaternion and
+/// position difference per model is reported against a tolerance, which has
+/// to allow for QuaternionScale near 180 degrees. The benchmark repeats the
+/// same SlerpBones, BlendBones and ScaleBones calls under a timer.
+
+#include "cbase.h"
+#include "bone_setup.h"
+#include "ff_utils.h"
+#include "ff_playerclass_parse.h"
+#include "datacache/imdlcache.h"
+#include "tier0/fasttimer.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+// poses for the two runs, and the one both start from
+static Quaternion s_q1[2][MAXSTUDIOBONES];
+static Vector s_pos1[2][MAXSTUDIOBONES];
+static Quaternion s_q1Start[MAXSTUDIOBONES];
+static Vector s_pos1Start[MAXSTUDIOBONES];
+static QuaternionAligned s_q2[MAXSTUDIOBONES];
+static Vector s_pos2[MAXSTUDIOBONES];
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets the studio model of a player class, NULL if it won't load
+//-----------------------------------------------------------------------------
+static const studiohdr_t *FF_BoneBlendClassModel( int iClass )
+{
+	PLAYERCLASS_FILE_INFO_HANDLE hClassInfo;
+	if ( !ReadPlayerClassDataFromFileForSlot( filesystem, Class_IntToString( iClass ), &hClassInfo, g_pGameRules->GetEncryptionKey() ) )
+		return NULL;
+
+	const CFFPlayerClassInfo *pClassInfo = GetFilePlayerClassInfoFromHandle( hClassInfo );
+	if ( !pClassInfo )
+		return NULL;
+
+	const model_t *pModel = modelinfo->FindOrLoadModel( pClassInfo->m_szModel );
+	if ( !pModel )
+		return NULL;
+
+	return modelinfo->GetStudiomodel( pModel );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Random poses, with some bones of q2 left close to or opposite
+//			q1 so the small angle and 180 degree cases get used too
+//-----------------------------------------------------------------------------
+static void FF_BoneBlendRandomPoses( int nBones )
+{
+	for ( int i = 0; i < nBones; i++ )
+	{
+		Quaternion &q1 = s_q1Start[i];
+		q1.Init( RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ) );
+		QuaternionNormalize( q1 );
+
+		QuaternionAligned &q2 = s_q2[i];
+		switch ( RandomInt( 0, 3 ) )
+		{
+		case 0:
+			q2.Init( q1.x, q1.y, q1.z, q1.w );
+			break;
+		case 1:
+			q2.Init( -q1.x, -q1.y, -q1.z, -q1.w );
+			break;
+		case 2:
+			q2.Init( q1.x + RandomFloat( -0.01f, 0.01f ), q1.y + RandomFloat( -0.01f, 0.01f ), q1.z + RandomFloat( -0.01f, 0.01f ), q1.w + RandomFloat( -0.01f, 0.01f ) );
+			break;
+		default:
+			q2.Init( RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ), RandomFloat( -1, 1 ) );
+			break;
+		}
+		QuaternionNormalize( q2 );
+
+		s_pos1Start[i].Init( RandomFloat( -64, 64 ), RandomFloat( -64, 64 ), RandomFloat( -64, 64 ) );
+		s_pos2[i].Init( RandomFloat( -64, 64 ), RandomFloat( -64, 64 ), RandomFloat( -64, 64 ) );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The blends a layer of animation goes through, on s_q1[iRun]
+//-----------------------------------------------------------------------------
+static void FF_BoneBlendRun( CStudioHdr *pStudioHdr, int iRun, int iSequence, float s )
+{
+	mstudioseqdesc_t &seqdesc = pStudioHdr->pSeqdesc( iSequence );
+
+	SlerpBones( pStudioHdr, s_q1[iRun], s_pos1[iRun], seqdesc, iSequence, s_q2, s_pos2, s, BONE_USED_BY_ANYTHING );
+	BlendBones( pStudioHdr, s_q1[iRun], s_pos1[iRun], seqdesc, iSequence, s_q2, s_pos2, s, BONE_USED_BY_ANYTHING );
+	ScaleBones( pStudioHdr, s_q1[iRun], s_pos1[iRun], iSequence, s, BONE_USED_BY_ANYTHING );
+}
+
+CON_COMMAND_F( ffdev_boneblend_test, "Compares the SSE bone blending against the scalar code over every sequence of the class models. Usage: ffdev_boneblend_test [tolerance]", FCVAR_CHEAT )
+{
+	if ( !g_pGameRules )
+		return;
+
+	// the 180 degree end of QuaternionScale is badly conditioned, even the scalar
+	// code is only good to a few 1e-4 there, so this is the default rather than 1e-6
+	float flTolerance = ( args.ArgC() > 1 ) ? atof( args[1] ) : 0.0005f;
+
+	ConVarRef anim_simdblend( "anim_simdblend" );
+	bool bWasSIMD = anim_simdblend.GetBool();
+
+	int nFailed = 0;
+	for ( int iClass = CLASS_SCOUT; iClass <= CLASS_CIVILIAN; iClass++ )
+	{
+		const studiohdr_t *pStudioModel = FF_BoneBlendClassModel( iClass );
+		if ( !pStudioModel )
+		{
+			Warning( "%s: couldn't load the model\n", Class_IntToString( iClass ) );
+			continue;
+		}
+
+		CStudioHdr studioHdr( pStudioModel, mdlcache );
+		if ( !studioHdr.IsValid() )
+			continue;
+
+		int nBones = studioHdr.numbones();
+		float flMaxQuatError = 0.0f;
+		float flMaxPosError = 0.0f;
+
+		for ( int iSequence = 0; iSequence < studioHdr.GetNumSeq(); iSequence++ )
+		{
+			FF_BoneBlendRandomPoses( nBones );
+			float s = RandomFloat( 0.01f, 0.99f );
+
+			for ( int iRun = 0; iRun < 2; iRun++ )
+			{
+				memcpy( s_q1[iRun], s_q1Start, nBones * sizeof( Quaternion ) );
+				memcpy( s_pos1[iRun], s_pos1Start, nBones * sizeof( Vector ) );
+
+				anim_simdblend.SetValue( iRun );
+				FF_BoneBlendRun( &studioHdr, iRun, iSequence, s );
+			}
+
+			for ( int i = 0; i < nBones; i++ )
+			{
+				for ( int k = 0; k < 4; k++ )
+					flMaxQuatError = MAX( flMaxQuatError, fabs( s_q1[0][i][k] - s_q1[1][i][k] ) );
+
+				for ( int k = 0; k < 3; k++ )
+					flMaxPosError = MAX( flMaxPosError, fabs( s_pos1[0][i][k] - s_pos1[1][i][k] ) );
+			}
+		}
+
+		bool bPassed = ( flMaxQuatError <= flTolerance && flMaxPosError <= flTolerance );
+		if ( !bPassed )
+			nFailed++;
+
+		Msg( "%-10s %3d bones %4d sequences: max quaternion error %g, max position error %g %s\n", Class_IntToString( iClass ),
+			nBones, studioHdr.GetNumSeq(), flMaxQuatError, flMaxPosError, bPassed ? "" : "FAILED" );
+	}
+
+	anim_simdblend.SetValue( bWasSIMD );
+
+	Msg( nFailed ? "%d models outside the tolerance\n" : "All models within tolerance\n", nFailed );
+}
+
+CON_COMMAND_F( ffdev_boneblend_benchmark, "Times the scalar and SSE bone blending over the class models. Usage: ffdev_boneblend_benchmark [iterations]", FCVAR_CHEAT )
+{
+	if ( !g_pGameRules )
+		return;
+
+	int nIterations = ( args.ArgC() > 1 ) ? clamp( atoi( args[1] ), 1, 100000 ) : 1000;
+
+	ConVarRef anim_simdblend( "anim_simdblend" );
+	bool bWasSIMD = anim_simdblend.GetBool();
+
+	for ( int iClass = CLASS_SCOUT; iClass <= CLASS_CIVILIAN; iClass++ )
+	{
+		const studiohdr_t *pStudioModel = FF_BoneBlendClassModel( iClass );
+		if ( !pStudioModel )
+			continue;
+
+		CStudioHdr studioHdr( pStudioModel, mdlcache );
+		if ( !studioHdr.IsValid() || !studioHdr.GetNumSeq() )
+			continue;
+
+		int nBones = studioHdr.numbones();
+		FF_BoneBlendRandomPoses( nBones );
+
+		float flMilliseconds[2];
+		for ( int iRun = 0; iRun < 2; iRun++ )
+		{
+			anim_simdblend.SetValue( iRun );
+
+			CFastTimer timer;
+			timer.Start();
+			for ( int iIteration = 0; iIteration < nIterations; iIteration++ )
+			{
+				// start from the same pose each time, so the blends don't converge
+				memcpy( s_q1[iRun], s_q1Start, nBones * sizeof( Quaternion ) );
+				memcpy( s_pos1[iRun], s_pos1Start, nBones * sizeof( Vector ) );
+
+				FF_BoneBlendRun( &studioHdr, iRun, iIteration % studioHdr.GetNumSeq(), 0.5f );
+			}
+			timer.End();
+
+			flMilliseconds[iRun] = timer.GetDuration().GetMillisecondsF();
+		}
+
+		Msg( "%-10s %3d bones: scalar %.4f ms, SSE %.4f ms per pass (%.2fx)\n", Class_IntToString( iClass ), nBones,
+			flMilliseconds[0] / nIterations, flMilliseconds[1] / nIterations,
+			( flMilliseconds[1] > 0.0f ) ? flMilliseconds[0] / flMilliseconds[1] : 0.0f );
+	}
+
+	anim_simdblend.SetValue( bWasSIMD );
+}
@@ -0,0 +1,221 @@
+//	=============== Fortress Forever ==============
+//	======== A modification for Half-Life 2 =======
+//
+//	@file ff_playericons.cpp
+//	@brief Batched rendering of the status icons drawn above players
+//
+//	REVISIONS
+//	---------
+//	Icon materials are looked up once per map instead of every
+//	frame, and each player's icons are queued up and drawn with
+//	one mesh per material once all the players have been drawn.
+
+#include "cbase.h"
+#include "ff_playericons.h"
+#include "view.h"
+#include "viewrender.h"
+#include "tier0/vprof.h"
+#include "materialsystem/imesh.h"
+#include "materialsystem/imaterial.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+ConVar ffdev_playericons_batched( "ffdev_playericons_batched", "1", 0, "Draw all the player status icons together once the main view has been drawn, instead of with each player." );
+
+// Must match the order of FFPlayerIcon_t
+static const char *g_pszPlayerIconMaterials[FF_PLAYERICON_COUNT] =
+{
+	"sprites/ff_sprite_teammate",
+	"sprites/ff_sprite_saveme",
+	"sprites/ff_sprite_engyme",
+	"sprites/ff_sprite_ammome",
+	"sprites/ff_sprite_spy",
+	"sprites/ff_sprite_concussed",
+	"sprites/ff_sprite_tranquilized",
+};
+
+static CFFPlayerIconRenderer g_FFPlayerIconRenderer;
+
+CFFPlayerIconRenderer *FFPlayerIcons()
+{
+	return &g_FFPlayerIconRenderer;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CFFPlayerIconRenderer::CFFPlayerIconRenderer() : CAutoGameSystem( "FFPlayerIconRenderer" )
+{
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Look up all the icon materials for this map
+//-----------------------------------------------------------------------------
+void CFFPlayerIconRenderer::LevelInitPreEntity()
+{
+	for (int i = 0; i < FF_PLAYERICON_COUNT; i++)
+	{
+		m_hMaterials[i].Init( g_pszPlayerIconMaterials[i], TEXTURE_GROUP_CLIENT_EFFECTS );
+		m_Sprites[i].RemoveAll();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Throw away anything that didn't get drawn
+//-----------------------------------------------------------------------------
+void CFFPlayerIconRenderer::LevelShutdownPostEntity()
+{
+	for (int i = 0; i < FF_PLAYERICON_COUNT; i++)
+		m_Sprites[i].Purge();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFPlayerIconRenderer::Shutdown()
+{
+	for (int i = 0; i < FF_PLAYERICON_COUNT; i++)
+	{
+		m_hMaterials[i].Shutdown();
+		m_Sprites[i].Purge();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool CFFPlayerIconRenderer::IsValid( FFPlayerIcon_t eIcon ) const
+{
+	return m_hMaterials[eIcon].IsValid();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queue up a sprite to be drawn with the rest of its material
+//-----------------------------------------------------------------------------
+void CFFPlayerIconRenderer::AddIcon( FFPlayerIcon_t eIcon, const Vector &vecOrigin, float flWidth, float flHeight, color32 clr )
+{
+	if (!IsValid( eIcon ))
+		return;
+
+	IconSprite_t &sprite = m_Sprites[eIcon][m_Sprites[eIcon].AddToTail()];
+	sprite.m_vecOrigin = vecOrigin;
+	sprite.m_flHalfWidth = flWidth * 0.5f;
+	sprite.m_flHalfHeight = flHeight * 0.5f;
+	sprite.m_clr = clr;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The icons of players drawn in anything other than the main view
+//			are drawn now, since the main view's flush would put them in the
+//			wrong place (or draw them twice).
+//-----------------------------------------------------------------------------
+void CFFPlayerIconRenderer::EndPlayer()
+{
+	if (!ffdev_playericons_batched.GetBool() || CurrentViewID() != VIEW_MAIN)
+		Flush();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Build one mesh per material out of everything that's been queued.
+//			Each sprite faces the camera the same way DrawSprite() does it.
+//-----------------------------------------------------------------------------
+void CFFPlayerIconRenderer::Flush()
+{
+	VPROF_BUDGET( "CFFPlayerIconRenderer::Flush", VPROF_BUDGETGROUP_PARTICLE_RENDERING );
+
+	CMatRenderContextPtr pRenderContext( materials );
+
+	const Vector &vecViewOrigin = CurrentViewOrigin();
+	const Vector &vecViewUp = CurrentViewUp();
+	const Vector &vecViewRight = CurrentViewRight();
+
+	for (int iIcon = 0; iIcon < FF_PLAYERICON_COUNT; iIcon++)
+	{
+		CUtlVector<IconSprite_t> &sprites = m_Sprites[iIcon];
+		if (sprites.Count() == 0)
+			continue;
+
+		pRenderContext->Bind( m_hMaterials[iIcon] );
+
+		CMeshBuilder meshBuilder;
+		IMesh *pMesh = pRenderContext->GetDynamicMesh();
+
+		int nMaxVerts, nMaxIndices;
+		pRenderContext->GetMaxToRender( pMesh, false, &nMaxVerts, &nMaxIndices );
+		int nMaxQuads = min( nMaxVerts / 4, nMaxIndices / 6 );
+		if (nMaxQuads <= 0)
+		{
+			sprites.RemoveAll();
+			continue;
+		}
+
+		int iSprite = 0;
+		while (iSprite < sprites.Count())
+		{
+			int nQuads = min( sprites.Count() - iSprite, nMaxQuads );
+
+			meshBuilder.Begin( pMesh, MATERIAL_QUADS, nQuads );
+
+			for (int i = 0; i < nQuads; i++, iSprite++)
+			{
+				const IconSprite_t &sprite = sprites[iSprite];
+				unsigned char pColor[4] = { sprite.m_clr.r, sprite.m_clr.g, sprite.m_clr.b, sprite.m_clr.a };
+
+				// Compute direction vectors for the sprite
+				Vector fwd, right( 1, 0, 0 ), up( 0, 1, 0 );
+				VectorSubtract( vecViewOrigin, sprite.m_vecOrigin, fwd );
+				float flDist = VectorNormalize( fwd );
+				if (flDist >= 1e-3)
+				{
+					CrossProduct( vecViewUp, fwd, right );
+					flDist = VectorNormalize( right );
+					if (flDist >= 1e-3)
+					{
+						CrossProduct( fwd, right, up );
+					}
+					else
+					{
+						// Straight above or below us
+						CrossProduct( fwd, vecViewRight, up );
+						VectorNormalize( up );
+						CrossProduct( up, fwd, right );
+					}
+				}
+
+				Vector vecUp = up * sprite.m_flHalfHeight;
+				Vector vecRight = right * sprite.m_flHalfWidth;
+				Vector point;
+
+				meshBuilder.Color4ubv( pColor );
+				meshBuilder.TexCoord2f( 0, 0, 1 );
+				point = sprite.m_vecOrigin - vecUp - vecRight;
+				meshBuilder.Position3fv( point.Base() );
+				meshBuilder.AdvanceVertex();
+
+				meshBuilder.Color4ubv( pColor );
+				meshBuilder.TexCoord2f( 0, 0, 0 );
+				point = sprite.m_vecOrigin + vecUp - vecRight;
+				meshBuilder.Position3fv( point.Base() );
+				meshBuilder.AdvanceVertex();
+
+				meshBuilder.Color4ubv( pColor );
+				meshBuilder.TexCoord2f( 0, 1, 0 );
+				point = sprite.m_vecOrigin + vecUp + vecRight;
+				meshBuilder.Position3fv( point.Base() );
+				meshBuilder.AdvanceVertex();
+
+				meshBuilder.Color4ubv( pColor );
+				meshBuilder.TexCoord2f( 0, 1, 1 );
+				point = sprite.m_vecOrigin - vecUp + vecRight;
+				meshBuilder.Position3fv( point.Base() );
+				meshBuilder.AdvanceVertex();
+			}
+
+			meshBuilder.End();
+			pMesh->Draw();
+		}
+
+		sprites.RemoveAll();
+	}
+}
@@ -0,0 +1,71 @@
+//	=============== Fortress Forever ==============
+//	======== A modification for Half-Life 2 =======
+//
+//	@file ff_playericons.h
+//	@brief Batched rendering of the status icons drawn above players
+//
+//	REVISIONS
+//	---------
+//	Icon materials are looked up once per map instead of every
+//	frame, and each player's icons are queued up and drawn with
+//	one mesh per material once all the players have been drawn.
+
+#ifndef FF_PLAYERICONS_H
+#define FF_PLAYERICONS_H
+
+#include "igamesystem.h"
+#include "utlvector.h"
+#include "materialsystem/MaterialSystemUtil.h"
+
+enum FFPlayerIcon_t
+{
+	FF_PLAYERICON_TEAMMATE = 0,
+	FF_PLAYERICON_SAVEME,
+	FF_PLAYERICON_ENGYME,
+	FF_PLAYERICON_AMMOME,
+	FF_PLAYERICON_SPY,
+	FF_PLAYERICON_CONCUSSED,
+	FF_PLAYERICON_TRANQUILIZED,
+
+	FF_PLAYERICON_COUNT
+};
+
+class CFFPlayerIconRenderer : public CAutoGameSystem
+{
+public:
+	CFFPlayerIconRenderer();
+
+	// CAutoGameSystem
+	virtual void LevelInitPreEntity();
+	virtual void LevelShutdownPostEntity();
+	virtual void Shutdown();
+
+	// Whether the icon material was found
+	bool IsValid( FFPlayerIcon_t eIcon ) const;
+
+	// Queue a camera facing sprite, exactly like DrawSprite() would draw it
+	void AddIcon( FFPlayerIcon_t eIcon, const Vector &vecOrigin, float flWidth, float flHeight, color32 clr );
+
+	// Called once a player has queued all their icons. Only the main view
+	// is batched, anything else (water reflections etc) is drawn straight away.
+	void EndPlayer();
+
+	// Draw everything queued so far, one mesh per material
+	void Flush();
+
+private:
+	struct IconSprite_t
+	{
+		Vector	m_vecOrigin;
+		float	m_flHalfWidth;
+		float	m_flHalfHeight;
+		color32	m_clr;
+	};
+
+	CMaterialReference			m_hMaterials[FF_PLAYERICON_COUNT];
+	CUtlVector<IconSprite_t>	m_Sprites[FF_PLAYERICON_COUNT];
+};
+
+CFFPlayerIconRenderer *FFPlayerIcons();
+
+#endif // FF_PLAYERICONS_H
@@ -66,6 +66,7 @@ protected:
 	bool				m_bEnable;
 
 	CMaterialReference	m_Material;
+	CMaterialReference	m_FrontBuffer;
 
 	float				m_flStart;
 	float				m_flDuration;
@@ -125,6 +126,7 @@ CBaseEffect::~CBaseEffect()
 void CBaseEffect::Init()
 {
 	m_Material.Init(pszEffect(), TEXTURE_GROUP_OTHER);
+	m_FrontBuffer.Init("frontbuffer", TEXTURE_GROUP_OTHER);
 
 	m_bEnable = false;
 }
@@ -136,6 +138,7 @@ void CBaseEffect::Init()
 void CBaseEffect::Shutdown()
 {
 	m_Material.Shutdown();
+	m_FrontBuffer.Shutdown();
 }
 
 //------------------------------------------------------------------------------
@@ -230,7 +233,7 @@ void CBaseEffect::Render(int x, int y, int w, int h)
 	// frontbuffer.vmt is a quick and simple way of getting the.. frontbuffer
 	if (flElapsed < M_PI_2 || flRemaining < M_PI_2)
 	{
-		pMatScreen = materials->FindMaterial("frontbuffer.vmt", TEXTURE_GROUP_OTHER, true);
+		pMatScreen = m_FrontBuffer;
 
 		flInverseAlpha = (flElapsed < M_PI_2 ? flElapsed : flRemaining) / M_PI_2;
 
@@ -292,6 +295,7 @@ private:
 	float				m_flNextSampleTime;
 
 	CTextureReference	m_BlurImage;		
+	CMaterialReference	m_FrontBuffer;
 };
 
 ADD_SCREENSPACE_EFFECT(CMotionBlur, motionblur)
@@ -327,6 +331,8 @@ void CMotionBlur::Init()
 
 	m_BlurImage.InitRenderTarget(256, 256, RT_SIZE_FULL_FRAME_BUFFER,
 		IMAGE_FORMAT_ARGB8888, MATERIAL_RT_DEPTH_NONE, false, "CMotionBlur::Init");
+
+	m_FrontBuffer.Init("frontbuffer", TEXTURE_GROUP_OTHER);
 }
 
 //-----------------------------------------------------------------------------
@@ -335,6 +341,7 @@ void CMotionBlur::Init()
 void CMotionBlur::Shutdown()
 {
 	m_BlurImage.Shutdown();
+	m_FrontBuffer.Shutdown();
 }
 
 //-----------------------------------------------------------------------------
@@ -413,7 +420,7 @@ void CMotionBlur::Render(int x, int y, int w, int h)
 
 	IMaterialVar *pVar = NULL;
 	bool	bFound;
-	IMaterial *pMatScreen = materials->FindMaterial("frontbuffer", TEXTURE_GROUP_OTHER, true);
+	IMaterial *pMatScreen = m_FrontBuffer;
 	ITexture *pOriginalRenderTarget = pMatRenderContext->GetRenderTarget();
 	ITexture *pOriginalTexture = NULL;
 
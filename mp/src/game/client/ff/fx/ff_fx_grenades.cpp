@@ -30,6 +30,7 @@ extern ConVar conc_amplitude;
 extern ConVar conc_speed;
 
 extern ConVar nap_burst_scale;
+extern ConVar nap_batched;
 ConVar nap_burst_gravity("ffdev_nap_burst_gravity","-500.0", FCVAR_CHEAT,"Gravity magnitude for the napalm burst");
 ConVar nap_burst_vel("ffdev_nap_burst_vel","475", FCVAR_CHEAT,"Velocity of the napalm particles.");
 ConVar nap_burst_vel_z_divisor("ffdev_nap_burst_vel_z_divisor","2.0", FCVAR_CHEAT,"How much to divide the linear velocity for napalm particles by for the vertical velocity.");
@@ -117,14 +118,15 @@ void ConcussionExplosionCallback(const CEffectData &data)
 DECLARE_CLIENT_EFFECT( "ConcussionExplosion", ConcussionExplosionCallback )
 
 
-void FF_FX_NapalmBurst( Vector &origin )
+static CSmartPtr<CNapalmEmitter> FF_FX_CreateNapalmBurst( const Vector &origin, IUniformRandomStream *pRandom )
 {
 	float radius = 180.0f;
 	//FF_FX_DrawCircle(origin,radius,CFFGrenadeBase::m_iShockwaveTexture);
 	CSmartPtr<CNapalmEmitter> pEmitter = CNapalmEmitter::Create("NapalmBurst");
 	if(pEmitter == NULL)
-		return;
+		return NULL;
 	pEmitter->SetSortOrigin(origin);
+	pEmitter->SetRandomStream( pRandom );
 
 	pEmitter->SetGravity( Vector(0,0,1), nap_burst_gravity.GetFloat() );
 
@@ -136,27 +138,118 @@ void FF_FX_NapalmBurst( Vector &origin )
 	//psuedo random burst pattern
 	for(float r=radius, offset=0; r>0; r -= 45, offset++)
 	{
-		int iAngleSeed = RandomInt(0,360);
+		int iAngleSeed = pRandom->RandomInt(0,360);
 		for(int iAngle = iAngleSeed; iAngle < (iAngleSeed + 360)/*360*/; iAngle += 60)
 		{
 			pParticle = pEmitter->AddNapalmParticle(origin);
 			if(pParticle)
 			{
-				angle.x = RandomFloat(45,67.5);//67.5f;
+				angle.x = pRandom->RandomFloat(45,67.5);//67.5f;
 				angle.y = (offset*30) + iAngle;
 				angle.z = 0;
 				AngleVectors(angle, &forward, &right, &up);
 
 				velocity = forward * (nap_burst_vel.GetFloat() * ((r) / radius));
-				velocity.z = RandomFloat(100.0f,nap_burst_vel.GetFloat()/nap_burst_vel_z_divisor.GetFloat());
+				velocity.z = pRandom->RandomFloat(100.0f,nap_burst_vel.GetFloat()/nap_burst_vel_z_divisor.GetFloat());
 				pParticle->m_vVelocity = velocity;
-				if(random->RandomInt(0,1))
+				if(pRandom->RandomInt(0,1))
 					pParticle->m_bReverseSize = true;
 				else
 					pParticle->m_bReverseSize = false;
 			}
 		}
 	}
+
+	return pEmitter;
+}
+
+void FF_FX_NapalmBurst( Vector &origin )
+{
+	FF_FX_CreateNapalmBurst( origin, random );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Spawns napalm bursts around the local player and simulates them
+//			at a fixed timestep, in both the legacy and the batched mode,
+//			reporting the simulate time of each. The bursts are drawn from a
+//			private random stream and are removed again afterwards, so the
+//			live effects and the global random streams are left alone.
+//-----------------------------------------------------------------------------
+static void FF_FX_NapalmBenchmarkRun( const Vector &origin, int nEmitters, int nFrames, bool bBatched, float &flMilliseconds, int &nTraces, int &nPointContents, int &nFires )
+{
+	bool bWasBatched = nap_batched.GetBool();
+	nap_batched.SetValue( bBatched );
+
+	// the same bursts for both modes
+	CUniformRandomStream stream;
+	stream.SetSeed( 0x4e41 );
+
+	CUtlVector< CSmartPtr<CNapalmEmitter> > emitters;
+	for ( int i = 0; i < nEmitters; i++ )
+	{
+		Vector vOffset( stream.RandomFloat( -256.0f, 256.0f ), stream.RandomFloat( -256.0f, 256.0f ), 0.0f );
+		CSmartPtr<CNapalmEmitter> pEmitter = FF_FX_CreateNapalmBurst( origin + vOffset, &stream );
+		if ( pEmitter.IsValid() )
+			emitters.AddToTail( pEmitter );
+	}
+
+	CNapalmEmitter::s_nTraces = 0;
+	CNapalmEmitter::s_nPointContents = 0;
+	CNapalmEmitter::s_nFires = 0;
+
+	const float flTimeDelta = 1.0f / 60.0f;
+
+	CFastTimer timer;
+	timer.Start();
+	for ( int iFrame = 0; iFrame < nFrames; iFrame++ )
+	{
+		// the order the particle manager updates an effect in
+		for ( int i = 0; i < emitters.Count(); i++ )
+		{
+			emitters[i]->Update( flTimeDelta );
+			if ( iFrame > 0 )
+				emitters[i]->GetBinding().SimulateParticles( flTimeDelta );
+		}
+	}
+	timer.End();
+
+	flMilliseconds = timer.GetDuration().GetMillisecondsF();
+	nTraces = CNapalmEmitter::s_nTraces;
+	nPointContents = CNapalmEmitter::s_nPointContents;
+	nFires = CNapalmEmitter::s_nFires;
+
+	// the particle manager knows about every emitter, take ours away before it gets to simulate or draw them
+	for ( int i = 0; i < emitters.Count(); i++ )
+	{
+		emitters[i]->SetShouldSimulate( false );
+		emitters[i]->SetRandomStream( random );
+		emitters[i]->GetBinding().SetRemoveFlag();
+	}
+
+	nap_batched.SetValue( bWasBatched );
+}
+
+CON_COMMAND_F( ffdev_nap_benchmark, "Times napalm particle simulation. Usage: ffdev_nap_benchmark [emitters] [frames]", FCVAR_CHEAT )
+{
+	C_BasePlayer *pPlayer = C_BasePlayer::GetLocalPlayer();
+	if ( !pPlayer )
+		return;
+
+	int nEmitters = ( args.ArgC() > 1 ) ? clamp( atoi( args[1] ), 1, 256 ) : 16;
+	int nFrames = ( args.ArgC() > 2 ) ? clamp( atoi( args[2] ), 1, 1000 ) : 180;
+
+	Vector origin = pPlayer->GetAbsOrigin() + Vector( 0, 0, 32.0f );
+
+	for ( int iMode = 0; iMode < 2; iMode++ )
+	{
+		float flMilliseconds;
+		int nTraces, nPointContents, nFires;
+		FF_FX_NapalmBenchmarkRun( origin, nEmitters, nFrames, iMode != 0, flMilliseconds, nTraces, nPointContents, nFires );
+
+		Msg( "%s: %d emitters, %d frames: %.3f ms total, %.4f ms/frame, %.1f traces/frame, %.1f contents/frame, %d fires\n",
+			iMode ? "batched" : "legacy ", nEmitters, nFrames, flMilliseconds, flMilliseconds / nFrames,
+			(float)nTraces / nFrames, (float)nPointContents / nFrames, nFires );
+	}
 }
 
 void NapalmBurstCallback(const CEffectData &data)
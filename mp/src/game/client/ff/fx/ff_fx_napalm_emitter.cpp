@@ -17,6 +17,10 @@
 #include "particles_simple.h"
 #include "ff_fx_napalm_emitter.h"
 #include "ff_grenade_base.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
 
 //========================================================================
 // Static material handles
@@ -25,6 +29,10 @@ PMaterialHandle CNapalmEmitter::m_hMaterial			= INVALID_MATERIAL_HANDLE;
 PMaterialHandle CNapalmEmitter::m_hHeatwaveMaterial	= INVALID_MATERIAL_HANDLE;
 PMaterialHandle CNapalmEmitter::m_hFlameMaterial	= INVALID_MATERIAL_HANDLE;
 
+int CNapalmEmitter::s_nTraces			= 0;
+int CNapalmEmitter::s_nPointContents	= 0;
+int CNapalmEmitter::s_nFires			= 0;
+
 //========================================================================
 // material strings
 //========================================================================
@@ -72,6 +80,24 @@ ConVar nap_burst_scale("ffdev_nap_burst_scale","10", FCVAR_CHEAT,"Napalm burst s
 ConVar nap_burst_dietime("ffdev_nap_burst_dietime","3.0", FCVAR_CHEAT,"Napalm burst particle dietime");
 ConVar nap_burst_flame_scale("ffdev_nap_burst_flame_scale","16.0", FCVAR_CHEAT,"Scale of the flame sprites");
 ConVar nap_burst_flame_time("ffdev_nap_burst_flame_time","5.0", FCVAR_CHEAT,"Burn time for flames");
+ConVar nap_batched("ffdev_nap_batched","1", FCVAR_CHEAT,"Simulate napalm particles in SIMD batches with amortized collision");
+ConVar nap_collision_subsets("ffdev_nap_collision_subsets","2", FCVAR_CHEAT,"Napalm particles are collision tested in this many round-robin subsets, one subset per frame", true, 1, true, 8);
+
+//========================================================================
+// Collision constants
+//========================================================================
+#define NAPALM_RADIUS				180.0f	// particles leaving the burst radius drop straight down
+#define NAPALM_COLLISION_LOOKAHEAD	0.1f	// seconds of travel each collision trace covers
+#define NAPALM_COLLISION_MARGIN		8.0f
+
+// bits of the contents snapshot cells
+#define NAPALM_CELL_KNOWN			0x01
+#define NAPALM_CELL_WATER			0x02
+#define NAPALM_CELL_OPEN_KNOWN		0x04
+#define NAPALM_CELL_OPEN			0x08	// nothing solid anywhere in the cell
+
+// lookahead segments overlapping more cells than this are always traced
+#define NAPALM_OPEN_TEST_CELLS		8
 
 //========================================================================
 // CNapalmEmitter constructor
@@ -84,6 +110,12 @@ CNapalmEmitter::CNapalmEmitter( const char *pDebugName ) : CParticleEffect( pDeb
 	m_flNearClipMax	= 64.0f;
 	m_vGravity = Vector(0,0,0);
 	m_flGravityMagnitude = 0;
+
+	m_iUpdateCount = 0;
+	m_iCollisionFrame = 0;
+	m_bHasSnapshot = false;
+
+	m_pRandom = random;
 }
 
 //========================================================================
@@ -129,6 +161,10 @@ NapalmParticle*	CNapalmEmitter::AddNapalmParticle( const Vector &vOrigin )
 		pRet->m_uchColor[1] = 160;
 		pRet->m_uchColor[2] = 0;
 		pRet->m_bStartFire = true;
+		pRet->m_iSlot = -1;
+
+		// the caller sets the velocity, so the particle joins a batch on the next update
+		m_PendingParticles.AddToTail( pRet );
 	}
 
 	return pRet;
@@ -167,6 +203,22 @@ void CNapalmEmitter::ApplyGravity( NapalmParticle *pParticle, float timeDelta )
 //			well as removing dead particles
 //========================================================================
 void CNapalmEmitter::SimulateParticles( CParticleSimulateIterator *pIterator )
+{
+	VPROF_BUDGET( "CNapalmEmitter::SimulateParticles", VPROF_BUDGETGROUP_PARTICLE_SIMULATION );
+
+	if ( nap_batched.GetBool() )
+		SimulateParticlesBatched( pIterator );
+	else
+		SimulateParticlesLegacy( pIterator );
+}
+
+//========================================================================
+// SimulateParticlesLegacy
+// ----------
+// Purpose: Moves and collides each particle on its own, tracing every
+//			particle every frame
+//========================================================================
+void CNapalmEmitter::SimulateParticlesLegacy( CParticleSimulateIterator *pIterator )
 {
 	float timeDelta = pIterator->GetTimeDelta();
 
@@ -176,6 +228,7 @@ void CNapalmEmitter::SimulateParticles( CParticleSimulateIterator *pIterator )
 		pParticle->m_flLifetime += timeDelta;
 
 		// Kill this particle if it's hit water
+		++s_nPointContents;
 		if (UTIL_PointContents(pParticle->m_Pos) & (CONTENTS_SLIME|CONTENTS_WATER))
 		{
 			pParticle->m_flLifetime = pParticle->m_flDieTime;
@@ -200,6 +253,7 @@ void CNapalmEmitter::SimulateParticles( CParticleSimulateIterator *pIterator )
 				}
 				pParticle->m_Pos += pParticle->m_vVelocity * timeDelta;
 
+				++s_nTraces;
 				trace_t tr;
 				UTIL_TraceLine(
 					pParticle->m_Pos,
@@ -228,6 +282,420 @@ void CNapalmEmitter::SimulateParticles( CParticleSimulateIterator *pIterator )
 	}
 }
 
+//========================================================================
+// Update
+// ----------
+// Purpose: Integrates every batched particle once per frame, before the
+//			particle manager simulates each material
+//========================================================================
+void CNapalmEmitter::Update( float flTimeDelta )
+{
+	BaseClass::Update( flTimeDelta );
+
+	if ( !nap_batched.GetBool() )
+		return;
+
+	VPROF_BUDGET( "CNapalmEmitter::Update", VPROF_BUDGETGROUP_PARTICLE_SIMULATION );
+
+	if ( !m_bHasSnapshot )
+	{
+		BuildCollisionSnapshot();
+	}
+
+	AddPendingParticles();
+
+	// the particle manager doesn't simulate an effect on its first frame
+	if ( m_iUpdateCount++ > 0 )
+	{
+		IntegrateBlocks( flTimeDelta );
+	}
+}
+
+//========================================================================
+// NotifyDestroyParticle
+// ----------
+// Purpose: Releases the batch lane of a particle as it is destroyed
+//========================================================================
+void CNapalmEmitter::NotifyDestroyParticle( Particle *pParticle )
+{
+	NapalmParticle *pNapalm = (NapalmParticle *)pParticle;
+
+	if ( pNapalm->m_iType == eNapalmParticle )
+	{
+		if ( pNapalm->m_iSlot >= 0 )
+		{
+			FreeSlot( pNapalm->m_iSlot );
+		}
+		else
+		{
+			m_PendingParticles.FindAndRemove( pNapalm );
+		}
+	}
+
+	BaseClass::NotifyDestroyParticle( pParticle );
+}
+
+//========================================================================
+// AddPendingParticles
+// ----------
+// Purpose: Gives the particles added since the last update a batch lane
+//========================================================================
+void CNapalmEmitter::AddPendingParticles( void )
+{
+	for ( int i = 0; i < m_PendingParticles.Count(); i++ )
+	{
+		NapalmParticle *pParticle = m_PendingParticles[i];
+
+		int iSlot;
+		if ( m_FreeSlots.Count() )
+		{
+			iSlot = m_FreeSlots.Tail();
+			m_FreeSlots.RemoveMultipleFromTail( 1 );
+		}
+		else
+		{
+			// open a new block, and keep its spare lanes for later particles
+			int iBlock = m_Blocks.AddToTail();
+			V_memset( &m_Blocks[iBlock], 0, sizeof( NapalmBlock_t ) );
+			m_NearSurface.AddToTail( 0 );
+
+			iSlot = iBlock * 4;
+			m_SlotParticles.AddMultipleToTail( 4 );
+			for ( int iLane = 3; iLane > 0; iLane-- )
+			{
+				m_SlotParticles[iSlot + iLane] = NULL;
+				m_FreeSlots.AddToTail( iSlot + iLane );
+			}
+		}
+
+		NapalmBlock_t &block = m_Blocks[iSlot >> 2];
+		int iLane = iSlot & 3;
+
+		SubFloat( block.x, iLane ) = pParticle->m_Pos.x;
+		SubFloat( block.y, iLane ) = pParticle->m_Pos.y;
+		SubFloat( block.z, iLane ) = pParticle->m_Pos.z;
+		SubFloat( block.vx, iLane ) = pParticle->m_vVelocity.x;
+		SubFloat( block.vy, iLane ) = pParticle->m_vVelocity.y;
+		SubFloat( block.vz, iLane ) = pParticle->m_vVelocity.z;
+
+		m_SlotParticles[iSlot] = pParticle;
+		pParticle->m_iSlot = iSlot;
+	}
+
+	m_PendingParticles.RemoveAll();
+}
+
+//========================================================================
+// FreeSlot
+// ----------
+// Purpose: Parks a lane so it can be reused. Free lanes keep being
+//			integrated with the rest of their block, so they are zeroed.
+//========================================================================
+void CNapalmEmitter::FreeSlot( int iSlot )
+{
+	NapalmBlock_t &block = m_Blocks[iSlot >> 2];
+	int iLane = iSlot & 3;
+
+	SubFloat( block.vx, iLane ) = 0.0f;
+	SubFloat( block.vy, iLane ) = 0.0f;
+	SubFloat( block.vz, iLane ) = 0.0f;
+
+	m_SlotParticles[iSlot] = NULL;
+	m_FreeSlots.AddToTail( iSlot );
+}
+
+//========================================================================
+// IntegrateBlocks
+// ----------
+// Purpose: Applies gravity and moves every batched particle, four at a
+//			time, and flags the ones close enough to the ground plane
+//			to need a collision trace
+//========================================================================
+void CNapalmEmitter::IntegrateBlocks( float flTimeDelta )
+{
+	const fltx4 dt = ReplicateX4( flTimeDelta );
+
+	Vector vGravity = m_vGravity * ( m_flGravityMagnitude * flTimeDelta );
+	const fltx4 gx = ReplicateX4( vGravity.x );
+	const fltx4 gy = ReplicateX4( vGravity.y );
+	const fltx4 gz = ReplicateX4( vGravity.z );
+
+	const fltx4 ox = ReplicateX4( m_vSortOrigin.x );
+	const fltx4 oy = ReplicateX4( m_vSortOrigin.y );
+	const fltx4 oz = ReplicateX4( m_vSortOrigin.z );
+	const fltx4 radiusSqr = ReplicateX4( NAPALM_RADIUS * NAPALM_RADIUS );
+
+	const fltx4 nx = ReplicateX4( m_vGroundNormal.x );
+	const fltx4 ny = ReplicateX4( m_vGroundNormal.y );
+	const fltx4 nz = ReplicateX4( m_vGroundNormal.z );
+	const fltx4 dist = ReplicateX4( m_flGroundDist );
+
+	// a collision trace covers the lookahead, and a particle may wait a few frames for its turn
+	float flLookahead = MAX( NAPALM_COLLISION_LOOKAHEAD, nap_collision_subsets.GetInt() * flTimeDelta );
+	const fltx4 lookahead = ReplicateX4( flLookahead );
+	const fltx4 margin = ReplicateX4( NAPALM_COLLISION_MARGIN );
+
+	for ( int i = 0; i < m_Blocks.Count(); i++ )
+	{
+		NapalmBlock_t &block = m_Blocks[i];
+
+		fltx4 vx = AddSIMD( block.vx, gx );
+		fltx4 vy = AddSIMD( block.vy, gy );
+		fltx4 vz = AddSIMD( block.vz, gz );
+
+		// if this particle has moved outside of the grenade explosion radius, make it drop straight down
+		fltx4 dx = SubSIMD( ox, MaddSIMD( vx, dt, block.x ) );
+		fltx4 dy = SubSIMD( oy, MaddSIMD( vy, dt, block.y ) );
+		fltx4 dz = SubSIMD( oz, MaddSIMD( vz, dt, block.z ) );
+		fltx4 distSqr = MaddSIMD( dx, dx, MaddSIMD( dy, dy, MulSIMD( dz, dz ) ) );
+		fltx4 outside = CmpGtSIMD( distSqr, radiusSqr );
+		vx = MaskedAssign( outside, Four_Zeros, vx );
+		vy = MaskedAssign( outside, Four_Zeros, vy );
+
+		block.x = MaddSIMD( vx, dt, block.x );
+		block.y = MaddSIMD( vy, dt, block.y );
+		block.z = MaddSIMD( vz, dt, block.z );
+		block.vx = vx;
+		block.vy = vy;
+		block.vz = vz;
+
+		// |v|1 >= |v|, so this never misses a particle that can reach the plane within the lookahead
+		fltx4 speed = AddSIMD( MaxSIMD( vx, SubSIMD( Four_Zeros, vx ) ),
+							   AddSIMD( MaxSIMD( vy, SubSIMD( Four_Zeros, vy ) ), MaxSIMD( vz, SubSIMD( Four_Zeros, vz ) ) ) );
+		fltx4 height = SubSIMD( MaddSIMD( nx, block.x, MaddSIMD( ny, block.y, MulSIMD( nz, block.z ) ) ), dist );
+		fltx4 nearMask = CmpLtSIMD( height, MaddSIMD( speed, lookahead, margin ) );
+
+		m_NearSurface[i] = (unsigned char)TestSignSIMD( nearMask );
+	}
+}
+
+//========================================================================
+// BuildCollisionSnapshot
+// ----------
+// Purpose: Caches the ground plane under the burst, and clears the
+//			contents cells around it to be filled on demand
+//========================================================================
+void CNapalmEmitter::BuildCollisionSnapshot( void )
+{
+	m_bHasSnapshot = true;
+
+	++s_nTraces;
+	trace_t tr;
+	UTIL_TraceLine( m_vSortOrigin, m_vSortOrigin - Vector( 0, 0, 1024.0f ), MASK_SOLID, NULL, COLLISION_GROUP_NONE, &tr );
+
+	if ( tr.fraction < 1.0f && !tr.startsolid )
+	{
+		m_vGroundNormal = tr.plane.normal;
+		m_flGroundDist = DotProduct( tr.plane.normal, tr.endpos );
+	}
+	else
+	{
+		// nothing below - every particle gets traced when its turn comes
+		m_vGroundNormal.Init( 0, 0, 1 );
+		m_flGroundDist = FLT_MAX;
+	}
+
+	// the burst falls, so most of the snapshot lies below its origin
+	const float flSpan = NAPALM_CONTENTS_CELLS * NAPALM_CONTENTS_CELL_SIZE;
+	m_vContentsMins = m_vSortOrigin - Vector( flSpan * 0.5f, flSpan * 0.5f, flSpan * 0.75f );
+
+	V_memset( m_Contents, 0, sizeof( m_Contents ) );
+}
+
+//========================================================================
+// GetCachedContents
+// ----------
+// Purpose: Returns the water contents at a point from the snapshot cell
+//			that holds it, sampling the cell the first time it is used
+//========================================================================
+int CNapalmEmitter::GetCachedContents( const Vector &vPos )
+{
+	Vector vCell = ( vPos - m_vContentsMins ) * ( 1.0f / NAPALM_CONTENTS_CELL_SIZE );
+	int x = (int)floor( vCell.x );
+	int y = (int)floor( vCell.y );
+	int z = (int)floor( vCell.z );
+
+	if ( x < 0 || y < 0 || z < 0 || x >= NAPALM_CONTENTS_CELLS || y >= NAPALM_CONTENTS_CELLS || z >= NAPALM_CONTENTS_CELLS )
+	{
+		++s_nPointContents;
+		return UTIL_PointContents( vPos );
+	}
+
+	unsigned char &cell = m_Contents[ ( z * NAPALM_CONTENTS_CELLS + y ) * NAPALM_CONTENTS_CELLS + x ];
+	if ( !( cell & NAPALM_CELL_KNOWN ) )
+	{
+		Vector vCenter = m_vContentsMins + Vector( x + 0.5f, y + 0.5f, z + 0.5f ) * NAPALM_CONTENTS_CELL_SIZE;
+
+		++s_nPointContents;
+		int contents = UTIL_PointContents( vCenter );
+
+		cell |= NAPALM_CELL_KNOWN;
+		if ( contents & ( CONTENTS_SLIME | CONTENTS_WATER ) )
+			cell |= NAPALM_CELL_WATER;
+	}
+
+	return ( cell & NAPALM_CELL_WATER ) ? CONTENTS_WATER : 0;
+}
+
+//========================================================================
+// IsCellOpen
+// ----------
+// Purpose: Returns true if nothing solid overlaps the whole snapshot
+//			cell, testing the cell's box the first time it is asked
+//========================================================================
+bool CNapalmEmitter::IsCellOpen( int x, int y, int z )
+{
+	if ( x < 0 || y < 0 || z < 0 || x >= NAPALM_CONTENTS_CELLS || y >= NAPALM_CONTENTS_CELLS || z >= NAPALM_CONTENTS_CELLS )
+		return false;
+
+	unsigned char &cell = m_Contents[ ( z * NAPALM_CONTENTS_CELLS + y ) * NAPALM_CONTENTS_CELLS + x ];
+	if ( !( cell & NAPALM_CELL_OPEN_KNOWN ) )
+	{
+		const Vector vHalf( NAPALM_CONTENTS_CELL_SIZE * 0.5f, NAPALM_CONTENTS_CELL_SIZE * 0.5f, NAPALM_CONTENTS_CELL_SIZE * 0.5f );
+		Vector vCenter = m_vContentsMins + Vector( x + 0.5f, y + 0.5f, z + 0.5f ) * NAPALM_CONTENTS_CELL_SIZE;
+
+		++s_nTraces;
+		trace_t tr;
+		UTIL_TraceHull( vCenter, vCenter, -vHalf, vHalf, MASK_SOLID, NULL, COLLISION_GROUP_NONE, &tr );
+
+		cell |= NAPALM_CELL_OPEN_KNOWN;
+		if ( !tr.startsolid && !tr.allsolid )
+			cell |= NAPALM_CELL_OPEN;
+	}
+
+	return ( cell & NAPALM_CELL_OPEN ) != 0;
+}
+
+//========================================================================
+// IsSegmentOpen
+// ----------
+// Purpose: Returns true if every snapshot cell the segment's bounds
+//			overlap is open, so a trace along it can't hit anything.
+//			Anything else, walls and thin brushes included, gets traced.
+//========================================================================
+bool CNapalmEmitter::IsSegmentOpen( const Vector &vStart, const Vector &vEnd )
+{
+	Vector vMins, vMaxs;
+	VectorMin( vStart, vEnd, vMins );
+	VectorMax( vStart, vEnd, vMaxs );
+
+	// a point on a cell face belongs to both cells
+	const Vector vEpsilon( 1.0f, 1.0f, 1.0f );
+	vMins = ( vMins - vEpsilon - m_vContentsMins ) * ( 1.0f / NAPALM_CONTENTS_CELL_SIZE );
+	vMaxs = ( vMaxs + vEpsilon - m_vContentsMins ) * ( 1.0f / NAPALM_CONTENTS_CELL_SIZE );
+
+	int x0 = (int)floor( vMins.x ), x1 = (int)floor( vMaxs.x );
+	int y0 = (int)floor( vMins.y ), y1 = (int)floor( vMaxs.y );
+	int z0 = (int)floor( vMins.z ), z1 = (int)floor( vMaxs.z );
+
+	if ( ( x1 - x0 + 1 ) * ( y1 - y0 + 1 ) * ( z1 - z0 + 1 ) > NAPALM_OPEN_TEST_CELLS )
+		return false;
+
+	for ( int z = z0; z <= z1; z++ )
+	{
+		for ( int y = y0; y <= y1; y++ )
+		{
+			for ( int x = x0; x <= x1; x++ )
+			{
+				if ( !IsCellOpen( x, y, z ) )
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+//========================================================================
+// SimulateParticlesBatched
+// ----------
+// Purpose: Ages the particles and handles their collisions. Movement has
+//			already been done by IntegrateBlocks(); here each frame only
+//			one round-robin subset of the particles is collision tested.
+//			Those whose lookahead stays inside cells known to be empty
+//			skip the trace, every other one is traced like the legacy path.
+//========================================================================
+void CNapalmEmitter::SimulateParticlesBatched( CParticleSimulateIterator *pIterator )
+{
+	float timeDelta = pIterator->GetTimeDelta();
+
+	int iSubsets = nap_collision_subsets.GetInt();
+	int iSubset = -1;
+
+	// a particle waits iSubsets frames for its next turn, so its trace has to reach that far
+	float flLookahead = MAX( NAPALM_COLLISION_LOOKAHEAD, iSubsets * timeDelta );
+
+	NapalmParticle *pParticle = (NapalmParticle*)pIterator->GetFirst();
+	while ( pParticle )
+	{
+		pParticle->m_flLifetime += timeDelta;
+
+		int iSlot = pParticle->m_iSlot;
+		bool bBatched = ( pParticle->m_iType == eNapalmParticle && iSlot >= 0 );
+
+		if ( bBatched )
+		{
+			const NapalmBlock_t &block = m_Blocks[iSlot >> 2];
+			int iLane = iSlot & 3;
+
+			pParticle->m_Pos.Init( SubFloat( block.x, iLane ), SubFloat( block.y, iLane ), SubFloat( block.z, iLane ) );
+			pParticle->m_vVelocity.Init( SubFloat( block.vx, iLane ), SubFloat( block.vy, iLane ), SubFloat( block.vz, iLane ) );
+
+			// Kill this particle if it's hit water (flames are checked once, when they start)
+			if ( GetCachedContents( pParticle->m_Pos ) & CONTENTS_WATER )
+			{
+				pParticle->m_flLifetime = pParticle->m_flDieTime;
+			}
+		}
+
+		if ( pParticle->m_flLifetime >= pParticle->m_flDieTime )
+		{
+			pIterator->RemoveParticle( pParticle );
+		}
+		else if ( bBatched )
+		{
+			// the napalm material is simulated once per frame, so step the round-robin here
+			if ( iSubset < 0 )
+			{
+				iSubset = m_iCollisionFrame++ % iSubsets;
+			}
+
+			if ( ( iSlot % iSubsets ) == iSubset )
+			{
+				Vector vEnd = pParticle->m_Pos + ( pParticle->m_vVelocity * flLookahead );
+
+				// near the ground plane always traces, without looking at the cells
+				bool bNeedsTrace = ( m_NearSurface[iSlot >> 2] & ( 1 << ( iSlot & 3 ) ) ) != 0;
+				if ( !bNeedsTrace )
+				{
+					bNeedsTrace = !IsSegmentOpen( pParticle->m_Pos, vEnd );
+				}
+
+				if ( bNeedsTrace )
+				{
+					++s_nTraces;
+					trace_t tr;
+					UTIL_TraceLine( pParticle->m_Pos, vEnd, MASK_SOLID, NULL, COLLISION_GROUP_NONE, &tr );
+					if ( tr.fraction != 1.0 )
+					{
+						NapalmBlock_t &block = m_Blocks[iSlot >> 2];
+						SubFloat( block.vx, iSlot & 3 ) = 0.0f;
+						SubFloat( block.vy, iSlot & 3 ) = 0.0f;
+
+						if ( pParticle->m_bStartFire )
+						{
+							pIterator->RemoveParticle( pParticle );
+							StartFire( tr.endpos );
+						}
+					}
+				}
+			}
+		}
+
+		pParticle = (NapalmParticle*)pIterator->GetNext();
+	}
+}
+
 // Render a quad on the screen where you pass in color and size.
 inline void RenderParticle_ColorSizeFrame(
 									 ParticleDraw* pDraw,									
@@ -340,6 +808,12 @@ void CNapalmEmitter::RenderParticles( CParticleRenderIterator *pIterator )
 
 void CNapalmEmitter::StartFire(const Vector &pos)
 {
+	// flames don't move, so one contents check does for their whole life
+	if ( nap_batched.GetBool() && m_bHasSnapshot && ( GetCachedContents( pos ) & CONTENTS_WATER ) )
+		return;
+
+	++s_nFires;
+
 	NapalmParticle *pFireParticle = (NapalmParticle*)AddParticle( sizeof( NapalmParticle ), m_hFlameMaterial,pos );
 	if ( pFireParticle )
 	{
@@ -347,13 +821,14 @@ void CNapalmEmitter::StartFire(const Vector &pos)
 		pFireParticle->m_Pos = pos;
 		pFireParticle->m_vVelocity.Init();
 		pFireParticle->m_flLifetime = 0;
-		pFireParticle->m_flDieTime = nap_burst_flame_time.GetFloat() * random->RandomFloat(0.7f, 1.3f);
+		pFireParticle->m_flDieTime = nap_burst_flame_time.GetFloat() * m_pRandom->RandomFloat(0.7f, 1.3f);
 		pFireParticle->m_uchColor[0] = 255;
 		pFireParticle->m_uchColor[1] = 
-		pFireParticle->m_uchColor[2] = random->RandomInt(160, 255);
-		pFireParticle->m_uchColor[3] = random->RandomInt(230, 250);
+		pFireParticle->m_uchColor[2] = m_pRandom->RandomInt(160, 255);
+		pFireParticle->m_uchColor[3] = m_pRandom->RandomInt(230, 250);
 		pFireParticle->m_bStartFire = false;
-		pFireParticle->m_flScale = nap_burst_flame_scale.GetFloat() * random->RandomFloat(0.7f, 1.3f);
+		pFireParticle->m_iSlot = -1;
+		pFireParticle->m_flScale = nap_burst_flame_scale.GetFloat() * m_pRandom->RandomFloat(0.7f, 1.3f);
 	}
 	/*NapalmParticle *pHeatParticle = (NapalmParticle*)AddParticle( sizeof( NapalmParticle ), m_hHeatwaveMaterial, pos );
 	if(pHeatParticle)
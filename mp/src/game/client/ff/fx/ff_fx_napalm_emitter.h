@@ -15,6 +15,10 @@
 #ifndef FF_FX_NAPALM_EMITTER_H
 #define FF_FX_NAPALM_EMITTER_H
 
+#include "mathlib/ssemath.h"
+
+class IUniformRandomStream;
+
 enum NapalmParticleType
 {
 	eNapalmParticle,
@@ -35,8 +39,13 @@ public:
 	bool			m_bStartFire;
 	bool			m_bReverseSize;
 	float			m_flScale;
+	int				m_iSlot;		// lane of this particle in the emitter's batched state, or -1
 };
 
+// Cells of the cached contents snapshot around each emitter
+#define NAPALM_CONTENTS_CELL_SIZE	16.0f
+#define NAPALM_CONTENTS_CELLS		24
+
 class CNapalmEmitter : public CParticleEffect
 {
 public:
@@ -46,6 +55,8 @@ public:
 
 	virtual void SimulateParticles	( CParticleSimulateIterator *pIterator );
 	virtual void RenderParticles	( CParticleRenderIterator *pIterator );
+	virtual void Update				( float flTimeDelta );
+	virtual void NotifyDestroyParticle( Particle *pParticle );
 
 	NapalmParticle*	AddNapalmParticle( const Vector &vOrigin);
 
@@ -55,6 +66,14 @@ public:
 	
 	void StartFire(const Vector &pos);
 
+	// Stream the flames are randomized from, the global one unless set
+	void SetRandomStream( IUniformRandomStream *pRandom ) { m_pRandom = pRandom; }
+
+	// Counters for ffdev_nap_benchmark
+	static int	s_nTraces;
+	static int	s_nPointContents;
+	static int	s_nFires;
+
 protected:
 	CNapalmEmitter( const char *pDebugName );
 	virtual			~CNapalmEmitter();
@@ -64,6 +83,43 @@ private:
 
 	void ApplyGravity(NapalmParticle *pParticle, float flTimeDelta);
 
+	void SimulateParticlesLegacy	( CParticleSimulateIterator *pIterator );
+	void SimulateParticlesBatched	( CParticleSimulateIterator *pIterator );
+
+	// Batched simulation state: particles that move are kept four to a block,
+	// one SIMD lane each, and integrated together once per frame in Update()
+	struct NapalmBlock_t
+	{
+		fltx4 x, y, z;
+		fltx4 vx, vy, vz;
+	};
+
+	void	AddPendingParticles( void );
+	void	FreeSlot( int iSlot );
+	void	IntegrateBlocks( float flTimeDelta );
+	void	BuildCollisionSnapshot( void );
+	int		GetCachedContents( const Vector &vPos );
+	bool	IsCellOpen( int x, int y, int z );
+	bool	IsSegmentOpen( const Vector &vStart, const Vector &vEnd );
+
+	CUtlVector< NapalmBlock_t, CUtlMemoryAligned< NapalmBlock_t, 16 > > m_Blocks;
+	CUtlVector< unsigned char >	m_NearSurface;		// per block, a bit for each lane within reach of the ground plane
+	CUtlVector< NapalmParticle * > m_SlotParticles;	// per lane, NULL when free
+	CUtlVector< int >			m_FreeSlots;
+	CUtlVector< NapalmParticle * > m_PendingParticles;	// added since the last update, velocity not yet known
+
+	int			m_iUpdateCount;
+	int			m_iCollisionFrame;
+
+	// Collision snapshot, taken on the first update
+	bool		m_bHasSnapshot;
+	Vector		m_vGroundNormal;
+	float		m_flGroundDist;
+	Vector		m_vContentsMins;
+	unsigned char m_Contents[ NAPALM_CONTENTS_CELLS * NAPALM_CONTENTS_CELLS * NAPALM_CONTENTS_CELLS ];
+
+	IUniformRandomStream *m_pRandom;
+
 	float m_flNearClipMin;
 	float m_flNearClipMax;
 	Vector m_vGravity;
@@ -140,23 +140,11 @@ void CHudLua::MsgFunc_FF_HudLua(bf_read &msg)
 		
 	case HUD_BOX:
 		{
-			int xPos = msg.ReadShort();
-			int yPos = msg.ReadShort();
-			int iWidth = msg.ReadShort();
-			int iHeight = msg.ReadShort();
-			int iRed = msg.ReadShort();
-			int iGreen = msg.ReadShort();
-			int iBlue = msg.ReadShort();
-			int iAlpha = msg.ReadShort();
-			int iBorderRed = msg.ReadShort();
-			int iBorderGreen = msg.ReadShort();
-			int iBorderBlue = msg.ReadShort();
-			int iBorderAlpha = msg.ReadShort();
-			int iBorderWidth = msg.ReadShort();
-			int iAlignX = msg.ReadShort();
-			int iAlignY = msg.ReadShort();
+			// x, y, width, height, color, border color, border width, x and y alignment
+			int v[15];
+			msg.ReadSBitLongs(v, ARRAYSIZE(v), sizeof(short) << 3);
 
-			HudBox(hudIdentifier, xPos, yPos, iWidth, iHeight, Color(iRed,iGreen,iBlue,iAlpha), Color(iBorderRed,iBorderGreen,iBorderBlue,iBorderAlpha), iBorderWidth, iAlignX, iAlignY);
+			HudBox(hudIdentifier, v[0], v[1], v[2], v[3], Color(v[4],v[5],v[6],v[7]), Color(v[8],v[9],v[10],v[11]), v[12], v[13], v[14]);
 
 			break;
 		}
@@ -188,16 +176,11 @@ void CHudLua::MsgFunc_FF_HudLua(bf_read &msg)
 			if (!msg.ReadString(szText, 255))
 				return;
 
-			int r = msg.ReadShort();
-			int g = msg.ReadShort();
-			int b = msg.ReadShort();
-			int a = msg.ReadShort();
-
-			int iAlignX = msg.ReadShort();
-			int iAlignY = msg.ReadShort();
-			int iSize = msg.ReadShort();
+			// color, x and y alignment, size
+			int v[7];
+			msg.ReadSBitLongs(v, ARRAYSIZE(v), sizeof(short) << 3);
 
-			HudTextColored(hudIdentifier, xPos, yPos, szText, iAlignX, iAlignY, iSize, Color(r, g, b, a));
+			HudTextColored(hudIdentifier, xPos, yPos, szText, v[4], v[5], v[6], Color(v[0], v[1], v[2], v[3]));
 
 			break;
 		}
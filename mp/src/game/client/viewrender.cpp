@@ -55,6 +55,7 @@
 #include "client_virtualreality.h"
 
 #include "ff_vieweffects.h"
+#include "ff_playericons.h"
 
 #ifdef PORTAL
 //#include "C_Portal_Player.h"
@@ -1805,6 +1806,9 @@ void CViewRender::RenderPlayerSprites()
 	tmZone( TELEMETRY_LEVEL0, TMZF_NONE, "%s", __FUNCTION__ );
 
 	GetClientVoiceMgr()->DrawHeadLabels();
+
+	// FF player status icons, batched up while the players were drawn
+	FFPlayerIcons()->Flush();
 }
 
 //-----------------------------------------------------------------------------
@@ -1234,6 +1234,26 @@ float CBaseAnimating::SetPoseParameter( CStudioHdr *pStudioHdr, int iParameter,
 	return flValue;
 }
 
+// --> FF
+float CBaseAnimating::SetPoseParameterUnsent( int iParameter, float flValue )
+{
+	CStudioHdr *pStudioHdr = GetModelPtr();
+	if ( !pStudioHdr || iParameter < 0 )
+		return flValue;
+
+	float flNewValue;
+	flValue = Studio_SetPoseParameter( pStudioHdr, iParameter, flValue, flNewValue );
+	const_cast< float * >( m_flPoseParameter.Base() )[ iParameter ] = flNewValue;
+	return flValue;
+}
+
+void CBaseAnimating::NetworkPoseParameter( int iParameter )
+{
+	if ( iParameter >= 0 )
+		m_flPoseParameter.GetForModify( iParameter );
+}
+// <-- FF
+
 //=========================================================
 //=========================================================
 float CBaseAnimating::GetPoseParameter( const char *szName )
@@ -2582,6 +2602,20 @@ void CBaseAnimating::UnlockStudioHdr()
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: the bones the shared bone cache holds
+//-----------------------------------------------------------------------------
+int CBaseAnimating::GetBoneCacheMask( void ) const
+{
+	int boneMask = BONE_USED_BY_HITBOX | BONE_USED_BY_ATTACHMENT;
+
+	// TF queries these bones to position weapons when players are killed
+#if defined( TF_DLL )
+	boneMask |= BONE_USED_BY_BONE_MERGE;
+#endif
+	return boneMask;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: return the index to the shared bone cache
 // Output :
@@ -2592,12 +2626,8 @@ CBoneCache *CBaseAnimating::GetBoneCache( void )
 	Assert(pStudioHdr);
 
 	CBoneCache *pcache = Studio_GetBoneCache( m_boneCacheHandle );
-	int boneMask = BONE_USED_BY_HITBOX | BONE_USED_BY_ATTACHMENT;
+	int boneMask = GetBoneCacheMask();
 
-	// TF queries these bones to position weapons when players are killed
-#if defined( TF_DLL )
-	boneMask |= BONE_USED_BY_BONE_MERGE;
-#endif
 	if ( pcache )
 	{
 		if ( pcache->IsValid( gpGlobals->curtime ) && (pcache->m_boneMask & boneMask) == boneMask && pcache->m_timeValid <= gpGlobals->curtime)
@@ -2606,36 +2636,53 @@ CBoneCache *CBaseAnimating::GetBoneCache( void )
 			// in memory and still valid, use it!
 			return pcache;
 		}
-		// in memory, but missing some of the bone masks
-		if ( (pcache->m_boneMask & boneMask) != boneMask )
-		{
-			Studio_DestroyBoneCache( m_boneCacheHandle );
-			m_boneCacheHandle = 0;
-			pcache = NULL;
-		}
 	}
 
 	matrix3x4_t bonetoworld[MAXSTUDIOBONES];
 	SetupBones( bonetoworld, boneMask );
+	SetBoneCache( bonetoworld );
+
+	pcache = Studio_GetBoneCache( m_boneCacheHandle );
+	Assert(pcache);
+	return pcache;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: fill the shared bone cache with bones that have already been set
+//			up with GetBoneCacheMask(), as of the current time
+//-----------------------------------------------------------------------------
+void CBaseAnimating::SetBoneCache( const matrix3x4_t *pBoneToWorld )
+{
+	CStudioHdr *pStudioHdr = GetModelPtr( );
+	if ( !pStudioHdr )
+		return;
+
+	CBoneCache *pcache = Studio_GetBoneCache( m_boneCacheHandle );
+	int boneMask = GetBoneCacheMask();
+
+	// in memory, but missing some of the bone masks
+	if ( pcache && (pcache->m_boneMask & boneMask) != boneMask )
+	{
+		Studio_DestroyBoneCache( m_boneCacheHandle );
+		m_boneCacheHandle = 0;
+		pcache = NULL;
+	}
 
 	if ( pcache )
 	{
 		// still in memory but out of date, refresh the bones.
-		pcache->UpdateBones( bonetoworld, pStudioHdr->numbones(), gpGlobals->curtime );
+		pcache->UpdateBones( pBoneToWorld, pStudioHdr->numbones(), gpGlobals->curtime );
 	}
 	else
 	{
 		bonecacheparams_t params;
 		params.pStudioHdr = pStudioHdr;
-		params.pBoneToWorld = bonetoworld;
+		params.pBoneToWorld = const_cast< matrix3x4_t * >( pBoneToWorld );
 		params.curtime = gpGlobals->curtime;
 		params.boneMask = boneMask;
 
 		m_boneCacheHandle = Studio_CreateBoneCache( params );
-		pcache = Studio_GetBoneCache( m_boneCacheHandle );
 	}
-	Assert(pcache);
-	return pcache;
 }
 
 
@@ -150,6 +150,12 @@ public:
 	inline float SetPoseParameter( const char *szName, float flValue ) { return SetPoseParameter( GetModelPtr(), szName, flValue ); }
 	float	SetPoseParameter( CStudioHdr *pStudioHdr, int iParameter, float flValue );
 	inline float SetPoseParameter( int iParameter, float flValue ) { return SetPoseParameter( GetModelPtr(), iParameter, flValue ); }
+	// --> FF
+	// Sets a pose parameter for the server's own bone setup and attachments without marking
+	// it for sending. NetworkPoseParameter marks it when clients should get it.
+	float	SetPoseParameterUnsent( int iParameter, float flValue );
+	void	NetworkPoseParameter( int iParameter );
+	// <-- FF
 
 	float	GetPoseParameter( const char *szName );
 	float	GetPoseParameter( int iParameter );
@@ -258,6 +264,8 @@ public:
 	virtual bool TestCollision( const Ray_t &ray, unsigned int fContentsMask, trace_t& tr );
 	virtual bool TestHitboxes( const Ray_t &ray, unsigned int fContentsMask, trace_t& tr );
 	class CBoneCache *GetBoneCache( void );
+	int GetBoneCacheMask( void ) const;
+	void SetBoneCache( const matrix3x4_t *pBoneToWorld );
 	void InvalidateBoneCache();
 	void InvalidateBoneCacheIfOlderThan( float deltaTime );
 	virtual int DrawDebugTextOverlays( void );
@@ -275,6 +283,7 @@ public:
 	// also calculate IK on server? (always done on client)
 	void EnableServerIK();
 	void DisableServerIK();
+	bool IsServerIKEnabled() const { return m_pIk != NULL; }
 
 	// for ragdoll vs. car
 	int GetHitboxesFrontside( int *boxList, int boxMax, const Vector &normal, float dist );
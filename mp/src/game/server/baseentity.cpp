@@ -68,6 +68,7 @@
 
 #include "ff_luacontext.h" // FF
 #include "ff_scriptman.h" // FF
+#include "ff_mapsnapshot.h" // FF
 
 // Lua includes
 extern "C"
@@ -3065,6 +3066,12 @@ FORCEINLINE bool NamesMatch( const char *pszQuery, string_t nameToMatch )
 	return false;
 }
 
+void CBaseEntity::SetName( string_t newName )
+{
+	m_iName = newName;
+	gEntList.OnEntityNameChanged( this );
+}
+
 bool CBaseEntity::NameMatchesComplex( const char *pszNameOrWildcard )
 {
 	if ( !Q_stricmp( "!player", pszNameOrWildcard) )
@@ -3944,6 +3951,9 @@ bool CBaseEntity::AcceptInput( const char *szInputName, CBaseEntity *pActivator,
 	Q_strlower(buf);
 	_scriptman.RunPredicates_LUA(this, &hInput, buf);
 
+	// FF: the round reset can't trust what the snapshot says about this any more
+	g_FFMapSnapshot.OnEntityInput( this );
+
 	if ( ent_messages_draw.GetBool() )
 	{
 		if ( pCaller != NULL )
@@ -2042,11 +2042,6 @@ inline string_t CBaseEntity::GetEntityName()
 	return m_iName; 
 }
 
-inline void CBaseEntity::SetName( string_t newName )
-{
-	m_iName = newName;
-}
-
 
 inline bool CBaseEntity::NameMatches( const char *pszNameOrWildcard )
 {
@@ -81,6 +81,7 @@ void MessageEnd( void );
 void MessageWriteByte( int iValue);
 void MessageWriteChar( int iValue);
 void MessageWriteShort( int iValue);
+void MessageWriteShorts( const int *pValues, int nCount );
 void MessageWriteWord( int iValue );
 void MessageWriteLong( int iValue);
 void MessageWriteFloat( float flValue);
@@ -113,6 +114,7 @@ extern CSteamID GetSteamIDForPlayerIndex( int iPlayerIndex );
 #define WRITE_BYTE		(MessageWriteByte)
 #define WRITE_CHAR		(MessageWriteChar)
 #define WRITE_SHORT		(MessageWriteShort)
+#define WRITE_SHORTS	(MessageWriteShorts)
 #define WRITE_WORD		(MessageWriteWord)
 #define WRITE_LONG		(MessageWriteLong)
 #define WRITE_FLOAT		(MessageWriteFloat)
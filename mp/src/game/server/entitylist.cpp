@@ -17,6 +17,7 @@
 #include "ai_initutils.h"
 #include "globalstate.h"
 #include "datacache/imdlcache.h"
+#include "tier1/generichash.h"
 
 #ifdef HL2_DLL
 #include "npc_playercompanion.h"
@@ -33,6 +34,8 @@ static CUtlVector<IServerNetworkable*> g_DeleteList;
 CGlobalEntityList gEntList;
 CBaseEntityList *g_pEntityList = &gEntList;
 
+ConVar ent_name_index( "ent_name_index", "1", 0, "Look up entities by name through the name index rather than walking the entity list." );
+
 class CAimTargetManager : public IEntityListener
 {
 public:
@@ -290,6 +293,159 @@ CBaseEntityClassList::~CBaseEntityClassList()
 {
 }
 
+CEntityNameIndex::CEntityNameIndex()
+{
+	m_nNextOrder = 0;
+
+	for ( int i = 0; i < NUM_BUCKETS; i++ )
+	{
+		m_BucketHead[i] = -1;
+		m_BucketTail[i] = -1;
+	}
+
+	for ( int i = 0; i < NUM_ENT_ENTRIES; i++ )
+	{
+		m_pEntity[i] = NULL;
+		m_iIndexedName[i] = NULL_STRING;
+		m_nOrder[i] = 0;
+		m_Bucket[i] = -1;
+		m_Next[i] = -1;
+		m_Prev[i] = -1;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: (Re)files an entity under its current name, at its place in the
+//			entity list. The first call for an entity comes from OnAddEntity,
+//			as it's added to the tail of the list.
+//-----------------------------------------------------------------------------
+void CEntityNameIndex::Update( CBaseEntity *pEntity )
+{
+	const CBaseHandle &handle = pEntity->GetRefEHandle();
+	if ( handle == INVALID_EHANDLE_INDEX )
+		return;
+
+	int iEntry = handle.GetEntryIndex();
+	string_t iName = pEntity->GetEntityName();
+
+	if ( m_Bucket[iEntry] != -1 && m_pEntity[iEntry] == pEntity && m_iIndexedName[iEntry] == iName )
+		return;
+
+	Unlink( iEntry );
+
+	if ( m_pEntity[iEntry] != pEntity )
+		m_nOrder[iEntry] = m_nNextOrder++;
+
+	m_pEntity[iEntry] = pEntity;
+	m_iIndexedName[iEntry] = iName;
+
+	if ( iName == NULL_STRING )
+		return;
+
+	// Names are mostly set as entities spawn, so this rarely steps back from the tail
+	int iBucket = HashStringCaseless( STRING( iName ) ) % NUM_BUCKETS;
+	int iPrev = m_BucketTail[iBucket];
+	while ( iPrev != -1 && m_nOrder[iPrev] > m_nOrder[iEntry] )
+		iPrev = m_Prev[iPrev];
+
+	int iNext = ( iPrev != -1 ) ? m_Next[iPrev] : m_BucketHead[iBucket];
+
+	m_Bucket[iEntry] = iBucket;
+	m_Prev[iEntry] = iPrev;
+	m_Next[iEntry] = iNext;
+
+	if ( iPrev != -1 )
+		m_Next[iPrev] = iEntry;
+	else
+		m_BucketHead[iBucket] = iEntry;
+
+	if ( iNext != -1 )
+		m_Prev[iNext] = iEntry;
+	else
+		m_BucketTail[iBucket] = iEntry;
+}
+
+void CEntityNameIndex::Remove( int iEntry )
+{
+	Unlink( iEntry );
+	m_pEntity[iEntry] = NULL;
+	m_iIndexedName[iEntry] = NULL_STRING;
+}
+
+void CEntityNameIndex::Unlink( int iEntry )
+{
+	int iBucket = m_Bucket[iEntry];
+	if ( iBucket == -1 )
+		return;
+
+	if ( m_Prev[iEntry] != -1 )
+		m_Next[ m_Prev[iEntry] ] = m_Next[iEntry];
+	else
+		m_BucketHead[iBucket] = m_Next[iEntry];
+
+	if ( m_Next[iEntry] != -1 )
+		m_Prev[ m_Next[iEntry] ] = m_Prev[iEntry];
+	else
+		m_BucketTail[iBucket] = m_Prev[iEntry];
+
+	m_Bucket[iEntry] = -1;
+	m_Next[iEntry] = -1;
+	m_Prev[iEntry] = -1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Walks the chain szName hashes to. szName mustn't be a wildcard or
+//			a procedural name, as those can match names in any chain.
+//-----------------------------------------------------------------------------
+bool CEntityNameIndex::FindNext( CBaseEntity *pStartEntity, const char *szName, IEntityFindFilter *pFilter, CBaseEntity **ppResult ) const
+{
+	int iBucket = HashStringCaseless( szName ) % NUM_BUCKETS;
+	int iEntry;
+
+	if ( pStartEntity )
+	{
+		const CBaseHandle &handle = pStartEntity->GetRefEHandle();
+		if ( handle == INVALID_EHANDLE_INDEX )
+			return false;
+
+		int iStart = handle.GetEntryIndex();
+		if ( m_pEntity[iStart] != pStartEntity )
+			return false;
+
+		if ( m_Bucket[iStart] == iBucket )
+		{
+			iEntry = m_Next[iStart];
+		}
+		else
+		{
+			// pStartEntity was renamed during the search, pick up from its place in the list
+			iEntry = m_BucketHead[iBucket];
+			while ( iEntry != -1 && m_nOrder[iEntry] < m_nOrder[iStart] )
+				iEntry = m_Next[iEntry];
+		}
+	}
+	else
+	{
+		iEntry = m_BucketHead[iBucket];
+	}
+
+	for ( ; iEntry != -1; iEntry = m_Next[iEntry] )
+	{
+		CBaseEntity *ent = m_pEntity[iEntry];
+		if ( !ent->NameMatches( szName ) )
+			continue;
+
+		if ( pFilter && !pFilter->ShouldFindEntity( ent ) )
+			continue;
+
+		*ppResult = ent;
+		return true;
+	}
+
+	*ppResult = NULL;
+	return true;
+}
+
 CGlobalEntityList::CGlobalEntityList()
 {
 	m_iHighestEnt = m_iNumEnts = m_iNumEdicts = 0;
@@ -700,6 +856,15 @@ CBaseEntity *CGlobalEntityList::FindEntityByName( CBaseEntity *pStartEntity, con
 
 		return NULL;
 	}
+
+	// --> FF: plain names only need to look at the entities filed under them
+	if ( ent_name_index.GetBool() && !strchr( szName, '*' ) )
+	{
+		CBaseEntity *pResult;
+		if ( m_NameIndex.FindNext( pStartEntity, szName, pFilter, &pResult ) )
+			return pResult;
+	}
+	// <-- FF
 	
 	const CEntInfo *pInfo = pStartEntity ? GetEntInfoPtr( pStartEntity->GetRefEHandle() )->m_pNext : FirstEntInfo();
 
@@ -1204,6 +1369,8 @@ void CGlobalEntityList::OnAddEntity( IHandleEntity *pEnt, CBaseHandle handle )
 	
 	// NOTE: Must be a CBaseEntity on server
 	Assert( pBaseEnt );
+	m_NameIndex.Update( pBaseEnt );
+
 	//DevMsg(2,"Created %s\n", pBaseEnt->GetClassname() );
 	for ( i = m_entityListeners.Count()-1; i >= 0; i-- )
 	{
@@ -1234,6 +1401,8 @@ void CGlobalEntityList::OnRemoveEntity( IHandleEntity *pEnt, CBaseHandle handle
 	if ( pBaseEnt->edict() )
 		m_iNumEdicts--;
 
+	m_NameIndex.Remove( handle.GetEntryIndex() );
+
 	m_iNumEnts--;
 }
 
@@ -1254,6 +1423,9 @@ void CGlobalEntityList::NotifySpawn( CBaseEntity *pEnt )
 	if ( !pEnt )
 		return;
 
+	// catches names set without going through SetName()
+	m_NameIndex.Update( pEnt );
+
 	//DevMsg(2,"Deleted %s\n", pBaseEnt->GetClassname() );
 	for ( int i = m_entityListeners.Count()-1; i >= 0; i-- )
 	{
@@ -1261,6 +1433,11 @@ void CGlobalEntityList::NotifySpawn( CBaseEntity *pEnt )
 	}
 }
 
+void CGlobalEntityList::OnEntityNameChanged( CBaseEntity *pEnt )
+{
+	m_NameIndex.Update( pEnt );
+}
+
 // NOTE: This doesn't happen in OnRemoveEntity() specifically because 
 // listeners may want to reference the object as it's being deleted
 // OnRemoveEntity isn't called until the destructor and all data is invalid.
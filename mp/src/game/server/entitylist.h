@@ -66,6 +66,44 @@ public:
 	virtual CBaseEntity *GetFilterResult( void ) = 0;
 };
 
+//-----------------------------------------------------------------------------
+// Purpose: Entities chained by the caseless hash of their targetname, so looking
+//			up a plain name only visits entities that could have it. Kept up to
+//			date as entities are added, named (SetName) and removed. Each chain
+//			is in entity list order, so a search visits entities in the same
+//			order as a walk of the list would.
+//-----------------------------------------------------------------------------
+class CEntityNameIndex
+{
+public:
+	CEntityNameIndex();
+
+	void Update( CBaseEntity *pEntity );
+	void Remove( int iEntry );
+
+	// Finds the next entity after pStartEntity (NULL for the first) called szName, in entity
+	// list order. pStartEntity may have been renamed since it was found. Returns false if it
+	// can't say because pStartEntity isn't in the index.
+	bool FindNext( CBaseEntity *pStartEntity, const char *szName, IEntityFindFilter *pFilter, CBaseEntity **ppResult ) const;
+
+private:
+	enum { NUM_BUCKETS = 1024 };
+
+	void Unlink( int iEntry );
+
+	int m_BucketHead[ NUM_BUCKETS ];
+	int m_BucketTail[ NUM_BUCKETS ];
+	unsigned int m_nNextOrder;
+
+	// by entity entry index
+	CBaseEntity *m_pEntity[ NUM_ENT_ENTRIES ];
+	string_t m_iIndexedName[ NUM_ENT_ENTRIES ];
+	unsigned int m_nOrder[ NUM_ENT_ENTRIES ];	// when the entity was added, its place in the entity list
+	int m_Bucket[ NUM_ENT_ENTRIES ];			// -1 when not in the index
+	int m_Next[ NUM_ENT_ENTRIES ];
+	int m_Prev[ NUM_ENT_ENTRIES ];
+};
+
 //-----------------------------------------------------------------------------
 // Purpose: a global list of all the entities in the game.  All iteration through
 //			entities is done through this object.
@@ -81,6 +119,8 @@ private:
 	bool m_bClearingEntities;
 	CUtlVector<IEntityListener *>	m_entityListeners;
 
+	CEntityNameIndex m_NameIndex;
+
 public:
 	IServerNetworkable* GetServerNetworkable( CBaseHandle hEnt ) const;
 	CBaseNetworkable* GetBaseNetworkable( CBaseHandle hEnt ) const;
@@ -112,6 +152,9 @@ public:
 	void NotifyCreateEntity( CBaseEntity *pEnt );
 	void NotifySpawn( CBaseEntity *pEnt );
 	void NotifyRemoveEntity( CBaseHandle hEnt );
+
+	// keeps FindEntityByName's index up to date, called by SetName()
+	void OnEntityNameChanged( CBaseEntity *pEnt );
 	// iteration functions
 
 	// returns the next entity after pCurrentEnt;  if pCurrentEnt is NULL, return the first entity
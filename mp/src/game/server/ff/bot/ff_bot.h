@@ -875,6 +875,7 @@ public:
 	void OnWeaponFireOnEmpty( IGameEvent *event );
 	void OnWeaponReload( IGameEvent *event );
 	void OnWeaponZoom( IGameEvent *event );
+	static float GetWeaponFireNoiseRange( CBasePlayer *player );	///< how far away a player's shot can be heard, negative if it can't be
 
 	void OnBulletImpact( IGameEvent *event );
 
@@ -1064,6 +1065,8 @@ private:
 	Vector m_bentNoisePosition;										///< the last computed bent line of sight
 	bool m_bendNoisePositionValid;
 
+	unsigned int m_eventInboxCursor;								///< how far through TheCSBots()' event inbox we've read
+
 	//- "looking around" mechanism -----------------------------------------------------------------------------------
 	float m_lookAroundStateTimestamp;								///< time of next state change
 	float m_lookAheadAngle;											///< our desired forward look angle
@@ -1161,7 +1164,21 @@ private:
 		int m_validFrame;											///< frame of last computation (for lazy evaluation)
 	};
 	static PartInfo m_partInfo[ MAX_PLAYERS ];						///< part positions for each player
-	void ComputePartPositions( CCSPlayer *player );					///< compute part positions from bone location
+	static void ComputePartPositions( CCSPlayer *player );			///< compute part positions from bone location
+
+	// Visibility is worked out for every bot due an Update() at once, on worker threads, by TheCSBots()->UpdatePerception().
+	// Update() then reads the results instead of tracing as it goes.
+	struct PerceptionInfo
+	{
+		int m_tick;													///< tick these results are for, -1 if none
+		unsigned char m_visParts[ MAX_PLAYERS + 1 ];				///< parts we can see of each enemy by entindex, GUT if we can see a friend
+		const SpotEncounter *m_spotEncounter;						///< the encounter m_spotVisible is for, NULL if we didn't check
+		CUtlVector< bool > m_spotVisible;							///< peripheral vision result for each encounter spot
+	}
+	m_perception;
+	void ComputePerception( void );									///< fill in m_perception - called on a worker thread, must not change anything else
+	bool HasPerception( void ) const { return m_perception.m_tick == gpGlobals->tickcount; }
+	bool IsPeripheralVisionDue( void ) const;
 
 	//- attack state data --------------------------------------------------------------------------------------------
 	DispositionType m_disposition;									///< how we will react to enemies
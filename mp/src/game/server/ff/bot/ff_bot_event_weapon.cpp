@@ -34,6 +34,21 @@ void CCSBot::OnWeaponFire( IGameEvent *event )
 		ForceRun( 5.0f );
 	}
 
+	float range = GetWeaponFireNoiseRange( player );
+	if (range < 0.0f)
+		return;
+
+	OnAudibleEvent( event, player, range, PRIORITY_HIGH, true ); // weapon_fire
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return how far away the given player's weapon fire can be heard, or a negative value if it makes no noise.
+ * TheCSBots() uses this to decide which bots to tell about the shot.
+ */
+float CCSBot::GetWeaponFireNoiseRange( CBasePlayer *player )
+{
 	const float ShortRange = 1000.0f;
 	const float NormalRange = 2000.0f;
 
@@ -44,7 +59,7 @@ void CCSBot::OnWeaponFire( IGameEvent *event )
 	CWeaponCSBase *weapon = (CWeaponCSBase *)((player)?player->GetActiveWeapon():NULL);
 
 	if (weapon == NULL)
-		return;
+		return -1.0f;
 
 	switch( weapon->GetWeaponID() )
 	{
@@ -54,7 +69,7 @@ void CCSBot::OnWeaponFire( IGameEvent *event )
 		case WEAPON_FLASHBANG:
 		case WEAPON_SHIELDGUN:
 		case WEAPON_C4:
-			return;
+			return -1.0f;
 
 		// quiet
 		case WEAPON_KNIFE:
@@ -101,7 +116,7 @@ void CCSBot::OnWeaponFire( IGameEvent *event )
 			break;
 	}
 
-	OnAudibleEvent( event, player, range, PRIORITY_HIGH, true ); // weapon_fire
+	return range;
 }
 
 
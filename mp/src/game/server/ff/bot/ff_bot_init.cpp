@@ -99,6 +99,9 @@ void Bot_ServerCommand( void )
 CCSBot::CCSBot( void ) : m_chatter( this ), m_gameState( this )
 {
 	m_hasJoined = false;
+
+	// don't deliver anything that happened before we arrived
+	m_eventInboxCursor = TheCSBots() ? TheCSBots()->GetEventInboxHead() : 0;
 }
 
 
@@ -268,6 +271,9 @@ void CCSBot::ResetValues( void )
 	m_spotCheckTimestamp = 0.0f;
 	m_peripheralTimestamp = 0.0f;
 
+	m_perception.m_tick = -1;
+	m_perception.m_spotEncounter = NULL;
+
 	m_avgVelIndex = 0;
 	m_avgVelCount = 0;
 
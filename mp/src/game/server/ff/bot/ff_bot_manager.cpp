@@ -17,6 +17,7 @@
 #include "shared_util.h"
 #include "KeyValues.h"
 #include "tier0/icommandline.h"
+#include "vstdlib/jobthread.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -42,6 +43,8 @@ int UTIL_CSSBotsInGame( void );
 
 ConVar bot_join_delay( "bot_join_delay", "0", FCVAR_GAMEDLL, "Prevents bots from joining the server for this many seconds after a map change." );
 
+ConVar bot_perception_parallel( "bot_perception_parallel", "1", FCVAR_GAMEDLL | FCVAR_CHEAT, "Work out what every updating bot can see at the start of the tick, across worker threads." );
+
 /**
  * Determine whether bots can be used or not
  */
@@ -104,6 +107,13 @@ CCSBotManager::CCSBotManager()
 	m_bombDefuser = NULL;
 	m_roundStartTimestamp = 0.0f;
 
+	for( int i=0; i<BOT_GRID_DIM * BOT_GRID_DIM; ++i )
+		m_botGridHead[i] = -1;
+	m_botGridTick = -1;
+
+	m_eventInboxBase = 0;
+	m_eventInboxReadHead = 0;
+
 	m_eventListenersEnabled = true;
 	m_commonEventListeners.AddToTail( &m_PlayerFootstepEvent );
 	m_commonEventListeners.AddToTail( &m_PlayerRadioEvent );
@@ -233,6 +243,80 @@ void CCSBotManager::EnableEventListeners( bool enable )
 	}
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Job pool callback for UpdatePerception()
+ */
+void CCSBotManager::ComputeBotPerception( CCSBot *&bot )
+{
+	bot->ComputePerception();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Find the bots that will Update() this tick and do their visibility checks all at once on the job pool.
+ * Anything a worker reads that could be lazily recomputed (part positions, abs origins) is brought up to
+ * date here first, so the workers only ever read.
+ */
+void CCSBotManager::UpdatePerception( void )
+{
+	VPROF_BUDGET( "CCSBotManager::UpdatePerception", VPROF_BUDGETGROUP_NPCS );
+
+	m_perceptionTargets.RemoveAll();
+	m_perceivingBots.RemoveAll();
+
+	if (!bot_perception_parallel.GetBool() || cv_bot_zombie.GetBool() || cv_bot_flipout.GetBool() || cv_bot_stop.GetBool())
+		return;
+
+	// same test CBotManager::StartFrame() uses to decide who updates
+	for( int i = 1; i <= gpGlobals->maxClients; ++i )
+	{
+		CCSBot *bot = dynamic_cast< CCSBot * >( UTIL_PlayerByIndex( i ) );
+
+		if (bot == NULL || !IsEntityValid( bot ))
+			continue;
+
+		if (((gpGlobals->tickcount + bot->entindex()) % g_BotUpdateSkipCount) != 0)
+			continue;
+
+		if (!bot->IsAlive() || bot->GetTeamNumber() == 0 || bot->IsBlind())
+			continue;
+
+		// size the peripheral vision results now so the worker doesn't allocate
+		bot->m_perception.m_spotEncounter = NULL;
+		if (bot->m_spotEncounter && bot->IsPeripheralVisionDue())
+		{
+			bot->m_perception.m_spotEncounter = bot->m_spotEncounter;
+			bot->m_perception.m_spotVisible.SetCount( bot->m_spotEncounter->spots.Count() );
+		}
+
+		bot->EyePosition();
+
+		m_perceivingBots.AddToTail( bot );
+	}
+
+	if (m_perceivingBots.Count() == 0)
+		return;
+
+	// everyone who can be seen
+	for( int i = 1; i <= gpGlobals->maxClients; ++i )
+	{
+		CCSPlayer *player = ToCSPlayer( UTIL_PlayerByIndex( i ) );
+
+		if (player == NULL || !player->IsAlive())
+			continue;
+
+		CCSBot::ComputePartPositions( player );
+		CCSBot::m_partInfo[ player->entindex() % MAX_PLAYERS ].m_validFrame = gpGlobals->framecount;
+
+		int t = m_perceptionTargets.AddToTail();
+		m_perceptionTargets[t].m_player = player;
+		m_perceptionTargets[t].m_center = player->WorldSpaceCenter();
+	}
+
+	ParallelProcess( "CCSBot::ComputePerception", m_perceivingBots.Base(), m_perceivingBots.Count(), this, &CCSBotManager::ComputeBotPerception );
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Called each frame
@@ -245,9 +329,15 @@ void CCSBotManager::StartFrame( void )
 		return;
 	}
 
+	// what the bots updating this tick can see, before any of them move
+	UpdatePerception();
+
 	// EXTEND
 	CBotManager::StartFrame();
 
+	// bots have just read their inboxes in Update()
+	TrimEventInbox();
+
 	MaintainBotQuota();
 	EnableEventListeners( UTIL_CSSBotsInGame() > 0 );
 
@@ -432,6 +522,8 @@ void CCSBotManager::ServerActivate( void )
 void CCSBotManager::ServerDeactivate( void )
 {
 	m_serverActive = false;
+
+	ClearEventInbox();
 }
 
 void CCSBotManager::ClientDisconnect( CBaseEntity *entity )
@@ -1665,10 +1757,252 @@ void CCSBotManager::OnServerShutdown( IGameEvent *event )
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+// Event delivery
+//--------------------------------------------------------------------------------------------------------------
+
+#define BOT_EVENT_THUNK( Callback ) \
+	static void Thunk_##Callback( CCSBot *bot, IGameEvent *event ) { bot->Callback( event ); }
+
+BOT_EVENT_THUNK( OnPlayerFootstep )
+BOT_EVENT_THUNK( OnPlayerRadio )
+BOT_EVENT_THUNK( OnPlayerDeath )
+BOT_EVENT_THUNK( OnPlayerFallDamage )
+BOT_EVENT_THUNK( OnBombPickedUp )
+BOT_EVENT_THUNK( OnBombPlanted )
+BOT_EVENT_THUNK( OnBombBeep )
+BOT_EVENT_THUNK( OnBombDefuseBegin )
+BOT_EVENT_THUNK( OnBombDefused )
+BOT_EVENT_THUNK( OnBombDefuseAbort )
+BOT_EVENT_THUNK( OnBombExploded )
+BOT_EVENT_THUNK( OnDoorMoving )
+BOT_EVENT_THUNK( OnBreakProp )
+BOT_EVENT_THUNK( OnBreakBreakable )
+BOT_EVENT_THUNK( OnHostageFollows )
+BOT_EVENT_THUNK( OnHostageRescuedAll )
+BOT_EVENT_THUNK( OnWeaponFire )
+BOT_EVENT_THUNK( OnWeaponFireOnEmpty )
+BOT_EVENT_THUNK( OnWeaponReload )
+BOT_EVENT_THUNK( OnWeaponZoom )
+BOT_EVENT_THUNK( OnBulletImpact )
+BOT_EVENT_THUNK( OnHEGrenadeDetonate )
+BOT_EVENT_THUNK( OnFlashbangDetonate )
+BOT_EVENT_THUNK( OnSmokeGrenadeDetonate )
+BOT_EVENT_THUNK( OnGrenadeBounce )
+BOT_EVENT_THUNK( OnNavBlocked )
+
+/// bots can have moved a little since the grid was built
+const float BotGridSlop = 32.0f;
+
+
+//--------------------------------------------------------------------------------------------------------------
+inline int BotGridCoord( float value, int cellSize, int dim )
+{
+	int cell = (int)floor( value / cellSize ) + dim/2;
+	return clamp( cell, 0, dim-1 );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Bucket the living bots by position. Done at most once a tick, the first time a noise needs it.
+ */
+void CCSBotManager::UpdateBotGrid( void )
+{
+	if (m_botGridTick == gpGlobals->tickcount)
+		return;
+
+	m_botGridTick = gpGlobals->tickcount;
+
+	for( int i=0; i<m_botGridUsedCells.Count(); ++i )
+		m_botGridHead[ m_botGridUsedCells[i] ] = -1;
+
+	m_botGridUsedCells.RemoveAll();
+	m_botGrid.RemoveAll();
+
+	for ( int idx = 1; idx <= gpGlobals->maxClients; ++idx )
+	{
+		CBasePlayer *player = UTIL_PlayerByIndex( idx );
+		if (player == NULL || !player->IsBot() || !player->IsAlive())
+			continue;
+
+		CCSBot *bot = dynamic_cast< CCSBot * >( player );
+		if ( !bot )
+			continue;
+
+		GridBot &entry = m_botGrid[ m_botGrid.AddToTail() ];
+		entry.m_bot = bot;
+		entry.m_pos = GetCentroid( bot );
+
+		int cell = BotGridCoord( entry.m_pos.y, BOT_GRID_CELL_SIZE, BOT_GRID_DIM ) * BOT_GRID_DIM + BotGridCoord( entry.m_pos.x, BOT_GRID_CELL_SIZE, BOT_GRID_DIM );
+
+		if (m_botGridHead[ cell ] == -1)
+			m_botGridUsedCells.AddToTail( cell );
+
+		entry.m_next = m_botGridHead[ cell ];
+		m_botGridHead[ cell ] = m_botGrid.Count() - 1;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Deliver a noise to the living bots within range of it. The bot still does its own hearing check, this
+ * just saves asking the ones that are obviously too far away.
+ */
+void CCSBotManager::DispatchAudibleEvent( BotEventThunk thunk, IGameEvent *event, const Vector &origin, float range )
+{
+	VPROF_BUDGET( "CCSBotManager::DispatchAudibleEvent", VPROF_BUDGETGROUP_NPCS );
+
+	UpdateBotGrid();
+
+	float reach = range + BotGridSlop;
+	float reachSq = reach * reach;
+
+	int minX = BotGridCoord( origin.x - reach, BOT_GRID_CELL_SIZE, BOT_GRID_DIM );
+	int maxX = BotGridCoord( origin.x + reach, BOT_GRID_CELL_SIZE, BOT_GRID_DIM );
+	int minY = BotGridCoord( origin.y - reach, BOT_GRID_CELL_SIZE, BOT_GRID_DIM );
+	int maxY = BotGridCoord( origin.y + reach, BOT_GRID_CELL_SIZE, BOT_GRID_DIM );
+
+	// if it covers more cells than there are bots just check them all
+	if ((maxX - minX + 1) * (maxY - minY + 1) > m_botGrid.Count())
+	{
+		for( int i=0; i<m_botGrid.Count(); ++i )
+		{
+			if ((m_botGrid[i].m_pos - origin).LengthSqr() < reachSq)
+				thunk( m_botGrid[i].m_bot, event );
+		}
+		return;
+	}
+
+	for( int y=minY; y<=maxY; ++y )
+	{
+		for( int x=minX; x<=maxX; ++x )
+		{
+			for( int i = m_botGridHead[ y * BOT_GRID_DIM + x ]; i != -1; i = m_botGrid[i].m_next )
+			{
+				if ((m_botGrid[i].m_pos - origin).LengthSqr() < reachSq)
+					thunk( m_botGrid[i].m_bot, event );
+			}
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Deliver a noise made by the event's "userid" player
+ */
+void CCSBotManager::DispatchPlayerNoise( BotEventThunk thunk, IGameEvent *event, float range )
+{
+	// bots ignore noises that don't come from a player
+	CBasePlayer *player = UTIL_PlayerByUserId( event->GetInt( "userid" ) );
+	if (player == NULL)
+		return;
+
+	DispatchAudibleEvent( thunk, event, GetCentroid( player ), range );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Hold on to a copy of the event until every bot has had a chance to see it
+ */
+void CCSBotManager::QueueEvent( BotEventThunk thunk, IGameEvent *event, int coalesceKey )
+{
+	IGameEvent *copy = gameeventmanager->DuplicateEvent( event );
+	if ( !copy )
+		return;
+
+	// replace an older version no bot has read yet
+	if (coalesceKey != NO_COALESCE)
+	{
+		for( int i = m_eventInbox.Count()-1; i >= 0 && m_eventInboxBase + i >= m_eventInboxReadHead; --i )
+		{
+			QueuedEvent &queued = m_eventInbox[i];
+			if (queued.m_thunk == thunk && queued.m_coalesceKey == coalesceKey)
+			{
+				gameeventmanager->FreeEvent( queued.m_event );
+				m_eventInbox.Remove( i );
+				break;
+			}
+		}
+	}
+
+	QueuedEvent &queued = m_eventInbox[ m_eventInbox.AddToTail() ];
+	queued.m_thunk = thunk;
+	queued.m_event = copy;
+	queued.m_coalesceKey = coalesceKey;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Called from the bot's Update() to catch up on everything that's happened since last time
+ */
+void CCSBotManager::DeliverQueuedEvents( CCSBot *bot )
+{
+	unsigned int cursor = max( bot->m_eventInboxCursor, m_eventInboxBase );
+
+	// handlers can fire events of their own, so don't hang on to anything in the inbox
+	while ( cursor < GetEventInboxHead() )
+	{
+		BotEventThunk thunk = m_eventInbox[ cursor - m_eventInboxBase ].m_thunk;
+		IGameEvent *event = m_eventInbox[ cursor - m_eventInboxBase ].m_event;
+
+		++cursor;
+		bot->m_eventInboxCursor = cursor;
+		m_eventInboxReadHead = max( m_eventInboxReadHead, cursor );
+
+		thunk( bot, event );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CCSBotManager::TrimEventInbox( void )
+{
+	unsigned int oldest = GetEventInboxHead();
+
+	for ( int idx = 1; idx <= gpGlobals->maxClients; ++idx )
+	{
+		CBasePlayer *player = UTIL_PlayerByIndex( idx );
+		if (player == NULL || !player->IsBot())
+			continue;
+
+		CCSBot *bot = dynamic_cast< CCSBot * >( player );
+		if ( bot )
+			oldest = min( oldest, max( bot->m_eventInboxCursor, m_eventInboxBase ) );
+	}
+
+	int count = oldest - m_eventInboxBase;
+	if (count <= 0)
+		return;
+
+	for( int i=0; i<count; ++i )
+		gameeventmanager->FreeEvent( m_eventInbox[i].m_event );
+
+	m_eventInbox.RemoveMultipleFromHead( count );
+	m_eventInboxBase = oldest;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CCSBotManager::ClearEventInbox( void )
+{
+	for( int i=0; i<m_eventInbox.Count(); ++i )
+		gameeventmanager->FreeEvent( m_eventInbox[i].m_event );
+
+	m_eventInboxBase += m_eventInbox.Count();
+	m_eventInboxReadHead = m_eventInboxBase;
+	m_eventInbox.RemoveAll();
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnPlayerFootstep( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnPlayerFootstep, event );
+	DispatchPlayerNoise( Thunk_OnPlayerFootstep, event, 1100.0f );
 }
 
 
@@ -1682,21 +2016,21 @@ void CCSBotManager::OnPlayerRadio( IGameEvent *event )
 		SetLastSeenEnemyTimestamp();
 	}
 
-	CCSBOTMANAGER_ITERATE_BOTS( OnPlayerRadio, event );
+	QueueEvent( Thunk_OnPlayerRadio, event );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnPlayerDeath( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnPlayerDeath, event );
+	QueueEvent( Thunk_OnPlayerDeath, event );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnPlayerFallDamage( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnPlayerFallDamage, event );
+	DispatchPlayerNoise( Thunk_OnPlayerFallDamage, event, 1100.0f );
 }
 
 
@@ -1706,7 +2040,7 @@ void CCSBotManager::OnBombPickedUp( IGameEvent *event )
 	// bomb no longer loose
 	SetLooseBomb( NULL );
 
-	CCSBOTMANAGER_ITERATE_BOTS( OnBombPickedUp, event );
+	QueueEvent( Thunk_OnBombPickedUp, event );
 }
 
 
@@ -1716,14 +2050,19 @@ void CCSBotManager::OnBombPlanted( IGameEvent *event )
 	m_isBombPlanted = true;
 	m_bombPlantTimestamp = gpGlobals->curtime;
 
-	CCSBOTMANAGER_ITERATE_BOTS( OnBombPlanted, event );
+	QueueEvent( Thunk_OnBombPlanted, event );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnBombBeep( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnBombBeep, event );
+	// bots only notice the bomb if they're close enough to hear it beep
+	CBaseEntity *entity = UTIL_EntityByIndex( event->GetInt( "entindex" ) );
+	if ( entity )
+	{
+		DispatchAudibleEvent( Thunk_OnBombBeep, event, entity->GetAbsOrigin(), 1500.0f );
+	}
 }
 
 
@@ -1732,7 +2071,7 @@ void CCSBotManager::OnBombDefuseBegin( IGameEvent *event )
 {
 	m_bombDefuser = static_cast<CCSPlayer *>( UTIL_PlayerByUserId( event->GetInt( "userid" ) ) );
 
-	CCSBOTMANAGER_ITERATE_BOTS( OnBombDefuseBegin, event );
+	QueueEvent( Thunk_OnBombDefuseBegin, event );
 }
 
 
@@ -1742,7 +2081,7 @@ void CCSBotManager::OnBombDefused( IGameEvent *event )
 	m_isBombPlanted = false;
 	m_bombDefuser = NULL;
 
-	CCSBOTMANAGER_ITERATE_BOTS( OnBombDefused, event );
+	QueueEvent( Thunk_OnBombDefused, event );
 }
 
 
@@ -1751,14 +2090,14 @@ void CCSBotManager::OnBombDefuseAbort( IGameEvent *event )
 {
 	m_bombDefuser = NULL;
 
-	CCSBOTMANAGER_ITERATE_BOTS( OnBombDefuseAbort, event );
+	QueueEvent( Thunk_OnBombDefuseAbort, event );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnBombExploded( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnBombExploded, event );
+	QueueEvent( Thunk_OnBombExploded, event );
 }
 
 
@@ -1776,6 +2115,9 @@ void CCSBotManager::OnRoundStart( IGameEvent *event )
 {
 	RestartRound();
 
+	// anything still queued is about last round
+	ClearEventInbox();
+
 	CCSBOTMANAGER_ITERATE_BOTS( OnRoundStart, event );
 }
 
@@ -1884,7 +2226,8 @@ void CCSBotManager::OnRoundFreezeEnd( IGameEvent *event )
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnNavBlocked( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnNavBlocked, event );
+	// only the latest state of each area matters
+	QueueEvent( Thunk_OnNavBlocked, event, event->GetInt( "area" ) );
 	CheckForBlockedZones();
 }
 
@@ -1892,7 +2235,7 @@ void CCSBotManager::OnNavBlocked( IGameEvent *event )
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnDoorMoving( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnDoorMoving, event );
+	DispatchPlayerNoise( Thunk_OnDoorMoving, event, 1100.0f );
 }
 
 
@@ -1942,7 +2285,7 @@ void CCSBotManager::OnBreakBreakable( IGameEvent *event )
 	CheckAreasOverlappingBreakable collector( UTIL_EntityByIndex( event->GetInt( "entindex" ) ) );
 	TheNavMesh->ForAllAreas( collector );
 
-	CCSBOTMANAGER_ITERATE_BOTS( OnBreakBreakable, event );
+	DispatchPlayerNoise( Thunk_OnBreakBreakable, event, 1100.0f );
 }
 
 
@@ -1952,84 +2295,95 @@ void CCSBotManager::OnBreakProp( IGameEvent *event )
 	CheckAreasOverlappingBreakable collector( UTIL_EntityByIndex( event->GetInt( "entindex" ) ) );
 	TheNavMesh->ForAllAreas( collector );
 
-	CCSBOTMANAGER_ITERATE_BOTS( OnBreakProp, event );
+	DispatchPlayerNoise( Thunk_OnBreakProp, event, 1100.0f );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnHostageFollows( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnHostageFollows, event );
+	QueueEvent( Thunk_OnHostageFollows, event );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnHostageRescuedAll( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnHostageRescuedAll, event );
+	QueueEvent( Thunk_OnHostageRescuedAll, event );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnWeaponFire( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnWeaponFire, event );
+	CBasePlayer *player = UTIL_PlayerByUserId( event->GetInt( "userid" ) );
+	if ( player == NULL )
+		return;
+
+	// silent weapons still tell bots knife fighting this player to rush them
+	float range = CCSBot::GetWeaponFireNoiseRange( player );
+	if ( range < 0.0f )
+		range = 500.0f;
+
+	DispatchAudibleEvent( Thunk_OnWeaponFire, event, GetCentroid( player ), range );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnWeaponFireOnEmpty( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnWeaponFireOnEmpty, event );
+	DispatchPlayerNoise( Thunk_OnWeaponFireOnEmpty, event, 1100.0f );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnWeaponReload( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnWeaponReload, event );
+	DispatchPlayerNoise( Thunk_OnWeaponReload, event, 1100.0f );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnWeaponZoom( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnWeaponZoom, event );
+	DispatchPlayerNoise( Thunk_OnWeaponZoom, event, 1100.0f );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnBulletImpact( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnBulletImpact, event );
+	Vector origin( event->GetFloat( "x", 0.0f ), event->GetFloat( "y", 0.0f ), event->GetFloat( "z", 0.0f ) );
+
+	DispatchAudibleEvent( Thunk_OnBulletImpact, event, origin, 1100.0f );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnHEGrenadeDetonate( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnHEGrenadeDetonate, event );
+	DispatchPlayerNoise( Thunk_OnHEGrenadeDetonate, event, 99999.0f );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnFlashbangDetonate( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnFlashbangDetonate, event );
+	DispatchPlayerNoise( Thunk_OnFlashbangDetonate, event, 1000.0f );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnSmokeGrenadeDetonate( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnSmokeGrenadeDetonate, event );
+	DispatchPlayerNoise( Thunk_OnSmokeGrenadeDetonate, event, 1000.0f );
 }
 
 
 //--------------------------------------------------------------------------------------------------------------
 void CCSBotManager::OnGrenadeBounce( IGameEvent *event )
 {
-	CCSBOTMANAGER_ITERATE_BOTS( OnGrenadeBounce, event );
+	DispatchPlayerNoise( Thunk_OnGrenadeBounce, event, 500.0f );
 }
 
 
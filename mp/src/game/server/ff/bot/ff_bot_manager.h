@@ -21,6 +21,10 @@
 extern ConVar friendlyfire;
 
 class CBasePlayerWeapon;
+class CCSBot;
+
+/// invokes one of the CCSBot::On*() event handlers
+typedef void (*BotEventThunk)( CCSBot *bot, IGameEvent *event );
 
 /**
  * Given one team, return the other
@@ -296,6 +300,24 @@ public:
 
 	bool IsRoundOver( void ) const					{ return m_isRoundOver; }		///< return true if the round has ended
 
+	// event delivery ---------------------------------------------------------------------------------------------
+	// Noises only go to bots close enough to hear them. Everything else waits in an inbox until the bot's
+	// next Update(), so a burst of events costs one pass per bot rather than one call per bot per event.
+
+	void DeliverQueuedEvents( CCSBot *bot );					///< run the handlers for everything queued since the bot last looked
+	unsigned int GetEventInboxHead( void ) const	{ return m_eventInboxBase + m_eventInbox.Count(); }
+
+	// perception -------------------------------------------------------------------------------------------------
+	// Every bot due an Update() this tick does its visibility checks at the same time, spread across worker threads,
+	// against part positions computed once per player at the start of the tick rather than once per observer.
+
+	struct PerceptionTarget
+	{
+		CCSPlayer *m_player;
+		Vector m_center;										///< WorldSpaceCenter() when the snapshot was taken
+	};
+	const CUtlVector< PerceptionTarget > &GetPerceptionTargets( void ) const	{ return m_perceptionTargets; }
+
 	#define FROM_CONSOLE true
 	bool BotAddCommand( int team, bool isFromConsole = false, const char *profileName = NULL, CSWeaponType weaponType = WEAPONTYPE_UNKNOWN, BotDifficultyType difficulty = NUM_DIFFICULTY_LEVELS );	///< process the "bot_add" console command
 
@@ -372,6 +394,47 @@ private:
 
 	DECLARE_CSBOTMANAGER_EVENT_LISTENER( ServerShutdown,		server_shutdown )
 
+	// event delivery -------------------------------------------------------------------------------------------
+	enum { BOT_GRID_CELL_SIZE = 512 };						///< world units per side of a bot grid cell
+	enum { BOT_GRID_DIM = 64 };								///< cells per side, centered on the world origin
+	enum { NO_COALESCE = -1 };
+
+	struct GridBot
+	{
+		CCSBot *m_bot;
+		Vector m_pos;
+		int m_next;											///< next bot in the same cell, or -1
+	};
+
+	struct QueuedEvent
+	{
+		BotEventThunk m_thunk;
+		IGameEvent *m_event;								///< our own copy, freed once every bot has seen it
+		int m_coalesceKey;									///< a newer unread event with the same thunk and key replaces this one
+	};
+
+	void UpdateBotGrid( void );								///< bucket the living bots by position, once per tick
+	void DispatchAudibleEvent( BotEventThunk thunk, IGameEvent *event, const Vector &origin, float range );
+	void DispatchPlayerNoise( BotEventThunk thunk, IGameEvent *event, float range );
+	void QueueEvent( BotEventThunk thunk, IGameEvent *event, int coalesceKey = NO_COALESCE );
+	void TrimEventInbox( void );								///< free the events every bot has seen
+	void ClearEventInbox( void );
+
+	void UpdatePerception( void );							///< snapshot the players and run the visibility checks of the bots updating this tick
+	void ComputeBotPerception( CCSBot *&bot );
+
+	int m_botGridHead[ BOT_GRID_DIM * BOT_GRID_DIM ];		///< first bot in each cell, or -1
+	CUtlVector< int > m_botGridUsedCells;
+	CUtlVector< GridBot > m_botGrid;
+	int m_botGridTick;
+
+	CUtlVector< QueuedEvent > m_eventInbox;
+	unsigned int m_eventInboxBase;							///< sequence number of m_eventInbox[0]
+	unsigned int m_eventInboxReadHead;						///< nothing before this can be coalesced, some bot has seen it
+
+	CUtlVector< PerceptionTarget > m_perceptionTargets;		///< living players as of the start of the tick
+	CUtlVector< CCSBot * > m_perceivingBots;				///< bots running ComputePerception() this tick
+
 	CUtlVector< BotEventInterface * > m_commonEventListeners;	// These event listeners fire often, and can be disabled for performance gains when no bots are present.
 	bool m_eventListenersEnabled;
 	void EnableEventListeners( bool enable );
@@ -9,6 +9,7 @@
 
 #include "cbase.h"
 #include "cs_bot.h"
+#include "nav_hierarchy.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -1932,11 +1933,11 @@ bool CCSBot::ComputePath( const Vector &goal, RouteType route )
 	}
 
 	//
-	// Compute shortest path to goal
+	// Compute shortest path to goal - long trips are planned over regions first
 	//
 	CNavArea *closestArea = NULL;
 	PathCost cost( this, route );
-	bool pathToGoalExists = NavAreaBuildPath( startArea, goalArea, &goal, cost, &closestArea );
+	bool pathToGoalExists = NavAreaBuildHierarchicalPath( startArea, goalArea, &goal, cost, &closestArea );
 
 	CNavArea *effectiveGoalArea = (pathToGoalExists) ? goalArea : closestArea;
 
@@ -241,6 +241,9 @@ void CCSBot::Update( void )
 {
 	VPROF_BUDGET( "CCSBot::Update", VPROF_BUDGETGROUP_NPCS );
 
+	// catch up on events that don't need handling the moment they happen
+	TheCSBots()->DeliverQueuedEvents( this );
+
 	// If bot_flipout is on, then we only do stuff in Upkeep().
 	if ( cv_bot_flipout.GetBool() )
 		return;
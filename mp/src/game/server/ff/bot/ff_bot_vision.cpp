@@ -562,6 +562,84 @@ const Vector &CCSBot::GetPartPosition( CCSPlayer *player, VisiblePartType part )
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Work out everything FindMostDangerousThreat() and UpdatePeripheralVision() need to see this tick.
+ * This runs on a worker thread alongside the other bots, so it may only read the world, and only
+ * part positions from the snapshot TheCSBots()->UpdatePerception() took before starting us.
+ */
+void CCSBot::ComputePerception( void )
+{
+	VPROF_BUDGET( "CCSBot::ComputePerception", VPROF_BUDGETGROUP_NPCS );
+
+	Q_memset( m_perception.m_visParts, NONE, sizeof( m_perception.m_visParts ) );
+
+	const CUtlVector< CCSBotManager::PerceptionTarget > &targets = TheCSBots()->GetPerceptionTargets();
+	for( int i=0; i<targets.Count(); ++i )
+	{
+		CCSPlayer *player = targets[i].m_player;
+
+		// ignore self
+		if (player == this)
+			continue;
+
+		int idx = player->entindex();
+		const PartInfo &info = m_partInfo[ idx % MAX_PLAYERS ];
+
+		// friends only need the less exact visibility check
+		if (player->InSameTeam( this ))
+		{
+			if (IsVisible( targets[i].m_center, false, this ))
+				m_perception.m_visParts[ idx ] = GUT;
+
+			continue;
+		}
+
+		// same as IsVisible( player, CHECK_FOV, &visParts ), against the snapshot
+		if (!FInViewCone( targets[i].m_center ))
+			continue;
+
+		unsigned char visParts = NONE;
+
+		if (IsVisible( info.m_gutPos, CHECK_FOV ))
+			visParts |= GUT;
+
+		if (IsVisible( info.m_headPos, CHECK_FOV ))
+			visParts |= HEAD;
+
+		if (IsVisible( info.m_feetPos, CHECK_FOV ))
+			visParts |= FEET;
+
+		if (IsVisible( info.m_leftSidePos, CHECK_FOV ))
+			visParts |= LEFT_SIDE;
+
+		if (IsVisible( info.m_rightSidePos, CHECK_FOV ))
+			visParts |= RIGHT_SIDE;
+
+		m_perception.m_visParts[ idx ] = visParts;
+	}
+
+	// peripheral vision - the spot list was sized before we started
+	if (m_perception.m_spotEncounter)
+	{
+		Vector pos;
+
+		FOR_EACH_VEC( m_perception.m_spotEncounter->spots, it )
+		{
+			const Vector &spotPos = m_perception.m_spotEncounter->spots[ it ].spot->GetPosition();
+
+			pos.x = spotPos.x;
+			pos.y = spotPos.y;
+			pos.z = spotPos.z + HalfHumanHeight;
+
+			m_perception.m_spotVisible[ it ] = IsVisible( pos, CHECK_FOV );
+		}
+	}
+
+	m_perception.m_tick = gpGlobals->tickcount;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Update desired view angles to point towards m_lookAtSpot
@@ -627,6 +705,16 @@ void CCSBot::InhibitLookAround( float duration )
 	m_inhibitLookAroundTimestamp = gpGlobals->curtime + duration;
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if it's time to check the encounter spots with our peripheral vision
+ */
+bool CCSBot::IsPeripheralVisionDue( void ) const
+{
+	const float peripheralUpdateInterval = 0.29f;		// if we update at 10Hz, this ensures we test once every three
+	return (gpGlobals->curtime - m_peripheralTimestamp >= peripheralUpdateInterval);
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Update enounter spot timestamps, etc
@@ -635,14 +723,18 @@ void CCSBot::UpdatePeripheralVision()
 {
 	VPROF_BUDGET( "CCSBot::UpdatePeripheralVision", VPROF_BUDGETGROUP_NPCS );
 
-	const float peripheralUpdateInterval = 0.29f;		// if we update at 10Hz, this ensures we test once every three
-	if (gpGlobals->curtime - m_peripheralTimestamp < peripheralUpdateInterval)
+	if (!IsPeripheralVisionDue())
 		return;
 
 	m_peripheralTimestamp = gpGlobals->curtime;
 
 	if (m_spotEncounter)
 	{
+		// use this tick's perception pass if it looked at the same spots
+		const bool usePerception = HasPerception() &&
+								   m_perception.m_spotEncounter == m_spotEncounter &&
+								   m_perception.m_spotVisible.Count() == m_spotEncounter->spots.Count();
+
 		// check LOS to all spots in case we see them with our "peripheral vision"
 		const SpotOrder *spotOrder;
 		Vector pos;
@@ -651,14 +743,22 @@ void CCSBot::UpdatePeripheralVision()
 		{
 			spotOrder = &m_spotEncounter->spots[ it ];
 
-			const Vector &spotPos = spotOrder->spot->GetPosition();
+			if (usePerception)
+			{
+				if (!m_perception.m_spotVisible[ it ])
+					continue;
+			}
+			else
+			{
+				const Vector &spotPos = spotOrder->spot->GetPosition();
 
-			pos.x = spotPos.x;
-			pos.y = spotPos.y;
-			pos.z = spotPos.z + HalfHumanHeight;
+				pos.x = spotPos.x;
+				pos.y = spotPos.y;
+				pos.z = spotPos.z + HalfHumanHeight;
 
-			if (!IsVisible( pos, CHECK_FOV ))
-				continue;
+				if (!IsVisible( pos, CHECK_FOV ))
+					continue;
+			}
 
 			// can see hiding spot, remember when we saw it last
 			SetHidingSpotCheckTimestamp( spotOrder->spot );
@@ -1232,6 +1332,9 @@ CCSPlayer *CCSBot::FindMostDangerousThreat( void )
 
 	const float lookingAtMeTolerance = 0.7071f;
 
+	// visibility was worked out in parallel with the other bots at the start of the tick
+	const bool hasPerception = HasPerception();
+
 	int i;
 
 	{
@@ -1262,7 +1365,13 @@ CCSPlayer *CCSBot::FindMostDangerousThreat( void )
 			if (player->InSameTeam( this ))
 			{
 				// keep track of nearby friends - use less exact visibility check
-				if (IsVisible( entity->WorldSpaceCenter(), false, this ))
+				bool isFriendVisible;
+				if (hasPerception)
+					isFriendVisible = (m_perception.m_visParts[ player->entindex() ] != NONE);
+				else
+					isFriendVisible = IsVisible( entity->WorldSpaceCenter(), false, this );
+
+				if (isFriendVisible)
 				{
 					// update watch timestamp
 					int idx = player->entindex();
@@ -1291,8 +1400,16 @@ CCSPlayer *CCSBot::FindMostDangerousThreat( void )
 
 			// check if this enemy is fully or partially visible
 			unsigned char visParts;
-			if (!IsVisible( player, CHECK_FOV, &visParts ))
+			if (hasPerception)
+			{
+				visParts = m_perception.m_visParts[ player->entindex() ];
+				if (visParts == NONE)
+					continue;
+			}
+			else if (!IsVisible( player, CHECK_FOV, &visParts ))
+			{
 				continue;
+			}
 
 			// do we notice this enemy? (always notice current enemy)
 			if (player != currentThreat)
@@ -0,0 +1,458 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_areaeffectmanager.cpp
+/// @brief Shared broadphase for lingering grenade effects
+///
+/// REVISIONS
+/// ---------
+/// Gas, slowfield and napalm register a volume here instead of each
+/// running its own entity sphere query every think. Players (and their
+/// buildables) are gathered once a tick and only tested against the
+/// volumes whose bounds they overlap.
+
+#include "cbase.h"
+#include "ff_areaeffectmanager.h"
+#include "ff_player.h"
+#include "ff_buildableobject.h"
+#include "ff_buildable_sentrygun.h"
+#include "ff_buildable_dispenser.h"
+#include "ff_buildable_mancannon.h"
+#include "collisionutils.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+// How far a volume can drift from where the broadphase saw it before its
+// candidates have to be found again. Covers grenades bobbing and rolling.
+#define AREAEFFECT_BROADPHASE_MARGIN	16.0f
+
+#define AREAEFFECT_HANDLE_INDEX( h )		( ( h ) & 0xFFFF )
+#define AREAEFFECT_HANDLE_SERIAL( h )		( ( h ) >> 16 )
+#define AREAEFFECT_MAKE_HANDLE( i, s )		( ( ( s ) << 16 ) | ( i ) )
+
+static CFFAreaEffectManager g_FFAreaEffectManager;
+
+CFFAreaEffectManager *FFAreaEffectManager()
+{
+	return &g_FFAreaEffectManager;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CFFAreaEffectManager::CFFAreaEffectManager() : CAutoGameSystemPerFrame( "FFAreaEffectManager" )
+{
+	m_nBroadphaseTick = -1;
+	m_nActiveVolumes = 0;
+	m_nNextSerial = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::LevelInitPreEntity()
+{
+	m_Volumes.RemoveAll();
+	m_Gathered.RemoveAll();
+	m_Candidates.RemoveAll();
+	m_nBroadphaseTick = -1;
+	m_nActiveVolumes = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::LevelShutdownPostEntity()
+{
+	m_Volumes.Purge();
+	m_Gathered.Purge();
+	m_Candidates.Purge();
+	m_nActiveVolumes = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Drop volumes whose entity has gone or whose time is up
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::FrameUpdatePostEntityThink()
+{
+	for ( int i = 0; i < m_Volumes.Count(); i++ )
+	{
+		Volume_t &volume = m_Volumes[i];
+
+		if ( !volume.m_bActive )
+			continue;
+
+		if ( !volume.m_hEntity.Get() || ( volume.m_flExpireTime && gpGlobals->curtime >= volume.m_flExpireTime ) )
+			FreeVolume( volume );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Start tracking a volume. Slots are reused, the serial in the
+//			handle stops a stale handle from finding someone else's volume.
+//-----------------------------------------------------------------------------
+AreaEffectHandle_t CFFAreaEffectManager::AddVolume( CBaseEntity *pEntity, const AreaEffectDesc_t &desc )
+{
+	if ( !pEntity )
+		return AREAEFFECT_INVALID_HANDLE;
+
+	int iSlot = -1;
+	for ( int i = 0; i < m_Volumes.Count(); i++ )
+	{
+		if ( !m_Volumes[i].m_bActive )
+		{
+			iSlot = i;
+			break;
+		}
+	}
+
+	if ( iSlot == -1 )
+	{
+		if ( m_Volumes.Count() > 0xFFFF )
+			return AREAEFFECT_INVALID_HANDLE;
+
+		iSlot = m_Volumes.AddToTail();
+	}
+
+	Volume_t &volume = m_Volumes[iSlot];
+	volume.m_hEntity = pEntity;
+	volume.m_Desc = desc;
+	volume.m_flExpireTime = ( desc.m_flLifetime > 0.0f ) ? gpGlobals->curtime + desc.m_flLifetime : 0.0f;
+	volume.m_nSerial = ( m_nNextSerial++ ) & 0x7FFF;
+	volume.m_bActive = true;
+	volume.m_iFirstCandidate = 0;
+	volume.m_nCandidates = 0;
+	volume.m_LastInside.RemoveAll();
+
+	m_nActiveVolumes++;
+
+	// Let it get its candidates on the next query, even if this tick's
+	// broadphase has already been done
+	if ( m_nBroadphaseTick == gpGlobals->tickcount )
+		BroadphaseVolume( volume, pEntity->GetAbsOrigin() + desc.m_vecOffset );
+
+	return AREAEFFECT_MAKE_HANDLE( iSlot, volume.m_nSerial );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::RemoveVolume( AreaEffectHandle_t &hVolume )
+{
+	Volume_t *pVolume = GetVolume( hVolume );
+
+	if ( pVolume )
+		FreeVolume( *pVolume );
+
+	hVolume = AREAEFFECT_INVALID_HANDLE;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool CFFAreaEffectManager::IsVolumeActive( AreaEffectHandle_t hVolume ) const
+{
+	return GetVolume( hVolume ) != NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A bigger radius is picked up by the next query, which finds
+//			candidates again if the broadphase was done with a smaller one
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::SetVolumeRadius( AreaEffectHandle_t hVolume, float flRadius )
+{
+	Volume_t *pVolume = GetVolume( hVolume );
+
+	if ( pVolume )
+		pVolume->m_Desc.m_flRadius = flRadius;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Exact test of this volume against its broadphase candidates
+//-----------------------------------------------------------------------------
+int CFFAreaEffectManager::GetEntitiesInVolume( AreaEffectHandle_t hVolume, CUtlVector<CBaseEntity *> &inside, CUtlVector<CBaseEntity *> *pExited )
+{
+	inside.RemoveAll();
+
+	if ( pExited )
+		pExited->RemoveAll();
+
+	Volume_t *pVolume = GetVolume( hVolume );
+
+	if ( !pVolume )
+		return 0;
+
+	CBaseEntity *pEntity = pVolume->m_hEntity.Get();
+
+	if ( !pEntity )
+		return 0;
+
+	if ( m_nBroadphaseTick != gpGlobals->tickcount )
+		UpdateBroadphase();
+
+	Vector vecCenter = pEntity->GetAbsOrigin() + pVolume->m_Desc.m_vecOffset;
+
+	// Moved (or grew) too much since the broadphase, so look again
+	if ( pVolume->m_Desc.m_flRadius > pVolume->m_flBroadRadius || vecCenter.DistToSqr( pVolume->m_vecBroadCenter ) > Square( AREAEFFECT_BROADPHASE_MARGIN ) )
+		BroadphaseVolume( *pVolume, vecCenter );
+
+	for ( int i = 0; i < pVolume->m_nCandidates; i++ )
+	{
+		const Candidate_t &candidate = m_Gathered[ m_Candidates[ pVolume->m_iFirstCandidate + i ] ];
+
+		// Could have died and gone into spectator since the gather
+		if ( !candidate.m_bBuildable && ToBasePlayer( candidate.m_pEntity )->IsObserver() )
+			continue;
+
+		if ( IsInside( *pVolume, vecCenter, candidate ) )
+			inside.AddToTail( candidate.m_pEntity );
+	}
+
+	if ( pExited )
+	{
+		for ( int i = 0; i < pVolume->m_LastInside.Count(); i++ )
+		{
+			CBaseEntity *pLast = pVolume->m_LastInside[i].Get();
+
+			if ( pLast && !inside.HasElement( pLast ) )
+				pExited->AddToTail( pLast );
+		}
+	}
+
+	pVolume->m_LastInside.SetCount( inside.Count() );
+	for ( int i = 0; i < inside.Count(); i++ )
+		pVolume->m_LastInside[i] = inside[i];
+
+	return inside.Count();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+int CFFAreaEffectManager::GetLastEntitiesInVolume( AreaEffectHandle_t hVolume, CUtlVector<CBaseEntity *> &inside ) const
+{
+	inside.RemoveAll();
+
+	const Volume_t *pVolume = GetVolume( hVolume );
+
+	if ( !pVolume )
+		return 0;
+
+	for ( int i = 0; i < pVolume->m_LastInside.Count(); i++ )
+	{
+		CBaseEntity *pLast = pVolume->m_LastInside[i].Get();
+
+		if ( pLast )
+			inside.AddToTail( pLast );
+	}
+
+	return inside.Count();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CFFAreaEffectManager::Volume_t *CFFAreaEffectManager::GetVolume( AreaEffectHandle_t hVolume )
+{
+	if ( hVolume == AREAEFFECT_INVALID_HANDLE )
+		return NULL;
+
+	int iSlot = AREAEFFECT_HANDLE_INDEX( hVolume );
+
+	if ( !m_Volumes.IsValidIndex( iSlot ) )
+		return NULL;
+
+	Volume_t &volume = m_Volumes[iSlot];
+
+	if ( !volume.m_bActive || volume.m_nSerial != AREAEFFECT_HANDLE_SERIAL( hVolume ) )
+		return NULL;
+
+	if ( volume.m_flExpireTime && gpGlobals->curtime >= volume.m_flExpireTime )
+		return NULL;
+
+	return &volume;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+const CFFAreaEffectManager::Volume_t *CFFAreaEffectManager::GetVolume( AreaEffectHandle_t hVolume ) const
+{
+	return const_cast<CFFAreaEffectManager *>( this )->GetVolume( hVolume );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::FreeVolume( Volume_t &volume )
+{
+	volume.m_bActive = false;
+	volume.m_hEntity = NULL;
+	volume.m_nCandidates = 0;
+	volume.m_LastInside.Purge();
+
+	m_nActiveVolumes--;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gather once, then bucket the gathered entities by the volumes
+//			whose bounds they overlap
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::UpdateBroadphase()
+{
+	VPROF_BUDGET( "CFFAreaEffectManager::UpdateBroadphase", VPROF_BUDGETGROUP_GAME );
+
+	m_nBroadphaseTick = gpGlobals->tickcount;
+	m_Candidates.RemoveAll();
+
+	GatherCandidates();
+
+	for ( int i = 0; i < m_Volumes.Count(); i++ )
+	{
+		Volume_t &volume = m_Volumes[i];
+
+		if ( !volume.m_bActive )
+			continue;
+
+		CBaseEntity *pEntity = volume.m_hEntity.Get();
+
+		if ( !pEntity )
+		{
+			volume.m_nCandidates = 0;
+			continue;
+		}
+
+		BroadphaseVolume( volume, pEntity->GetAbsOrigin() + volume.m_Desc.m_vecOffset );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Everything a volume can affect: players that aren't spectating
+//			and, if anyone wants them, their buildables
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::GatherCandidates()
+{
+	m_Gathered.RemoveAll();
+
+	bool bBuildables = false;
+	for ( int i = 0; i < m_Volumes.Count(); i++ )
+	{
+		if ( m_Volumes[i].m_bActive && ( m_Volumes[i].m_Desc.m_iFlags & AREAEFFECT_BUILDABLES ) )
+		{
+			bBuildables = true;
+			break;
+		}
+	}
+
+	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
+	{
+		CFFPlayer *pPlayer = ToFFPlayer( UTIL_PlayerByIndex( i ) );
+
+		if ( !pPlayer )
+			continue;
+
+		if ( !pPlayer->IsObserver() )
+			AddCandidate( pPlayer, false );
+
+		if ( !bBuildables )
+			continue;
+
+		if ( pPlayer->GetSentryGun() )
+			AddCandidate( pPlayer->GetSentryGun(), true );
+
+		if ( pPlayer->GetDispenser() )
+			AddCandidate( pPlayer->GetDispenser(), true );
+
+		if ( pPlayer->GetManCannon() )
+			AddCandidate( pPlayer->GetManCannon(), true );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::AddCandidate( CBaseEntity *pEntity, bool bBuildable )
+{
+	Candidate_t &candidate = m_Gathered[ m_Gathered.AddToTail() ];
+	candidate.m_pEntity = pEntity;
+	candidate.m_vecOrigin = pEntity->GetAbsOrigin();
+	pEntity->CollisionProp()->WorldSpaceSurroundingBounds( &candidate.m_vecMins, &candidate.m_vecMaxs );
+	candidate.m_iTeam = pEntity->GetTeamNumber();
+	candidate.m_bBuildable = bBuildable;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Find the gathered entities whose bounds overlap the volume's,
+//			grown by the margin. They're added as a fresh run on the end of
+//			m_Candidates, so a volume can be redone partway through a tick.
+//-----------------------------------------------------------------------------
+void CFFAreaEffectManager::BroadphaseVolume( Volume_t &volume, const Vector &vecCenter )
+{
+	const AreaEffectDesc_t &desc = volume.m_Desc;
+
+	float flReach = desc.m_flRadius + AREAEFFECT_BROADPHASE_MARGIN;
+	float flReachZ = ( desc.m_iShape == AREAEFFECT_CYLINDER ? desc.m_flHeight : desc.m_flRadius ) + AREAEFFECT_BROADPHASE_MARGIN;
+
+	Vector vecMins( vecCenter.x - flReach, vecCenter.y - flReach, vecCenter.z - flReachZ );
+	Vector vecMaxs( vecCenter.x + flReach, vecCenter.y + flReach, vecCenter.z + flReachZ );
+
+	volume.m_vecBroadCenter = vecCenter;
+	volume.m_flBroadRadius = desc.m_flRadius;
+	volume.m_iFirstCandidate = m_Candidates.Count();
+	volume.m_nCandidates = 0;
+
+	for ( int i = 0; i < m_Gathered.Count(); i++ )
+	{
+		const Candidate_t &candidate = m_Gathered[i];
+
+		if ( candidate.m_bBuildable && !( desc.m_iFlags & AREAEFFECT_BUILDABLES ) )
+			continue;
+
+		if ( candidate.m_iTeam >= 0 && candidate.m_iTeam < 32 && !( desc.m_iTeamMask & ( 1u << candidate.m_iTeam ) ) )
+			continue;
+
+		if ( !IsBoxIntersectingBox( vecMins, vecMaxs, candidate.m_vecMins, candidate.m_vecMaxs ) )
+			continue;
+
+		m_Candidates.AddToTail( i );
+		volume.m_nCandidates++;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The exact test. Bounds are tested the way CEntitySphereQuery
+//			does, origins the way the old slowfield distance check did.
+//-----------------------------------------------------------------------------
+bool CFFAreaEffectManager::IsInside( const Volume_t &volume, const Vector &vecCenter, const Candidate_t &candidate ) const
+{
+	const AreaEffectDesc_t &desc = volume.m_Desc;
+	CBaseEntity *pEntity = candidate.m_pEntity;
+
+	if ( desc.m_iFlags & AREAEFFECT_ORIGINONLY )
+	{
+		Vector vecOrigin = pEntity->GetAbsOrigin();
+
+		if ( desc.m_iShape == AREAEFFECT_CYLINDER )
+			return ( vecOrigin.AsVector2D() - vecCenter.AsVector2D() ).LengthSqr() < Square( desc.m_flRadius ) && fabs( vecOrigin.z - vecCenter.z ) <= desc.m_flHeight;
+
+		return vecOrigin.DistToSqr( vecCenter ) < Square( desc.m_flRadius );
+	}
+
+	Vector vecMins, vecMaxs;
+	pEntity->CollisionProp()->WorldSpaceSurroundingBounds( &vecMins, &vecMaxs );
+
+	if ( desc.m_iShape == AREAEFFECT_CYLINDER )
+	{
+		if ( vecMaxs.z < vecCenter.z - desc.m_flHeight || vecMins.z > vecCenter.z + desc.m_flHeight )
+			return false;
+
+		float dx = vecCenter.x - clamp( vecCenter.x, vecMins.x, vecMaxs.x );
+		float dy = vecCenter.y - clamp( vecCenter.y, vecMins.y, vecMaxs.y );
+
+		return dx * dx + dy * dy <= Square( desc.m_flRadius );
+	}
+
+	return IsBoxIntersectingSphere( vecMins, vecMaxs, vecCenter, desc.m_flRadius );
+}
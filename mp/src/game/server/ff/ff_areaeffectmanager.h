@@ -0,0 +1,134 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_areaeffectmanager.h
+/// @brief Shared broadphase for lingering grenade effects
+///
+/// REVISIONS
+/// ---------
+/// Gas, slowfield and napalm register a volume here instead of each
+/// running its own entity sphere query every think. Players (and their
+/// buildables) are gathered once a tick and only tested against the
+/// volumes whose bounds they overlap.
+
+#ifndef FF_AREAEFFECTMANAGER_H
+#define FF_AREAEFFECTMANAGER_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "igamesystem.h"
+#include "utlvector.h"
+
+enum AreaEffectShape_t
+{
+	AREAEFFECT_SPHERE = 0,
+	AREAEFFECT_CYLINDER,		// upright, m_flHeight above and below the centre
+};
+
+// Volume flags
+#define AREAEFFECT_BUILDABLES		0x0001		// sentries, dispensers and jump pads as well as players
+#define AREAEFFECT_ORIGINONLY		0x0002		// test entity origins rather than their bounds
+
+#define AREAEFFECT_ALLTEAMS			0xFFFFFFFF
+
+typedef int AreaEffectHandle_t;
+#define AREAEFFECT_INVALID_HANDLE	-1
+
+struct AreaEffectDesc_t
+{
+	AreaEffectDesc_t()
+	{
+		m_iShape = AREAEFFECT_SPHERE;
+		m_flRadius = 0.0f;
+		m_flHeight = 0.0f;
+		m_vecOffset = vec3_origin;
+		m_flLifetime = 0.0f;
+		m_iFlags = 0;
+		m_iTeamMask = AREAEFFECT_ALLTEAMS;
+	}
+
+	int		m_iShape;			// AREAEFFECT_SPHERE, AREAEFFECT_CYLINDER
+	float	m_flRadius;
+	float	m_flHeight;			// cylinders only
+	Vector	m_vecOffset;		// from the entity the volume follows
+	float	m_flLifetime;		// 0 lasts until the volume is removed
+	int		m_iFlags;			// AREAEFFECT_*
+	unsigned int m_iTeamMask;	// ( 1 << team ) for each team to include
+};
+
+class CFFAreaEffectManager : public CAutoGameSystemPerFrame
+{
+public:
+	CFFAreaEffectManager();
+
+	// CAutoGameSystemPerFrame
+	virtual void LevelInitPreEntity();
+	virtual void LevelShutdownPostEntity();
+	virtual void FrameUpdatePostEntityThink();
+
+	// The volume follows pEntity around and goes away when it's removed
+	AreaEffectHandle_t AddVolume( CBaseEntity *pEntity, const AreaEffectDesc_t &desc );
+	void	RemoveVolume( AreaEffectHandle_t &hVolume );
+	bool	IsVolumeActive( AreaEffectHandle_t hVolume ) const;
+	void	SetVolumeRadius( AreaEffectHandle_t hVolume, float flRadius );
+
+	// Fills in what is inside the volume right now. If pExited is given it
+	// gets anything that was inside last time this was called but isn't now.
+	int		GetEntitiesInVolume( AreaEffectHandle_t hVolume, CUtlVector<CBaseEntity *> &inside, CUtlVector<CBaseEntity *> *pExited = NULL );
+
+	// What was inside the last time GetEntitiesInVolume was called
+	int		GetLastEntitiesInVolume( AreaEffectHandle_t hVolume, CUtlVector<CBaseEntity *> &inside ) const;
+
+	int		GetVolumeCount() const { return m_nActiveVolumes; }
+
+private:
+	struct Volume_t
+	{
+		EHANDLE		m_hEntity;
+		AreaEffectDesc_t m_Desc;
+		float		m_flExpireTime;
+		int			m_nSerial;
+		bool		m_bActive;
+
+		// Broadphase result for the current tick
+		Vector		m_vecBroadCenter;
+		float		m_flBroadRadius;
+		int			m_iFirstCandidate;		// into m_Candidates
+		int			m_nCandidates;
+
+		CUtlVector<EHANDLE>	m_LastInside;
+	};
+
+	struct Candidate_t
+	{
+		CBaseEntity	*m_pEntity;
+		Vector		m_vecOrigin;
+		Vector		m_vecMins;				// world space
+		Vector		m_vecMaxs;
+		int			m_iTeam;
+		bool		m_bBuildable;
+	};
+
+	Volume_t	*GetVolume( AreaEffectHandle_t hVolume );
+	const Volume_t *GetVolume( AreaEffectHandle_t hVolume ) const;
+	void	FreeVolume( Volume_t &volume );
+
+	void	UpdateBroadphase();
+	void	GatherCandidates();
+	void	AddCandidate( CBaseEntity *pEntity, bool bBuildable );
+	void	BroadphaseVolume( Volume_t &volume, const Vector &vecCenter );
+	bool	IsInside( const Volume_t &volume, const Vector &vecCenter, const Candidate_t &candidate ) const;
+
+	CUtlVector<Volume_t>	m_Volumes;
+	CUtlVector<Candidate_t>	m_Gathered;		// everything that can be affected this tick
+	CUtlVector<int>			m_Candidates;	// into m_Gathered, grouped by volume
+
+	int		m_nBroadphaseTick;
+	int		m_nActiveVolumes;
+	int		m_nNextSerial;
+};
+
+CFFAreaEffectManager *FFAreaEffectManager();
+
+#endif // FF_AREAEFFECTMANAGER_H
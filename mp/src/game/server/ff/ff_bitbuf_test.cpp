@@ -0,0 +1,399 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_bitbuf_test.cpp
+/// @brief Checks and times the bulk bf_write/bf_read calls
+///
+/// REVISIONS
+/// ---------
+/// Each check picks a field type, width, count and unaligned start bit at
+/// random, and writes the fields one call at a time and again through
+/// WriteUBitLongs/WriteUBitVars or bf_write_accumulator. The two streams
+/// have to be bit for bit the same, and reading them back one at a time and
+/// in bulk has to give the fields written. Seeded, so a failure repeats. The benchmark times the same
+/// calls per field on an FF_HudLua HUD_BOX message and a snapshot sized
+/// stream.
+
+#include "cbase.h"
+#include "bitbuf.h"
+#include "vstdlib/random.h"
+#include "tier0/fasttimer.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+#define BITBUFTEST_MAX_FIELDS	64
+
+// dwords, bitbufs need them aligned. Big enough for the snapshot stream.
+#define BITBUFTEST_BUFFER_SIZE	8192
+
+static unsigned int s_BitBufA[BITBUFTEST_BUFFER_SIZE];
+static unsigned int s_BitBufB[BITBUFTEST_BUFFER_SIZE];
+
+static CUniformRandomStream s_BitBufRandom;
+
+static unsigned int FF_BitBufRandomDWord()
+{
+	return (unsigned int)s_BitBufRandom.RandomInt( 0, 0x7FFFFFFF ) * 2 + s_BitBufRandom.RandomInt( 0, 1 );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the same fields to both buffers one at a time and in bulk,
+//			and reads them back both ways. Returns false if anything differs.
+//-----------------------------------------------------------------------------
+static bool FF_BitBufTestOnce()
+{
+	int nBytes = 4 * s_BitBufRandom.RandomInt( 1, 40 );
+	for ( int i = 0; i < nBytes / 4; i++ )
+		s_BitBufA[i] = s_BitBufB[i] = FF_BitBufRandomDWord();
+
+	// sometimes a bit count that doesn't fill the buffer, so it overflows mid dword
+	int nMaxBits = nBytes * 8 - ( s_BitBufRandom.RandomInt( 0, 1 ) ? s_BitBufRandom.RandomInt( 0, 30 ) : 0 );
+	int iStartBit = s_BitBufRandom.RandomInt( 0, nMaxBits / 2 );
+	if ( s_BitBufRandom.RandomInt( 0, 2 ) == 0 )
+		iStartBit &= ~7;
+
+	bf_write bufA( s_BitBufA, nBytes, nMaxBits ), bufB( s_BitBufB, nBytes, nMaxBits );
+	bufA.SetAssertOnOverflow( false );
+	bufB.SetAssertOnOverflow( false );
+	bufA.SeekToBit( iStartBit );
+	bufB.SeekToBit( iStartBit );
+
+	// whole bytes, words and dwords a third of the time for the aligned paths
+	int iType = s_BitBufRandom.RandomInt( 0, 3 );
+	int nBits = s_BitBufRandom.RandomInt( 0, 2 ) ? s_BitBufRandom.RandomInt( 1, 32 ) : ( 8 << s_BitBufRandom.RandomInt( 0, 2 ) );
+	int nCount = s_BitBufRandom.RandomInt( 0, BITBUFTEST_MAX_FIELDS - 20 );
+
+	unsigned int values[BITBUFTEST_MAX_FIELDS];
+	int widths[BITBUFTEST_MAX_FIELDS];
+	for ( int i = 0; i < nCount; i++ )
+	{
+		values[i] = FF_BitBufRandomDWord();
+		widths[i] = s_BitBufRandom.RandomInt( 1, 32 );
+
+		if ( iType == 1 && nBits < 32 )
+		{
+			// signed values that fit
+			values[i] = (unsigned int)( (int)( values[i] << ( 32 - nBits ) ) >> ( 32 - nBits ) );
+		}
+		else if ( iType == 0 || iType == 2 )
+		{
+			// varints want all the sizes, not just big ones
+			if ( nBits < 32 )
+				values[i] &= ( 1u << nBits ) - 1;
+			values[i] >>= s_BitBufRandom.RandomInt( 0, 31 );
+		}
+	}
+
+	switch ( iType )
+	{
+	case 0:
+		for ( int i = 0; i < nCount; i++ )
+			bufA.WriteUBitLong( values[i], nBits );
+		bufB.WriteUBitLongs( values, nCount, nBits );
+		break;
+
+	case 1:
+		for ( int i = 0; i < nCount; i++ )
+			bufA.WriteSBitLong( values[i], nBits );
+		bufB.WriteSBitLongs( (int *)values, nCount, nBits );
+		break;
+
+	case 2:
+		for ( int i = 0; i < nCount; i++ )
+			bufA.WriteUBitVar( values[i] );
+		bufB.WriteUBitVars( values, nCount );
+		break;
+
+	default:
+		{
+			// any mix of widths, with a flush partway through
+			for ( int i = 0; i < nCount; i++ )
+				bufA.WriteUBitLong( values[i], widths[i], false );
+
+			bf_write_accumulator accum( bufB );
+			for ( int i = 0; i < nCount; i++ )
+			{
+				accum.WriteUBitLong( values[i], widths[i] );
+				if ( i == nCount / 2 )
+					accum.Flush();
+			}
+		}
+		break;
+	}
+
+	if ( bufA.GetNumBitsWritten() != bufB.GetNumBitsWritten() || bufA.IsOverflowed() != bufB.IsOverflowed() || Q_memcmp( s_BitBufA, s_BitBufB, nBytes ) )
+	{
+		Warning( "Write mismatch: type %d, %d bits, %d fields from bit %d of %d\n", iType, nBits, nCount, iStartBit, nMaxBits );
+		return false;
+	}
+
+	if ( iType == 3 )
+		return true;
+
+	// read past the end now and then, so it overflows
+	int nReadCount = nCount + ( s_BitBufRandom.RandomInt( 0, 3 ) ? 0 : 20 );
+	unsigned int resultsA[BITBUFTEST_MAX_FIELDS], resultsB[BITBUFTEST_MAX_FIELDS];
+
+	bf_read readA( s_BitBufA, nBytes, nMaxBits ), readB( s_BitBufA, nBytes, nMaxBits );
+	readA.SetAssertOnOverflow( false );
+	readB.SetAssertOnOverflow( false );
+	readA.Seek( iStartBit );
+	readB.Seek( iStartBit );
+
+	switch ( iType )
+	{
+	case 0:
+		for ( int i = 0; i < nReadCount; i++ )
+			resultsA[i] = readA.ReadUBitLong( nBits );
+		readB.ReadUBitLongs( resultsB, nReadCount, nBits );
+		break;
+
+	case 1:
+		for ( int i = 0; i < nReadCount; i++ )
+			resultsA[i] = readA.ReadSBitLong( nBits );
+		readB.ReadSBitLongs( (int *)resultsB, nReadCount, nBits );
+		break;
+
+	default:
+		for ( int i = 0; i < nReadCount; i++ )
+			resultsA[i] = readA.ReadUBitVar();
+		readB.ReadUBitVars( resultsB, nReadCount );
+		break;
+	}
+
+	if ( readA.GetNumBitsRead() != readB.GetNumBitsRead() || readA.IsOverflowed() != readB.IsOverflowed() || Q_memcmp( resultsA, resultsB, nReadCount * sizeof( unsigned int ) ) )
+	{
+		Warning( "Read mismatch: type %d, %d bits, %d fields from bit %d of %d\n", iType, nBits, nReadCount, iStartBit, nMaxBits );
+		return false;
+	}
+
+	if ( !bufA.IsOverflowed() && Q_memcmp( resultsA, values, nCount * sizeof( unsigned int ) ) )
+	{
+		Warning( "Round trip mismatch: type %d, %d bits, %d fields\n", iType, nBits, nCount );
+		return false;
+	}
+
+	return true;
+}
+
+CON_COMMAND_F( ffdev_bitbuf_test, "Checks the bulk and accumulator bitbuf calls write and read the same bits as one call per field. Usage: ffdev_bitbuf_test [iterations]", FCVAR_CHEAT )
+{
+	int nIterations = ( args.ArgC() > 1 ) ? clamp( atoi( args[1] ), 1, 10000000 ) : 100000;
+
+	s_BitBufRandom.SetSeed( 1 );
+
+	int nFailed = 0;
+	for ( int i = 0; i < nIterations && nFailed < 10; i++ )
+	{
+		if ( !FF_BitBufTestOnce() )
+			nFailed++;
+	}
+
+	Msg( nFailed ? "ffdev_bitbuf_test: %d failures\n" : "ffdev_bitbuf_test: all %d passed\n", nFailed ? nFailed : nIterations );
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+
+// A FF_HudLua HUD_BOX message, everything after the type byte
+static int s_HudBoxValues[] = { 12, 5, 120, 64, 32, 255, 255, 255, 96, 0, 0, 0, 255, 2, 1, 0 };
+
+// Fields of one entity in the snapshot stream: a UBitVar prop index delta then
+// the value, the widths the player and projectile props tend to use
+static const int s_SnapshotWidths[] = { 1, 11, 11, 11, 7, 8, 13, 2, 1, 16, 32, 5, 9, 20, 20, 20 };
+
+#define BITBUFTEST_SNAPSHOT_ENTITIES	200
+
+static unsigned int s_SnapshotValues[BITBUFTEST_SNAPSHOT_ENTITIES * ARRAYSIZE( s_SnapshotWidths )];
+static unsigned int s_SnapshotDeltas[BITBUFTEST_SNAPSHOT_ENTITIES * ARRAYSIZE( s_SnapshotWidths )];
+static unsigned int s_ColumnValues[BITBUFTEST_SNAPSHOT_ENTITIES * ARRAYSIZE( s_SnapshotWidths )];
+static unsigned int s_Results[BITBUFTEST_SNAPSHOT_ENTITIES * ARRAYSIZE( s_SnapshotWidths )];
+
+static int FF_BitBufWriteHudBox( bool bBulk )
+{
+	bf_write buf( s_BitBufA, sizeof( s_BitBufA ) );
+	buf.WriteByte( 1 );
+	if ( bBulk )
+	{
+		buf.WriteSBitLongs( s_HudBoxValues, ARRAYSIZE( s_HudBoxValues ), 16 );
+	}
+	else
+	{
+		for ( int i = 0; i < ARRAYSIZE( s_HudBoxValues ); i++ )
+			buf.WriteShort( s_HudBoxValues[i] );
+	}
+	return buf.GetNumBytesWritten();
+}
+
+static int FF_BitBufReadHudBox( bool bBulk )
+{
+	int values[ARRAYSIZE( s_HudBoxValues )];
+
+	bf_read buf( s_BitBufA, sizeof( s_BitBufA ) );
+	buf.ReadByte();
+	if ( bBulk )
+	{
+		buf.ReadSBitLongs( values, ARRAYSIZE( values ), 16 );
+	}
+	else
+	{
+		for ( int i = 0; i < ARRAYSIZE( values ); i++ )
+			values[i] = buf.ReadShort();
+	}
+	return values[ARRAYSIZE( values ) - 1];
+}
+
+static int FF_BitBufWriteSnapshot( bool bBulk )
+{
+	bf_write buf( s_BitBufA, sizeof( s_BitBufA ) );
+	if ( bBulk )
+	{
+		bf_write_accumulator accum( buf );
+		for ( int i = 0; i < ARRAYSIZE( s_SnapshotValues ); i++ )
+		{
+			accum.WriteUBitVar( s_SnapshotDeltas[i] );
+			accum.WriteUBitLong( s_SnapshotValues[i], s_SnapshotWidths[i % ARRAYSIZE( s_SnapshotWidths )] );
+		}
+	}
+	else
+	{
+		for ( int i = 0; i < ARRAYSIZE( s_SnapshotValues ); i++ )
+		{
+			buf.WriteUBitVar( s_SnapshotDeltas[i] );
+			buf.WriteUBitLong( s_SnapshotValues[i], s_SnapshotWidths[i % ARRAYSIZE( s_SnapshotWidths )] );
+		}
+	}
+	return buf.GetNumBytesWritten();
+}
+
+// The same prop over every entity, all one width
+static int FF_BitBufWriteColumn( bool bBulk, int nBits )
+{
+	bf_write buf( s_BitBufA, sizeof( s_BitBufA ) );
+	if ( bBulk )
+	{
+		buf.WriteUBitLongs( s_ColumnValues, ARRAYSIZE( s_ColumnValues ), nBits );
+	}
+	else
+	{
+		for ( int i = 0; i < ARRAYSIZE( s_ColumnValues ); i++ )
+			buf.WriteUBitLong( s_ColumnValues[i], nBits );
+	}
+	return buf.GetNumBytesWritten();
+}
+
+static int FF_BitBufReadColumn( bool bBulk, int nBits )
+{
+	bf_read buf( s_BitBufA, sizeof( s_BitBufA ) );
+	if ( bBulk )
+	{
+		buf.ReadUBitLongs( s_Results, ARRAYSIZE( s_Results ), nBits );
+	}
+	else
+	{
+		for ( int i = 0; i < ARRAYSIZE( s_Results ); i++ )
+			s_Results[i] = buf.ReadUBitLong( nBits );
+	}
+	return s_Results[0];
+}
+
+static int FF_BitBufReadDeltas( bool bBulk )
+{
+	bf_read buf( s_BitBufA, sizeof( s_BitBufA ) );
+	if ( bBulk )
+	{
+		buf.ReadUBitVars( s_Results, ARRAYSIZE( s_Results ) );
+	}
+	else
+	{
+		for ( int i = 0; i < ARRAYSIZE( s_Results ); i++ )
+			s_Results[i] = buf.ReadUBitVar();
+	}
+	return s_Results[0];
+}
+
+typedef int ( *BitBufBenchmarkFn )( bool bBulk, int nBits );
+
+static int FF_BitBufWriteHudBoxFn( bool bBulk, int nBits ) { return FF_BitBufWriteHudBox( bBulk ); }
+static int FF_BitBufReadHudBoxFn( bool bBulk, int nBits ) { return FF_BitBufReadHudBox( bBulk ); }
+static int FF_BitBufWriteSnapshotFn( bool bBulk, int nBits ) { return FF_BitBufWriteSnapshot( bBulk ); }
+static int FF_BitBufReadDeltasFn( bool bBulk, int nBits ) { return FF_BitBufReadDeltas( bBulk ); }
+
+//-----------------------------------------------------------------------------
+// Purpose: Times fn one field at a time and in bulk, and prints both.
+//			nFields is how many fields one call does, for the per field time.
+//-----------------------------------------------------------------------------
+static int FF_BitBufBenchmark( const char *pszName, BitBufBenchmarkFn fn, int nBits, int nIterations, int nFields )
+{
+	static const char *s_pszModes[] = { "PerField", "Bulk" };
+
+	int nSink = 0;
+	for ( int iMode = 0; iMode < 2; iMode++ )
+	{
+		CFastTimer timer;
+		timer.Start();
+		for ( int i = 0; i < nIterations; i++ )
+			nSink += fn( iMode == 1, nBits );
+		timer.End();
+
+		char szName[128];
+		Q_snprintf( szName, sizeof( szName ), "%s/%s", pszName, s_pszModes[iMode] );
+		Msg( "%-40s %10.2f ns %12d\n", szName, timer.GetDuration().GetSeconds() * 1e9 / ( (double)nIterations * nFields ), nIterations * nFields );
+	}
+	return nSink;
+}
+
+CON_COMMAND_F( ffdev_bitbuf_benchmark, "Times writing and reading FF user messages and snapshot sized streams one field at a time against the bulk bitbuf calls. Usage: ffdev_bitbuf_benchmark [iterations]", FCVAR_CHEAT )
+{
+	int nIterations = ( args.ArgC() > 1 ) ? clamp( atoi( args[1] ), 1, 1000000 ) : 10000;
+
+	s_BitBufRandom.SetSeed( 1 );
+	for ( int i = 0; i < ARRAYSIZE( s_SnapshotValues ); i++ )
+	{
+		int nBits = s_SnapshotWidths[i % ARRAYSIZE( s_SnapshotWidths )];
+		s_SnapshotValues[i] = s_BitBufRandom.RandomInt( 0, 0x7FFFFFFF ) & ( nBits < 32 ? ( 1u << nBits ) - 1 : ~0u );
+
+		// mostly the next prop, sometimes a jump
+		s_SnapshotDeltas[i] = s_BitBufRandom.RandomInt( 0, 3 ) ? 0 : s_BitBufRandom.RandomInt( 1, 300 );
+	}
+
+	Msg( "%-40s %13s %12s\n", "Benchmark (per field)", "Time", "Iterations" );
+	Msg( "------------------------------------------------------------------\n" );
+
+	int nSink = 0;
+	nSink += FF_BitBufBenchmark( "HudBox/Write", FF_BitBufWriteHudBoxFn, 0, nIterations, ARRAYSIZE( s_HudBoxValues ) );
+	nSink += FF_BitBufBenchmark( "HudBox/Read", FF_BitBufReadHudBoxFn, 0, nIterations, ARRAYSIZE( s_HudBoxValues ) );
+
+	// the snapshot sized ones are a few thousand fields a call
+	int nFields = ARRAYSIZE( s_SnapshotValues );
+	int nSnapshotIterations = MAX( nIterations / 100, 1 );
+
+	nSink += FF_BitBufBenchmark( "Snapshot/Write", FF_BitBufWriteSnapshotFn, 0, nSnapshotIterations, nFields * 2 );
+
+	static const int s_ColumnBits[] = { 7, 11, 16, 20 };
+	for ( int iBits = 0; iBits < ARRAYSIZE( s_ColumnBits ); iBits++ )
+	{
+		int nBits = s_ColumnBits[iBits];
+		for ( int i = 0; i < nFields; i++ )
+			s_ColumnValues[i] = s_SnapshotValues[i] & ( ( 1u << nBits ) - 1 );
+
+		char szName[64];
+		Q_snprintf( szName, sizeof( szName ), "Column%d/Write", nBits );
+		nSink += FF_BitBufBenchmark( szName, FF_BitBufWriteColumn, nBits, nSnapshotIterations, nFields );
+
+		Q_snprintf( szName, sizeof( szName ), "Column%d/Read", nBits );
+		nSink += FF_BitBufBenchmark( szName, FF_BitBufReadColumn, nBits, nSnapshotIterations, nFields );
+	}
+
+	// a stream of prop index deltas on their own
+	{
+		bf_write buf( s_BitBufA, sizeof( s_BitBufA ) );
+		buf.WriteUBitVars( s_SnapshotDeltas, nFields );
+	}
+	nSink += FF_BitBufBenchmark( "UBitVar/Read", FF_BitBufReadDeltasFn, 0, nSnapshotIterations, nFields );
+
+	// keeps the work from being optimized out
+	DevMsg( 2, "%d\n", nSink );
+}
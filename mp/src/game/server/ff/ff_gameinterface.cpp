@@ -34,7 +34,8 @@ void CServerGameDLL::LevelInit_ParseAllEntities( const char *pMapEntities )
 	// Mulch: 9/6/2007: New blatantly stolen code from: http://developer.valvesoftware.com/wiki/Resetting_Maps_and_Entities
 	// Load the entities and build up a new list of the map entities and their starting state in here.
 	g_MapEntityRefs.Purge();
-	CMapLoadEntityFilter filter;
+	g_FFMapSnapshot.Clear();
+	CFFMapLoadEntityFilter filter;
 	MapEntity_ParseAllEntities( pMapEntities, &filter );
 }
 
@@ -5,6 +5,7 @@
 #include "ff_utils.h"
 
 #include "ff_player.h"
+#include "ff_areaeffectmanager.h"
 
 //ConVar ffdev_nap_bonusdamage_burn1("ffdev_nap_bonusdamage_burn1", "0", FCVAR_REPLICATED | FCVAR_CHEAT);
 #define NAP_BONUSDAMAGE_BURN1 0 //ffdev_nap_bonusdamage_burn1.GetInt()
@@ -40,6 +41,8 @@ void CFFGrenadeNapalmlet::UpdateOnRemove( void )
 	StopSound( "General.BurningFlesh" );
 	StopSound( "General.BurningObject" );
 
+	FFAreaEffectManager()->RemoveVolume( m_hAreaEffect );
+
 	BaseClass::UpdateOnRemove();
 }
 
@@ -78,6 +81,13 @@ void CFFGrenadeNapalmlet::Spawn( void )
 		SetEffectEntity( m_pFlame );
 		m_pFlame->SetSize( FFDEV_NAP_FLAMESIZE );
 	}
+
+	// Burns buildables as well as players
+	AreaEffectDesc_t desc;
+	desc.m_flRadius = NAP_BURN_RADIUS;
+	desc.m_vecOffset = Vector( 0, 0, 1 );
+	desc.m_iFlags = AREAEFFECT_BUILDABLES;
+	m_hAreaEffect = FFAreaEffectManager()->AddVolume( this, desc );
 }
 
 
@@ -204,15 +214,12 @@ void CFFGrenadeNapalmlet::FlameThink()
 		return;
 	}
 
-	Vector	vecSrc = GetAbsOrigin();
-	vecSrc.z += 1;
+	CUtlVector<CBaseEntity *> inside;
+	FFAreaEffectManager()->GetEntitiesInVolume( m_hAreaEffect, inside );
 
-	CBaseEntity *pEntity = NULL;
-
-	for( CEntitySphereQuery sphere( vecSrc, NAP_BURN_RADIUS ); ( pEntity = sphere.GetCurrentEntity() ) != NULL; sphere.NextEntity() )
+	for( int i = 0; i < inside.Count(); i++ )
 	{
-		if( !pEntity )
-			continue;
+		CBaseEntity *pEntity = inside[i];
 
 		// Bug #0000269: Napalm through walls.
 		// Mulch: if we hit water w/ the trace, abort too!
@@ -18,6 +18,7 @@
 #endif
 
 #include "ff_player.h"
+#include "ff_areaeffectmanager.h"
 
 //=============================================================================
 //
@@ -30,7 +31,7 @@ public:
 	DECLARE_CLASS( CFFGrenadeNapalmlet, CBaseAnimating );
 	void Precache();
 
-	CFFGrenadeNapalmlet( void ){m_flBurnTime = gpGlobals->curtime + 5.0f;}
+	CFFGrenadeNapalmlet( void ){m_flBurnTime = gpGlobals->curtime + 5.0f; m_hAreaEffect = AREAEFFECT_INVALID_HANDLE;}
 	void UpdateOnRemove( void );
 
 	void Spawn();
@@ -42,6 +43,7 @@ public:
 private:
 	float m_flBurnTime;
 	CEntityFlame *m_pFlame;
+	AreaEffectHandle_t m_hAreaEffect;
 	int CalculateBonusBurnDamage(int burnLevel);
 };
 
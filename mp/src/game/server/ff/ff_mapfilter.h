@@ -25,6 +25,7 @@
 #include "mapentities.h"
 #include "UtlSortVector.h"
 #include "gameinterface.h"
+#include "ff_mapsnapshot.h"
 
 //=============================================================================
 //
@@ -75,6 +76,7 @@ public:
 
 		// add the new ref to the linked list and return the entity
 		g_MapEntityRefs.AddToTail( ref );
+		g_FFMapSnapshot.AddMapEntity( pRet );
 		return pRet;
 	}
 };
@@ -0,0 +1,514 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_mapsnapshot.cpp
+/// @brief Snapshot of the map entities for resetting rounds
+///
+/// REVISIONS
+/// ---------
+/// An entity's state is a CRC of the fields in its datadesc, which covers
+/// its keyvalues and everything it sets up when it spawns. Time fields are
+/// left out since they move with the clock, and utlvectors are hashed by what
+/// they hold. Only the classes in g_MapSnapshotKeepableList can be kept at
+/// all. Entities that are thinking, have had an input or belong to Lua are
+/// always made again, as are any that point at an entity that's being made
+/// again.
+
+#include "cbase.h"
+#include "ff_mapsnapshot.h"
+#include "ff_mapfilter.h"
+#include "ff_scriptman.h"
+#include "mapentities.h"
+#include "entityoutput.h"
+#include "saverestore_utlvector.h"
+#include "tier0/vprof.h"
+
+// lua
+extern "C"
+{
+	#include "lua.h"
+}
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+CFFMapSnapshot g_FFMapSnapshot;
+
+ConVar sv_fastroundreset( "sv_fastroundreset", "0", 0, "Only recreate the map entities that have changed when the round is reset, instead of all of them. Only a few simple classes are ever kept." );
+ConVar sv_fastroundreset_debug( "sv_fastroundreset_debug", "0", 0, "Print which map entities get recreated on a round reset, and why." );
+
+// Classes that keep all of their state in their datadesc, so the CRC can tell
+// whether they've changed. Anything with state elsewhere (touch links, physics,
+// animation, handles described as pointers like path_track's) isn't listed.
+static const char *g_MapSnapshotKeepableList[] =
+{
+	"func_brush",
+	"func_wall",
+	"func_wall_toggle",
+	"func_illusionary",
+	"func_ladderendpoint",
+	"info_ladder_dismount",
+	"info_landmark",
+	"info_teleport_destination",
+	"path_corner",
+	"env_sprite",
+	"env_glow",
+	NULL
+};
+
+// these get set and cleared as the entity is used, they aren't part of its state
+#define EFL_DIRTY_FLAGS ( EFL_DIRTY_SHADOWUPDATE | EFL_DIRTY_ABSTRANSFORM | EFL_DIRTY_ABSVELOCITY | EFL_DIRTY_ABSANGVELOCITY | EFL_DIRTY_SURROUNDING_COLLISION_BOUNDS | EFL_DIRTY_SPATIAL_PARTITION )
+
+//=============================================================================
+//
+// Class CFFMapSnapshotFilter
+//
+//=============================================================================
+class CFFMapSnapshotFilter : public IMapEntityFilter
+{
+public:
+	CFFMapSnapshotFilter( CFFMapSnapshot *pSnapshot )
+	{
+		m_pSnapshot = pSnapshot;
+		m_iNext = 0;
+		m_nCreated = 0;
+	}
+
+	virtual bool ShouldCreateEntity( const char *pszClassname )
+	{
+		CUtlVector< CFFMapSnapshot::Entry_t > &entries = m_pSnapshot->m_Entries;
+
+		// Preserved and unchanged entities are still there
+		if( FindInList( g_MapEntityFilterKeepList, pszClassname ) || ( m_iNext < entries.Count() && entries[ m_iNext ].m_bKeep ) )
+		{
+			m_iNext++;
+			return false;
+		}
+
+		return true;
+	}
+
+	virtual CBaseEntity *CreateNextEntity( const char *pszClassname )
+	{
+		CUtlVector< CFFMapSnapshot::Entry_t > &entries = m_pSnapshot->m_Entries;
+
+		m_nCreated++;
+
+		// We should never get here, there's an entry for everything in the entity lump
+		if( m_iNext >= entries.Count() )
+		{
+			Assert( m_iNext < entries.Count() );
+			return CreateEntityByName( pszClassname );
+		}
+
+		CFFMapSnapshot::Entry_t &entry = entries[ m_iNext++ ];
+
+		// Put it back in the slot it came from if that's free
+		CBaseEntity *pEntity;
+		if( ( entry.m_iEdict == -1 ) || engine->PEntityOfEntIndex( entry.m_iEdict ) )
+			pEntity = CreateEntityByName( pszClassname );
+		else
+			pEntity = CreateEntityByName( pszClassname, entry.m_iEdict );
+
+		entry.m_hEntity = pEntity;
+		return pEntity;
+	}
+
+	int		GetNumCreated() const { return m_nCreated; }
+
+private:
+	CFFMapSnapshot *m_pSnapshot;
+	int		m_iNext;
+	int		m_nCreated;
+};
+
+//=============================================================================
+//
+// Class CFFMapSnapshot
+//
+//=============================================================================
+CFFMapSnapshot::CFFMapSnapshot()
+{
+	m_bCaptured = false;
+	m_bCapturePending = false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Starts a new list of map entities for a map that's loading
+//-----------------------------------------------------------------------------
+void CFFMapSnapshot::Clear()
+{
+	m_Entries.RemoveAll();
+	m_References.RemoveAll();
+	m_InputReceived.ClearAll();
+	m_Kept.ClearAll();
+
+	m_bCaptured = false;
+	RequestCapture();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Records the entity made by the next block of the entity lump.
+//			pEntity is NULL if it couldn't be made.
+//-----------------------------------------------------------------------------
+void CFFMapSnapshot::AddMapEntity( CBaseEntity *pEntity )
+{
+	int i = m_Entries.AddToTail();
+	Entry_t &entry = m_Entries[ i ];
+
+	entry.m_hEntity = pEntity;
+	entry.m_iEdict = pEntity ? pEntity->entindex() : -1;
+	entry.m_nStateHash = 0;
+	entry.m_iFirstReference = 0;
+	entry.m_nReferences = 0;
+	entry.m_bKeep = false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Takes a requested snapshot
+//-----------------------------------------------------------------------------
+void CFFMapSnapshot::Update()
+{
+	if( m_bCapturePending )
+		Capture();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Remembers the state of every map entity as it is now
+//-----------------------------------------------------------------------------
+void CFFMapSnapshot::Capture()
+{
+	VPROF_BUDGET( "CFFMapSnapshot::Capture", VPROF_BUDGETGROUP_GAME );
+
+	m_References.RemoveAll();
+
+	for( int i = 0; i < m_Entries.Count(); i++ )
+	{
+		Entry_t &entry = m_Entries[ i ];
+
+		entry.m_iFirstReference = m_References.Count();
+
+		CBaseEntity *pEntity = entry.m_hEntity.Get();
+		if( pEntity )
+			entry.m_nStateHash = HashEntityState( pEntity, true );
+
+		entry.m_nReferences = m_References.Count() - entry.m_iFirstReference;
+	}
+
+	m_InputReceived.ClearAll();
+
+	m_bCaptured = true;
+	m_bCapturePending = false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Whether a round reset leaves this entity alone (players, the
+//			world, game rules etc.)
+//-----------------------------------------------------------------------------
+bool CFFMapSnapshot::IsPreserved( CBaseEntity *pEntity ) const
+{
+	return FindInList( g_MapEntityFilterKeepList, pEntity->GetClassname() );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Whether a map entity looks the same as it did in the snapshot.
+//			Doesn't check what it points at, ResetMapEntities does that.
+//-----------------------------------------------------------------------------
+bool CFFMapSnapshot::CanKeep( const Entry_t &entry, CBaseEntity *pEntity )
+{
+	const char *pszReason = NULL;
+
+	if( !FindInList( g_MapSnapshotKeepableList, pEntity->GetClassname() ) )
+	{
+		pszReason = "isn't a class that can be kept";
+	}
+	else if( m_InputReceived.IsBitSet( pEntity->GetRefEHandle().GetEntryIndex() ) )
+	{
+		pszReason = "had an input";
+	}
+	else if( pEntity->GetFirstThinkTick() != TICK_NEVER_THINK )
+	{
+		pszReason = "is thinking";
+	}
+	else if( pEntity->Classify() == CLASS_INFOSCRIPT || pEntity->Classify() == CLASS_TRIGGERSCRIPT )
+	{
+		pszReason = "is a script entity";
+	}
+	else if( HashEntityState( pEntity, false ) != entry.m_nStateHash )
+	{
+		pszReason = "has changed";
+	}
+	else if( pEntity->GetEntityName() != NULL_STRING && _scriptman.GetLuaState() )
+	{
+		// Lua sets up entities that have a table when they spawn
+		lua_State *L = _scriptman.GetLuaState();
+		lua_getglobal( L, STRING( pEntity->GetEntityName() ) );
+		if( lua_istable( L, -1 ) )
+			pszReason = "has a Lua table";
+		lua_pop( L, 1 );
+	}
+
+	if( pszReason && sv_fastroundreset_debug.GetBool() )
+		Msg( "[Round reset] Recreating %s \"%s\", it %s\n", pEntity->GetClassname(), pEntity->GetDebugName(), pszReason );
+
+	return !pszReason;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets rid of everything from the round and puts the map entities
+//			back the way they were
+//-----------------------------------------------------------------------------
+void CFFMapSnapshot::ResetMapEntities( bool bKeepUnchanged )
+{
+	VPROF_BUDGET( "CFFMapSnapshot::ResetMapEntities", VPROF_BUDGETGROUP_GAME );
+
+	m_Kept.ClearAll();
+
+	int nKept = 0;
+	bool bUseSnapshot = bKeepUnchanged && m_bCaptured;
+
+	for( int i = 0; i < m_Entries.Count(); i++ )
+	{
+		Entry_t &entry = m_Entries[ i ];
+		entry.m_bKeep = false;
+
+		if( !bUseSnapshot )
+			continue;
+
+		// Gone, so it has to be made again
+		CBaseEntity *pEntity = entry.m_hEntity.Get();
+		if( !pEntity || IsPreserved( pEntity ) )
+			continue;
+
+		if( CanKeep( entry, pEntity ) )
+		{
+			entry.m_bKeep = true;
+			m_Kept.Set( pEntity->GetRefEHandle().GetEntryIndex() );
+		}
+	}
+
+	// An entity can't be kept if it points at one that's going, and
+	// not keeping it might mean others pointing at it can't be either
+	bool bChanged = bUseSnapshot;
+	while( bChanged )
+	{
+		bChanged = false;
+
+		for( int i = 0; i < m_Entries.Count(); i++ )
+		{
+			Entry_t &entry = m_Entries[ i ];
+			if( !entry.m_bKeep )
+				continue;
+
+			for( int j = 0; j < entry.m_nReferences; j++ )
+			{
+				CBaseEntity *pReferenced = m_References[ entry.m_iFirstReference + j ].Get();
+				if( pReferenced && ( m_Kept.IsBitSet( pReferenced->GetRefEHandle().GetEntryIndex() ) || IsPreserved( pReferenced ) ) )
+					continue;
+
+				if( sv_fastroundreset_debug.GetBool() )
+					Msg( "[Round reset] Recreating %s \"%s\", it points at an entity that's being recreated\n", entry.m_hEntity->GetClassname(), entry.m_hEntity->GetDebugName() );
+
+				entry.m_bKeep = false;
+				m_Kept.Clear( entry.m_hEntity->GetRefEHandle().GetEntryIndex() );
+				bChanged = true;
+				break;
+			}
+		}
+	}
+
+	// Get rid of all entities except players, preserved entities and the map entities we're keeping
+	CBaseEntity *pCur = gEntList.FirstEnt();
+	while( pCur )
+	{
+		CBaseEntity *pNext = gEntList.NextEnt( pCur );
+
+		if( m_Kept.IsBitSet( pCur->GetRefEHandle().GetEntryIndex() ) )
+			nKept++;
+		else if( !IsPreserved( pCur ) )
+			UTIL_Remove( pCur );
+
+		pCur = pNext;
+	}
+
+	// Really remove the entities so we can have access to their slots below.
+	gEntList.CleanupDeleteList();
+
+	// Recreate the rest of the map entities from the map data (preserving their indices)
+	CFFMapSnapshotFilter filter( this );
+	MapEntity_ParseAllEntities( engine->GetMapEntitiesString(), &filter, true );
+
+	DevMsg( "Round reset: kept %d map entities, recreated %d\n", nKept, filter.GetNumCreated() );
+
+	// Everything we made has new handles, so the snapshot needs taking again
+	m_bCaptured = false;
+	RequestCapture();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: CRC of everything in the entity's datadesc. With bRecordReferences
+//			the entities it points at are added to m_References.
+//-----------------------------------------------------------------------------
+unsigned int CFFMapSnapshot::HashEntityState( CBaseEntity *pEntity, bool bRecordReferences )
+{
+	CRC32_t crc;
+	CRC32_Init( &crc );
+
+	HashDataMap( crc, pEntity->GetDataDescMap(), (const byte *)pEntity, bRecordReferences );
+
+	CRC32_Final( &crc );
+	return crc;
+}
+
+void CFFMapSnapshot::HashDataMap( CRC32_t &crc, datamap_t *pMap, const byte *pData, bool bRecordReferences )
+{
+	for( ; pMap; pMap = pMap->baseMap )
+	{
+		for( int i = 0; i < pMap->dataNumFields; i++ )
+		{
+			const typedescription_t &field = pMap->dataDesc[ i ];
+
+			// Input functions and the like aren't data
+			if( !( field.flags & ( FTYPEDESC_SAVE | FTYPEDESC_KEY ) ) || field.fieldSize == 0 )
+				continue;
+
+			const byte *pField = pData + field.fieldOffset[ TD_OFFSET_NORMAL ];
+
+			switch( field.fieldType )
+			{
+			case FIELD_TIME:
+			case FIELD_TICK:
+				break;
+
+			case FIELD_EMBEDDED:
+				if( field.flags & FTYPEDESC_PTR )
+				{
+					CRC32_ProcessBuffer( &crc, pField, sizeof( void * ) );
+				}
+				else
+				{
+					int nStride = field.fieldSizeInBytes / field.fieldSize;
+					for( int j = 0; j < field.fieldSize; j++ )
+						HashDataMap( crc, field.td, pField + j * nStride, bRecordReferences );
+				}
+				break;
+
+			case FIELD_EHANDLE:
+				if( bRecordReferences )
+				{
+					const CBaseHandle *pHandles = (const CBaseHandle *)pField;
+					for( int j = 0; j < field.fieldSize; j++ )
+					{
+						if( pHandles[ j ].IsValid() )
+							m_References.AddToTail( EHANDLE( pHandles[ j ] ) );
+					}
+				}
+				CRC32_ProcessBuffer( &crc, pField, field.fieldSizeInBytes );
+				break;
+
+			case FIELD_CLASSPTR:
+				if( bRecordReferences )
+				{
+					CBaseEntity * const *ppEntities = (CBaseEntity * const *)pField;
+					for( int j = 0; j < field.fieldSize; j++ )
+					{
+						if( ppEntities[ j ] )
+							m_References.AddToTail( EHANDLE( ppEntities[ j ] ) );
+					}
+				}
+				CRC32_ProcessBuffer( &crc, pField, field.fieldSizeInBytes );
+				break;
+
+			case FIELD_INTEGER:
+				if( !Q_strcmp( field.fieldName, "m_iEFlags" ) )
+				{
+					int iEFlags = *(const int *)pField & ~EFL_DIRTY_FLAGS;
+					CRC32_ProcessBuffer( &crc, &iEFlags, sizeof( iEFlags ) );
+				}
+				else
+				{
+					CRC32_ProcessBuffer( &crc, pField, field.fieldSizeInBytes );
+				}
+				break;
+
+			case FIELD_CUSTOM:
+				// Outputs lose their actions as they run out of times to fire
+				if( field.flags & FTYPEDESC_OUTPUT )
+				{
+					int nActions = ( (CBaseEntityOutput *)pField )->NumberOfElements();
+					CRC32_ProcessBuffer( &crc, &nActions, sizeof( nActions ) );
+				}
+				else
+				{
+					// The vector's own bytes don't change when its elements do
+					IUtlVectorFieldInfo *pVectorInfo = dynamic_cast< IUtlVectorFieldInfo * >( field.pSaveRestoreOps );
+					if( pVectorInfo )
+					{
+						HashUtlVector( crc, pVectorInfo, pField, bRecordReferences );
+						break;
+					}
+				}
+				CRC32_ProcessBuffer( &crc, pField, field.fieldSizeInBytes );
+				break;
+
+			default:
+				CRC32_ProcessBuffer( &crc, pField, field.fieldSizeInBytes );
+				break;
+			}
+		}
+	}
+}
+
+void CFFMapSnapshot::HashUtlVector( CRC32_t &crc, IUtlVectorFieldInfo *pVectorInfo, const byte *pField, bool bRecordReferences )
+{
+	int nElements = pVectorInfo->Count( pField );
+	CRC32_ProcessBuffer( &crc, &nElements, sizeof( nElements ) );
+
+	if( !nElements )
+		return;
+
+	const byte *pElements = (const byte *)pVectorInfo->Base( pField );
+	int nElementSize = pVectorInfo->GetElementSize();
+
+	switch( pVectorInfo->GetElementType() )
+	{
+	case FIELD_TIME:
+	case FIELD_TICK:
+		break;
+
+	case FIELD_EMBEDDED:
+		for( int i = 0; i < nElements; i++ )
+			HashDataMap( crc, pVectorInfo->GetElementDataMap(), pElements + i * nElementSize, bRecordReferences );
+		break;
+
+	case FIELD_EHANDLE:
+		if( bRecordReferences )
+		{
+			for( int i = 0; i < nElements; i++ )
+			{
+				const CBaseHandle &handle = *(const CBaseHandle *)( pElements + i * nElementSize );
+				if( handle.IsValid() )
+					m_References.AddToTail( EHANDLE( handle ) );
+			}
+		}
+		CRC32_ProcessBuffer( &crc, pElements, nElements * nElementSize );
+		break;
+
+	case FIELD_CLASSPTR:
+		if( bRecordReferences )
+		{
+			for( int i = 0; i < nElements; i++ )
+			{
+				CBaseEntity *pEntity = *(CBaseEntity * const *)( pElements + i * nElementSize );
+				if( pEntity )
+					m_References.AddToTail( EHANDLE( pEntity ) );
+			}
+		}
+		CRC32_ProcessBuffer( &crc, pElements, nElements * nElementSize );
+		break;
+
+	default:
+		CRC32_ProcessBuffer( &crc, pElements, nElements * nElementSize );
+		break;
+	}
+}
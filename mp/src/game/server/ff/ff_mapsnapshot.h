@@ -0,0 +1,94 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_mapsnapshot.h
+/// @brief Snapshot of the map entities for resetting rounds
+///
+/// REVISIONS
+/// ---------
+/// Remembers which entity each block of the BSP entity lump made and what
+/// its state looked like once the round got going, so a round reset only
+/// has to recreate the map entities that were removed or have changed.
+
+#ifndef FF_MAPSNAPSHOT_H
+#define FF_MAPSNAPSHOT_H
+
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "utlvector.h"
+#include "bitvec.h"
+#include "ehandle.h"
+#include "checksum_crc.h"
+
+class CBaseEntity;
+class IUtlVectorFieldInfo;
+
+class CFFMapSnapshot
+{
+public:
+	CFFMapSnapshot();
+
+	// Map load: called for each entity in the entity lump, in order, as the load filter creates it
+	void	Clear();
+	void	AddMapEntity( CBaseEntity *pEntity );
+
+	// Takes the snapshot on the next Update(). Entities are only settled
+	// once they've been activated, which happens after the map load.
+	void	RequestCapture() { m_bCapturePending = true; }
+	void	Update();
+
+	bool	IsCaptured() const { return m_bCaptured; }
+
+	// Anything that gets an input can have changed in ways the snapshot can't see
+	void	OnEntityInput( CBaseEntity *pEntity )
+	{
+		if( m_bCaptured )
+			m_InputReceived.Set( pEntity->GetRefEHandle().GetEntryIndex() );
+	}
+
+	// Removes everything but the players and preserved entities, then creates
+	// the map entities again. With bKeepUnchanged, map entities that match the
+	// snapshot are left as they are instead.
+	void	ResetMapEntities( bool bKeepUnchanged );
+
+private:
+	struct Entry_t
+	{
+		EHANDLE			m_hEntity;
+		int				m_iEdict;			// slot it was first created in, -1 for none
+		unsigned int	m_nStateHash;
+		int				m_iFirstReference;	// into m_References
+		int				m_nReferences;
+		bool			m_bKeep;
+	};
+
+	friend class CFFMapSnapshotFilter;
+
+	void	Capture();
+	bool	CanKeep( const Entry_t &entry, CBaseEntity *pEntity );
+	bool	IsPreserved( CBaseEntity *pEntity ) const;
+
+	unsigned int HashEntityState( CBaseEntity *pEntity, bool bRecordReferences );
+	void	HashDataMap( CRC32_t &crc, datamap_t *pMap, const byte *pData, bool bRecordReferences );
+	void	HashUtlVector( CRC32_t &crc, IUtlVectorFieldInfo *pVectorInfo, const byte *pField, bool bRecordReferences );
+
+	CUtlVector< Entry_t >	m_Entries;
+
+	// entities each snapshotted entity pointed at, so it isn't kept pointing at something that's gone
+	CUtlVector< EHANDLE >	m_References;
+
+	// by entity entry index
+	CBitVec< NUM_ENT_ENTRIES >	m_InputReceived;
+	CBitVec< NUM_ENT_ENTRIES >	m_Kept;
+
+	bool	m_bCaptured;
+	bool	m_bCapturePending;
+};
+
+extern CFFMapSnapshot g_FFMapSnapshot;
+
+extern ConVar sv_fastroundreset;
+
+#endif // FF_MAPSNAPSHOT_H
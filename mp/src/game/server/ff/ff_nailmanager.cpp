@@ -0,0 +1,395 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_nailmanager.cpp
+/// @brief Pooled simulation of nail projectiles
+///
+/// REVISIONS
+/// ---------
+/// Nails are plain records swept in one batch each tick rather than
+/// an entity (with an edict and a think) each.
+
+#include "cbase.h"
+#include "ff_nailmanager.h"
+#include "ff_projectile_nail.h"
+#include "te_ff_nails.h"
+#include "ff_utils.h"
+#include "ammodef.h"
+#include "world.h"
+#include "collisionutils.h"
+#include "itempents.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+// Nails normally hit something long before this
+#define FF_NAIL_MAX_LIFETIME	10.0f
+
+// Room for a few nail grenades worth before the pool has to grow
+#define FF_NAIL_POOL_SIZE		256
+
+static CFFNailManager g_FFNailManager;
+
+CFFNailManager *FFNailManager()
+{
+	return &g_FFNailManager;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hits what a CFFProjectileNail would have, apart from players,
+//			which are tested separately against the boxes gathered each tick
+//-----------------------------------------------------------------------------
+class CTraceFilterNail : public CTraceFilterSimple
+{
+public:
+	DECLARE_CLASS( CTraceFilterNail, CTraceFilterSimple );
+
+	CTraceFilterNail( const CBaseEntity *pOwner ) : CTraceFilterSimple( NULL, COLLISION_GROUP_ROCKET ), m_pOwner( pOwner )
+	{
+	}
+
+	virtual bool ShouldHitEntity( IHandleEntity *pHandleEntity, int contentsMask )
+	{
+		CBaseEntity *pEntity = EntityFromEntityHandle( pHandleEntity );
+
+		if ( pEntity && ( pEntity == m_pOwner || pEntity->IsPlayer() ) )
+			return false;
+
+		return BaseClass::ShouldHitEntity( pHandleEntity, contentsMask );
+	}
+
+private:
+	const CBaseEntity *m_pOwner;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+CFFNailManager::CFFNailManager() : CAutoGameSystemPerFrame( "FFNailManager" )
+{
+	m_nPeakNails = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reserve the pool up front so firing doesn't allocate
+//-----------------------------------------------------------------------------
+void CFFNailManager::LevelInitPreEntity()
+{
+	m_Nails.RemoveAll();
+	m_Nails.EnsureCapacity( FF_NAIL_POOL_SIZE );
+	m_Spawns.RemoveAll();
+	m_nPeakNails = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFNailManager::LevelShutdownPostEntity()
+{
+	m_Nails.Purge();
+	m_Spawns.Purge();
+	m_HullPlayers.Purge();
+	m_HullMins.Purge();
+	m_HullMaxs.Purge();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Queue up a nail. It's sent to clients at the end of the tick
+//			along with anything else the same player fired.
+//-----------------------------------------------------------------------------
+void CFFNailManager::AddNail( CBaseEntity *pSource, CBaseEntity *pOwner, const Vector &vecOrigin, const QAngle &angAngles, float flDamage, bool bSendToClients )
+{
+	Vector vecForward;
+	AngleVectors( angAngles, &vecForward );
+
+	Nail_t &nail = m_Nails[ m_Nails.AddToTail() ];
+	nail.m_vecOrigin = vecOrigin;
+	nail.m_vecVelocity = vecForward * FF_NAIL_SPEED;
+	nail.m_hSource = pSource;
+	nail.m_hOwner = pOwner;
+	nail.m_flDamage = flDamage;
+	nail.m_flAge = 0.0f;
+	nail.m_bBubbled = false;
+	nail.m_bNew = true;
+
+	m_nPeakNails = max( m_nPeakNails, m_Nails.Count() );
+
+	if ( !bSendToClients || !pOwner )
+		return;
+
+	NailSpawn_t &spawn = m_Spawns[ m_Spawns.AddToTail() ];
+	spawn.m_vecOrigin = vecOrigin;
+	spawn.m_angAngles = angAngles;
+	spawn.m_iOwner = pOwner->entindex();
+	// Set while the owner's own commands run, when they'll have drawn it already
+	spawn.m_bSuppressHost = ( te->GetSuppressHost() == pOwner );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Nails caught in an emp are removed, as CFFProjectileBase::TakeEmp()
+//			does for the entity ones. pRemoved gets where they were and
+//			their damage, which TakeEmp() returned.
+//-----------------------------------------------------------------------------
+int CFFNailManager::RemoveNailsInSphere( const Vector &vecCenter, float flRadius, CUtlVector<RemovedNail_t> *pRemoved )
+{
+	int nRemoved = 0;
+	float flRadiusSqr = flRadius * flRadius;
+
+	for ( int i = m_Nails.Count() - 1; i >= 0; i-- )
+	{
+		if ( m_Nails[i].m_vecOrigin.DistToSqr( vecCenter ) <= flRadiusSqr )
+		{
+			if ( pRemoved )
+			{
+				RemovedNail_t &removed = pRemoved->Element( pRemoved->AddToTail() );
+				removed.m_vecOrigin = m_Nails[i].m_vecOrigin;
+				removed.m_flDamage = m_Nails[i].m_flDamage;
+			}
+
+			m_Nails.FastRemove( i );
+			nRemoved++;
+		}
+	}
+
+	return nRemoved;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Everything has moved for this tick, so sweep all the nails
+//-----------------------------------------------------------------------------
+void CFFNailManager::FrameUpdatePostEntityThink()
+{
+	if ( m_Nails.Count() > 0 )
+	{
+		VPROF_BUDGET( "CFFNailManager::Simulate", VPROF_BUDGETGROUP_GAME );
+
+		GatherHulls();
+
+		float flInterval = gpGlobals->frametime;
+
+		// Backwards so FastRemove only ever moves a nail that's already been done.
+		// The nail is copied out since damage can end up firing more of them.
+		for ( int i = m_Nails.Count() - 1; i >= 0; i-- )
+		{
+			Nail_t nail = m_Nails[i];
+
+			if ( SweepNail( nail, flInterval ) )
+				m_Nails.FastRemove( i );
+			else
+				m_Nails[i] = nail;
+		}
+	}
+
+	SendSpawnEvents();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Get the bounds of every player a nail could hit once per tick,
+//			grown by the nail's hull so each test is just a ray against a box
+//-----------------------------------------------------------------------------
+void CFFNailManager::GatherHulls()
+{
+	m_HullPlayers.RemoveAll();
+	m_HullMins.RemoveAll();
+	m_HullMaxs.RemoveAll();
+
+	Vector vecHull( FF_NAIL_BBOX, FF_NAIL_BBOX, FF_NAIL_BBOX );
+
+	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
+	{
+		CBasePlayer *pPlayer = UTIL_PlayerByIndex( i );
+
+		if ( !pPlayer || !pPlayer->IsAlive() )
+			continue;
+
+		// Same checks CFFProjectileNail::NailTouch makes
+		if ( !pPlayer->IsSolid() || pPlayer->IsSolidFlagSet( FSOLID_VOLUME_CONTENTS ) || !g_pGameRules->ShouldCollide( COLLISION_GROUP_ROCKET, pPlayer->GetCollisionGroup() ) )
+			continue;
+
+		Vector vecMins, vecMaxs;
+		pPlayer->CollisionProp()->WorldSpaceAABB( &vecMins, &vecMaxs );
+
+		m_HullPlayers.AddToTail( pPlayer );
+		m_HullMins.AddToTail( vecMins - vecHull );
+		m_HullMaxs.AddToTail( vecMaxs + vecHull );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Move a nail along for this tick. Returns true if it's done with.
+//-----------------------------------------------------------------------------
+bool CFFNailManager::SweepNail( Nail_t &nail, float flInterval )
+{
+	// Fired this tick, the same as an entity nail it starts moving next tick
+	if ( nail.m_bNew )
+	{
+		nail.m_bNew = false;
+		return false;
+	}
+
+	CBaseEntity *pOwner = nail.m_hOwner;
+
+	Vector vecHull( FF_NAIL_BBOX, FF_NAIL_BBOX, FF_NAIL_BBOX );
+	Vector vecDelta = nail.m_vecVelocity * flInterval;
+	Vector vecEnd = nail.m_vecOrigin + vecDelta;
+
+	// The world and everything other than players
+	CTraceFilterNail filter( pOwner );
+	trace_t tr;
+	UTIL_TraceHull( nail.m_vecOrigin, vecEnd, -vecHull, vecHull, MASK_SOLID, &filter, &tr );
+
+	// Only the players whose box the nail passes through get a proper trace
+	BatchRay_t batchRay;
+	batchRay.Init( nail.m_vecOrigin, vecDelta );
+
+	bool bHits[ MAX_PLAYERS ];
+	if ( IsBoxIntersectingRay( batchRay, m_HullMins.Base(), m_HullMaxs.Base(), m_HullPlayers.Count(), bHits ) )
+	{
+		Ray_t ray;
+		ray.Init( nail.m_vecOrigin, vecEnd, -vecHull, vecHull );
+
+		for ( int i = 0; i < m_HullPlayers.Count(); i++ )
+		{
+			CBaseEntity *pPlayer = m_HullPlayers[i];
+
+			if ( !bHits[i] || pPlayer == pOwner )
+				continue;
+
+			trace_t trPlayer;
+			enginetrace->ClipRayToEntity( ray, MASK_SOLID, pPlayer, &trPlayer );
+
+			if ( trPlayer.fraction < tr.fraction || ( trPlayer.startsolid && !tr.startsolid ) )
+			{
+				tr = trPlayer;
+				tr.m_pEnt = pPlayer;
+			}
+		}
+	}
+
+	if ( ( tr.fraction < 1.0f || tr.startsolid ) && tr.m_pEnt )
+	{
+		CBaseEntity *pOther = tr.m_pEnt;
+
+		if ( pOther->m_takedamage == DAMAGE_NO )
+			return true;
+
+		HitEntity( nail, pOther, tr );
+
+		// Keep going through the glass.
+		if ( pOther->GetCollisionGroup() != COLLISION_GROUP_BREAKABLE_GLASS )
+		{
+			// Play body "thwack" sound
+			CPASAttenuationFilter sndFilter( tr.endpos, "Nail.HitBody" );
+			CBaseEntity::EmitSound( sndFilter, 0, "Nail.HitBody", &tr.endpos );
+			return true;
+		}
+	}
+
+	nail.m_vecOrigin = vecEnd;
+	nail.m_flAge += flInterval;
+
+	// Same as CFFProjectileNail::BubbleThink, which only ever got one go
+	if ( !nail.m_bBubbled && nail.m_flAge >= 0.1f )
+	{
+		nail.m_bBubbled = true;
+
+		if ( UTIL_PointContents( nail.m_vecOrigin ) & MASK_WATER )
+			UTIL_BubbleTrail( nail.m_vecOrigin - nail.m_vecVelocity * 0.1f, nail.m_vecOrigin, 1 );
+	}
+
+	if ( nail.m_flAge > FF_NAIL_MAX_LIFETIME )
+		return true;
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		if ( nail.m_vecOrigin[i] >= MAX_COORD_INTEGER || nail.m_vecOrigin[i] <= MIN_COORD_INTEGER )
+			return true;
+	}
+
+	return false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Deal out the damage, as CFFProjectileNail::NailTouch does
+//-----------------------------------------------------------------------------
+void CFFNailManager::HitEntity( Nail_t &nail, CBaseEntity *pOther, trace_t &tr )
+{
+	CBaseEntity *pOwner = nail.m_hOwner;
+
+	// The weapon stands in for the nail entity. If it's gone (the player
+	// died, say) fall back to the player like other weaponless damage does.
+	CBaseEntity *pInflictor = nail.m_hSource;
+	if ( !pInflictor )
+		pInflictor = pOwner;
+	if ( !pInflictor )
+		pInflictor = GetWorldEntity();
+
+	Vector vecNormalizedVel = nail.m_vecVelocity;
+	VectorNormalize( vecNormalizedVel );
+
+	ClearMultiDamage();
+
+	int iDamageType = DMG_BULLET | DMG_NEVERGIB;
+
+	if ( FF_IsAirshot( pOther ) )
+		iDamageType |= DMG_AIRSHOT;
+
+	CTakeDamageInfo dmgInfo( pInflictor, pOwner, nail.m_flDamage, iDamageType );
+	CalculateBulletDamageForce( &dmgInfo, GetAmmoDef()->Index( "AMMO_NAILS" ), vecNormalizedVel, tr.endpos );
+	dmgInfo.SetDamagePosition( tr.endpos );
+
+	if ( pOther->IsPlayer() )
+		dmgInfo.ScaleDamageForce( FF_NAIL_PUSHMULTIPLIER );
+
+	pOther->DispatchTraceAttack( dmgInfo, vecNormalizedVel, &tr );
+
+	ApplyMultiDamage();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Send everything fired this tick, one event per owner. If the
+//			owner predicted their nails they've already drawn them.
+//-----------------------------------------------------------------------------
+void CFFNailManager::SendSpawnEvents()
+{
+	Vector vecOrigins[FF_NAIL_EVENT_MAX];
+	QAngle angAngles[FF_NAIL_EVENT_MAX];
+
+	for ( int i = 0; i < m_Spawns.Count(); i++ )
+	{
+		// Already went out with an earlier one
+		if ( m_Spawns[i].m_iOwner == 0 )
+			continue;
+
+		NailSpawn_t first = m_Spawns[i];
+		int nNails = 0;
+
+		for ( int j = i; j < m_Spawns.Count() && nNails < FF_NAIL_EVENT_MAX; j++ )
+		{
+			NailSpawn_t &spawn = m_Spawns[j];
+
+			if ( spawn.m_iOwner != first.m_iOwner || spawn.m_bSuppressHost != first.m_bSuppressHost )
+				continue;
+
+			vecOrigins[nNails] = spawn.m_vecOrigin;
+			angAngles[nNails] = spawn.m_angAngles;
+			nNails++;
+
+			spawn.m_iOwner = 0;
+		}
+
+		CPASFilter filter( first.m_vecOrigin );
+
+		if ( first.m_bSuppressHost )
+		{
+			CBasePlayer *pPlayer = UTIL_PlayerByIndex( first.m_iOwner );
+			if ( pPlayer )
+				filter.RemoveRecipient( pPlayer );
+		}
+
+		TE_FFNails( filter, first.m_iOwner, nNails, vecOrigins, angAngles );
+	}
+
+	m_Spawns.RemoveAll();
+}
@@ -0,0 +1,89 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_nailmanager.h
+/// @brief Pooled simulation of nail projectiles
+///
+/// REVISIONS
+/// ---------
+/// Nails are plain records swept in one batch each tick rather than
+/// an entity (with an edict and a think) each.
+
+#ifndef FF_NAILMANAGER_H
+#define FF_NAILMANAGER_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "igamesystem.h"
+#include "utlvector.h"
+
+class CFFNailManager : public CAutoGameSystemPerFrame
+{
+public:
+	CFFNailManager();
+
+	// CAutoGameSystemPerFrame
+	virtual void LevelInitPreEntity();
+	virtual void LevelShutdownPostEntity();
+	virtual void FrameUpdatePostEntityThink();
+
+	// Start simulating a nail. pSource is the weapon that fired it and is
+	// used as the inflictor, so the death notice shows the right thing.
+	// If bSendToClients is false something else is drawing the nail.
+	void AddNail( CBaseEntity *pSource, CBaseEntity *pOwner, const Vector &vecOrigin, const QAngle &angAngles, float flDamage, bool bSendToClients );
+
+	// What an emp took out, so it can blow them up like it does projectiles
+	struct RemovedNail_t
+	{
+		Vector	m_vecOrigin;
+		float	m_flDamage;
+	};
+
+	// Stands in for CFFProjectileBase::TakeEmp()
+	int RemoveNailsInSphere( const Vector &vecCenter, float flRadius, CUtlVector<RemovedNail_t> *pRemoved = NULL );
+
+	int GetNailCount() const { return m_Nails.Count(); }
+	int GetPeakNailCount() const { return m_nPeakNails; }
+
+private:
+	struct Nail_t
+	{
+		Vector	m_vecOrigin;
+		Vector	m_vecVelocity;
+		EHANDLE	m_hSource;
+		EHANDLE	m_hOwner;
+		float	m_flDamage;
+		float	m_flAge;
+		bool	m_bBubbled;		// only checked once, like CFFProjectileNail::BubbleThink
+		bool	m_bNew;			// fired this tick, starts moving next tick
+	};
+
+	struct NailSpawn_t
+	{
+		Vector	m_vecOrigin;
+		QAngle	m_angAngles;
+		int		m_iOwner;
+		bool	m_bSuppressHost;	// the owner predicted it
+	};
+
+	void	GatherHulls();
+	bool	SweepNail( Nail_t &nail, float flInterval );
+	void	HitEntity( Nail_t &nail, CBaseEntity *pOther, trace_t &tr );
+	void	SendSpawnEvents();
+
+	CUtlVector<Nail_t>		m_Nails;
+	CUtlVector<NailSpawn_t>	m_Spawns;
+
+	// Players a nail could hit this tick. The bounds are already grown by the
+	// nail's hull and kept apart so each nail tests them in one batch.
+	CUtlVector<CBaseEntity *>	m_HullPlayers;
+	CUtlVector<Vector>			m_HullMins;
+	CUtlVector<Vector>			m_HullMaxs;
+
+	int		m_nPeakNails;
+};
+
+CFFNailManager *FFNailManager();
+
+#endif // FF_NAILMANAGER_H
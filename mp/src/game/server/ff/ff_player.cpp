@@ -40,6 +40,7 @@
 // added these so I could cast to check for grenades that are not derived from projectile base
 // Could probably do it more cleanly but I just went with what was already in place.  -> Defrag
 #include "ff_grenade_napalmlet.h"
+#include "ff_playerthink.h"
 #include "dt_common.h"
 
 // Lua includes
@@ -724,7 +725,11 @@ void CFFPlayer::PreThink(void)
 		m_bConcussed = false;
 
 	// Update our list of tagged players that the client
-	FindRadioTaggedPlayers();
+	if( FFPlayerThink_IsDue( FF_PLAYERSUBSYSTEM_RADIOTAG, entindex() ) )
+	{
+		FF_PLAYERTHINK_VPROF( "CFFPlayer::FindRadioTaggedPlayers" );
+		FindRadioTaggedPlayers();
+	}
 
 	// Riding a vehicle?
 	if( IsInAVehicle() )	
@@ -762,7 +767,14 @@ void CFFPlayer::PreThink(void)
 			PostBuildGenericThink();
 	}
 
-	StatusEffectsThink();	
+	// Speed effects change how we move so they can't wait
+	SpeedEffectsThink();
+
+	if( FFPlayerThink_IsDue( FF_PLAYERSUBSYSTEM_STATUSEFFECTS, entindex() ) )
+	{
+		FF_PLAYERTHINK_VPROF( "CFFPlayer::StatusEffectsThink" );
+		StatusEffectsThink();
+	}
 
 	// Do some spy stuff
 	if (GetClassSlot() == CLASS_SPY)
@@ -811,7 +823,11 @@ void CFFPlayer::PreThink(void)
 		SpySabotageThink();
 
 		// Cloak fade thinking
-		SpyCloakFadeThink();
+		if( FFPlayerThink_IsDue( FF_PLAYERSUBSYSTEM_SPYCLOAKFADE, entindex() ) )
+		{
+			FF_PLAYERTHINK_VPROF( "CFFPlayer::SpyCloakFadeThink" );
+			SpyCloakFadeThink();
+		}
 	}
 
 	SharedPreThink();
@@ -1761,6 +1777,7 @@ void CFFPlayer::InitialSpawn( void )
 
 	m_hRadioTagData = ( CFFRadioTagData * )CreateEntityByName( "ff_radiotagdata" );
 	Assert( m_hRadioTagData );
+	m_hRadioTagData->SetOwnerEntity( this );
 	m_hRadioTagData->Spawn();
 
 	// Mulch: I'm wondering if there's a network delay in getting this value, so
@@ -3994,6 +4011,20 @@ void CFFPlayer::Command_Discard(const CCommand& args)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Moves a status effect timer on by its interval. StatusEffectsThink
+//			doesn't run every tick, so resetting the timer to curtime would add
+//			the schedule's lateness to every interval. A timer that has fallen
+//			more than an interval behind (the effect just started) is resynced.
+//-----------------------------------------------------------------------------
+static void AdvanceStatusEffectTimer( float &flTime, float flInterval )
+{
+	flTime += flInterval;
+
+	if( flTime + flInterval < gpGlobals->curtime )
+		flTime = gpGlobals->curtime;
+}
+
 void CFFPlayer::StatusEffectsThink( void )
 {
 	if( m_bGassed )
@@ -4026,7 +4057,7 @@ void CFFPlayer::StatusEffectsThink( void )
 					WRITE_FLOAT( 2.5f );
 				MessageEnd();
 
-				m_flNextGas = gpGlobals->curtime + 1.0f;
+				AdvanceStatusEffectTimer( m_flNextGas, 1.0f );
 			}
 		}
 		else
@@ -4035,14 +4066,6 @@ void CFFPlayer::StatusEffectsThink( void )
 		}
 	}
 
-	if (m_bSliding)
-	{
-		if (m_flSlidingTime <= gpGlobals->curtime)
-		{
-			StopSliding();
-		}
-	}
-
 	// If we jump in water up to waist level, extinguish ourselves
 	if (GetBurnLevel() > 0 && GetWaterLevel() >= WL_Waist)
 		Extinguish();
@@ -4053,7 +4076,7 @@ void CFFPlayer::StatusEffectsThink( void )
 		if( ( ( GetClassSlot() == CLASS_MEDIC ) || ( GetClassSlot() == CLASS_ENGINEER ) ) &&
 			( gpGlobals->curtime > ( m_fLastHealTick + FFDEV_REGEN_FREQ ) ) )
 		{		
-			m_fLastHealTick = gpGlobals->curtime;
+			AdvanceStatusEffectTimer( m_fLastHealTick, FFDEV_REGEN_FREQ );
 
 			if( GetClassSlot() == CLASS_MEDIC )
 			{
@@ -4084,7 +4107,7 @@ void CFFPlayer::StatusEffectsThink( void )
 	{
 		if( gpGlobals->curtime > ( m_flLastOverHealthTick + FFDEV_OVERHEALTH_FREQ ) )
 		{
-			m_flLastOverHealthTick = gpGlobals->curtime;
+			AdvanceStatusEffectTimer( m_flLastOverHealthTick, FFDEV_OVERHEALTH_FREQ );
 			int iMaxHealth = m_iMaxHealth;
 			m_iHealth = max( m_iHealth - FFDEV_REGEN_HEALTH, iMaxHealth );
 		}
@@ -4150,7 +4173,7 @@ void CFFPlayer::StatusEffectsThink( void )
 			// When you change this be sure to change the StopSound above ^^ for bug
 			
 			EmitSound( "Player.DrownContinue" );	// |-- Mirv: [TODO] Change to something more suitable
-			m_fLastInfectedTick = gpGlobals->curtime;
+			AdvanceStatusEffectTimer( m_fLastInfectedTick, FFDEV_INFECT_FREQ );
 			m_iInfectTick++;
 
 			int iInfectDamage = m_fNextInfectedTickDamage;
@@ -4230,6 +4253,30 @@ void CFFPlayer::StatusEffectsThink( void )
 		}
 	}
 
+	// Bug #0000503: "Immunity" is not in the mod
+	// See if immunity has worn off
+	if( IsImmune() )
+	{
+		// TODO: Dispatch immune effect!
+
+		if( gpGlobals->curtime > m_flImmuneTime )
+			m_bImmune = false;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The status effects that change how we move, checked every tick
+//-----------------------------------------------------------------------------
+void CFFPlayer::SpeedEffectsThink( void )
+{
+	if (m_bSliding)
+	{
+		if (m_flSlidingTime <= gpGlobals->curtime)
+		{
+			StopSliding();
+		}
+	}
+
 	// check if any speed effects are over
 	bool recalcspeed = false;
 	for (int i=0; i<NUM_SPEED_EFFECTS; i++)
@@ -4244,16 +4291,6 @@ void CFFPlayer::StatusEffectsThink( void )
 	// we might need to actually set their speed
 	if (recalcspeed)
 		RecalculateSpeed();
-
-	// Bug #0000503: "Immunity" is not in the mod
-	// See if immunity has worn off
-	if( IsImmune() )
-	{
-		// TODO: Dispatch immune effect!
-
-		if( gpGlobals->curtime > m_flImmuneTime )
-			m_bImmune = false;
-	}
 }
 
 //-----------------------------------------------------------------------------
@@ -612,6 +612,7 @@ private:
 	int m_iBurnLevel;
 
 	void StatusEffectsThink( void );
+	void SpeedEffectsThink( void );
 	void RecalculateSpeed( );
 
 private:
@@ -0,0 +1,56 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_playerthink.cpp
+/// @brief Staggered update rates for the player's PreThink subsystems
+///
+/// REVISIONS
+/// ---------
+/// Subsystems that only need a few updates a second say how often they
+/// want to run, and players are spread across the ticks in between so
+/// they don't all do the work on the same frame. Anything that affects
+/// movement stays in PreThink every tick.
+
+#include "cbase.h"
+#include "ff_playerthink.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+ConVar ffdev_playerthink_radiotag_rate( "ffdev_playerthink_radiotag_rate", "10", FCVAR_FF_FFDEV, "Updates per second of each player's radio tagged player list (0 for every tick)" );
+ConVar ffdev_playerthink_statuseffects_rate( "ffdev_playerthink_statuseffects_rate", "10", FCVAR_FF_FFDEV, "Updates per second of gas, infection, regen and overhealth (0 for every tick)" );
+ConVar ffdev_playerthink_spycloakfade_rate( "ffdev_playerthink_spycloakfade_rate", "20", FCVAR_FF_FFDEV, "Updates per second of a spy's cloak fade (0 for every tick)" );
+
+struct FFPlayerSubsystemInfo_t
+{
+	ConVar	*m_pRate;
+	int		m_iPhase;		// keeps one player's subsystems off the same tick
+};
+
+static const FFPlayerSubsystemInfo_t g_FFPlayerSubsystems[ FF_PLAYERSUBSYSTEM_COUNT ] =
+{
+	{ &ffdev_playerthink_radiotag_rate,			0 },
+	{ &ffdev_playerthink_statuseffects_rate,	2 },
+	{ &ffdev_playerthink_spycloakfade_rate,		1 },
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: A subsystem wanting N updates a second runs every 1/N seconds
+//			worth of ticks, with each player offset by their index.
+//-----------------------------------------------------------------------------
+bool FFPlayerThink_IsDue( int iSubsystem, int iPlayerIndex )
+{
+	Assert( iSubsystem >= 0 && iSubsystem < FF_PLAYERSUBSYSTEM_COUNT );
+
+	const FFPlayerSubsystemInfo_t &info = g_FFPlayerSubsystems[ iSubsystem ];
+
+	float flRate = info.m_pRate->GetFloat();
+	if( flRate <= 0.0f || gpGlobals->interval_per_tick <= 0.0f )
+		return true;
+
+	int nInterval = RoundFloatToInt( 1.0f / ( flRate * gpGlobals->interval_per_tick ) );
+	if( nInterval <= 1 )
+		return true;
+
+	return ( ( gpGlobals->tickcount + iPlayerIndex + info.m_iPhase ) % nInterval ) == 0;
+}
@@ -0,0 +1,37 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_playerthink.h
+/// @brief Staggered update rates for the player's PreThink subsystems
+///
+/// REVISIONS
+/// ---------
+/// Subsystems that only need a few updates a second say how often they
+/// want to run, and players are spread across the ticks in between so
+/// they don't all do the work on the same frame. Anything that affects
+/// movement stays in PreThink every tick.
+
+#ifndef FF_PLAYERTHINK_H
+#define FF_PLAYERTHINK_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/vprof.h"
+
+enum FFPlayerSubsystem_t
+{
+	FF_PLAYERSUBSYSTEM_RADIOTAG = 0,		// FindRadioTaggedPlayers
+	FF_PLAYERSUBSYSTEM_STATUSEFFECTS,		// gas, infection, regen, overhealth (not speed effects)
+	FF_PLAYERSUBSYSTEM_SPYCLOAKFADE,		// render alpha while fading in/out of cloak
+
+	FF_PLAYERSUBSYSTEM_COUNT
+};
+
+// Should the subsystem run for this player this tick
+bool FFPlayerThink_IsDue( int iSubsystem, int iPlayerIndex );
+
+// Time a subsystem's update under the "FF Player Think" vprof group
+#define FF_PLAYERTHINK_VPROF( name )	VPROF_BUDGET( name, VPROF_BUDGETGROUP_FF_PLAYERTHINK )
+
+#endif // FF_PLAYERTHINK_H
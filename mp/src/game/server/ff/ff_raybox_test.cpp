@@ -0,0 +1,287 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_raybox_test.cpp
+/// @brief Checks and times the batched ray vs box tests in collisionutils
+///
+/// REVISIONS
+/// ---------
+/// Random rays, some lying flat along an axis so the parallel slab case gets
+/// hit, are tested against random boxes by both the batched kernels and
+/// IsBoxIntersectingRay/IsRayIntersectingOBB one box at a time. AABB hits
+/// have to match exactly and entry fractions to within 1e-4. OBB results are
+/// only reported, since the scalar OBB test has no tolerance at the faces.
+
+#include "cbase.h"
+#include "collisionutils.h"
+#include "vstdlib/random.h"
+#include "tier0/fasttimer.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+#define RAYBOX_MAX_BOXES	1024
+
+// boxes are mins/maxs around an origin, rotated by angles for the OBB tests
+static Vector s_vecBoxOrigins[RAYBOX_MAX_BOXES];
+static QAngle s_angBoxAngles[RAYBOX_MAX_BOXES];
+static matrix3x4_t s_matBoxToWorld[RAYBOX_MAX_BOXES];
+static Vector s_vecBoxMins[RAYBOX_MAX_BOXES];
+static Vector s_vecBoxMaxs[RAYBOX_MAX_BOXES];
+static Vector s_vecWorldMins[RAYBOX_MAX_BOXES];
+static Vector s_vecWorldMaxs[RAYBOX_MAX_BOXES];
+static bool s_bHits[RAYBOX_MAX_BOXES];
+static float s_flFractions[RAYBOX_MAX_BOXES];
+
+static CUniformRandomStream s_RayBoxRandom;
+
+static Vector FF_RayBoxRandomVector( float flMin, float flMax )
+{
+	return Vector( s_RayBoxRandom.RandomFloat( flMin, flMax ), s_RayBoxRandom.RandomFloat( flMin, flMax ), s_RayBoxRandom.RandomFloat( flMin, flMax ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Player to building sized boxes spread over a map sized area
+//-----------------------------------------------------------------------------
+static void FF_RayBoxRandomBoxes( int nBoxes )
+{
+	for ( int i = 0; i < nBoxes; i++ )
+	{
+		Vector vecExtents = FF_RayBoxRandomVector( 1.0f, 64.0f );
+		s_vecBoxMins[i] = -vecExtents;
+		s_vecBoxMaxs[i] = vecExtents;
+		s_vecBoxOrigins[i] = FF_RayBoxRandomVector( -512.0f, 512.0f );
+		s_angBoxAngles[i].Init( s_RayBoxRandom.RandomFloat( -180.0f, 180.0f ), s_RayBoxRandom.RandomFloat( -180.0f, 180.0f ), s_RayBoxRandom.RandomFloat( -180.0f, 180.0f ) );
+
+		AngleMatrix( s_angBoxAngles[i], s_vecBoxOrigins[i], s_matBoxToWorld[i] );
+		s_vecWorldMins[i] = s_vecBoxOrigins[i] + s_vecBoxMins[i];
+		s_vecWorldMaxs[i] = s_vecBoxOrigins[i] + s_vecBoxMaxs[i];
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: A random ray, sometimes flat along an axis so the rays that never
+//			cross a pair of planes get tested too
+//-----------------------------------------------------------------------------
+static void FF_RayBoxRandomRay( Vector &vecStart, Vector &vecDelta )
+{
+	vecStart = FF_RayBoxRandomVector( -640.0f, 640.0f );
+	vecDelta = FF_RayBoxRandomVector( -1024.0f, 1024.0f );
+
+	int iFlatAxis = s_RayBoxRandom.RandomInt( -3, 2 );
+	if ( iFlatAxis >= 0 )
+		vecDelta[iFlatAxis] = 0.0f;
+}
+
+CON_COMMAND_F( ffdev_raybox_test, "Compares the batched ray vs box tests against the scalar ones over random rays and boxes. Usage: ffdev_raybox_test [rays]", FCVAR_CHEAT )
+{
+	int nRays = ( args.ArgC() > 1 ) ? clamp( atoi( args[1] ), 1, 100000 ) : 1000;
+
+	s_RayBoxRandom.SetSeed( 0 );
+
+	int nTests = 0;
+	int nAABBMismatches = 0;
+	int nFractionMismatches = 0;
+	int nOBBMismatches = 0;
+	int nFourRayMismatches = 0;
+	int nFourRayOBBMismatches = 0;
+
+	for ( int iRay = 0; iRay < nRays; iRay++ )
+	{
+		// odd box counts leave a partial batch at the end
+		int nBoxes = RAYBOX_MAX_BOXES - ( iRay & 3 );
+		FF_RayBoxRandomBoxes( nBoxes );
+
+		Vector vecStart, vecDelta;
+		FF_RayBoxRandomRay( vecStart, vecDelta );
+		float flTolerance = ( iRay % 3 ) ? 0.0f : 1.0f;
+
+		BatchRay_t batchRay;
+		batchRay.Init( vecStart, vecDelta, flTolerance );
+
+		IsBoxIntersectingRay( batchRay, s_vecWorldMins, s_vecWorldMaxs, nBoxes, s_bHits, s_flFractions );
+		for ( int i = 0; i < nBoxes; i++ )
+		{
+			bool bHit = IsBoxIntersectingRay( s_vecWorldMins[i], s_vecWorldMaxs[i], vecStart, vecDelta, flTolerance );
+			if ( bHit != s_bHits[i] )
+				nAABBMismatches++;
+
+			BoxTraceInfo_t trace;
+			if ( bHit && IntersectRayWithBox( vecStart, vecDelta, s_vecWorldMins[i], s_vecWorldMaxs[i], flTolerance, &trace ) )
+			{
+				if ( fabs( MAX( trace.t1, 0.0f ) - s_flFractions[i] ) > 1e-4f )
+					nFractionMismatches++;
+			}
+		}
+		nTests += nBoxes;
+
+		// IsRayIntersectingOBB has no tolerance
+		Ray_t ray;
+		ray.Init( vecStart, vecStart + vecDelta );
+		batchRay.Init( vecStart, vecDelta );
+
+		IsOBBIntersectingRay( batchRay, s_matBoxToWorld, s_vecBoxMins, s_vecBoxMaxs, nBoxes, s_bHits );
+		for ( int i = 0; i < nBoxes; i++ )
+		{
+			if ( IsRayIntersectingOBB( ray, s_vecBoxOrigins[i], s_angBoxAngles[i], s_vecBoxMins[i], s_vecBoxMaxs[i] ) != s_bHits[i] )
+				nOBBMismatches++;
+		}
+
+		// and four rays at each box, sometimes fewer
+		Vector vecStarts[4], vecDeltas[4];
+		Ray_t rays[4];
+		for ( int k = 0; k < 4; k++ )
+		{
+			FF_RayBoxRandomRay( vecStarts[k], vecDeltas[k] );
+			rays[k].Init( vecStarts[k], vecStarts[k] + vecDeltas[k] );
+		}
+
+		int nFourRays = 1 + ( iRay & 3 );
+		FourRays_t fourRays;
+		fourRays.Init( vecStarts, vecDeltas, nFourRays );
+
+		for ( int i = 0; i < nBoxes; i++ )
+		{
+			int nHitMask = IsBoxIntersectingRays( fourRays, s_vecWorldMins[i], s_vecWorldMaxs[i] );
+			int nOBBHitMask = IsOBBIntersectingRays( fourRays, s_matBoxToWorld[i], s_vecBoxMins[i], s_vecBoxMaxs[i] );
+
+			for ( int k = 0; k < nFourRays; k++ )
+			{
+				if ( ( ( nHitMask >> k ) & 1 ) != (int)IsBoxIntersectingRay( s_vecWorldMins[i], s_vecWorldMaxs[i], vecStarts[k], vecDeltas[k] ) )
+					nFourRayMismatches++;
+
+				if ( ( ( nOBBHitMask >> k ) & 1 ) != (int)IsRayIntersectingOBB( rays[k], s_vecBoxOrigins[i], s_angBoxAngles[i], s_vecBoxMins[i], s_vecBoxMaxs[i] ) )
+					nFourRayOBBMismatches++;
+			}
+
+			// nothing set past the rays that were given
+			if ( ( nHitMask | nOBBHitMask ) >> nFourRays )
+				nFourRayMismatches++;
+		}
+	}
+
+	Msg( "%d ray vs box tests\n", nTests );
+	Msg( "  one ray vs AABBs:  %d mismatches, %d fractions off\n", nAABBMismatches, nFractionMismatches );
+	Msg( "  one ray vs OBBs:   %d mismatches\n", nOBBMismatches );
+	Msg( "  four rays vs AABB: %d mismatches\n", nFourRayMismatches );
+	Msg( "  four rays vs OBB:  %d mismatches\n", nFourRayOBBMismatches );
+
+	// the OBB tests move the ray into box space with different float math
+	// to AngleIMatrix/VectorITransform, so a ray grazing an edge can differ
+	int nMismatches = nAABBMismatches + nFractionMismatches + nFourRayMismatches;
+	Msg( nMismatches ? "FAILED\n" : "All AABB results match%s\n", ( nOBBMismatches + nFourRayOBBMismatches ) ? ", OBB results differ at the edges" : "" );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Prints a line of the benchmark table
+//-----------------------------------------------------------------------------
+static void FF_RayBoxReport( const char *pszName, CFastTimer &timer, int nIterations, int nTestsPerIteration, int nHits )
+{
+	double flNanoseconds = timer.GetDuration().GetMicrosecondsF() * 1000.0;
+	Msg( "%-36s %10.1f ns %10.2f ns/test %10d %8d\n", pszName, flNanoseconds / nIterations,
+		flNanoseconds / ( (double)nIterations * nTestsPerIteration ), nIterations, nHits );
+}
+
+CON_COMMAND_F( ffdev_raybox_benchmark, "Times the batched ray vs box tests against the scalar ones. Usage: ffdev_raybox_benchmark [boxes] [iterations]", FCVAR_CHEAT )
+{
+	int nBoxes = ( args.ArgC() > 1 ) ? clamp( atoi( args[1] ), 1, RAYBOX_MAX_BOXES ) : 256;
+	int nIterations = ( args.ArgC() > 2 ) ? clamp( atoi( args[2] ), 1, 1000000 ) : 1000;
+
+	s_RayBoxRandom.SetSeed( 0 );
+	FF_RayBoxRandomBoxes( nBoxes );
+
+	const int nRays = 64;
+	Vector vecStarts[nRays], vecDeltas[nRays];
+	Ray_t rays[nRays];
+	BatchRay_t batchRays[nRays];
+	for ( int i = 0; i < nRays; i++ )
+	{
+		FF_RayBoxRandomRay( vecStarts[i], vecDeltas[i] );
+		rays[i].Init( vecStarts[i], vecStarts[i] + vecDeltas[i] );
+		batchRays[i].Init( vecStarts[i], vecDeltas[i] );
+	}
+
+	FourRays_t fourRays[nRays / 4];
+	for ( int i = 0; i < nRays / 4; i++ )
+		fourRays[i].Init( &vecStarts[i * 4], &vecDeltas[i * 4], 4 );
+
+	Msg( "%-36s %13s %18s %10s %8s\n", "Benchmark", "Time", "", "Iterations", "Hits" );
+
+	CFastTimer timer;
+	int nHits;
+	char szName[64];
+
+	// one ray at a time against every box, the hit counts of each pair should match
+	nHits = 0;
+	timer.Start();
+	for ( int iIteration = 0; iIteration < nIterations; iIteration++ )
+	{
+		const Ray_t &ray = rays[iIteration % nRays];
+		for ( int i = 0; i < nBoxes; i++ )
+			nHits += IsBoxIntersectingRay( s_vecWorldMins[i], s_vecWorldMaxs[i], ray.m_Start, ray.m_Delta );
+	}
+	timer.End();
+	Q_snprintf( szName, sizeof( szName ), "AABB/Scalar/%d", nBoxes );
+	FF_RayBoxReport( szName, timer, nIterations, nBoxes, nHits );
+
+	nHits = 0;
+	timer.Start();
+	for ( int iIteration = 0; iIteration < nIterations; iIteration++ )
+		nHits += IsBoxIntersectingRay( batchRays[iIteration % nRays], s_vecWorldMins, s_vecWorldMaxs, nBoxes, s_bHits );
+	timer.End();
+	Q_snprintf( szName, sizeof( szName ), "AABB/Batch/%d", nBoxes );
+	FF_RayBoxReport( szName, timer, nIterations, nBoxes, nHits );
+
+	nHits = 0;
+	timer.Start();
+	for ( int iIteration = 0; iIteration < nIterations; iIteration++ )
+	{
+		const Ray_t &ray = rays[iIteration % nRays];
+		for ( int i = 0; i < nBoxes; i++ )
+			nHits += IsRayIntersectingOBB( ray, s_vecBoxOrigins[i], s_angBoxAngles[i], s_vecBoxMins[i], s_vecBoxMaxs[i] );
+	}
+	timer.End();
+	Q_snprintf( szName, sizeof( szName ), "OBB/Scalar/%d", nBoxes );
+	FF_RayBoxReport( szName, timer, nIterations, nBoxes, nHits );
+
+	nHits = 0;
+	timer.Start();
+	for ( int iIteration = 0; iIteration < nIterations; iIteration++ )
+		nHits += IsOBBIntersectingRay( batchRays[iIteration % nRays], s_matBoxToWorld, s_vecBoxMins, s_vecBoxMaxs, nBoxes, s_bHits );
+	timer.End();
+	Q_snprintf( szName, sizeof( szName ), "OBB/Batch/%d", nBoxes );
+	FF_RayBoxReport( szName, timer, nIterations, nBoxes, nHits );
+
+	// eight rays against each box, as two groups of four
+	nHits = 0;
+	timer.Start();
+	for ( int iIteration = 0; iIteration < nIterations; iIteration++ )
+	{
+		int iFirst = ( iIteration * 8 ) % nRays;
+		for ( int i = 0; i < nBoxes; i++ )
+		{
+			for ( int k = 0; k < 8; k++ )
+				nHits += IsBoxIntersectingRay( s_vecWorldMins[i], s_vecWorldMaxs[i], vecStarts[iFirst + k], vecDeltas[iFirst + k] );
+		}
+	}
+	timer.End();
+	Q_snprintf( szName, sizeof( szName ), "EightRays/Scalar/%d", nBoxes );
+	FF_RayBoxReport( szName, timer, nIterations, nBoxes * 8, nHits );
+
+	nHits = 0;
+	timer.Start();
+	for ( int iIteration = 0; iIteration < nIterations; iIteration++ )
+	{
+		int iFirst = ( ( iIteration * 8 ) % nRays ) / 4;
+		for ( int i = 0; i < nBoxes; i++ )
+		{
+			int nHitMask = IsBoxIntersectingRays( fourRays[iFirst], s_vecWorldMins[i], s_vecWorldMaxs[i] );
+			nHitMask |= IsBoxIntersectingRays( fourRays[iFirst + 1], s_vecWorldMins[i], s_vecWorldMaxs[i] ) << 4;
+			for ( ; nHitMask; nHitMask &= nHitMask - 1 )
+				nHits++;
+		}
+	}
+	timer.End();
+	Q_snprintf( szName, sizeof( szName ), "EightRays/Batch/%d", nBoxes );
+	FF_RayBoxReport( szName, timer, nIterations, nBoxes * 8, nHits );
+}
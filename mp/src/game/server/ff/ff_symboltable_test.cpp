@@ -0,0 +1,359 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_symboltable_test.cpp
+/// @brief Times CUtlHashedSymbolTable against the tree symbol tables
+///
+/// REVISIONS
+/// ---------
+/// Uses the strings a running server really has: convars, entity classnames
+/// and names, datamap fields, sound names and string tables. They can be
+/// dumped to a file and replayed, so runs on different builds use the same
+/// set. For CUtlSymbolTable, CUtlSymbolTableMT and CUtlHashedSymbolTable it
+/// times inserts, finds that hit and finds that miss. It also times finds
+/// spread over the job threads, and reports each table's memory. A find that
+/// misses an added string, or hits one that was never added, is a warning.
+
+#include "cbase.h"
+#include "utlsymbol.h"
+#include "utlbuffer.h"
+#include "filesystem.h"
+#include "networkstringtable_gamedll.h"
+#include "SoundEmitterSystem/isoundemittersystembase.h"
+#include "vstdlib/jobthread.h"
+#include "tier0/fasttimer.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+extern ISoundEmitterSystemBase *soundemitterbase;
+
+// symbols are 16 bits, so the tables top out at 65535 strings
+#define SYMBOLTEST_MAX_STRINGS	60000
+
+// slices of the strings each job looks up, for the threaded finds
+#define SYMBOLTEST_JOB_SLICES	64
+
+class CFFSymbolTestStrings
+{
+public:
+	void Add( const char *pszString )
+	{
+		if ( !pszString || !pszString[0] || m_Strings.Count() >= SYMBOLTEST_MAX_STRINGS )
+			return;
+
+		int nStrings = m_Unique.GetNumStrings();
+		m_Unique.AddString( pszString );
+		if ( m_Unique.GetNumStrings() != nStrings )
+			m_Strings.AddToTail( pszString );
+	}
+
+	int Count() const { return m_Strings.Count(); }
+	const char *Get( int i ) const { return m_Strings[i].Get(); }
+
+	CUtlVector< CUtlString >	m_Strings;
+	CUtlSymbolTable				m_Unique;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: The names of a datamap and the ones it derives from
+//-----------------------------------------------------------------------------
+static void FF_SymbolTestAddDataMap( CFFSymbolTestStrings &strings, datamap_t *pMap )
+{
+	for ( ; pMap; pMap = pMap->baseMap )
+	{
+		strings.Add( pMap->dataClassName );
+
+		for ( int i = 0; i < pMap->dataNumFields; i++ )
+		{
+			const typedescription_t &field = pMap->dataDesc[i];
+			strings.Add( field.fieldName );
+			strings.Add( field.externalName );
+
+			if ( field.td )
+				FF_SymbolTestAddDataMap( strings, field.td );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Every string the server has lying around that looks like the
+//			kind of thing that ends up in a symbol table
+//-----------------------------------------------------------------------------
+static void FF_SymbolTestGather( CFFSymbolTestStrings &strings )
+{
+	for ( const ConCommandBase *pCommand = g_pCVar->GetCommands(); pCommand; pCommand = pCommand->GetNext() )
+		strings.Add( pCommand->GetName() );
+
+	for ( CBaseEntity *pEntity = gEntList.FirstEnt(); pEntity; pEntity = gEntList.NextEnt( pEntity ) )
+	{
+		strings.Add( pEntity->GetClassname() );
+		strings.Add( STRING( pEntity->GetEntityName() ) );
+		strings.Add( STRING( pEntity->GetModelName() ) );
+		FF_SymbolTestAddDataMap( strings, pEntity->GetDataDescMap() );
+	}
+
+	if ( soundemitterbase )
+	{
+		for ( int i = 0; i < soundemitterbase->GetSoundCount(); i++ )
+			strings.Add( soundemitterbase->GetSoundName( i ) );
+	}
+
+	if ( networkstringtable )
+	{
+		for ( int iTable = 0; iTable < networkstringtable->GetNumTables(); iTable++ )
+		{
+			INetworkStringTable *pTable = networkstringtable->GetTable( iTable );
+			if ( !pTable )
+				continue;
+
+			for ( int i = 0; i < pTable->GetNumStrings(); i++ )
+				strings.Add( pTable->GetString( i ) );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Strings from a file written by ffdev_symboltable_dump, one per line
+//-----------------------------------------------------------------------------
+static bool FF_SymbolTestLoad( CFFSymbolTestStrings &strings, const char *pszFilename )
+{
+	CUtlBuffer buf( 0, 0, CUtlBuffer::TEXT_BUFFER );
+	if ( !filesystem->ReadFile( pszFilename, "MOD", buf ) )
+		return false;
+
+	char szLine[1024];
+	while ( buf.IsValid() && buf.GetBytesRemaining() > 0 )
+	{
+		buf.GetLine( szLine, sizeof( szLine ) );
+
+		int nLength = Q_strlen( szLine );
+		while ( nLength > 0 && ( szLine[nLength - 1] == '\n' || szLine[nLength - 1] == '\r' ) )
+			szLine[--nLength] = 0;
+
+		strings.Add( szLine );
+	}
+
+	return true;
+}
+
+CON_COMMAND_F( ffdev_symboltable_dump, "Writes the strings ffdev_symboltable_benchmark uses to a file, one per line. Usage: ffdev_symboltable_dump <file>", FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	if ( args.ArgC() < 2 )
+	{
+		Msg( "Usage: ffdev_symboltable_dump <file>\n" );
+		return;
+	}
+
+	CFFSymbolTestStrings strings;
+	FF_SymbolTestGather( strings );
+
+	CUtlBuffer buf( 0, 0, CUtlBuffer::TEXT_BUFFER );
+	for ( int i = 0; i < strings.Count(); i++ )
+		buf.Printf( "%s\n", strings.Get( i ) );
+
+	if ( !filesystem->WriteFile( args[1], "MOD", buf ) )
+	{
+		Warning( "Couldn't write %s\n", args[1] );
+		return;
+	}
+
+	Msg( "Wrote %d strings to %s\n", strings.Count(), args[1] );
+}
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+template < class T >
+struct FFSymbolTestJob_t
+{
+	const T				*m_pTable;
+	const char * const	*m_ppStrings;
+	int					m_nStrings;
+	int					m_nPasses;
+	int					m_nFound;
+};
+
+template < class T >
+static void FF_SymbolTestFindJob( FFSymbolTestJob_t< T > &job )
+{
+	int nFound = 0;
+	for ( int iPass = 0; iPass < job.m_nPasses; iPass++ )
+	{
+		for ( int i = 0; i < job.m_nStrings; i++ )
+		{
+			if ( job.m_pTable->Find( job.m_ppStrings[i] ).IsValid() )
+				nFound++;
+		}
+	}
+	job.m_nFound = nFound;
+}
+
+static void FF_SymbolTestReport( const char *pszTable, const char *pszTest, double flSeconds, int nOperations )
+{
+	char szName[128];
+	Q_snprintf( szName, sizeof( szName ), "%s/%s", pszTable, pszTest );
+	Msg( "%-40s %10.1f ns %12d\n", szName, nOperations ? flSeconds * 1e9 / nOperations : 0.0, nOperations );
+}
+
+template < class T >
+static int FF_SymbolTestFind( const T &table, const CUtlVector< const char * > &strings, int nPasses )
+{
+	int nFound = 0;
+	for ( int iPass = 0; iPass < nPasses; iPass++ )
+	{
+		for ( int i = 0; i < strings.Count(); i++ )
+		{
+			if ( table.Find( strings[i] ).IsValid() )
+				nFound++;
+		}
+	}
+	return nFound;
+}
+
+template < class T >
+static void FF_SymbolTestRun( const char *pszTable, const CUtlVector< const char * > &hits, const CUtlVector< const char * > &misses,
+							  int nPasses, bool bThreaded )
+{
+	CFastTimer timer;
+
+	// insert into a fresh table each pass, the last one is kept for the finds
+	T *pTable = NULL;
+	double flInsert = 0.0;
+	for ( int iPass = 0; iPass < nPasses; iPass++ )
+	{
+		delete pTable;
+		pTable = new T;
+
+		timer.Start();
+		for ( int i = 0; i < hits.Count(); i++ )
+			pTable->AddString( hits[i] );
+		timer.End();
+		flInsert += timer.GetDuration().GetSeconds();
+	}
+	FF_SymbolTestReport( pszTable, "Insert", flInsert, hits.Count() * nPasses );
+
+	timer.Start();
+	int nFound = FF_SymbolTestFind( *pTable, hits, nPasses );
+	timer.End();
+	FF_SymbolTestReport( pszTable, "FindHit", timer.GetDuration().GetSeconds(), hits.Count() * nPasses );
+	if ( nFound != hits.Count() * nPasses )
+		Warning( "%s: only found %d of %d\n", pszTable, nFound, hits.Count() * nPasses );
+
+	timer.Start();
+	nFound = FF_SymbolTestFind( *pTable, misses, nPasses );
+	timer.End();
+	FF_SymbolTestReport( pszTable, "FindMiss", timer.GetDuration().GetSeconds(), misses.Count() * nPasses );
+	if ( nFound )
+		Warning( "%s: found %d strings that were never added\n", pszTable, nFound );
+
+	if ( bThreaded )
+	{
+		CUtlVector< FFSymbolTestJob_t< T > > jobs;
+		int nPerJob = ( hits.Count() + SYMBOLTEST_JOB_SLICES - 1 ) / SYMBOLTEST_JOB_SLICES;
+		for ( int iFirst = 0; iFirst < hits.Count(); iFirst += nPerJob )
+		{
+			FFSymbolTestJob_t< T > &job = jobs[jobs.AddToTail()];
+			job.m_pTable = pTable;
+			job.m_ppStrings = hits.Base() + iFirst;
+			job.m_nStrings = MIN( nPerJob, hits.Count() - iFirst );
+			job.m_nPasses = nPasses;
+			job.m_nFound = 0;
+		}
+
+		timer.Start();
+		ParallelProcess( "FF_SymbolTestFindJob", jobs.Base(), jobs.Count(), &FF_SymbolTestFindJob< T > );
+		timer.End();
+
+		nFound = 0;
+		for ( int i = 0; i < jobs.Count(); i++ )
+			nFound += jobs[i].m_nFound;
+
+		// wall clock over every find, so this is throughput rather than latency.
+		// CUtlSymbolTable doesn't get this, its Find isn't safe to call from several threads
+		FF_SymbolTestReport( pszTable, "FindHitThreaded", timer.GetDuration().GetSeconds(), hits.Count() * nPasses );
+		if ( nFound != hits.Count() * nPasses )
+			Warning( "%s: threaded finds only found %d of %d\n", pszTable, nFound, hits.Count() * nPasses );
+	}
+
+	delete pTable;
+}
+
+// CUtlSymbolTableMT hides CUtlSymbolTable's GetMemoryUsage, it would be the same anyway
+static size_t FF_SymbolTestMemory( const CUtlSymbolTable &table ) { return table.GetMemoryUsage(); }
+static size_t FF_SymbolTestMemory( const CUtlHashedSymbolTable &table ) { return table.GetMemoryUsage(); }
+
+template < class T >
+static void FF_SymbolTestMemoryReport( const char *pszTable, const CUtlVector< const char * > &hits )
+{
+	T table;
+	for ( int i = 0; i < hits.Count(); i++ )
+		table.AddString( hits[i] );
+
+	size_t nBytes = FF_SymbolTestMemory( table );
+	Msg( "%-40s %10.1f KB %9.1f B/string\n", pszTable, nBytes / 1024.0, hits.Count() ? (double)nBytes / hits.Count() : 0.0 );
+}
+
+CON_COMMAND_F( ffdev_symboltable_benchmark, "Times the tree and hashed symbol tables on the server's strings, or the ones in a file from ffdev_symboltable_dump. Usage: ffdev_symboltable_benchmark [file] [passes]", FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	CFFSymbolTestStrings strings;
+	if ( args.ArgC() > 1 && Q_strcmp( args[1], "-" ) )
+	{
+		if ( !FF_SymbolTestLoad( strings, args[1] ) )
+		{
+			Warning( "Couldn't read %s\n", args[1] );
+			return;
+		}
+	}
+	else
+	{
+		FF_SymbolTestGather( strings );
+	}
+
+	int nPasses = ( args.ArgC() > 2 ) ? clamp( atoi( args[2] ), 1, 1000 ) : 20;
+
+	if ( !strings.Count() )
+	{
+		Msg( "No strings to test with\n" );
+		return;
+	}
+
+	// misses are the same strings with something on the end, so they hash
+	// differently but still share prefixes with what's in the table
+	CUtlVector< CUtlString > missStrings;
+	missStrings.EnsureCapacity( strings.Count() );
+	for ( int i = 0; i < strings.Count(); i++ )
+	{
+		char szMiss[1024];
+		Q_snprintf( szMiss, sizeof( szMiss ), "%s#", strings.Get( i ) );
+		missStrings.AddToTail( szMiss );
+	}
+
+	CUtlVector< const char * > hits, misses;
+	hits.EnsureCapacity( strings.Count() );
+	misses.EnsureCapacity( strings.Count() );
+	for ( int i = 0; i < strings.Count(); i++ )
+	{
+		hits.AddToTail( strings.Get( i ) );
+		misses.AddToTail( missStrings[i].Get() );
+	}
+
+	Msg( "%d strings, %d passes\n", strings.Count(), nPasses );
+	Msg( "%-40s %13s %12s\n", "Benchmark", "Time", "Iterations" );
+	Msg( "------------------------------------------------------------------\n" );
+
+	FF_SymbolTestRun< CUtlSymbolTable >( "CUtlSymbolTable", hits, misses, nPasses, false );
+	FF_SymbolTestRun< CUtlSymbolTableMT >( "CUtlSymbolTableMT", hits, misses, nPasses, true );
+	FF_SymbolTestRun< CUtlHashedSymbolTable >( "CUtlHashedSymbolTable", hits, misses, nPasses, true );
+
+	Msg( "\n%-40s %13s\n", "Memory", "Total" );
+	Msg( "------------------------------------------------------------------\n" );
+	FF_SymbolTestMemoryReport< CUtlSymbolTable >( "CUtlSymbolTable", hits );
+	FF_SymbolTestMemoryReport< CUtlHashedSymbolTable >( "CUtlHashedSymbolTable", hits );
+}
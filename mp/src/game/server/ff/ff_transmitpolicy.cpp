@@ -0,0 +1,518 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_transmitpolicy.cpp
+/// @brief Who gets sent what, for FF entities
+///
+/// REVISIONS
+/// ---------
+/// Per class relevance rules on top of the engine's PVS check, and an
+/// estimate of what each entity class costs to send per client.
+
+#include "cbase.h"
+#include "ff_transmitpolicy.h"
+#include "ff_buildableobject.h"
+#include "igamesystem.h"
+#include "bitvec.h"
+#include "utlmap.h"
+#include "tier0/vprof.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+ConVar ffdev_transmit_projectile_range( "ffdev_transmit_projectile_range", "4096", FCVAR_FF_FFDEV, "Projectiles further than this from a player aren't sent to them, unless they own it (0 sends everything in the PVS)" );
+ConVar ffdev_transmit_idle_interval( "ffdev_transmit_idle_interval", "0.1", FCVAR_FF_FFDEV, "How often idle buildables (eg a searching sentry's sweep) update their networked animation state" );
+
+// Rough sizes of the bits the engine wraps around entity data in a snapshot
+#define TRANSMIT_ENTITY_HEADER_BITS		8		// index delta and update type
+#define TRANSMIT_ENTER_PVS_BITS			18		// class id and serial number
+#define TRANSMIT_PROP_INDEX_BITS		7		// index delta per changed prop
+
+//-----------------------------------------------------------------------------
+// Purpose: Distance falloff for projectiles
+//-----------------------------------------------------------------------------
+int FFTransmit_ProjectileShouldTransmit( CBaseEntity *pProjectile, const CCheckTransmitInfo *pInfo, int nBaseFlags )
+{
+	if ( nBaseFlags == FL_EDICT_DONTSEND )
+		return nBaseFlags;
+
+	float flRange = ffdev_transmit_projectile_range.GetFloat();
+	if ( flRange <= 0.0f )
+		return nBaseFlags;
+
+	CBasePlayer *pRecipient = ToBasePlayer( CBaseEntity::Instance( pInfo->m_pClientEnt ) );
+	if ( !pRecipient )
+		return nBaseFlags;
+
+	// Owners are predicting their own, and sourcetv/replay want the lot
+	if ( pProjectile->GetOwnerEntity() == pRecipient || pRecipient->IsHLTV() || pRecipient->IsReplay() )
+		return nBaseFlags;
+
+	// Spectators see from whoever they're watching
+	CBaseEntity *pViewer = pRecipient;
+	if ( pRecipient->IsObserver() && pRecipient->GetObserverTarget() )
+		pViewer = pRecipient->GetObserverTarget();
+
+	if ( pViewer->EyePosition().DistToSqr( pProjectile->GetAbsOrigin() ) > flRange * flRange )
+		return FL_EDICT_DONTSEND;
+
+	return nBaseFlags;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Only the owner
+//-----------------------------------------------------------------------------
+int FFTransmit_OwnerOnlyShouldTransmit( CBaseEntity *pEntity, const CCheckTransmitInfo *pInfo )
+{
+	CBaseEntity *pRecipient = CBaseEntity::Instance( pInfo->m_pClientEnt );
+
+	if ( pRecipient && pRecipient == pEntity->GetOwnerEntity() )
+		return FL_EDICT_ALWAYS;
+
+	return FL_EDICT_DONTSEND;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Buildable ammo and the like only go to the owner's team (and
+//			allies). Everyone else gets the rest of the buildable as normal.
+//-----------------------------------------------------------------------------
+void *SendProxy_SendBuildableTeamDataTable( const SendProp *pProp, const void *pStruct, const void *pVarData, CSendProxyRecipients *pRecipients, int objectID )
+{
+	const CFFBuildableObject *pBuildable = ( const CFFBuildableObject * )pStruct;
+	CBaseEntity *pOwner = pBuildable->m_hOwner.Get();
+
+	// No owner yet, so there's no team to keep it from
+	if ( !pOwner )
+		return ( void * )pVarData;
+
+	pRecipients->ClearAllRecipients();
+
+	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
+	{
+		CBasePlayer *pPlayer = UTIL_PlayerByIndex( i );
+
+		if ( !pPlayer )
+			continue;
+
+		if ( pPlayer == pOwner || pPlayer->IsHLTV() || pPlayer->IsReplay() || g_pGameRules->PlayerRelationship( pPlayer, pOwner ) == GR_TEAMMATE )
+			pRecipients->SetRecipient( i - 1 );
+	}
+
+	return ( void * )pVarData;
+}
+REGISTER_SEND_PROXY_NON_MODIFIED_POINTER( SendProxy_SendBuildableTeamDataTable );
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+bool FFTransmit_IdleUpdateDue( float &flNextUpdate )
+{
+	float flInterval = ffdev_transmit_idle_interval.GetFloat();
+
+	if ( flInterval > 0.0f && gpGlobals->curtime < flNextUpdate )
+		return false;
+
+	flNextUpdate = gpGlobals->curtime + flInterval;
+	return true;
+}
+
+//=============================================================================
+// CFFTransmitStats
+//
+// The game dll never sees the packed snapshots, so this estimates them from
+// what it does see: which entities each client is sent, whether they've just
+// come into view, and which network vars changed since the last pack. Each
+// changed var is costed at the bits its SendProp encodes to. Vars changed
+// with a plain NetworkStateChanged() count as the whole class, so treat the
+// numbers as an upper bound for comparing classes against each other.
+//=============================================================================
+class CFFTransmitStats : public CAutoGameSystem
+{
+public:
+	CFFTransmitStats() : CAutoGameSystem( "FFTransmitStats" )
+	{
+		m_bRecording = false;
+	}
+
+	virtual void LevelShutdownPreEntity()
+	{
+		Stop();
+	}
+
+	void	Start();
+	void	Stop();
+	void	Print();
+	bool	IsRecording() const { return m_bRecording; }
+
+	void	RecordSnapshot( const CCheckTransmitInfo *pInfo );
+
+private:
+	struct PropCost_t
+	{
+		int		m_iOffset;
+		int		m_nBits;
+	};
+
+	struct ClassCost_t
+	{
+		ServerClass				*m_pClass;
+		CUtlVector<PropCost_t>	m_Props;		// sorted by offset
+		int						m_nFullBits;
+
+		int64	m_nBits;
+		int		m_nSends;
+		int		m_nEnters;
+	};
+
+	ClassCost_t	*GetClassCost( ServerClass *pClass );
+	int		GetChangedBits( edict_t *pEdict, const ClassCost_t &cost ) const;
+
+	static int	PropSortFunc( const PropCost_t *lhs, const PropCost_t *rhs ) { return lhs->m_iOffset - rhs->m_iOffset; }
+	static int	ClassSortFunc( ClassCost_t * const *lhs, ClassCost_t * const *rhs );
+	static int	EstimatePropBits( const SendProp *pProp );
+	static void	GatherExcludes( SendTable *pTable, CUtlVector<const SendProp *> &excludes );
+	static void	GatherProps( SendTable *pTable, int iBaseOffset, const CUtlVector<const SendProp *> &excludes, CUtlVector<PropCost_t> &props );
+
+	bool	m_bRecording;
+	float	m_flStartTime;
+
+	CUtlVector<ClassCost_t *>	m_Classes;			// by class id
+	CBitVec<MAX_EDICTS>			m_LastSent[ MAX_PLAYERS + 1 ];
+	int							m_nSnapshots[ MAX_PLAYERS + 1 ];
+};
+
+static CFFTransmitStats g_FFTransmitStats;
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void FFTransmit_RecordSnapshot( const CCheckTransmitInfo *pInfo )
+{
+	if ( g_FFTransmitStats.IsRecording() )
+		g_FFTransmitStats.RecordSnapshot( pInfo );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFTransmitStats::Start()
+{
+	m_Classes.PurgeAndDeleteElements();
+
+	for ( int i = 0; i <= MAX_PLAYERS; i++ )
+	{
+		m_LastSent[i].ClearAll();
+		m_nSnapshots[i] = 0;
+	}
+
+	m_flStartTime = gpGlobals->curtime;
+	m_bRecording = true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFTransmitStats::Stop()
+{
+	m_bRecording = false;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Tally up what one client is being sent this snapshot
+//-----------------------------------------------------------------------------
+void CFFTransmitStats::RecordSnapshot( const CCheckTransmitInfo *pInfo )
+{
+	VPROF_BUDGET( "CFFTransmitStats::RecordSnapshot", VPROF_BUDGETGROUP_OTHER_NETWORKING );
+
+	int iClient = engine->IndexOfEdict( pInfo->m_pClientEnt );
+	if ( iClient < 1 || iClient > MAX_PLAYERS )
+		return;
+
+	CBitVec<MAX_EDICTS> &lastSent = m_LastSent[iClient];
+	m_nSnapshots[iClient]++;
+
+	for ( int i = pInfo->m_pTransmitEdict->FindNextSetBit( 0 ); i >= 0; i = pInfo->m_pTransmitEdict->FindNextSetBit( i + 1 ) )
+	{
+		edict_t *pEdict = engine->PEntityOfEntIndex( i );
+		if ( !pEdict || pEdict->IsFree() || !pEdict->GetNetworkable() )
+			continue;
+
+		ClassCost_t *pCost = GetClassCost( pEdict->GetNetworkable()->GetServerClass() );
+		if ( !pCost )
+			continue;
+
+		int nBits;
+		if ( !lastSent.IsBitSet( i ) )
+		{
+			nBits = TRANSMIT_ENTITY_HEADER_BITS + TRANSMIT_ENTER_PVS_BITS + pCost->m_nFullBits;
+			pCost->m_nEnters++;
+		}
+		else
+		{
+			nBits = GetChangedBits( pEdict, *pCost );
+			if ( nBits )
+				nBits += TRANSMIT_ENTITY_HEADER_BITS;
+		}
+
+		pCost->m_nBits += nBits;
+		pCost->m_nSends++;
+	}
+
+	pInfo->m_pTransmitEdict->CopyTo( &lastSent );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: What the change offsets on an edict add up to
+//-----------------------------------------------------------------------------
+int CFFTransmitStats::GetChangedBits( edict_t *pEdict, const ClassCost_t &cost ) const
+{
+	if ( !( pEdict->m_fStateFlags & FL_EDICT_CHANGED ) )
+		return 0;
+
+	const IChangeInfoAccessor *pAccessor = pEdict->GetChangeAccessor();
+
+	if ( ( pEdict->m_fStateFlags & FL_FULL_EDICT_CHANGED ) || pAccessor->GetChangeInfoSerialNumber() != g_pSharedChangeInfo->m_iSerialNumber )
+		return cost.m_nFullBits;
+
+	const CEdictChangeInfo &info = g_pSharedChangeInfo->m_ChangeInfos[ pAccessor->GetChangeInfo() ];
+
+	int nBits = 0;
+	for ( int i = 0; i < info.m_nChangeOffsets; i++ )
+	{
+		// Find the prop at or just below the offset, so a var that's part
+		// of a bigger one (a vector component, say) costs the whole thing
+		int iOffset = info.m_ChangeOffsets[i];
+
+		int lo = 0, hi = cost.m_Props.Count() - 1, iFound = -1;
+		while ( lo <= hi )
+		{
+			int mid = ( lo + hi ) / 2;
+			if ( cost.m_Props[mid].m_iOffset <= iOffset )
+			{
+				iFound = mid;
+				lo = mid + 1;
+			}
+			else
+			{
+				hi = mid - 1;
+			}
+		}
+
+		if ( iFound != -1 )
+			nBits += TRANSMIT_PROP_INDEX_BITS + cost.m_Props[iFound].m_nBits;
+	}
+
+	return nBits;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Lazily flatten a class's send table into offsets and sizes
+//-----------------------------------------------------------------------------
+CFFTransmitStats::ClassCost_t *CFFTransmitStats::GetClassCost( ServerClass *pClass )
+{
+	if ( !pClass || pClass->m_ClassID < 0 )
+		return NULL;
+
+	if ( pClass->m_ClassID >= m_Classes.Count() )
+	{
+		int iOld = m_Classes.Count();
+		m_Classes.SetCount( pClass->m_ClassID + 1 );
+
+		for ( int i = iOld; i < m_Classes.Count(); i++ )
+			m_Classes[i] = NULL;
+	}
+
+	ClassCost_t *&pCost = m_Classes[ pClass->m_ClassID ];
+	if ( pCost )
+		return pCost;
+
+	pCost = new ClassCost_t;
+	pCost->m_pClass = pClass;
+	pCost->m_nBits = 0;
+	pCost->m_nSends = 0;
+	pCost->m_nEnters = 0;
+
+	CUtlVector<const SendProp *> excludes;
+	GatherExcludes( pClass->m_pTable, excludes );
+	GatherProps( pClass->m_pTable, 0, excludes, pCost->m_Props );
+
+	pCost->m_Props.Sort( PropSortFunc );
+
+	pCost->m_nFullBits = 0;
+	for ( int i = 0; i < pCost->m_Props.Count(); i++ )
+		pCost->m_nFullBits += TRANSMIT_PROP_INDEX_BITS + pCost->m_Props[i].m_nBits;
+
+	return pCost;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: SendPropExclude()s anywhere in the hierarchy
+//-----------------------------------------------------------------------------
+void CFFTransmitStats::GatherExcludes( SendTable *pTable, CUtlVector<const SendProp *> &excludes )
+{
+	for ( int i = 0; i < pTable->GetNumProps(); i++ )
+	{
+		const SendProp *pProp = pTable->GetProp( i );
+
+		if ( pProp->IsExcludeProp() )
+			excludes.AddToTail( pProp );
+		else if ( pProp->GetType() == DPT_DataTable && pProp->GetDataTable() )
+			GatherExcludes( pProp->GetDataTable(), excludes );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose:
+//-----------------------------------------------------------------------------
+void CFFTransmitStats::GatherProps( SendTable *pTable, int iBaseOffset, const CUtlVector<const SendProp *> &excludes, CUtlVector<PropCost_t> &props )
+{
+	for ( int i = 0; i < pTable->GetNumProps(); i++ )
+	{
+		const SendProp *pProp = pTable->GetProp( i );
+
+		if ( pProp->IsExcludeProp() || pProp->IsInsideArray() )
+			continue;
+
+		bool bExcluded = false;
+		for ( int j = 0; j < excludes.Count() && !bExcluded; j++ )
+		{
+			bExcluded = !V_stricmp( excludes[j]->GetExcludeDTName(), pTable->GetName() ) && !V_stricmp( excludes[j]->GetName(), pProp->GetName() );
+		}
+
+		if ( bExcluded )
+			continue;
+
+		if ( pProp->GetType() == DPT_DataTable )
+		{
+			if ( pProp->GetDataTable() )
+				GatherProps( pProp->GetDataTable(), iBaseOffset + pProp->GetOffset(), excludes, props );
+			continue;
+		}
+
+		PropCost_t &cost = props[ props.AddToTail() ];
+		cost.m_iOffset = iBaseOffset + pProp->GetOffset();
+		cost.m_nBits = EstimatePropBits( pProp );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Bits one value of this prop typically encodes to
+//-----------------------------------------------------------------------------
+int CFFTransmitStats::EstimatePropBits( const SendProp *pProp )
+{
+	int nFlags = pProp->GetFlags();
+	int nFloatBits = pProp->m_nBits;
+
+	if ( nFlags & SPROP_NOSCALE )
+		nFloatBits = 32;
+	else if ( nFlags & ( SPROP_COORD | SPROP_COORD_MP | SPROP_COORD_MP_LOWPRECISION | SPROP_COORD_MP_INTEGRAL ) )
+		nFloatBits = 18;
+	else if ( nFlags & SPROP_NORMAL )
+		nFloatBits = 12;
+
+	switch ( pProp->GetType() )
+	{
+	case DPT_Int:
+		return pProp->m_nBits;
+	case DPT_Float:
+		return nFloatBits;
+	case DPT_Vector:
+		return ( nFlags & SPROP_NORMAL ) ? nFloatBits * 2 + 1 : nFloatBits * 3;
+	case DPT_VectorXY:
+		return nFloatBits * 2;
+	case DPT_String:
+		return DT_MAX_STRING_BITS + 16 * 8;
+	case DPT_Array:
+		return pProp->GetNumArrayLengthBits() + ( pProp->GetArrayProp() ? pProp->GetNumElements() * EstimatePropBits( pProp->GetArrayProp() ) : 0 );
+	default:
+		return 32;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Most expensive first
+//-----------------------------------------------------------------------------
+int CFFTransmitStats::ClassSortFunc( ClassCost_t * const *lhs, ClassCost_t * const *rhs )
+{
+	if ( ( *lhs )->m_nBits == ( *rhs )->m_nBits )
+		return 0;
+
+	return ( *lhs )->m_nBits > ( *rhs )->m_nBits ? -1 : 1;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Classes by estimated bytes per client per second
+//-----------------------------------------------------------------------------
+void CFFTransmitStats::Print()
+{
+	float flElapsed = gpGlobals->curtime - m_flStartTime;
+	if ( flElapsed <= 0.0f )
+	{
+		Msg( "No transmit stats recorded yet\n" );
+		return;
+	}
+
+	int nClients = 0;
+	for ( int i = 1; i <= MAX_PLAYERS; i++ )
+	{
+		if ( m_nSnapshots[i] )
+			nClients++;
+	}
+
+	if ( !nClients )
+	{
+		Msg( "No snapshots recorded yet\n" );
+		return;
+	}
+
+	CUtlVector<ClassCost_t *> sorted;
+	for ( int i = 0; i < m_Classes.Count(); i++ )
+	{
+		if ( m_Classes[i] && m_Classes[i]->m_nSends )
+			sorted.AddToTail( m_Classes[i] );
+	}
+
+	sorted.Sort( ClassSortFunc );
+
+	float flScale = 1.0f / ( 8.0f * flElapsed * nClients );
+	float flTotal = 0.0f;
+
+	Msg( "Estimated transmit cost over %.1f seconds, %d clients (upper bound)\n", flElapsed, nClients );
+	Msg( "%-32s %12s %10s %10s\n", "class", "bytes/cl/s", "sends/s", "enters/s" );
+
+	for ( int i = 0; i < sorted.Count(); i++ )
+	{
+		const ClassCost_t *pCost = sorted[i];
+		float flBytes = pCost->m_nBits * flScale;
+		flTotal += flBytes;
+
+		Msg( "%-32s %12.1f %10.1f %10.1f\n", pCost->m_pClass->GetName(), flBytes, pCost->m_nSends / ( flElapsed * nClients ), pCost->m_nEnters / ( flElapsed * nClients ) );
+	}
+
+	Msg( "%-32s %12.1f\n", "total", flTotal );
+}
+
+CON_COMMAND( ffdev_transmit_stats, "Estimates network bytes per entity class per client per second. Usage: ffdev_transmit_stats [start|stop]" )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	if ( args.ArgC() > 1 )
+	{
+		if ( !Q_stricmp( args[1], "start" ) )
+		{
+			g_FFTransmitStats.Start();
+			Msg( "Recording transmit stats\n" );
+			return;
+		}
+
+		if ( !Q_stricmp( args[1], "stop" ) )
+		{
+			g_FFTransmitStats.Stop();
+			Msg( "Stopped recording transmit stats\n" );
+			return;
+		}
+	}
+
+	g_FFTransmitStats.Print();
+}
@@ -0,0 +1,40 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_transmitpolicy.h
+/// @brief Who gets sent what, for FF entities
+///
+/// REVISIONS
+/// ---------
+/// Per class relevance rules on top of the engine's PVS check, and an
+/// estimate of what each entity class costs to send per client.
+
+#ifndef FF_TRANSMITPOLICY_H
+#define FF_TRANSMITPOLICY_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+class CCheckTransmitInfo;
+class CSendProxyRecipients;
+class SendProp;
+
+// Projectiles: culled for everyone except their owner past
+// ffdev_transmit_projectile_range. nBaseFlags is what BaseClass::ShouldTransmit said.
+int FFTransmit_ProjectileShouldTransmit( CBaseEntity *pProjectile, const CCheckTransmitInfo *pInfo, int nBaseFlags );
+
+// For entities holding data that only their owner's HUD reads
+int FFTransmit_OwnerOnlyShouldTransmit( CBaseEntity *pEntity, const CCheckTransmitInfo *pInfo );
+
+// Datatable proxy that sends a buildable's internals (ammo etc) only to
+// players on its owner's team
+void *SendProxy_SendBuildableTeamDataTable( const SendProp *pProp, const void *pStruct, const void *pVarData, CSendProxyRecipients *pRecipients, int objectID );
+
+// Idle entities only push their cosmetic network state this often. Returns
+// true (and moves flNextUpdate on) when it's time.
+bool FFTransmit_IdleUpdateDue( float &flNextUpdate );
+
+// Called at the end of CServerGameEnts::CheckTransmit for each client
+void FFTransmit_RecordSnapshot( const CCheckTransmitInfo *pInfo );
+
+#endif // FF_TRANSMITPOLICY_H
@@ -84,6 +84,7 @@ void CFFEntitySystemHelper::OnThink()
 	_scheduleman.Update();
 	//_menuman.Update();
 	_timerman.Update();
+	_scriptman.Update();
 	SetNextThink(gpGlobals->curtime + TICK_INTERVAL);
 }
 
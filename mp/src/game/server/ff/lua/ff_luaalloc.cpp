@@ -0,0 +1,258 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_luaalloc.cpp
+/// @brief Memory allocator for the Lua VM
+///
+/// REVISIONS
+/// ---------
+/// Blocks up to MAX_POOLED_SIZE bytes are rounded up to one of a handful of
+/// size classes, each backed by a CUtlMemoryPool. Lua only ever runs on the
+/// main thread and gets the allocator as its ud, so the pools need no locking.
+
+#include "cbase.h"
+#include "ff_luaalloc.h"
+#include "ff_scriptman.h"
+#include "tier0/vprof.h"
+
+// lua
+extern "C"
+{
+	#include "lua.h"
+}
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+// the allocator the script manager's VM runs on
+CFFLuaAllocator g_LuaAllocator;
+
+static const int s_LuaSizeClasses[] = { 16, 32, 48, 64, 96, 128, 192, 256 };
+
+// each pool grows by about this much at a time
+#define LUAALLOC_BLOB_SIZE		16384
+
+/////////////////////////////////////////////////////////////////////////////
+CFFLuaAllocator::CFFLuaAllocator()
+{
+	COMPILE_TIME_ASSERT( ARRAYSIZE( s_LuaSizeClasses ) == NUM_SIZE_CLASSES );
+	COMPILE_TIME_ASSERT( MAX_POOLED_SIZE == 256 );
+
+	int iClass = 0;
+	for( int i = 0; i < ARRAYSIZE( m_SizeClassLookup ); i++ )
+	{
+		while( s_LuaSizeClasses[ iClass ] < i * SIZE_CLASS_GRANULARITY )
+			iClass++;
+
+		m_SizeClassLookup[ i ] = (unsigned char)iClass;
+	}
+
+	// the pools themselves are made on first use, as this is a global
+	for( int i = 0; i < NUM_SIZE_CLASSES; i++ )
+		m_pPools[ i ] = NULL;
+
+	m_nReportedKB = 0;
+	ResetStats();
+}
+
+/////////////////////////////////////////////////////////////////////////////
+CFFLuaAllocator::~CFFLuaAllocator()
+{
+	for( int i = 0; i < NUM_SIZE_CLASSES; i++ )
+	{
+		delete m_pPools[ i ];
+		m_pPools[ i ] = NULL;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaAllocator::Clear()
+{
+	AssertMsg( m_nBytesLive == 0, "Clearing the Lua pools with blocks still in use" );
+
+	for( int i = 0; i < NUM_SIZE_CLASSES; i++ )
+	{
+		if( m_pPools[ i ] )
+			m_pPools[ i ]->Clear();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaAllocator::ResetStats()
+{
+	m_nBytesPeak = m_nBytesLive;
+	m_nAllocs = 0;
+	m_nPooledAllocs = 0;
+
+	m_nAllocsAtLastSample = 0;
+	m_flLastSampleTime = gpGlobals ? gpGlobals->curtime : 0.0f;
+	m_flAllocsPerSecond = 0.0f;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void *CFFLuaAllocator::LuaAlloc( void *ud, void *ptr, size_t osize, size_t nsize )
+{
+	CFFLuaAllocator *pAllocator = (CFFLuaAllocator *)ud;
+
+	if( nsize == 0 )
+	{
+		pAllocator->Free( ptr, osize );
+		return NULL;
+	}
+
+	if( !ptr )
+		return pAllocator->Allocate( nsize );
+
+	return pAllocator->Reallocate( ptr, osize, nsize );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void *CFFLuaAllocator::Allocate( size_t nSize )
+{
+	VPROF_INCREMENT_COUNTER( "Lua allocations", 1 );
+
+	void *ptr;
+
+	int iClass = GetSizeClass( nSize );
+	if( iClass >= 0 )
+	{
+		if( !m_pPools[ iClass ] )
+		{
+			int nBlockSize = s_LuaSizeClasses[ iClass ];
+			m_pPools[ iClass ] = new CUtlMemoryPool( nBlockSize, LUAALLOC_BLOB_SIZE / nBlockSize, CUtlMemoryPool::GROW_SLOW, "CFFLuaAllocator", 8 );
+		}
+
+		ptr = m_pPools[ iClass ]->Alloc();
+		m_nPooledAllocs++;
+	}
+	else
+	{
+		ptr = malloc( nSize );
+	}
+
+	// Lua copes with running out, as long as we say so
+	if( !ptr )
+		return NULL;
+
+	m_nAllocs++;
+	m_nBytesLive += nSize;
+	if( m_nBytesLive > m_nBytesPeak )
+		m_nBytesPeak = m_nBytesLive;
+
+	return ptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaAllocator::Free( void *ptr, size_t nSize )
+{
+	if( !ptr )
+		return;
+
+	int iClass = GetSizeClass( nSize );
+	if( iClass >= 0 )
+	{
+		Assert( m_pPools[ iClass ] );
+		m_pPools[ iClass ]->Free( ptr );
+	}
+	else
+	{
+		free( ptr );
+	}
+
+	Assert( m_nBytesLive >= nSize );
+	m_nBytesLive -= nSize;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void *CFFLuaAllocator::Reallocate( void *ptr, size_t nOldSize, size_t nNewSize )
+{
+	int iOldClass = GetSizeClass( nOldSize );
+	int iNewClass = GetSizeClass( nNewSize );
+
+	// still fits the block it's in
+	if( iOldClass >= 0 && iOldClass == iNewClass )
+	{
+		m_nBytesLive += nNewSize;
+		m_nBytesLive -= nOldSize;
+		if( m_nBytesLive > m_nBytesPeak )
+			m_nBytesPeak = m_nBytesLive;
+
+		return ptr;
+	}
+
+	// big to big, let the heap grow it in place if it can
+	if( iOldClass < 0 && iNewClass < 0 )
+	{
+		void *pNew = realloc( ptr, nNewSize );
+		if( !pNew )
+			return NULL;
+
+		m_nBytesLive += nNewSize;
+		m_nBytesLive -= nOldSize;
+		if( m_nBytesLive > m_nBytesPeak )
+			m_nBytesPeak = m_nBytesLive;
+
+		return pNew;
+	}
+
+	// moving between a pool and the heap, or between pools
+	void *pNew = Allocate( nNewSize );
+	if( !pNew )
+		return NULL;
+
+	memcpy( pNew, ptr, MIN( nOldSize, nNewSize ) );
+	Free( ptr, nOldSize );
+
+	return pNew;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaAllocator::Update()
+{
+	float flElapsed = gpGlobals->curtime - m_flLastSampleTime;
+	if( flElapsed >= 1.0f || flElapsed < 0.0f )
+	{
+		m_flAllocsPerSecond = ( flElapsed > 0.0f ) ? ( m_nAllocs - m_nAllocsAtLastSample ) / flElapsed : 0.0f;
+		m_nAllocsAtLastSample = m_nAllocs;
+		m_flLastSampleTime = gpGlobals->curtime;
+	}
+
+	// counters can only be added to, so move it by however much we've changed
+	int nLiveKB = (int)( m_nBytesLive / 1024 );
+	VPROF_INCREMENT_GROUP_COUNTER( "Lua KB live", COUNTER_GROUP_NO_RESET, nLiveKB - m_nReportedKB );
+	m_nReportedKB = nLiveKB;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaAllocator::PrintStats() const
+{
+	Msg( "Lua memory: %.1f KB live, %.1f KB peak\n", m_nBytesLive / 1024.0f, m_nBytesPeak / 1024.0f );
+	Msg( "  %u allocations (%u pooled), %.0f/sec\n", m_nAllocs, m_nPooledAllocs, m_flAllocsPerSecond );
+
+	for( int i = 0; i < NUM_SIZE_CLASSES; i++ )
+	{
+		if( !m_pPools[ i ] )
+			continue;
+
+		Msg( "  %3d bytes: %6d in use, %6d peak\n", s_LuaSizeClasses[ i ], m_pPools[ i ]->Count(), m_pPools[ i ]->PeakCount() );
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+CON_COMMAND( lua_meminfo, "Show the memory used by the server-side Lua VM. 'lua_meminfo reset' starts the counters again." )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	if ( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) )
+	{
+		g_LuaAllocator.ResetStats();
+		return;
+	}
+
+	g_LuaAllocator.PrintStats();
+
+	lua_State *L = _scriptman.GetLuaState();
+	if ( L )
+		Msg( "  VM reports %d KB in use\n", lua_gc( L, LUA_GCCOUNT, 0 ) );
+}
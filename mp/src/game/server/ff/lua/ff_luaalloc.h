@@ -0,0 +1,83 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_luaalloc.h
+/// @brief Memory allocator for the Lua VM
+///
+/// REVISIONS
+/// ---------
+/// Small Lua allocations (tables, strings, closures, userdata) come out of
+/// fixed size-class pools instead of going to realloc every time, and the
+/// VM's memory use is counted so it can be looked at per map.
+
+#ifndef FF_LUAALLOC_H
+#define FF_LUAALLOC_H
+
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "mempool.h"
+
+class CFFLuaAllocator
+{
+public:
+	CFFLuaAllocator();
+	~CFFLuaAllocator();
+
+	// lua_Alloc, with the allocator as ud. Lua always tells us the old
+	// size of a block, so the size class never needs storing.
+	static void *LuaAlloc( void *ud, void *ptr, size_t osize, size_t nsize );
+
+	// Frees the pools. Only call once the VM using them is closed.
+	void	Clear();
+
+	// Starts the counters again, eg. for a new map
+	void	ResetStats();
+
+	// Samples the allocation rate and updates the VPROF counters
+	void	Update();
+
+	void	PrintStats() const;
+
+	size_t	GetBytesLive() const { return m_nBytesLive; }
+	size_t	GetBytesPeak() const { return m_nBytesPeak; }
+	float	GetAllocsPerSecond() const { return m_flAllocsPerSecond; }
+
+private:
+	enum
+	{
+		SIZE_CLASS_GRANULARITY = 16,
+		MAX_POOLED_SIZE = 256,
+		NUM_SIZE_CLASSES = 8,
+	};
+
+	void	*Allocate( size_t nSize );
+	void	Free( void *ptr, size_t nSize );
+	void	*Reallocate( void *ptr, size_t nOldSize, size_t nNewSize );
+
+	// -1 if the block is too big to be pooled
+	int		GetSizeClass( size_t nSize ) const
+	{
+		return ( nSize <= MAX_POOLED_SIZE ) ? m_SizeClassLookup[ ( nSize + SIZE_CLASS_GRANULARITY - 1 ) / SIZE_CLASS_GRANULARITY ] : -1;
+	}
+
+	CUtlMemoryPool	*m_pPools[ NUM_SIZE_CLASSES ];
+	unsigned char	m_SizeClassLookup[ MAX_POOLED_SIZE / SIZE_CLASS_GRANULARITY + 1 ];
+
+	size_t	m_nBytesLive;
+	size_t	m_nBytesPeak;
+	unsigned int m_nAllocs;				// since the last ResetStats
+	unsigned int m_nPooledAllocs;
+
+	// for the per second rate
+	unsigned int m_nAllocsAtLastSample;
+	float	m_flLastSampleTime;
+	float	m_flAllocsPerSecond;
+
+	int		m_nReportedKB;				// what the VPROF counter was last moved to
+};
+
+extern CFFLuaAllocator g_LuaAllocator;
+
+#endif // FF_LUAALLOC_H
@@ -7,6 +7,7 @@
 #include "ff_luacontext.h"
 #include "ff_scriptman.h"
 #include "ff_entity_system.h"
+#include "ff_luaprofiler.h"
 
 #include "ff_team.h"
 #include "ff_grenade_base.h"
@@ -261,6 +262,9 @@ bool CFFLuaSC::CallFunction(CBaseEntity* pEntity, const char* szFunctionName, co
 	for(int iParam = 0 ; iParam < nParams ; ++iParam)
 		(*m_params[iParam]).push(L);
 
+	// time this entity:callback if lua_profile is running
+	CFFLuaProfileScope profileScope( m_szFunction );
+
 	// call out to the script
 	if(lua_pcall(L, pEntity||szTargetEntName ? nParams + 1 : nParams, 1, 0) != 0)
 	{
@@ -702,15 +702,16 @@ namespace FFLib
 
 	CFFInfoScript* GetInfoScriptByName(const char* entityName)
 	{
-		CFFInfoScript *pEnt = (CFFInfoScript*)gEntList.FindEntityByClassT( NULL, CLASS_INFOSCRIPT );
+		// by name first, it's indexed
+		CBaseEntity *pEnt = gEntList.FindEntityByName( NULL, entityName );
 
 		while( pEnt != NULL )
 		{
-			if ( FStrEq( STRING(pEnt->GetEntityName()), entityName ) )
-				return pEnt;
+			if ( pEnt->Classify() == CLASS_INFOSCRIPT && FStrEq( STRING(pEnt->GetEntityName()), entityName ) )
+				return (CFFInfoScript*)pEnt;
 
 			// Next!
-			pEnt = (CFFInfoScript*)gEntList.FindEntityByClassT( pEnt, CLASS_INFOSCRIPT );
+			pEnt = gEntList.FindEntityByName( pEnt, entityName );
 		}
 
 		return NULL;
@@ -718,14 +719,14 @@ namespace FFLib
 
 	CFuncFFScript *GetTriggerScriptByName( const char *pszEntityName )
 	{
-		CFuncFFScript *pEntity = ( CFuncFFScript * )gEntList.FindEntityByClassT( NULL, CLASS_TRIGGERSCRIPT );
+		CBaseEntity *pEntity = gEntList.FindEntityByName( NULL, pszEntityName );
 
 		while( pEntity )
 		{
-			if( FStrEq( STRING( pEntity->GetEntityName() ), pszEntityName ) )
-				return pEntity;
+			if( pEntity->Classify() == CLASS_TRIGGERSCRIPT && FStrEq( STRING( pEntity->GetEntityName() ), pszEntityName ) )
+				return ( CFuncFFScript * )pEntity;
 
-			pEntity = ( CFuncFFScript * )gEntList.FindEntityByClassT( pEntity, CLASS_TRIGGERSCRIPT );
+			pEntity = gEntList.FindEntityByName( pEntity, pszEntityName );
 		}
 
 		return NULL;
@@ -0,0 +1,412 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_luaprofiler.cpp
+/// @brief Profiler for server-side Lua callbacks
+///
+/// REVISIONS
+/// ---------
+/// Callback timing is inclusive: a callback that ends up calling another
+/// one counts the inner call's time as well. Stack samples go into a fixed
+/// ring of interned frame names, so a long session only keeps the most
+/// recent MAX_SAMPLES.
+
+#include "cbase.h"
+#include "ff_luaprofiler.h"
+#include "ff_scriptman.h"
+#include "filesystem.h"
+
+// lua
+extern "C"
+{
+	#include "lua.h"
+}
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+CFFLuaProfiler g_LuaProfiler;
+
+// name used for the root frame of samples taken outside any callback (script loading, lua_dostring)
+#define LUAPROFILE_NO_CALLBACK		"[no callback]"
+
+/////////////////////////////////////////////////////////////////////////////
+CFFLuaProfiler::CFFLuaProfiler() : m_Callbacks( k_eDictCompareTypeCaseSensitive ), m_FrameNames( 32, false )
+{
+	m_bActive = false;
+	m_eSampling = LUAPROFILE_SAMPLE_NONE;
+	m_nSampleRate = 0;
+	m_nLinesUntilSample = 0;
+	m_pHookedState = NULL;
+	m_flStartTime = 0.0;
+	m_nCallbackDepth = 0;
+	m_nNextSample = 0;
+	m_nTotalSamples = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::Start( lua_State *L, LuaProfileSampling_t eSampling, int nSampleRate )
+{
+	Stop();
+	Reset();
+
+	m_eSampling = eSampling;
+	m_nSampleRate = MAX( nSampleRate, 1 );
+	m_nLinesUntilSample = m_nSampleRate;
+
+	if( m_eSampling != LUAPROFILE_SAMPLE_NONE )
+		m_Samples.SetCount( MAX_SAMPLES );
+
+	m_bActive = true;
+
+	if( L )
+		InstallHook( L );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::Stop()
+{
+	if( m_pHookedState )
+	{
+		lua_sethook( m_pHookedState, NULL, 0, 0 );
+		m_pHookedState = NULL;
+	}
+
+	m_bActive = false;
+	m_nCallbackDepth = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::Reset()
+{
+	m_Callbacks.RemoveAll();
+	m_FrameNames.RemoveAll();
+	m_nNextSample = 0;
+	m_nTotalSamples = 0;
+	m_flStartTime = Plat_FloatTime();
+
+	// a reset while running mustn't leave the open callbacks pointing at nothing
+	m_nCallbackDepth = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::OnVMStarted( lua_State *L )
+{
+	if( m_bActive )
+		InstallHook( L );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::OnVMClosed()
+{
+	// the hook went with the state
+	m_pHookedState = NULL;
+	m_nCallbackDepth = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::InstallHook( lua_State *L )
+{
+	m_pHookedState = NULL;
+
+	switch( m_eSampling )
+	{
+	case LUAPROFILE_SAMPLE_INSTRUCTIONS:
+		lua_sethook( L, SampleHook, LUA_MASKCOUNT, m_nSampleRate );
+		break;
+
+	case LUAPROFILE_SAMPLE_LINES:
+		lua_sethook( L, SampleHook, LUA_MASKLINE, 0 );
+		break;
+
+	default:
+		return;
+	}
+
+	m_pHookedState = L;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::EnterCallback( const char *pszCallback )
+{
+	int iCallback = m_Callbacks.Find( pszCallback );
+	if( iCallback == m_Callbacks.InvalidIndex() )
+	{
+		CallbackStats_t stats;
+		stats.m_flTotalTime = 0.0;
+		stats.m_flMaxTime = 0.0;
+		stats.m_nCalls = 0;
+		iCallback = m_Callbacks.Insert( pszCallback, stats );
+	}
+
+	// very deep nesting just gets attributed to the innermost slot
+	if( m_nCallbackDepth < MAX_CALLBACK_DEPTH )
+		m_CallbackStack[ m_nCallbackDepth ] = iCallback;
+	else
+		m_CallbackStack[ MAX_CALLBACK_DEPTH - 1 ] = iCallback;
+
+	m_nCallbackDepth++;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::ExitCallback( double flElapsed )
+{
+	// stopped or reset while the callback was running
+	if( m_nCallbackDepth <= 0 )
+		return;
+
+	m_nCallbackDepth--;
+
+	int iCallback = m_CallbackStack[ MIN( m_nCallbackDepth, MAX_CALLBACK_DEPTH - 1 ) ];
+
+	CallbackStats_t &stats = m_Callbacks[ iCallback ];
+	stats.m_flTotalTime += flElapsed;
+	stats.m_flMaxTime = MAX( stats.m_flMaxTime, flElapsed );
+	stats.m_nCalls++;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::SampleHook( lua_State *L, lua_Debug *ar )
+{
+	CFFLuaProfiler &profiler = g_LuaProfiler;
+
+	if( !profiler.m_bActive )
+		return;
+
+	if( ar->event == LUA_HOOKLINE )
+	{
+		if( --profiler.m_nLinesUntilSample > 0 )
+			return;
+
+		profiler.m_nLinesUntilSample = profiler.m_nSampleRate;
+	}
+
+	profiler.TakeSample( L );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::TakeSample( lua_State *L )
+{
+	if( m_Samples.Count() == 0 )
+		return;
+
+	// innermost first, as that's how lua_getstack counts
+	enum { MAX_WALK = 64 };
+	UtlSymId_t walked[ MAX_WALK ];
+	int nWalked = 0;
+
+	lua_Debug ar;
+	char szFrame[ 256 ];
+
+	for( int iLevel = 0; nWalked < MAX_WALK && lua_getstack( L, iLevel, &ar ); iLevel++ )
+	{
+		if( !lua_getinfo( L, "Snl", &ar ) )
+			break;
+
+		const char *pszName = ar.name ? ar.name : ( ar.what && !Q_strcmp( ar.what, "main" ) ? "main chunk" : "?" );
+
+		if( iLevel == 0 && m_eSampling == LUAPROFILE_SAMPLE_LINES && ar.currentline > 0 )
+			Q_snprintf( szFrame, sizeof( szFrame ), "%s (%s:%d) line %d", pszName, ar.short_src, ar.linedefined, ar.currentline );
+		else
+			Q_snprintf( szFrame, sizeof( szFrame ), "%s (%s:%d)", pszName, ar.short_src, ar.linedefined );
+
+		walked[ nWalked++ ] = m_FrameNames.AddString( szFrame );
+	}
+
+	Sample_t &sample = m_Samples[ m_nNextSample ];
+	sample.m_nFrames = 0;
+
+	// the callback the game called is the root
+	const char *pszRoot = LUAPROFILE_NO_CALLBACK;
+	if( m_nCallbackDepth > 0 )
+		pszRoot = m_Callbacks.GetElementName( m_CallbackStack[ MIN( m_nCallbackDepth, MAX_CALLBACK_DEPTH ) - 1 ] );
+
+	sample.m_Frames[ sample.m_nFrames++ ] = m_FrameNames.AddString( pszRoot );
+
+	// keep the outermost frames so samples still share their roots when the stack is deep
+	for( int i = nWalked - 1; i >= 0 && sample.m_nFrames < MAX_SAMPLE_FRAMES; i-- )
+		sample.m_Frames[ sample.m_nFrames++ ] = walked[ i ];
+
+	m_nNextSample = ( m_nNextSample + 1 ) % MAX_SAMPLES;
+	m_nTotalSamples++;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+struct LuaProfileReportEntry_t
+{
+	const char	*m_pszName;
+	double		m_flTotalTime;
+	double		m_flMaxTime;
+	unsigned int m_nCalls;
+};
+
+static int ReportEntrySortFunc( const LuaProfileReportEntry_t *a, const LuaProfileReportEntry_t *b )
+{
+	if( a->m_flTotalTime > b->m_flTotalTime )
+		return -1;
+
+	if( a->m_flTotalTime < b->m_flTotalTime )
+		return 1;
+
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+void CFFLuaProfiler::PrintReport( int nMaxEntries ) const
+{
+	double flElapsed = Plat_FloatTime() - m_flStartTime;
+
+	CUtlVector< LuaProfileReportEntry_t > entries;
+	for( int i = m_Callbacks.First(); i != m_Callbacks.InvalidIndex(); i = m_Callbacks.Next( i ) )
+	{
+		const CallbackStats_t &stats = m_Callbacks[ i ];
+
+		int iEntry = entries.AddToTail();
+		entries[ iEntry ].m_pszName = m_Callbacks.GetElementName( i );
+		entries[ iEntry ].m_flTotalTime = stats.m_flTotalTime;
+		entries[ iEntry ].m_flMaxTime = stats.m_flMaxTime;
+		entries[ iEntry ].m_nCalls = stats.m_nCalls;
+	}
+
+	entries.Sort( ReportEntrySortFunc );
+
+	Msg( "Lua callbacks over %.1f seconds%s:\n", flElapsed, m_bActive ? "" : " (stopped)" );
+	Msg( "  %10s %10s %10s %10s %6s  %s\n", "calls", "total ms", "avg ms", "max ms", "%", "callback" );
+
+	int nShown = MIN( entries.Count(), nMaxEntries );
+	for( int i = 0; i < nShown; i++ )
+	{
+		const LuaProfileReportEntry_t &entry = entries[ i ];
+
+		Msg( "  %10u %10.2f %10.3f %10.3f %5.1f%%  %s\n",
+			entry.m_nCalls,
+			entry.m_flTotalTime * 1000.0,
+			entry.m_nCalls ? entry.m_flTotalTime * 1000.0 / entry.m_nCalls : 0.0,
+			entry.m_flMaxTime * 1000.0,
+			flElapsed > 0.0 ? 100.0 * entry.m_flTotalTime / flElapsed : 0.0,
+			entry.m_pszName );
+	}
+
+	if( nShown < entries.Count() )
+		Msg( "  ... %d more\n", entries.Count() - nShown );
+
+	if( m_eSampling != LUAPROFILE_SAMPLE_NONE )
+		Msg( "%u stack samples taken, the last %d are kept for lua_profile dump\n", m_nTotalSamples, MIN( m_nTotalSamples, (unsigned int)MAX_SAMPLES ) );
+}
+
+/////////////////////////////////////////////////////////////////////////////
+bool CFFLuaProfiler::WriteFoldedStacks( const char *pszFilename ) const
+{
+	FileHandle_t hFile = filesystem->Open( pszFilename, "wb" );
+	if( !hFile )
+		return false;
+
+	int nSamples = MIN( m_nTotalSamples, (unsigned int)MAX_SAMPLES );
+
+	if( nSamples > 0 )
+	{
+		// identical stacks are written once with their count
+		CUtlDict< int, int > folded( k_eDictCompareTypeCaseSensitive );
+		char szStack[ 4096 ];
+
+		for( int i = 0; i < nSamples; i++ )
+		{
+			const Sample_t &sample = m_Samples[ i ];
+
+			szStack[ 0 ] = 0;
+			for( int iFrame = 0; iFrame < sample.m_nFrames; iFrame++ )
+			{
+				if( iFrame )
+					Q_strncat( szStack, ";", sizeof( szStack ) );
+
+				Q_strncat( szStack, m_FrameNames.String( sample.m_Frames[ iFrame ] ), sizeof( szStack ) );
+			}
+
+			int iStack = folded.Find( szStack );
+			if( iStack == folded.InvalidIndex() )
+				folded.Insert( szStack, 1 );
+			else
+				folded[ iStack ]++;
+		}
+
+		for( int i = folded.First(); i != folded.InvalidIndex(); i = folded.Next( i ) )
+			filesystem->FPrintf( hFile, "%s %d\n", folded.GetElementName( i ), folded[ i ] );
+	}
+	else
+	{
+		// no samples - the callbacks on their own, weighted by microseconds
+		for( int i = m_Callbacks.First(); i != m_Callbacks.InvalidIndex(); i = m_Callbacks.Next( i ) )
+			filesystem->FPrintf( hFile, "%s %d\n", m_Callbacks.GetElementName( i ), (int)( m_Callbacks[ i ].m_flTotalTime * 1000000.0 ) );
+	}
+
+	filesystem->Close( hFile );
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+CON_COMMAND( lua_profile, "Profile server-side Lua callbacks.\n"
+			 "  lua_profile start [instructions|lines] [rate] - time callbacks, optionally sampling the Lua stack every <rate> instructions or lines\n"
+			 "  lua_profile stop\n"
+			 "  lua_profile report [count] - callbacks sorted by total time\n"
+			 "  lua_profile dump <file> - write the samples as folded stacks, for flamegraph.pl\n"
+			 "  lua_profile reset" )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	const char *pszCmd = args.ArgC() > 1 ? args[1] : "";
+
+	if ( !Q_stricmp( pszCmd, "start" ) )
+	{
+		LuaProfileSampling_t eSampling = LUAPROFILE_SAMPLE_NONE;
+		int nDefaultRate = 0;
+
+		if ( args.ArgC() > 2 )
+		{
+			if ( !Q_stricmp( args[2], "instructions" ) )
+			{
+				eSampling = LUAPROFILE_SAMPLE_INSTRUCTIONS;
+				nDefaultRate = 1000;
+			}
+			else if ( !Q_stricmp( args[2], "lines" ) )
+			{
+				eSampling = LUAPROFILE_SAMPLE_LINES;
+				nDefaultRate = 100;
+			}
+			else
+			{
+				Msg( "Unknown sampling mode %s, use instructions or lines\n", args[2] );
+				return;
+			}
+		}
+
+		int nRate = args.ArgC() > 3 ? atoi( args[3] ) : nDefaultRate;
+
+		g_LuaProfiler.Start( _scriptman.GetLuaState(), eSampling, nRate );
+		Msg( "Lua profiling started\n" );
+	}
+	else if ( !Q_stricmp( pszCmd, "stop" ) )
+	{
+		g_LuaProfiler.Stop();
+		Msg( "Lua profiling stopped\n" );
+	}
+	else if ( !Q_stricmp( pszCmd, "report" ) )
+	{
+		g_LuaProfiler.PrintReport( args.ArgC() > 2 ? atoi( args[2] ) : 30 );
+	}
+	else if ( !Q_stricmp( pszCmd, "dump" ) && args.ArgC() > 2 )
+	{
+		if ( g_LuaProfiler.WriteFoldedStacks( args[2] ) )
+			Msg( "Wrote %s\n", args[2] );
+		else
+			Warning( "Couldn't write %s\n", args[2] );
+	}
+	else if ( !Q_stricmp( pszCmd, "reset" ) )
+	{
+		g_LuaProfiler.Reset();
+	}
+	else
+	{
+		Msg( "Usage: lua_profile start [instructions|lines] [rate] | stop | report [count] | dump <file> | reset\n" );
+	}
+}
@@ -0,0 +1,131 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_luaprofiler.h
+/// @brief Profiler for server-side Lua callbacks
+///
+/// REVISIONS
+/// ---------
+/// Times each entity:callback the game calls into, and can sample the Lua
+/// stack from a debug hook to see where inside a callback the time goes.
+/// Everything is off until lua_profile start is used.
+
+#ifndef FF_LUAPROFILER_H
+#define FF_LUAPROFILER_H
+
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "utldict.h"
+#include "utlsymbol.h"
+#include "utlvector.h"
+
+struct lua_State;
+struct lua_Debug;
+
+enum LuaProfileSampling_t
+{
+	LUAPROFILE_SAMPLE_NONE = 0,
+	LUAPROFILE_SAMPLE_INSTRUCTIONS,		// every N VM instructions
+	LUAPROFILE_SAMPLE_LINES,			// every N lines executed
+};
+
+class CFFLuaProfiler
+{
+public:
+	CFFLuaProfiler();
+
+	bool	IsActive() const { return m_bActive; }
+
+	void	Start( lua_State *L, LuaProfileSampling_t eSampling, int nSampleRate );
+	void	Stop();
+	void	Reset();
+
+	// The script manager tells us when its VM comes and goes, so
+	// sampling carries on across map changes
+	void	OnVMStarted( lua_State *L );
+	void	OnVMClosed();
+
+	// Only call these when IsActive()
+	void	EnterCallback( const char *pszCallback );
+	void	ExitCallback( double flElapsed );
+
+	void	PrintReport( int nMaxEntries ) const;
+	bool	WriteFoldedStacks( const char *pszFilename ) const;
+
+private:
+	enum
+	{
+		MAX_CALLBACK_DEPTH = 8,
+		MAX_SAMPLE_FRAMES = 16,
+		MAX_SAMPLES = 8192,			// ring size, the oldest samples are overwritten
+	};
+
+	struct CallbackStats_t
+	{
+		double			m_flTotalTime;
+		double			m_flMaxTime;
+		unsigned int	m_nCalls;
+	};
+
+	// Frames are outermost first. The first is always the callback.
+	struct Sample_t
+	{
+		UtlSymId_t		m_Frames[ MAX_SAMPLE_FRAMES ];
+		unsigned char	m_nFrames;
+	};
+
+	static void	SampleHook( lua_State *L, lua_Debug *ar );
+	void	TakeSample( lua_State *L );
+	void	InstallHook( lua_State *L );
+
+	bool	m_bActive;
+	LuaProfileSampling_t m_eSampling;
+	int		m_nSampleRate;
+	int		m_nLinesUntilSample;
+	lua_State *m_pHookedState;
+
+	double	m_flStartTime;
+
+	CUtlDict< CallbackStats_t, int > m_Callbacks;
+
+	int		m_CallbackStack[ MAX_CALLBACK_DEPTH ];		// into m_Callbacks
+	int		m_nCallbackDepth;
+
+	CUtlHashedSymbolTable m_FrameNames;
+	CUtlVector< Sample_t > m_Samples;
+	int		m_nNextSample;
+	unsigned int m_nTotalSamples;
+};
+
+extern CFFLuaProfiler g_LuaProfiler;
+
+//-----------------------------------------------------------------------------
+// Purpose: Times a callback for the profiler. Just a bool test when it's off.
+//-----------------------------------------------------------------------------
+class CFFLuaProfileScope
+{
+public:
+	CFFLuaProfileScope( const char *pszCallback )
+	{
+		m_bActive = g_LuaProfiler.IsActive();
+		if( m_bActive )
+		{
+			g_LuaProfiler.EnterCallback( pszCallback );
+			m_flStart = Plat_FloatTime();
+		}
+	}
+
+	~CFFLuaProfileScope()
+	{
+		if( m_bActive )
+			g_LuaProfiler.ExitCallback( Plat_FloatTime() - m_flStart );
+	}
+
+private:
+	bool	m_bActive;
+	double	m_flStart;
+};
+
+#endif // FF_LUAPROFILER_H
@@ -6,6 +6,8 @@
 #include "ff_entity_system.h"
 #include "ff_luacontext.h"
 #include "ff_lualib.h"
+#include "ff_luaalloc.h"
+#include "ff_luaprofiler.h"
 #include "ff_utils.h"
 #include "ff_info_script.h"
 #include "triggers.h"
@@ -39,6 +41,21 @@ extern bool g_Disable_Timelimit;
 ConVar sv_mapluasuffix( "sv_mapluasuffix", "", FCVAR_ARCHIVE, "Have a custom lua file (game mode) loaded when the map loads. If this suffix string is set, maps\\mapname__suffix__.lua (if it exists) is used instead of maps\\mapname.lua. To reset this cvar, make it \"\".");
 ConVar sv_globalluascript( "sv_globalluascript", "", FCVAR_ARCHIVE, "Load a custom lua file globally after map scripts. Will overwrite map script. Will be loaded from maps\\globalscripts. To disable, set to \"\".");
 
+// garbage collector tuning, applied when the VM starts so they can be set per map
+static void LuaGCChangeCallback( IConVar *var, const char *pOldValue, float flOldValue );
+ConVar sv_lua_gcpause( "sv_lua_gcpause", "200", 0, "How much the Lua heap grows (as a percentage) before a new garbage collection cycle starts. Lua's default is 200.", true, 50, true, 1000, LuaGCChangeCallback );
+ConVar sv_lua_gcstepmul( "sv_lua_gcstepmul", "200", 0, "How fast the Lua garbage collector runs relative to allocation. Lua's default is 200.", true, 100, true, 10000, LuaGCChangeCallback );
+ConVar sv_lua_gcstep( "sv_lua_gcstep", "0", 0, "KB of Lua garbage collection to do every tick, on top of what allocating does. 0 to only collect when allocating.", true, 0, true, 1024 );
+
+ConVar sv_lua_cachechunks( "sv_lua_cachechunks", "1", 0, "Keep the map's Lua scripts compiled, so resetting the map doesn't have to compile them again. Scripts that have changed on disk are compiled again." );
+
+// mirrors the panic function luaL_newstate sets
+static int LuaPanic( lua_State *L )
+{
+	Warning( "[SCRIPT] PANIC: unprotected error in call to Lua API (%s)\n", lua_tostring( L, -1 ) );
+	return 0;
+}
+
 // redirect Lua's print function to the console
 // based on the default Lua 5.1 print implementation in lbaselib.c
 static int print(lua_State *L)
@@ -72,8 +89,58 @@ CFFScriptManager _scriptman;
 CStringRegistry	g_HudElementStrings;
 int nextHudElementIndex;
 
+/** lua_Writer for lua_dump, appends to the CUtlBuffer in ud
+*/
+static int LuaChunkWriter( lua_State *L, const void *p, size_t sz, void *ud )
+{
+	((CUtlBuffer *)ud)->Put( p, sz );
+	return 0;
+}
+
+/** package.loaders entry that finds modules in the MOD search paths the same
+	way package.path does, but loads them with LoadFileIntoFunction so they're
+	only compiled once per map
+*/
+static int LuaCompiledChunkLoader( lua_State *L )
+{
+	if ( !sv_lua_cachechunks.GetBool() )
+	{
+		// leave it to the standard loader
+		lua_pushliteral(L, "");
+		return 1;
+	}
+
+	char szModule[MAX_PATH];
+	Q_strncpy( szModule, luaL_checkstring(L, 1), sizeof(szModule) );
+	for ( char *pszChar = szModule; *pszChar; pszChar++ )
+	{
+		if ( *pszChar == '.' )
+			*pszChar = '/';
+	}
+
+	static const char *s_pszModulePaths[] = { "maps/includes/%s.lua", "maps/%s.lua", "%s.lua" };
+
+	for ( int i = 0; i < ARRAYSIZE( s_pszModulePaths ); i++ )
+	{
+		char filename[MAX_PATH];
+		Q_snprintf( filename, sizeof(filename), s_pszModulePaths[i], szModule );
+
+		if ( !filesystem->FileExists( filename, "MOD" ) )
+			continue;
+
+		if ( !_scriptman.LoadFileIntoFunction( filename ) )
+			return luaL_error(L, "error loading module '%s' from file '%s'", lua_tostring(L, 1), filename);
+
+		return 1;
+	}
+
+	lua_pushfstring(L, "\n\tno file '%s.lua' in the mod search paths", szModule);
+	return 1;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 CFFScriptManager::CFFScriptManager()
+	: m_CompiledChunks( k_eDictCompareTypeFilenames )
 {
 	L = NULL;
 }
@@ -81,6 +148,7 @@ CFFScriptManager::CFFScriptManager()
 CFFScriptManager::~CFFScriptManager()
 {
 	Shutdown();
+	ClearCompiledChunks();
 }
 
 /** Close the Lua VM
@@ -91,7 +159,43 @@ void CFFScriptManager::Shutdown()
 	{
 		lua_close(L);
 		L = NULL;
+		g_LuaProfiler.OnVMClosed();
+
+		LuaMsg( "Lua VM closed, peak memory use was %.1f KB\n", g_LuaAllocator.GetBytesPeak() / 1024.0f );
+		g_LuaAllocator.Clear();
+	}
+}
+
+/** Applies the GC cvars to the running VM
+*/
+void CFFScriptManager::ApplyGCSettings()
+{
+	if(!L)
+		return;
+
+	lua_gc(L, LUA_GCSETPAUSE, sv_lua_gcpause.GetInt());
+	lua_gc(L, LUA_GCSETSTEPMUL, sv_lua_gcstepmul.GetInt());
+}
+
+static void LuaGCChangeCallback( IConVar *var, const char *pOldValue, float flOldValue )
+{
+	_scriptman.ApplyGCSettings();
+}
+
+/** Per tick upkeep: extra GC steps and memory stats
+*/
+void CFFScriptManager::Update()
+{
+	if(!L)
+		return;
+
+	if ( sv_lua_gcstep.GetInt() > 0 )
+	{
+		VPROF_BUDGET( "CFFScriptManager::Update - GC step", VPROF_BUDGETGROUP_FF_LUA );
+		lua_gc(L, LUA_GCSTEP, sv_lua_gcstep.GetInt());
 	}
+
+	g_LuaAllocator.Update();
 }
 
 /** Open the Lua VM
@@ -104,7 +208,10 @@ bool CFFScriptManager::Init()
 
 	// initialize VM
 	LuaMsg("Attempting to start the Lua VM...\n");
-	L = lua_open();
+	g_LuaAllocator.ResetStats();
+	L = lua_newstate(CFFLuaAllocator::LuaAlloc, &g_LuaAllocator);
+	if(L)
+		lua_atpanic(L, LuaPanic);
 
 	// no need to continue if VM failed to initialize
 	if(!L)
@@ -119,6 +226,11 @@ bool CFFScriptManager::Init()
 	// allow throwing exceptions for LuaBridge3
 	luabridge::enableExceptions(L);
 
+	ApplyGCSettings();
+
+	// carry on sampling if lua_profile was started on a previous map
+	g_LuaProfiler.OnVMStarted(L);
+
 	LuaMsg("Lua VM initialization successful.\n");
 	return true;
 }
@@ -170,6 +282,18 @@ void CFFScriptManager::SetupEnvironmentForFF()
 	lua_pushstring(L, "path");
 	lua_pushstring(L, szLuaSearchPaths);
 	lua_settable(L, -3); // -3 is the package table
+
+	// put our loader in front of the standard Lua file loader, behind package.preload
+	lua_getfield(L, -1, "loaders");
+	for ( int i = lua_objlen(L, -1); i >= 2; i-- )
+	{
+		lua_rawgeti(L, -1, i);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_pushcfunction(L, LuaCompiledChunkLoader);
+	lua_rawseti(L, -2, 2);
+	lua_pop(L, 1); // pop package.loaders
+
 	lua_pop(L, 1); // pop _G.package
 
 	// initialize game-specific library
@@ -183,6 +307,21 @@ bool CFFScriptManager::LoadFileIntoFunction( const char *filename )
 {
 	VPROF_BUDGET( "CFFScriptManager::LoadFileIntoFunction", VPROF_BUDGETGROUP_FF_LUA );
 
+	// use what we compiled last time if the file hasn't changed since
+	long nFileTime = filesystem->GetFileTime( filename, "MOD" );
+	int iChunk = m_CompiledChunks.Find( filename );
+	if ( sv_lua_cachechunks.GetBool() && iChunk != m_CompiledChunks.InvalidIndex() && m_CompiledChunks[iChunk]->m_nFileTime == nFileTime )
+	{
+		LuaMsg("Loading compiled Lua File: %s\n", filename);
+
+		CUtlBuffer &bytecode = m_CompiledChunks[iChunk]->m_Bytecode;
+		if ( luaL_loadbuffer(L, (const char *)bytecode.Base(), bytecode.TellPut(), filename) == 0 )
+			return true;
+
+		// shouldn't happen, but it can still be loaded from the file
+		lua_pop( L, 1 );
+	}
+
 	// open the file
 	LuaMsg("Loading Lua File: %s\n", filename);
 	FileHandle_t hFile = filesystem->Open(filename, "rb", "MOD");
@@ -217,10 +356,39 @@ bool CFFScriptManager::LoadFileIntoFunction( const char *filename )
 		lua_pop( L, 1 );
 		return false;
 	}
+
+	if ( sv_lua_cachechunks.GetBool() )
+		CacheCompiledChunk( filename, nFileTime );
 	
 	return true;
 }
 
+/** Dumps the function on top of the stack into the compiled chunks for filename
+*/
+void CFFScriptManager::CacheCompiledChunk( const char *filename, long nFileTime )
+{
+	int iChunk = m_CompiledChunks.Find( filename );
+	if ( iChunk == m_CompiledChunks.InvalidIndex() )
+		iChunk = m_CompiledChunks.Insert( filename, new CompiledChunk_t );
+
+	CompiledChunk_t *pChunk = m_CompiledChunks[iChunk];
+	pChunk->m_nFileTime = nFileTime;
+	pChunk->m_Bytecode.Purge();
+
+	if ( lua_dump(L, LuaChunkWriter, &pChunk->m_Bytecode) != 0 )
+	{
+		delete pChunk;
+		m_CompiledChunks.RemoveAt( iChunk );
+	}
+}
+
+/** Forgets the compiled scripts. They're only kept for the map they were loaded on.
+*/
+void CFFScriptManager::ClearCompiledChunks()
+{
+	m_CompiledChunks.PurgeAndDeleteElements();
+}
+
 /** Loads a Lua file into the current environment relative to a "MOD" search path
 	@returns True if file successfully loaded, false if there were any errors (syntax or execution)
 */
@@ -337,6 +505,7 @@ void CFFScriptManager::LevelInit(const char* szMapName)
 void CFFScriptManager::LevelShutdown()
 {
 	Shutdown();
+	ClearCompiledChunks();
 }
 
 /////////////////////////////////////////////////////////////////////////////
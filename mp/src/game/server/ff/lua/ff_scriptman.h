@@ -1,6 +1,9 @@
 #ifndef FF_SCRIPTMAN_H
 #define FF_SCRIPTMAN_H
 
+#include "utldict.h"
+#include "utlbuffer.h"
+
 // forward declarations
 struct lua_State;
 
@@ -23,6 +26,9 @@ private:
 
 	void SetupEnvironmentForFF();
 
+	// keeps the function on top of the stack compiled, for loading filename again
+	void CacheCompiledChunk( const char *filename, long nFileTime );
+
 public:
 	bool LoadFileIntoFunction( const char *filename );
 	bool LoadFile( const char *filename );
@@ -35,6 +41,15 @@ public:
 	// cleans up the scripts for the most recent level
 	void LevelShutdown();
 
+	// forgets the scripts compiled for this map
+	void ClearCompiledChunks();
+
+	// called every tick while the level is running
+	void Update();
+
+	// pushes the sv_lua_gc* cvars to the VM
+	void ApplyGCSettings();
+
 	void LuaMsg( const tchar* pMsg, ... );
 	void LuaWarning( const tchar* pMsg, ... );
 
@@ -65,6 +80,15 @@ public:
 
 private:
 	lua_State*	L;				///< Lua VM
+
+	// compiled scripts, so resetting the map doesn't have to compile them again
+	struct CompiledChunk_t
+	{
+		long		m_nFileTime;	///< file's modification time when it was compiled
+		CUtlBuffer	m_Bytecode;
+	};
+
+	CUtlDict< CompiledChunk_t *, int > m_CompiledChunks;
 };
 
 // global externs
@@ -0,0 +1,112 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file te_ff_nails.cpp
+/// @brief Batched nail spawn event for the pooled nails
+///
+/// REVISIONS
+/// ---------
+/// Nails fired in the same tick by one player are sent to clients
+/// as a single event instead of an effect dispatch each.
+
+#include "cbase.h"
+#include "basetempentity.h"
+#include "te_ff_nails.h"
+#include "ff_projectile_nail.h"
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Every nail one player fired in a tick. Nails fly in a straight
+//			line at a fixed speed, so the origin and direction are all the
+//			client needs to replay them.
+//-----------------------------------------------------------------------------
+class CTEFFNails : public CBaseTempEntity
+{
+public:
+	DECLARE_CLASS( CTEFFNails, CBaseTempEntity );
+	DECLARE_SERVERCLASS();
+
+					CTEFFNails( const char *name );
+	virtual			~CTEFFNails( void );
+
+public:
+	CNetworkVar( int, m_iOwner );	// entindex of whoever fired
+	CNetworkVar( int, m_nNails );
+	CNetworkArray( Vector, m_vecOrigin, FF_NAIL_EVENT_MAX );
+	CNetworkArray( float, m_flPitch, FF_NAIL_EVENT_MAX );
+	CNetworkArray( float, m_flYaw, FF_NAIL_EVENT_MAX );
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: 
+// Input  : *name - 
+//-----------------------------------------------------------------------------
+CTEFFNails::CTEFFNails( const char *name ) :
+	CBaseTempEntity( name )
+{
+	for ( int i = 0; i < FF_NAIL_EVENT_MAX; i++ )
+	{
+		m_vecOrigin.GetForModify( i ).Init();
+		m_flPitch.Set( i, 0.0f );
+		m_flYaw.Set( i, 0.0f );
+	}
+	m_nNails = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: 
+//-----------------------------------------------------------------------------
+CTEFFNails::~CTEFFNails( void )
+{
+}
+
+IMPLEMENT_SERVERCLASS_ST_NOBASE(CTEFFNails, DT_TEFFNails)
+	SendPropInt( SENDINFO( m_iOwner ), MAX_EDICT_BITS, SPROP_UNSIGNED ),
+	SendPropInt( SENDINFO( m_nNails ), 4, SPROP_UNSIGNED ),
+	SendPropArray(
+		SendPropVector( SENDINFO_ARRAY( m_vecOrigin ), -1, SPROP_COORD ),
+		m_vecOrigin ),
+	SendPropArray(
+		SendPropAngle( SENDINFO_ARRAY( m_flPitch ), 13, 0 ),
+		m_flPitch ),
+	SendPropArray(
+		SendPropAngle( SENDINFO_ARRAY( m_flYaw ), 13, 0 ),
+		m_flYaw ),
+END_SEND_TABLE()
+
+
+// Singleton
+static CTEFFNails g_TEFFNails( "FF Nails" );
+
+
+void TE_FFNails( 
+	IRecipientFilter &filter,
+	int	iOwner,
+	int nNails,
+	const Vector *pOrigins,
+	const QAngle *pAngles )
+{
+	Assert( nNails > 0 && nNails <= FF_NAIL_EVENT_MAX );
+
+	g_TEFFNails.m_iOwner = iOwner;
+	g_TEFFNails.m_nNails = nNails;
+
+	// Unused slots are left zeroed so they cost next to nothing to send
+	for ( int i = 0; i < FF_NAIL_EVENT_MAX; i++ )
+	{
+		if ( i < nNails )
+		{
+			g_TEFFNails.m_vecOrigin.Set( i, pOrigins[i] );
+			g_TEFFNails.m_flPitch.Set( i, pAngles[i].x );
+			g_TEFFNails.m_flYaw.Set( i, pAngles[i].y );
+		}
+		else
+		{
+			g_TEFFNails.m_vecOrigin.GetForModify( i ).Init();
+			g_TEFFNails.m_flPitch.Set( i, 0.0f );
+			g_TEFFNails.m_flYaw.Set( i, 0.0f );
+		}
+	}
+
+	g_TEFFNails.Create( filter, 0 );
+}
@@ -0,0 +1,28 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file te_ff_nails.h
+/// @brief Declaration of the batched nail spawn event
+///
+/// REVISIONS
+/// ---------
+/// Nails fired in the same tick by one player are sent to clients
+/// as a single event instead of an effect dispatch each.
+
+
+#ifndef TE_FF_NAILS_H
+#define TE_FF_NAILS_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+
+void TE_FFNails( 
+	IRecipientFilter &filter,
+	int	iOwner,
+	int nNails,
+	const Vector *pOrigins,
+	const QAngle *pAngles
+	);
+
+#endif // TE_FF_NAILS_H
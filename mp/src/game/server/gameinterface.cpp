@@ -138,6 +138,7 @@ extern ConVar tf_mm_servermode;
 #include "ff_timerman.h"
 #include "util.h"
 #include "omnibot_interface.h"
+#include "ff_transmitpolicy.h"
 
 extern IToolFrameworkServer *g_pToolFrameworkServer;
 extern IParticleSystemQuery *g_pParticleSystemQuery;
@@ -2699,6 +2700,9 @@ void CServerGameEnts::CheckTransmit( CCheckTransmitInfo *pInfo, const unsigned s
 	}
 
 //	Msg("A:%i, N:%i, F: %i, P: %i\n", always, dontSend, fullCheck, PVS );
+
+	// FF: tally up ffdev_transmit_stats
+	FFTransmit_RecordSnapshot( pInfo );
 }
 
 
@@ -3370,6 +3374,15 @@ void MessageWriteShort( int iValue)
 	g_pMsgBuffer->WriteShort( iValue );
 }
 
+// Same as WRITE_SHORT for each value, in one go
+void MessageWriteShorts( const int *pValues, int nCount )
+{
+	if (!g_pMsgBuffer)
+		Error( "WRITE_SHORTS called with no active message\n" );
+
+	g_pMsgBuffer->WriteSBitLongs( pValues, nCount, sizeof(short) << 3 );
+}
+
 void MessageWriteWord( int iValue )
 {
 	if (!g_pMsgBuffer)
@@ -14,11 +14,13 @@
 #include "tier0/vprof.h"
 #include "tier0/tslist.h"
 #include "tier1/utlhash.h"
+#include "bitvec.h"
 #include "vstdlib/jobthread.h"
 
 #include "nav_mesh.h"
 #include "nav_node.h"
 #include "nav_pathfind.h"
+#include "nav_hierarchy.h"
 #include "nav_colors.h"
 #include "fmtstr.h"
 #include "props_shared.h"
@@ -244,6 +246,8 @@ CNavArea::CNavArea( void )
 
 	m_inheritVisibilityFrom.area = NULL;
 	m_isInheritedFrom = false;
+	m_visibilityIndex = -1;
+	m_hierarchyRegion = -1;
 
 	m_funcNavCostVector.RemoveAll();
 
@@ -538,6 +542,10 @@ CNavArea::~CNavArea()
 	if (m_isReset)
 		return;
 
+	// other areas drop their visibility lists below, so the matrix built from them is no longer valid either
+	TheNavVisibility.Reset();
+	TheNavHierarchy.Reset();
+
 	// tell the other areas and ladders we are going away
 	AreaDestroyNotification notification( this );
 	TheNavMesh->ForAllAreas( notification );
@@ -805,6 +813,7 @@ void CNavArea::ConnectTo( CNavArea *area, NavDirType dir )
 	con.area = area;
 	con.length = ( area->GetCenter() - GetCenter() ).Length();
 	m_connect[ dir ].AddToTail( con );
+	TheNavHierarchy.Reset();
 	m_incomingConnect[ dir ].FindAndRemove( con );
 
 	NavDirType dirOpposite = OppositeDirection( dir );
@@ -856,6 +865,7 @@ void CNavArea::Disconnect( CNavArea *area )
 		if ( index != m_connect[ dir ].InvalidIndex() )
 		{
 			m_connect[ dir ].Remove( index );
+			TheNavHierarchy.Reset();
 			if ( area->IsConnected( this, dirOpposite ) )
 			{
 				AddIncomingConnection( area, dir );
@@ -881,7 +891,10 @@ void CNavArea::Disconnect( CNavLadder *ladder )
 
 	for( int i=0; i<CNavLadder::NUM_LADDER_DIRECTIONS; ++i )
 	{
-		m_ladder[i].FindAndRemove( con );
+		if ( m_ladder[i].FindAndRemove( con ) )
+		{
+			TheNavHierarchy.Reset();
+		}
 	}
 }
 
@@ -2389,6 +2402,23 @@ void CNavArea::ComputePortal( const CNavArea *to, NavDirType dir, Vector *center
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Compute the path segment of an encounter through this area, at eye level,
+ * from the portal with its "from" area to the portal with its "to" area.
+ */
+void CNavArea::ComputeEncounterPath( SpotEncounter *e ) const
+{
+	float halfWidth;
+	ComputePortal( e->to.area, e->toDir, &e->path.to, &halfWidth );
+	ComputePortal( e->from.area, e->fromDir, &e->path.from, &halfWidth );
+
+	const float eyeHeight = HalfHumanHeight;
+	e->path.from.z = e->from.area->GetZ( e->path.from ) + eyeHeight;
+	e->path.to.z = e->to.area->GetZ( e->path.to ) + eyeHeight;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 // compute largest portal to adjacent area, returning direction
 NavDirType CNavArea::ComputeLargestPortal( const CNavArea *to, Vector *center, float *halfWidth ) const
@@ -3724,11 +3754,36 @@ static Vector FindPositionInArea( CNavArea *area, NavCornerType corner )
 	return pos;
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Classify whether a hiding spot has good cover. Only touches the given spot, so
+ * this may be run on worker threads.
+ */
+void ClassifyHidingSpotCover( HidingSpot *&spot )
+{
+	spot->SetFlags( IsHidingSpotInCover( spot->GetPosition() ) ? HidingSpot::IN_COVER : HidingSpot::EXPOSED );
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Analyze local area neighborhood to find "hiding spots" for this area
  */
 void CNavArea::ComputeHidingSpots( void )
+{
+	CollectHidingSpots();
+
+	FOR_EACH_VEC( m_hidingSpots, it )
+	{
+		ClassifyHidingSpotCover( m_hidingSpots[ it ] );
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Create the hiding spots for this area without classifying their cover yet.
+ * See ClassifyHidingSpotCover().
+ */
+void CNavArea::CollectHidingSpots( void )
 {
 	struct
 	{
@@ -3838,7 +3893,6 @@ void CNavArea::ComputeHidingSpots( void )
 			{
 				HidingSpot *spot = TheNavMesh->CreateHidingSpot();
 				spot->SetPosition( pos );
-				spot->SetFlags( IsHidingSpotInCover( pos ) ? HidingSpot::IN_COVER : HidingSpot::EXPOSED );
 				m_hidingSpots.AddToTail( spot );
 			}
 		}
@@ -3992,7 +4046,7 @@ SpotEncounter *CNavArea::GetSpotEncounter( const CNavArea *from, const CNavArea
 /**
  * Add spot encounter data when moving from area to area
  */
-void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, const CNavArea *to, NavDirType toDir )
+void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, const CNavArea *to, NavDirType toDir, CLargeVarBitVec *seenSpots )
 {
 	SpotEncounter *e = new SpotEncounter;
 
@@ -4014,8 +4068,9 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 	Vector dir = e->path.to - e->path.from;
 	float length = dir.NormalizeInPlace();
 
-	// create unique marker to flag used spots
-	HidingSpot::ChangeMasterMarker();
+	// flag used spots. This is kept by the caller instead of using the HidingSpot markers
+	// so areas can compute their encounters in parallel.
+	seenSpots->ClearAll();
 
 	const float stepSize = 25.0f;		// 50
 	const float seeSpotRange = 2000.0f;	// 3000
@@ -4048,7 +4103,7 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 			if (!spot->HasGoodCover())
 				continue;
 
-			if (spot->IsMarked())
+			if (seenSpots->IsBitSet( it ))
 				continue;
 
 			const Vector &spotPos = spot->GetPosition();
@@ -4084,7 +4139,7 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 			}
 
 			// mark spot as encountered
-			spot->Mark();
+			seenSpots->Set( it );
 		}
 	}
 
@@ -4096,6 +4151,7 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 /**
  * Compute "spot encounter" data. This is an ordered list of spots to look at 
  * for each possible path thru a nav area.
+ * Only modifies this area, so different areas may be computed in parallel.
  */
 void CNavArea::ComputeSpotEncounters( void )
 {
@@ -4104,6 +4160,8 @@ void CNavArea::ComputeSpotEncounters( void )
 	if (nav_quicksave.GetBool())
 		return;
 
+	CLargeVarBitVec seenSpots( TheHidingSpots.Count() );
+
 	// for each adjacent area
 	for( int fromDir=0; fromDir<NUM_DIRECTIONS; ++fromDir )
 	{
@@ -4122,7 +4180,7 @@ void CNavArea::ComputeSpotEncounters( void )
 						continue;
 
 					// just do our direction, as we'll loop around for other direction
-					AddSpotEncounters( fromCon->area, (NavDirType)fromDir, toCon->area, (NavDirType)toDir );
+					AddSpotEncounters( fromCon->area, (NavDirType)fromDir, toCon->area, (NavDirType)toDir, &seenSpots );
 				}
 			}
 		}
@@ -5438,91 +5496,29 @@ CNavArea::VisibilityType CNavArea::ComputeVisibility( const CNavArea *area, bool
 
 
 //--------------------------------------------------------------------------------------------------------
-/**
- * Return a list of the delta between our visibility list and the given adjacent area
- */
-const CNavArea::CAreaBindInfoArray &CNavArea::ComputeVisibilityDelta( const CNavArea *other ) const
+void CNavArea::ResetPotentiallyVisibleAreas()
 {
-	static CAreaBindInfoArray delta;
-
-	delta.RemoveAll();
-	
-	// do not delta from a delta - if 'other' is already inheriting, use its inherited source directly
-	if ( other->m_inheritVisibilityFrom.area != NULL )
-	{
-		Assert( false && "Visibility inheriting from inherited area" );
-
-		delta = m_potentiallyVisibleAreas;
-		return delta;
-	}
-
-	// add any visible areas in my list that are not in 'others' list into the delta
-	int i, j;
-	for( i=0; i<m_potentiallyVisibleAreas.Count(); ++i )
-	{
-		if ( m_potentiallyVisibleAreas[i].area )
-		{
-			// is my visible area also in adjacent area's vis list
-			for( j=0; j<other->m_potentiallyVisibleAreas.Count(); ++j )
-			{
-				if ( m_potentiallyVisibleAreas[i].area == other->m_potentiallyVisibleAreas[j].area &&
-					 m_potentiallyVisibleAreas[i].attributes == other->m_potentiallyVisibleAreas[j].attributes )
-				{
-					// mutually identically visible
-					break;
-				}
-			}
-
-			if ( j == other->m_potentiallyVisibleAreas.Count() )
-			{
-				// my vis area not in adjacent area's vis list or has different visibility attributes - add to delta
-				delta.AddToTail( m_potentiallyVisibleAreas[i] );
-			}
-		}
-	}
-
-	// add explicit NOT_VISIBLE references to areas in 'others' list that are NOT in mine
-	for( j=0; j<other->m_potentiallyVisibleAreas.Count(); ++j )
-	{
-		if ( other->m_potentiallyVisibleAreas[j].area )
-		{
-			for( i=0; i<m_potentiallyVisibleAreas.Count(); ++i )
-			{
-				if ( m_potentiallyVisibleAreas[i].area == other->m_potentiallyVisibleAreas[j].area )
-				{
-					// area in both lists - already handled in delta above
-					break;
-				}
-			}
-
-			if ( i == m_potentiallyVisibleAreas.Count() )
-			{
-				// 'other' has area in their list that we don't - mark it explicitly NOT_VISIBLE
-				AreaBindInfo info;
-				info.area = other->m_potentiallyVisibleAreas[j].area;
-				info.attributes = NOT_VISIBLE;
-
-				delta.AddToTail( info );
-			}
-		}
-	}
-
-	return delta;
+	m_potentiallyVisibleAreas.RemoveAll();
 }
 
 
 //--------------------------------------------------------------------------------------------------------
-void CNavArea::ResetPotentiallyVisibleAreas()
+/**
+ * Free our visibility lists, including any inheritance, once TheNavVisibility has been built from them
+ */
+void CNavArea::PurgePotentiallyVisibleAreas( void )
 {
-	m_potentiallyVisibleAreas.RemoveAll();
+	m_potentiallyVisibleAreas.Purge();
+	m_inheritVisibilityFrom.area = NULL;
+	m_isInheritedFrom = false;
 }
 
 
 //--------------------------------------------------------------------------------------------------------
 /**
  * Determine visibility between areas.
- * Compute full list of all areas visible for each area.  This list will be compressed into deltas
- * in the PostCustomAnalysis() step.
+ * Compute full list of all areas visible for each area.  These lists will be compressed into
+ * TheNavVisibility in the EndVisibilityComputations() step.
  */
 
 CNavArea *g_pCurVisArea;
@@ -5722,6 +5718,17 @@ bool CNavArea::IsPotentiallyVisible( const CNavArea *viewedArea ) const
 		return true;
 	}
 
+	if ( TheNavVisibility.IsBuilt() )
+	{
+		if ( m_visibilityIndex < 0 || viewedArea->m_visibilityIndex < 0 )
+		{
+			// areas created since the matrix was built have no visibility data
+			return false;
+		}
+
+		return TheNavVisibility.IsPotentiallyVisible( m_visibilityIndex, viewedArea->m_visibilityIndex );
+	}
+
 	// normal visibility check
 	for ( int i=0; i<m_potentiallyVisibleAreas.Count(); ++i )
 	{
@@ -5767,6 +5774,17 @@ bool CNavArea::IsCompletelyVisible( const CNavArea *viewedArea ) const
 		return true;
 	}
 
+	if ( TheNavVisibility.IsBuilt() )
+	{
+		if ( m_visibilityIndex < 0 || viewedArea->m_visibilityIndex < 0 )
+		{
+			// areas created since the matrix was built have no visibility data
+			return false;
+		}
+
+		return TheNavVisibility.IsCompletelyVisible( m_visibilityIndex, viewedArea->m_visibilityIndex );
+	}
+
 	// normal visibility check
 	for ( int i=0; i<m_potentiallyVisibleAreas.Count(); ++i )
 	{
@@ -5803,6 +5821,12 @@ bool CNavArea::IsPotentiallyVisibleToTeam( int teamIndex ) const
 {
 	VPROF_BUDGET( "CNavArea::IsPotentiallyVisibleToTeam", "NextBot" );
 
+	if ( TheNavVisibility.IsBuilt() )
+	{
+		// union of the visibility rows of every area the team occupies, computed once per tick
+		return m_visibilityIndex >= 0 && TheNavVisibility.IsPotentiallyVisibleToTeam( m_visibilityIndex, teamIndex );
+	}
+
 	CTeam *team = GetGlobalTeam( teamIndex );
 
 	for( int i = 0; i < team->GetNumPlayers(); ++i )
@@ -5830,6 +5854,12 @@ bool CNavArea::IsCompletelyVisibleToTeam( int teamIndex ) const
 {
 	VPROF_BUDGET( "CNavArea::IsCompletelyVisibleToTeam", "NextBot" );
 
+	if ( TheNavVisibility.IsBuilt() )
+	{
+		// union of the visibility rows of every area the team occupies, computed once per tick
+		return m_visibilityIndex >= 0 && TheNavVisibility.IsCompletelyVisibleToTeam( m_visibilityIndex, teamIndex );
+	}
+
 	CTeam *team = GetGlobalTeam( teamIndex );
 
 	for( int i = 0; i < team->GetNumPlayers(); ++i )
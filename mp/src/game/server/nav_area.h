@@ -13,6 +13,7 @@
 #define _NAV_AREA_H_
 
 #include "nav_ladder.h"
+#include "nav_visibility.h"
 #include "tier1/memstack.h"
 
 // BOTPORT: Clean up relationship between team index and danger storage in nav areas
@@ -29,6 +30,7 @@ inline void DebuggerBreakOnNaN_StagingOnly( float val )
 #endif
 
 class CFuncElevator;
+class CLargeVarBitVec;
 class CFuncNavPrerequisite;
 class CFuncNavCost;
 
@@ -387,6 +389,7 @@ public:
 	const NavConnectVector &GetElevatorAreas( void ) const									{ return m_elevatorAreas; }	// return collection of areas reachable via elevator from this area
 
 	void ComputePortal( const CNavArea *to, NavDirType dir, Vector *center, float *halfWidth ) const;		// compute portal to adjacent area
+	void ComputeEncounterPath( SpotEncounter *e ) const;			// compute the eye-level path segment of an encounter between its from and to areas
 	NavDirType ComputeLargestPortal( const CNavArea *to, Vector *center, float *halfWidth ) const;		// compute largest portal to adjacent area, returning direction
 	void ComputeClosestPointInPortal( const CNavArea *to, NavDirType dir, const Vector &fromPos, Vector *closePos ) const; // compute closest point within the "portal" between to adjacent areas
 	NavDirType ComputeDirection( Vector *point ) const;			// return direction from this area to the given point
@@ -485,6 +488,7 @@ public:
 
 	//- generation and analysis -------------------------------------------------------------------------
 	virtual void ComputeHidingSpots( void );					// analyze local area neighborhood to find "hiding spots" in this area - for map learning
+	void CollectHidingSpots( void );							// create this area's hiding spots, without classifying their cover
 	virtual void ComputeSniperSpots( void );					// analyze local area neighborhood to find "sniper spots" in this area - for map learning
 	virtual void ComputeSpotEncounters( void );					// compute spot encounter data - for map learning
 	virtual void ComputeEarliestOccupyTimes( void );
@@ -533,6 +537,13 @@ public:
 	virtual bool IsCompletelyVisible( const CNavArea *area ) const;			// return true if given area is completely visible from somewhere in this area (very fast)
 	virtual bool IsCompletelyVisibleToTeam( int team ) const;				// return true if given area is completely visible from somewhere in this area by someone on the team (very fast)
 
+	int GetVisibilityIndex( void ) const	{ return m_visibilityIndex; }	// dense index of this area in TheNavVisibility, or -1
+	void SetVisibilityIndex( int index )	{ m_visibilityIndex = index; }
+	void PurgePotentiallyVisibleAreas( void );								// free the visibility lists once TheNavVisibility holds them
+
+	int GetHierarchyRegion( void ) const	{ return m_hierarchyRegion; }	// region of this area in TheNavHierarchy, or -1
+	void SetHierarchyRegion( int region )	{ m_hierarchyRegion = region; }
+
 	//-------------------------------------------------------------------------------------
 	/**
 	 * Apply the functor to all navigation areas that are potentially
@@ -541,6 +552,11 @@ public:
 	template < typename Functor >
 	bool ForAllPotentiallyVisibleAreas( Functor &func )
 	{
+		if ( TheNavVisibility.IsBuilt() && m_visibilityIndex >= 0 )
+		{
+			return TheNavVisibility.ForAllPotentiallyVisibleAreas( m_visibilityIndex, func );
+		}
+
 		int i;
 
 		++s_nCurrVisTestCounter;
@@ -598,6 +614,11 @@ public:
 	template < typename Functor >
 	bool ForAllCompletelyVisibleAreas( Functor &func )
 	{
+		if ( TheNavVisibility.IsBuilt() && m_visibilityIndex >= 0 )
+		{
+			return TheNavVisibility.ForAllCompletelyVisibleAreas( m_visibilityIndex, func );
+		}
+
 		int i;
 
 		++s_nCurrVisTestCounter;
@@ -699,7 +720,7 @@ private:
 
 	//- encounter spots ---------------------------------------------------------------------------------
 	SpotEncounterVector m_spotEncounters;						// list of possible ways to move thru this area, and the spots to look at as we do
-	void AddSpotEncounters( const CNavArea *from, NavDirType fromDir, const CNavArea *to, NavDirType toDir );	// add spot encounter data when moving from area to area
+	void AddSpotEncounters( const CNavArea *from, NavDirType fromDir, const CNavArea *to, NavDirType toDir, CLargeVarBitVec *seenSpots );	// add spot encounter data when moving from area to area
 
 	float m_earliestOccupyTime[ MAX_NAV_TEAMS ];				// min time to reach this spot from spawn
 
@@ -759,7 +780,8 @@ private:
 	CAreaBindInfoArray m_potentiallyVisibleAreas;				// list of areas potentially visible from inside this area (after PostLoad(), use area portion of union)
 	bool m_isInheritedFrom;										// latch used during visibility inheritance computation
 
-	const CAreaBindInfoArray &ComputeVisibilityDelta( const CNavArea *other ) const;	// return a list of the delta between our visibility list and the given adjacent area
+	int m_visibilityIndex;										// dense index of this area in TheNavVisibility, or -1 if it isn't in the matrix
+	int m_hierarchyRegion;										// region of this area in TheNavHierarchy, or -1 if it hasn't been clustered
 
 	uint32 m_nVisTestCounter;
 	static uint32 s_nCurrVisTestCounter;
@@ -11,6 +11,7 @@
 
 #include "cbase.h"
 #include "nav_mesh.h"
+#include "nav_image.h"
 #include "gamerules.h"
 #include "datacache/imdlcache.h"
 
@@ -36,7 +37,7 @@
 /// IMPORTANT: If this version changes, the swap function in makegamedata 
 /// must be updated to match. If not, this will break the Xbox 360.
 // TODO: Was changed from 15, update when latest 360 code is integrated (MSB 5/5/09)
-const int NavCurrentVersion = 16;
+const int NavCurrentVersion = 17;
 
 //--------------------------------------------------------------------------------------------------------------
 //
@@ -362,23 +363,7 @@ void CNavArea::Save( CUtlBuffer &fileBuffer, unsigned int version ) const
 		fileBuffer.PutFloat( m_lightIntensity[i] );
 	}
 
-	// save visible area set
-	unsigned int visibleAreaCount = m_potentiallyVisibleAreas.Count();
-	fileBuffer.PutUnsignedInt( visibleAreaCount );
-
-	for ( int vit=0; vit<m_potentiallyVisibleAreas.Count(); ++vit )
-	{
-		CNavArea *area = m_potentiallyVisibleAreas[ vit ].area;
-
-		unsigned int id = area ? area->GetID() : 0;
-
-		fileBuffer.PutUnsignedInt( id );
-		fileBuffer.PutUnsignedChar( m_potentiallyVisibleAreas[ vit ].attributes );
-	}
-
-	// store area we inherit visibility from
-	unsigned int id = ( m_inheritVisibilityFrom.area ) ? m_inheritVisibilityFrom.area->GetID() : 0;
-	fileBuffer.PutUnsignedInt( id );
+	// visible area set is saved by the mesh in TheNavVisibility
 }
 
 
@@ -637,7 +622,8 @@ NavErrorType CNavArea::Load( CUtlBuffer &fileBuffer, unsigned int version, unsig
 		m_lightIntensity[i] = fileBuffer.GetFloat();
 	}
 
-	if ( version < 16 )
+	// version 17 and later store visibility in the mesh, not per area
+	if ( version < 16 || version >= 17 )
 		return NAV_OK;
 
 	// load visibility information
@@ -742,14 +728,7 @@ NavErrorType CNavArea::PostLoad( void )
 
 		if (e->from.area && e->to.area)
 		{
-			// compute path
-			float halfWidth;
-			ComputePortal( e->to.area, e->toDir, &e->path.to, &halfWidth );
-			ComputePortal( e->from.area, e->fromDir, &e->path.from, &halfWidth );
-
-			const float eyeHeight = HalfHumanHeight;
-			e->path.from.z = e->from.area->GetZ( e->path.from ) + eyeHeight;
-			e->path.to.z = e->to.area->GetZ( e->path.to ) + eyeHeight;
+			ComputeEncounterPath( e );
 		}
 
 		// resolve HidingSpot IDs
@@ -1114,6 +1093,7 @@ bool CNavMesh::Save( void ) const
 	// 14 - Added a bool for if the nav needs analysis
 	// 15 - removed approach areas
 	// 16 - Added visibility data to the base mesh
+	// 17 - Visibility stored as a compressed bit matrix after the ladders, instead of per-area lists
 	fileBuffer.PutUnsignedInt( NavCurrentVersion );
 
 	// The sub-version number is maintained and owned by classes derived from CNavMesh and CNavArea
@@ -1179,6 +1159,11 @@ bool CNavMesh::Save( void ) const
 			ladder->Save( fileBuffer, NavCurrentVersion );
 		}
 	}
+
+	//
+	// Store the visibility matrix
+	//
+	TheNavVisibility.Save( fileBuffer );
 	
 	//
 	// Store derived class mesh info
@@ -1194,6 +1179,12 @@ bool CNavMesh::Save( void ) const
 	unsigned int navSize = filesystem->Size( filename );
 	DevMsg( "Size of nav file '%s' is %u bytes.\n", filename, navSize );
 
+	// keep the binary image in step with the nav file
+	if ( nav_image.GetBool() )
+	{
+		SaveNavImage( filename );
+	}
+
 	return true;
 }
 
@@ -1396,6 +1387,16 @@ NavErrorType CNavMesh::Load( void )
 	char filename[256];
 	Q_snprintf( filename, sizeof( filename ), FORMAT_NAVFILE, STRING( gpGlobals->mapname ) );
 
+	// use the binary image of the nav file if it is up to date
+	if ( nav_image.GetBool() && LoadNavImage( filename ) == NAV_OK )
+	{
+		NavErrorType loadResult = PostLoad( NavCurrentVersion );
+
+		WarnIfMeshNeedsAnalysis( NavCurrentVersion );
+
+		return loadResult;
+	}
+
 	bool navIsInBsp = false;
 	CUtlBuffer fileBuffer( 4096, 1024*1024, CUtlBuffer::READ_ONLY );
 	if ( !filesystem->ReadFile( filename, "MOD", fileBuffer ) )	// this ignores .nav files embedded in the .bsp ...
@@ -1558,6 +1559,15 @@ NavErrorType CNavMesh::Load( void )
 		BuildLadders();
 	}
 
+	//
+	// Load the visibility matrix
+	//
+	if ( version >= 17 && !TheNavVisibility.Load( fileBuffer ) )
+	{
+		// the areas fall back to their own (empty) lists until visibility is recomputed
+		m_isAnalyzed = false;
+	}
+
 	// mark stairways (TODO: this can be removed once all maps are re-saved with this attribute in them)
 	MarkStairAreas();
 
@@ -1600,18 +1610,31 @@ struct OneWayLink_t
  */
 NavErrorType CNavMesh::PostLoad( unsigned int version )
 {
-	// allow areas to connect to each other, etc
-	FOR_EACH_VEC( TheNavAreas, pit )
+	// allow areas to connect to each other, etc - an image is stored already bound
+	if ( !m_isBoundFromImage )
 	{
-		CNavArea *area = TheNavAreas[ pit ];
-		area->PostLoad();
+		FOR_EACH_VEC( TheNavAreas, pit )
+		{
+			CNavArea *area = TheNavAreas[ pit ];
+			area->PostLoad();
+		}
+	}
+
+	// older files store per-area visibility lists - compress them into the matrix. Newer files only
+	// have the matrix, if it was rejected there are no lists to build from.
+	if ( version < 17 && !TheNavVisibility.IsBuilt() )
+	{
+		TheNavVisibility.BuildFromAreaLists();
 	}
 
 	// allow hiding spots to compute information
-	FOR_EACH_VEC( TheHidingSpots, hit )
+	if ( !m_isBoundFromImage )
 	{
-		HidingSpot *spot = TheHidingSpots[ hit ];
-		spot->PostLoad();
+		FOR_EACH_VEC( TheHidingSpots, hit )
+		{
+			HidingSpot *spot = TheHidingSpots[ hit ];
+			spot->PostLoad();
+		}
 	}
 
 	if ( version < 8 )
@@ -17,6 +17,7 @@
 #include "viewport_panel_names.h"
 //#include "terror/TerrorShared.h"
 #include "fmtstr.h"
+#include "vstdlib/jobthread.h"
 
 #ifdef TERROR
 #include "func_simpleladder.h"
@@ -42,6 +43,8 @@ ConVar nav_generate_fixup_jump_areas( "nav_generate_fixup_jump_areas", "1", FCVA
 ConVar nav_generate_incremental_range( "nav_generate_incremental_range", "2000", FCVAR_CHEAT );
 ConVar nav_generate_incremental_tolerance( "nav_generate_incremental_tolerance", "0", FCVAR_CHEAT, "Z tolerance for adding new nav areas." );
 ConVar nav_area_max_size( "nav_area_max_size", "50", FCVAR_CHEAT, "Max area size created in nav generation" );
+ConVar nav_generate_parallel( "nav_generate_parallel", "0", FCVAR_CHEAT, "Sample walkable space and analyze spots on worker threads during full generation and analysis. Intended for offline/dedicated generation." );
+ConVar nav_generate_tile_size( "nav_generate_tile_size", "512", FCVAR_CHEAT, "Size of the spatial tiles that parallel walkable space sampling is batched into", true, GenerationStepSize, false, 0.0f );
 
 // Common bounding box for traces
 Vector NavTraceMins( -0.45, -0.45, 0 );
@@ -3457,6 +3460,7 @@ void CNavMesh::BeginGeneration( bool incremental )
 
 	// the system will see this NULL and select the next walkable seed
 	m_currentNode = NULL;
+	m_sampleFrontier.RemoveAll();
 
 	// if there are no seed points, we can't generate
 	if (m_walkableSeeds.Count() == 0)
@@ -3617,6 +3621,32 @@ static void HideAnalysisProgress( void )
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+// Per-item jobs for the parallel analysis steps (nav_generate_parallel)
+
+extern void ClassifyHidingSpotCover( HidingSpot *&spot );
+extern void ClassifySniperSpot( HidingSpot *spot );
+
+static void ClassifySniperSpotJob( HidingSpot *&spot )
+{
+	ClassifySniperSpot( spot );
+}
+
+static void ComputeAreaSpotEncounters( CNavArea *&area )
+{
+	area->ComputeSpotEncounters();
+}
+
+static void GetAllHidingSpots( CUtlVector< HidingSpot * > *spots )
+{
+	spots->EnsureCapacity( TheHidingSpots.Count() );
+	FOR_EACH_VEC( TheHidingSpots, it )
+	{
+		spots->AddToTail( TheHidingSpots[ it ] );
+	}
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Process the auto-generation for 'maxTime' seconds. return false if generation is complete.
@@ -3639,7 +3669,7 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 			AnalysisProgress( "Sampling walkable space...", 100, m_sampleTick / 10, false );
 			m_sampleTick = ( m_sampleTick + 1 ) % 1000;
 
-			while ( SampleStep() )
+			while ( IsParallelGeneration() ? SampleStepParallel() : SampleStep() )
 			{
 				if ( Plat_FloatTime() - startTime > maxTime )
 				{
@@ -3704,6 +3734,22 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 		//---------------------------------------------------------------------------
 		case FIND_HIDING_SPOTS:
 		{
+			if ( IsParallelGeneration() && m_generationIndex == 0 )
+			{
+				// Creating the spots hands out their IDs, so keep that serial and deterministic.
+				// Classifying cover is where the traces are.
+				FOR_EACH_VEC( TheNavAreas, it )
+				{
+					TheNavAreas[ it ]->CollectHidingSpots();
+				}
+
+				CUtlVector< HidingSpot * > spots;
+				GetAllHidingSpots( &spots );
+				ParallelProcess( "CNavArea::ClassifyHidingSpotCover", spots.Base(), spots.Count(), &ClassifyHidingSpotCover );
+
+				m_generationIndex = TheNavAreas.Count();
+			}
+
 			while( m_generationIndex < TheNavAreas.Count() )
 			{
 				CNavArea *area = TheNavAreas[ m_generationIndex ];
@@ -3729,6 +3775,12 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 		//---------------------------------------------------------------------------
 		case FIND_ENCOUNTER_SPOTS:
 		{
+			if ( IsParallelGeneration() && m_generationIndex == 0 )
+			{
+				ParallelProcess( "CNavArea::ComputeSpotEncounters", TheNavAreas.Base(), TheNavAreas.Count(), &ComputeAreaSpotEncounters );
+				m_generationIndex = TheNavAreas.Count();
+			}
+
 			while( m_generationIndex < TheNavAreas.Count() )
 			{
 				CNavArea *area = TheNavAreas[ m_generationIndex ];
@@ -3754,6 +3806,18 @@ bool CNavMesh::UpdateGeneration( float maxTime )
 		//---------------------------------------------------------------------------
 		case FIND_SNIPER_SPOTS:
 		{
+			if ( IsParallelGeneration() && m_generationIndex == 0 )
+			{
+				if ( !nav_quicksave.GetBool() )
+				{
+					CUtlVector< HidingSpot * > spots;
+					GetAllHidingSpots( &spots );
+					ParallelProcess( "ClassifySniperSpot", spots.Base(), spots.Count(), &ClassifySniperSpotJob );
+				}
+
+				m_generationIndex = TheNavAreas.Count();
+			}
+
 			while( m_generationIndex < TheNavAreas.Count() )
 			{
 				CNavArea *area = TheNavAreas[ m_generationIndex ];
@@ -4079,7 +4143,7 @@ const char *CNavMesh::GetPlayerSpawnName( void ) const
  * Node Z positions are ground level.
  */
 CNavNode *CNavMesh::AddNode( const Vector &destPos, const Vector &normal, NavDirType dir, CNavNode *source, bool isOnDisplacement, 
-							float obstacleHeight, float obstacleStartDist, float obstacleEndDist )
+							float obstacleHeight, float obstacleStartDist, float obstacleEndDist, bool checkNode )
 {
 	// check if a node exists at this location
 	CNavNode *node = CNavNode::GetNode( destPos );
@@ -4116,17 +4180,9 @@ CNavNode *CNavMesh::AddNode( const Vector &destPos, const Vector &normal, NavDir
 		m_currentNode = node;
 	}
 
-	node->CheckCrouch();
-
-	// determine if there's a cliff nearby and set an attribute on this node
-	for ( int i = 0; i < NUM_DIRECTIONS; i++ )
+	if ( checkNode )
 	{
-		NavDirType dir = (NavDirType) i;
-		if ( CheckCliff( node->GetPosition(), dir ) )
-		{
-			node->SetAttributes( node->GetAttributes() | NAV_MESH_CLIFF );
-			break;
-		}
+		CheckSampledNode( node );
 	}
 
 	return node;
@@ -4339,6 +4395,184 @@ static bool IsNodeOverlapped( const Vector& pos, const Vector& offset )
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * A single generation step from a node to one of its neighboring grid positions
+ */
+struct NavSampleStep
+{
+	CNavNode *from;
+	NavDirType dir;
+	Vector pos;														// the grid position we are trying to reach
+	int tile;														// spatial tile containing 'pos'
+	int order;														// order the step was queued in, to keep results deterministic
+
+	bool success;
+	Vector to;
+	Vector toNormal;
+	bool isOnDisplacement;
+	float obstacleHeight;
+	float obstacleStartDist;
+	float obstacleEndDist;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Try to take one generation step from 'from' to the adjacent grid position 'pos'.
+ * This only traces against the world and does not touch the node graph, so it is safe
+ * to run on worker threads (see nav_generate_parallel).
+ * Returns false if we can't move there.
+ */
+static bool ComputeSampleStep( const Vector &from, const Vector &pos, bool checkOverlap, NavSampleStep *step )
+{
+	trace_t result;
+	CTraceFilterWalkableEntities filter( NULL, COLLISION_GROUP_NONE, WALK_THRU_EVERYTHING );
+	Vector to, toNormal;
+	float obstacleHeight = 0, obstacleStartDist = 0, obstacleEndDist = GenerationStepSize;
+	if ( TraceAdjacentNode( 0, from, pos, &result ) )
+	{
+		to = result.endpos;
+		toNormal = result.plane.normal;
+	}
+	else
+	{
+		// test going up ClimbUpHeight
+		bool success = false;
+		for ( float height = StepHeight; height <= ClimbUpHeight; height += 1.0f )
+		{						
+			trace_t tr;
+			Vector start( from );
+			Vector end( pos );
+			start.z += height;
+			end.z += height;
+			UTIL_TraceHull( start, end, NavTraceMins, NavTraceMaxs, TheNavMesh->GetGenerationTraceMask(), &filter, &tr );
+			if ( !tr.startsolid && tr.fraction == 1.0f )
+			{
+				if ( !StayOnFloor( &tr ) )
+				{
+					break;
+				}
+
+				to = tr.endpos;
+				toNormal = tr.plane.normal;
+
+				start = end = from;
+				end.z += height;
+				UTIL_TraceHull( start, end, NavTraceMins, NavTraceMaxs, TheNavMesh->GetGenerationTraceMask(), &filter, &tr );
+				if ( tr.fraction < 1.0f )
+				{
+					break;
+				}
+
+				// keep track of far up we had to go to find a path to the next node
+				obstacleHeight = height;
+				success = true;
+				break;
+			}
+			else
+			{
+				// Could not trace from node to node at this height, something is in the way.
+				// Trace in the other direction to see if we hit something
+				Vector vecToObstacleStart = tr.endpos - start;
+				Assert( vecToObstacleStart.LengthSqr() <= Square( GenerationStepSize ) );
+				if ( vecToObstacleStart.LengthSqr() <= Square( GenerationStepSize ) )
+				{
+					UTIL_TraceHull( end, start, NavTraceMins, NavTraceMaxs, TheNavMesh->GetGenerationTraceMask(), &filter, &tr );
+					if ( !tr.startsolid && tr.fraction < 1.0 )
+					{
+						// We hit something going the other direction.  There is some obstacle between the two nodes.
+						Vector vecToObstacleEnd = tr.endpos - start;
+						Assert( vecToObstacleEnd.LengthSqr() <= Square( GenerationStepSize ) );
+						if ( vecToObstacleEnd.LengthSqr() <= Square( GenerationStepSize )  )
+						{
+							// Remember the distances to start and end of the obstacle (with respect to the "from" node).
+							// Keep track of the last distances to obstacle as we keep increasing the height we do a trace for.
+							// If we do eventually clear the obstacle, these values will be the start and end distance to the
+							// very tip of the obstacle.
+							obstacleStartDist = vecToObstacleStart.Length();
+							obstacleEndDist = vecToObstacleEnd.Length();
+							if ( obstacleEndDist == 0 )
+							{
+								obstacleEndDist = GenerationStepSize;
+							}
+						}								
+					}
+				}
+			}
+		}
+
+		if ( !success )
+		{
+			return false;
+		}
+	}
+
+	// Don't generate nodes if we spill off the end of the world onto skybox
+	if ( result.surface.flags & ( SURF_SKY|SURF_SKY2D ) )
+	{
+		return false;
+	}
+
+	// If we're incrementally generating, don't overlap existing nav areas.
+	Vector testPos( to );
+	bool overlapSE = IsNodeOverlapped( testPos, Vector(  1,  1, HalfHumanHeight ) );
+	bool overlapSW = IsNodeOverlapped( testPos, Vector( -1,  1, HalfHumanHeight ) );
+	bool overlapNE = IsNodeOverlapped( testPos, Vector(  1, -1, HalfHumanHeight ) );
+	bool overlapNW = IsNodeOverlapped( testPos, Vector( -1, -1, HalfHumanHeight ) );
+	if ( overlapSE && overlapSW && overlapNE && overlapNW && checkOverlap )
+	{
+		return false;
+	}
+
+	bool isOnDisplacement = result.IsDispSurface();
+
+	if ( nav_displacement_test.GetInt() > 0 )
+	{
+		// Test for nodes under displacement surfaces.
+		// This happens during development, and is a pain because the space underneath a displacement
+		// is not 'solid'.
+		Vector start = to + Vector( 0, 0, 0 );
+		Vector end = start + Vector( 0, 0, nav_displacement_test.GetInt() );
+		UTIL_TraceHull( start, end, NavTraceMins, NavTraceMaxs, TheNavMesh->GetGenerationTraceMask(), &filter, &result );
+
+		if ( result.fraction > 0 )
+		{
+			end = start;
+			start = result.endpos;
+			UTIL_TraceHull( start, end, NavTraceMins, NavTraceMaxs, TheNavMesh->GetGenerationTraceMask(), &filter, &result );
+			if ( result.fraction < 1 )
+			{
+				// if we made it down to within StepHeight, maybe we're on a static prop
+				if ( result.endpos.z > to.z + StepHeight )
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	float deltaZ = to.z - from.z;
+	// If there's an obstacle in the way and it's traversable, or the obstacle is not higher than the destination node itself minus a small epsilon
+	// (meaning the obstacle was just the height change to get to the destination node, no extra obstacle between the two), clear obstacle height
+	// and distances
+	if ( ( obstacleHeight < MaxTraversableHeight ) || ( deltaZ > ( obstacleHeight - 2.0f ) ) )
+	{
+		obstacleHeight = 0;
+		obstacleStartDist = 0;
+		obstacleEndDist = GenerationStepSize;
+	}
+
+	step->to = to;
+	step->toNormal = toNormal;
+	step->isOnDisplacement = isOnDisplacement;
+	step->obstacleHeight = obstacleHeight;
+	step->obstacleStartDist = obstacleStartDist;
+	step->obstacleEndDist = obstacleEndDist;
+	return true;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Search the world and build a map of possible movements.
@@ -4451,102 +4685,8 @@ bool CNavMesh::SampleStep( void )
 				}
 
 				// test if we can move to new position
-				trace_t result;
-				Vector from( *m_currentNode->GetPosition() );
-				CTraceFilterWalkableEntities filter( NULL, COLLISION_GROUP_NONE, WALK_THRU_EVERYTHING );
-				Vector to, toNormal;
-				float obstacleHeight = 0, obstacleStartDist = 0, obstacleEndDist = GenerationStepSize;
-				if ( TraceAdjacentNode( 0, from, pos, &result ) )
-				{
-					to = result.endpos;
-					toNormal = result.plane.normal;
-				}
-				else
-				{
-					// test going up ClimbUpHeight
-					bool success = false;
-					for ( float height = StepHeight; height <= ClimbUpHeight; height += 1.0f )
-					{						
-						trace_t tr;
-						Vector start( from );
-						Vector end( pos );
-						start.z += height;
-						end.z += height;
-						UTIL_TraceHull( start, end, NavTraceMins, NavTraceMaxs, GetGenerationTraceMask(), &filter, &tr );
-						if ( !tr.startsolid && tr.fraction == 1.0f )
-						{
-							if ( !StayOnFloor( &tr ) )
-							{
-								break;
-							}
-
-							to = tr.endpos;
-							toNormal = tr.plane.normal;
-
-							start = end = from;
-							end.z += height;
-							UTIL_TraceHull( start, end, NavTraceMins, NavTraceMaxs, GetGenerationTraceMask(), &filter, &tr );
-							if ( tr.fraction < 1.0f )
-							{
-								break;
-							}
-
-							// keep track of far up we had to go to find a path to the next node
-							obstacleHeight = height;
-							success = true;
-							break;
-						}
-						else
-						{
-							// Could not trace from node to node at this height, something is in the way.
-							// Trace in the other direction to see if we hit something
-							Vector vecToObstacleStart = tr.endpos - start;
-							Assert( vecToObstacleStart.LengthSqr() <= Square( GenerationStepSize ) );
-							if ( vecToObstacleStart.LengthSqr() <= Square( GenerationStepSize ) )
-							{
-								UTIL_TraceHull( end, start, NavTraceMins, NavTraceMaxs, GetGenerationTraceMask(), &filter, &tr );
-								if ( !tr.startsolid && tr.fraction < 1.0 )
-								{
-									// We hit something going the other direction.  There is some obstacle between the two nodes.
-									Vector vecToObstacleEnd = tr.endpos - start;
-									Assert( vecToObstacleEnd.LengthSqr() <= Square( GenerationStepSize ) );
-									if ( vecToObstacleEnd.LengthSqr() <= Square( GenerationStepSize )  )
-									{
-										// Remember the distances to start and end of the obstacle (with respect to the "from" node).
-										// Keep track of the last distances to obstacle as we keep increasing the height we do a trace for.
-										// If we do eventually clear the obstacle, these values will be the start and end distance to the
-										// very tip of the obstacle.
-										obstacleStartDist = vecToObstacleStart.Length();
-										obstacleEndDist = vecToObstacleEnd.Length();
-										if ( obstacleEndDist == 0 )
-										{
-											obstacleEndDist = GenerationStepSize;
-										}
-									}								
-								}
-							}
-						}
-					}
-
-					if ( !success )
-					{
-						return true;
-					}
-				}
-
-				// Don't generate nodes if we spill off the end of the world onto skybox
-				if ( result.surface.flags & ( SURF_SKY|SURF_SKY2D ) )
-				{
-					return true;
-				}
-
-				// If we're incrementally generating, don't overlap existing nav areas.
-				Vector testPos( to );
-				bool overlapSE = IsNodeOverlapped( testPos, Vector(  1,  1, HalfHumanHeight ) );
-				bool overlapSW = IsNodeOverlapped( testPos, Vector( -1,  1, HalfHumanHeight ) );
-				bool overlapNE = IsNodeOverlapped( testPos, Vector(  1, -1, HalfHumanHeight ) );
-				bool overlapNW = IsNodeOverlapped( testPos, Vector( -1, -1, HalfHumanHeight ) );
-				if ( overlapSE && overlapSW && overlapNE && overlapNW && m_generationMode != GENERATE_SIMPLIFY )
+				NavSampleStep step;
+				if ( !ComputeSampleStep( *m_currentNode->GetPosition(), pos, m_generationMode != GENERATE_SIMPLIFY, &step ) )
 				{
 					return true;
 				}
@@ -4555,7 +4695,7 @@ bool CNavMesh::SampleStep( void )
 				if ( nTolerance > 0 && m_generationMode == GENERATE_INCREMENTAL )
 				{
 					bool bValid = false;
-					int zPos = to.z;
+					int zPos = step.to.z;
 					for ( int i=0; i<m_walkableSeeds.Count(); ++i )
 					{
 						const Vector &seedPos = m_walkableSeeds[i].pos;
@@ -4573,48 +4713,9 @@ bool CNavMesh::SampleStep( void )
 						return true;
 				}
 
-
-				bool isOnDisplacement = result.IsDispSurface();
-
-				if ( nav_displacement_test.GetInt() > 0 )
-				{
-					// Test for nodes under displacement surfaces.
-					// This happens during development, and is a pain because the space underneath a displacement
-					// is not 'solid'.
-					Vector start = to + Vector( 0, 0, 0 );
-					Vector end = start + Vector( 0, 0, nav_displacement_test.GetInt() );
-					UTIL_TraceHull( start, end, NavTraceMins, NavTraceMaxs, GetGenerationTraceMask(), &filter, &result );
-
-					if ( result.fraction > 0 )
-					{
-						end = start;
-						start = result.endpos;
-						UTIL_TraceHull( start, end, NavTraceMins, NavTraceMaxs, GetGenerationTraceMask(), &filter, &result );
-						if ( result.fraction < 1 )
-						{
-							// if we made it down to within StepHeight, maybe we're on a static prop
-							if ( result.endpos.z > to.z + StepHeight )
-							{
-								return true;
-							}
-						}
-					}
-				}
-
-				float deltaZ = to.z - m_currentNode->GetPosition()->z;
-				// If there's an obstacle in the way and it's traversable, or the obstacle is not higher than the destination node itself minus a small epsilon
-				// (meaning the obstacle was just the height change to get to the destination node, no extra obstacle between the two), clear obstacle height
-				// and distances
-				if ( ( obstacleHeight < MaxTraversableHeight ) || ( deltaZ > ( obstacleHeight - 2.0f ) ) )
-				{
-					obstacleHeight = 0;
-					obstacleStartDist = 0;
-					obstacleEndDist = GenerationStepSize;
-				}
-
 				// we can move here
 				// create a new navigation node, and update current node pointer
-				AddNode( to, toNormal, m_generationDir, m_currentNode, isOnDisplacement, obstacleHeight, obstacleStartDist, obstacleEndDist );
+				AddNode( step.to, step.toNormal, m_generationDir, m_currentNode, step.isOnDisplacement, step.obstacleHeight, step.obstacleStartDist, step.obstacleEndDist );
 
 				return true;
 			}
@@ -4626,6 +4727,203 @@ bool CNavMesh::SampleStep( void )
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Parallel sampling. Instead of the depth-first walk SampleStep does, the search is expanded
+ * one wavefront at a time: every unexplored direction of every node on the frontier is queued,
+ * the queued steps are bucketed into spatial tiles and traced on worker threads, then the results
+ * are applied to the node graph serially in (tile, queue order). Since only the traces run in
+ * parallel and the graph is built in a fixed order, tile borders are stitched the same way
+ * no matter how many threads ran or which finished first.
+ */
+struct NavSampleTile
+{
+	int first;														// index of first step of this tile in s_sampleSteps
+	int count;
+};
+
+static CUtlVector< NavSampleStep > s_sampleSteps;
+
+static int NavSampleStepCompare( const NavSampleStep *lhs, const NavSampleStep *rhs )
+{
+	if ( lhs->tile != rhs->tile )
+		return ( lhs->tile < rhs->tile ) ? -1 : 1;
+
+	return lhs->order - rhs->order;
+}
+
+static int GetSampleTile( const Vector &pos )
+{
+	float tileSize = nav_generate_tile_size.GetFloat();
+	int x = (int)floor( pos.x / tileSize );
+	int y = (int)floor( pos.y / tileSize );
+	return ( ( y & 0xFFFF ) << 16 ) | ( x & 0xFFFF );
+}
+
+static void ComputeSampleTile( NavSampleTile &tile )
+{
+	for ( int i = tile.first; i < tile.first + tile.count; ++i )
+	{
+		NavSampleStep &step = s_sampleSteps[i];
+		step.success = ComputeSampleStep( *step.from->GetPosition(), step.pos, true, &step );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Crouch and cliff checks for a freshly sampled node. AddNode does these inline, the parallel
+ * sampler defers them so a whole wavefront of nodes can be checked at once.
+ */
+void CNavMesh::CheckSampledNode( CNavNode *&node )
+{
+	node->CheckCrouch();
+
+	// determine if there's a cliff nearby and set an attribute on this node
+	for ( int i = 0; i < NUM_DIRECTIONS; i++ )
+	{
+		NavDirType dir = (NavDirType) i;
+		if ( CheckCliff( node->GetPosition(), dir ) )
+		{
+			node->SetAttributes( node->GetAttributes() | NAV_MESH_CLIFF );
+			break;
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if generation steps should be spread over worker threads
+ */
+bool CNavMesh::IsParallelGeneration( void ) const
+{
+	return nav_generate_parallel.GetBool() && ( m_generationMode == GENERATE_FULL || m_generationMode == GENERATE_ANALYSIS_ONLY );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Sample one wavefront of the walkable space on worker threads.
+ * Returns true if sampling needs to continue, or false if done.
+ */
+bool CNavMesh::SampleStepParallel( void )
+{
+	if ( m_sampleFrontier.Count() == 0 )
+	{
+		// sampling is complete from current seed, try next one
+		CNavNode *seed = GetNextWalkableSeedNode();
+
+		if ( seed == NULL )
+		{
+			// search is exhausted - continue search from ends of ladders
+			for ( int i=0; i<m_ladders.Count(); ++i )
+			{
+				CNavLadder *ladder = m_ladders[i];
+
+				// check ladder bottom
+				if ((seed = LadderEndSearch( &ladder->m_bottom, ladder->GetDir() )) != 0)
+					break;
+
+				// check ladder top
+				if ((seed = LadderEndSearch( &ladder->m_top, ladder->GetDir() )) != 0)
+					break;
+			}
+
+			if ( seed == NULL )
+			{
+				// all seeds exhausted, sampling complete
+				return false;
+			}
+		}
+
+		m_sampleFrontier.AddToTail( seed );
+	}
+
+	// queue every unexplored direction of the frontier
+	s_sampleSteps.RemoveAll();
+	FOR_EACH_VEC( m_sampleFrontier, it )
+	{
+		CNavNode *node = m_sampleFrontier[ it ];
+
+		for( int dir = NORTH; dir < NUM_DIRECTIONS; dir++ )
+		{
+			if ( node->HasVisited( (NavDirType)dir ) )
+				continue;
+
+			node->MarkAsVisited( (NavDirType)dir );
+
+			Vector pos = *node->GetPosition();
+			int cx = SnapToGrid( pos.x );
+			int cy = SnapToGrid( pos.y );
+
+			switch( dir )
+			{
+				case NORTH:		cy -= GenerationStepSize; break;
+				case SOUTH:		cy += GenerationStepSize; break;
+				case EAST:		cx += GenerationStepSize; break;
+				case WEST:		cx -= GenerationStepSize; break;
+			}
+
+			pos.x = cx;
+			pos.y = cy;
+
+			NavSampleStep &step = s_sampleSteps[ s_sampleSteps.AddToTail() ];
+			step.from = node;
+			step.dir = (NavDirType)dir;
+			step.pos = pos;
+			step.tile = GetSampleTile( pos );
+			step.order = s_sampleSteps.Count() - 1;
+			step.success = false;
+		}
+	}
+	m_sampleFrontier.RemoveAll();
+
+	// bucket the steps by tile and trace them
+	s_sampleSteps.Sort( NavSampleStepCompare );
+
+	CUtlVector< NavSampleTile > tiles;
+	for ( int i = 0; i < s_sampleSteps.Count(); ++i )
+	{
+		if ( i == 0 || s_sampleSteps[i].tile != s_sampleSteps[i-1].tile )
+		{
+			NavSampleTile &tile = tiles[ tiles.AddToTail() ];
+			tile.first = i;
+			tile.count = 0;
+		}
+
+		++tiles.Tail().count;
+	}
+
+	ParallelProcess( "CNavMesh::SampleStepParallel", tiles.Base(), tiles.Count(), &ComputeSampleTile );
+
+	// apply the results to the node graph, in a fixed order
+	FOR_EACH_VEC( s_sampleSteps, it )
+	{
+		const NavSampleStep &step = s_sampleSteps[ it ];
+		if ( !step.success )
+			continue;
+
+		// a neighbor found this way earlier in this wavefront, and assumed the connection was commutative
+		if ( step.from->GetConnectedNode( step.dir ) )
+			continue;
+
+		// AddNode sets the current node only if it created a new one
+		m_currentNode = NULL;
+		AddNode( step.to, step.toNormal, step.dir, step.from, step.isOnDisplacement, step.obstacleHeight, step.obstacleStartDist, step.obstacleEndDist, false );
+		if ( m_currentNode )
+		{
+			m_sampleFrontier.AddToTail( m_currentNode );
+		}
+	}
+	m_currentNode = NULL;
+
+	ParallelProcess( "CNavMesh::CheckSampledNode", m_sampleFrontier.Base(), m_sampleFrontier.Count(), this, &CNavMesh::CheckSampledNode );
+
+	return true;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Add given walkable position to list of seed positions for map sampling
@@ -0,0 +1,605 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose:
+//
+// $NoKeywords: $
+//===========================================================================//
+
+// Region-level abstraction of the navigation mesh, for hierarchical path finding
+
+#include "cbase.h"
+#include "tier0/vprof.h"
+#include "tier1/utlpriorityqueue.h"
+#include "nav_mesh.h"
+#include "nav_hierarchy.h"
+
+// NOTE: This has to be the last file included!
+#include "tier0/memdbgon.h"
+
+
+static void NavHierarchyRegionSizeChanged( IConVar *var, const char *pOldValue, float flOldValue )
+{
+	TheNavHierarchy.Reset();
+}
+
+ConVar nav_hierarchy( "nav_hierarchy", "1", FCVAR_GAMEDLL | FCVAR_CHEAT, "If nonzero, long paths are planned over regions of the Navigation Mesh first, and only the areas along that route are searched." );
+ConVar nav_hierarchy_max_detour( "nav_hierarchy_max_detour", "1.5", FCVAR_GAMEDLL | FCVAR_CHEAT, "If a path found inside the region corridor costs more than this multiple of the straight line distance, the full Navigation Mesh is searched instead.", true, 1.0f, false, 0.0f );
+ConVar nav_hierarchy_region_size( "nav_hierarchy_region_size", "48", FCVAR_GAMEDLL | FCVAR_CHEAT, "The maximum number of areas clustered into one region of the Navigation Mesh hierarchy.", true, 1, false, 0, NavHierarchyRegionSizeChanged );
+
+CNavHierarchy TheNavHierarchy;
+
+
+//--------------------------------------------------------------------------------------------------------------
+CNavHierarchy::CNavHierarchy( void )
+{
+	m_isBuilt = false;
+	m_searchMarker = 0;
+	m_portalSearchMarker = 0;
+	m_corridorMarker = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavHierarchy::Reset( void )
+{
+	if ( !m_isBuilt )
+		return;
+
+	// areas keep their stale region until the next build reassigns them all
+	m_isBuilt = false;
+	m_regions.Purge();
+	m_edges.Purge();
+	m_portals.Purge();
+	m_corridor.Purge();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavHierarchy::Build( void )
+{
+	VPROF_BUDGET( "CNavHierarchy::Build", "NextBot" );
+
+	Reset();
+
+	BuildRegions();
+	BuildEdges();
+
+	m_searchMarker = 0;
+	m_portalSearchMarker = 0;
+	m_corridorMarker = 0;
+	m_isBuilt = true;
+
+	DevMsg( "Navigation hierarchy: %d areas in %d regions, %d edges, %d portals\n", TheNavAreas.Count(), m_regions.Count(), m_edges.Count(), m_portals.Count() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Cluster the areas by flood filling across connections between areas of the same Place,
+ * up to the maximum region size. Unnamed areas cluster with each other the same way.
+ */
+void CNavHierarchy::BuildRegions( void )
+{
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		TheNavAreas[ it ]->SetHierarchyRegion( -1 );
+	}
+
+	const int maxRegionSize = nav_hierarchy_region_size.GetInt();
+
+	CUtlVector< CNavArea * > queue;
+	queue.EnsureCapacity( maxRegionSize );
+
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		CNavArea *seed = TheNavAreas[ it ];
+		if ( seed->GetHierarchyRegion() >= 0 )
+			continue;
+
+		int region = m_regions.AddToTail();
+		Place place = seed->GetPlace();
+
+		seed->SetHierarchyRegion( region );
+		queue.RemoveAll();
+		queue.AddToTail( seed );
+
+		Vector center = vec3_origin;
+		for( int head=0; head<queue.Count(); ++head )
+		{
+			CNavArea *area = queue[ head ];
+			center += area->GetCenter();
+
+			for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
+			{
+				// walk one-way links in both directions, so drops don't split a region
+				const NavConnectVector *lists[2] = { area->GetAdjacentAreas( (NavDirType)dir ), area->GetIncomingConnections( (NavDirType)dir ) };
+
+				for( int l=0; l<2; ++l )
+				{
+					FOR_EACH_VEC( (*lists[l]), cit )
+					{
+						if ( queue.Count() >= maxRegionSize )
+							break;
+
+						CNavArea *adjArea = (*lists[l])[ cit ].area;
+						if ( adjArea->GetHierarchyRegion() >= 0 || adjArea->GetPlace() != place )
+							continue;
+
+						adjArea->SetHierarchyRegion( region );
+						queue.AddToTail( adjArea );
+					}
+				}
+			}
+		}
+
+		Region &info = m_regions[ region ];
+		info.center = center / (float)queue.Count();
+		info.place = place;
+		info.areaCount = queue.Count();
+		info.firstEdge = 0;
+		info.edgeCount = 0;
+		info.searchMarker = 0;
+		info.closedMarker = 0;
+		info.corridorMarker = 0;
+		info.costSoFar = 0.0f;
+		info.parentEdge = -1;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+int CNavHierarchy::ComparePortals( const Portal *lhs, const Portal *rhs )
+{
+	int result = lhs->from->GetHierarchyRegion() - rhs->from->GetHierarchyRegion();
+	if ( result != 0 )
+		return result;
+
+	result = lhs->to->GetHierarchyRegion() - rhs->to->GetHierarchyRegion();
+	if ( result != 0 )
+		return result;
+
+	// keep the order deterministic within an edge
+	if ( lhs->from->GetID() != rhs->from->GetID() )
+		return ( lhs->from->GetID() < rhs->from->GetID() ) ? -1 : 1;
+
+	if ( lhs->to->GetID() != rhs->to->GetID() )
+		return ( lhs->to->GetID() < rhs->to->GetID() ) ? -1 : 1;
+
+	return 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Collect every transition NavAreaBuildPath() can take between two regions, and group
+ * them into one directed edge per pair of regions.
+ */
+void CNavHierarchy::BuildEdges( void )
+{
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		CNavArea *area = TheNavAreas[ it ];
+		int region = area->GetHierarchyRegion();
+
+		CUtlVectorFixedGrowable< CNavArea *, 32 > successors;
+		CUtlVectorFixedGrowable< float, 32 > lengths;
+
+		for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
+		{
+			const NavConnectVector *connectList = area->GetAdjacentAreas( (NavDirType)dir );
+			FOR_EACH_VEC( (*connectList), cit )
+			{
+				successors.AddToTail( (*connectList)[ cit ].area );
+				lengths.AddToTail( ( (*connectList)[ cit ].area->GetCenter() - area->GetCenter() ).Length() );
+			}
+		}
+
+		// as in NavAreaBuildPath(), the area behind the top of a ladder isn't used going up
+		const NavLadderConnectVector *ladderList = area->GetLadders( CNavLadder::LADDER_UP );
+		FOR_EACH_VEC( (*ladderList), lit )
+		{
+			const CNavLadder *ladder = (*ladderList)[ lit ].ladder;
+			CNavArea *tops[] = { ladder->m_topForwardArea, ladder->m_topLeftArea, ladder->m_topRightArea };
+			for( int t=0; t<ARRAYSIZE( tops ); ++t )
+			{
+				if ( tops[t] )
+				{
+					successors.AddToTail( tops[t] );
+					lengths.AddToTail( ladder->m_length );
+				}
+			}
+		}
+
+		ladderList = area->GetLadders( CNavLadder::LADDER_DOWN );
+		FOR_EACH_VEC( (*ladderList), lit )
+		{
+			const CNavLadder *ladder = (*ladderList)[ lit ].ladder;
+			if ( ladder->m_bottomArea )
+			{
+				successors.AddToTail( ladder->m_bottomArea );
+				lengths.AddToTail( ladder->m_length );
+			}
+		}
+
+		if ( area->GetElevator() )
+		{
+			const NavConnectVector &elevatorAreas = area->GetElevatorAreas();
+			FOR_EACH_VEC( elevatorAreas, eit )
+			{
+				successors.AddToTail( elevatorAreas[ eit ].area );
+				lengths.AddToTail( ( elevatorAreas[ eit ].area->GetCenter() - area->GetCenter() ).Length() );
+			}
+		}
+
+		FOR_EACH_VEC( successors, sit )
+		{
+			CNavArea *adjArea = successors[ sit ];
+			int adjRegion = adjArea->GetHierarchyRegion();
+			if ( adjRegion == region )
+				continue;
+
+			Portal &portal = m_portals[ m_portals.AddToTail() ];
+			portal.from = area;
+			portal.to = adjArea;
+			portal.cost = ( area->GetCenter() - m_regions[ region ].center ).Length() + lengths[ sit ] + ( m_regions[ adjRegion ].center - adjArea->GetCenter() ).Length();
+			portal.length = lengths[ sit ];
+			portal.searchMarker = 0;
+			portal.closedMarker = 0;
+			portal.costSoFar = 0.0f;
+		}
+	}
+
+	m_portals.Sort( ComparePortals );
+
+	for( int i=0; i<m_portals.Count(); )
+	{
+		int fromRegion = m_portals[i].from->GetHierarchyRegion();
+		int toRegion = m_portals[i].to->GetHierarchyRegion();
+
+		int e = m_edges.AddToTail();
+		Edge &edge = m_edges[e];
+		edge.fromRegion = fromRegion;
+		edge.toRegion = toRegion;
+		edge.firstPortal = i;
+
+		while( i < m_portals.Count() && m_portals[i].from->GetHierarchyRegion() == fromRegion && m_portals[i].to->GetHierarchyRegion() == toRegion )
+		{
+			++i;
+		}
+		edge.portalCount = i - edge.firstPortal;
+
+		UpdateEdgeCost( &edge );
+
+		Region &from = m_regions[ fromRegion ];
+		if ( from.edgeCount == 0 )
+		{
+			from.firstEdge = e;
+		}
+		++from.edgeCount;
+
+		m_regions[ toRegion ].incomingEdges.AddToTail( e );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Recompute the cost of crossing the edge from its cheapest portal that is open to each team
+ */
+void CNavHierarchy::UpdateEdgeCost( Edge *edge )
+{
+	for( int slot=0; slot<NUM_BLOCK_SLOTS; ++slot )
+	{
+		int teamID = ( slot < MAX_NAV_TEAMS ) ? slot : TEAM_ANY;
+
+		edge->cost[ slot ] = -1.0f;
+		for( int p=0; p<edge->portalCount; ++p )
+		{
+			const Portal &portal = m_portals[ edge->firstPortal + p ];
+			if ( portal.from->IsBlocked( teamID ) || portal.to->IsBlocked( teamID ) )
+				continue;
+
+			if ( edge->cost[ slot ] < 0.0f || portal.cost < edge->cost[ slot ] )
+			{
+				edge->cost[ slot ] = portal.cost;
+			}
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Invoked by CNavMesh when an area becomes blocked or unblocked. Only the edges with
+ * a portal through the area are touched.
+ */
+void CNavHierarchy::OnAreaBlockedChanged( CNavArea *area )
+{
+	if ( !m_isBuilt )
+		return;
+
+	int region = area->GetHierarchyRegion();
+	if ( region < 0 || region >= m_regions.Count() )
+		return;
+
+	const Region &info = m_regions[ region ];
+
+	for( int e=info.firstEdge; e<info.firstEdge + info.edgeCount; ++e )
+	{
+		Edge &edge = m_edges[e];
+		for( int p=0; p<edge.portalCount; ++p )
+		{
+			if ( m_portals[ edge.firstPortal + p ].from == area )
+			{
+				UpdateEdgeCost( &edge );
+				break;
+			}
+		}
+	}
+
+	FOR_EACH_VEC( info.incomingEdges, it )
+	{
+		Edge &edge = m_edges[ info.incomingEdges[ it ] ];
+		for( int p=0; p<edge.portalCount; ++p )
+		{
+			if ( m_portals[ edge.firstPortal + p ].to == area )
+			{
+				UpdateEdgeCost( &edge );
+				break;
+			}
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool CNavHierarchy::IsOpenRegionLessThan( const OpenRegion &lhs, const OpenRegion &rhs )
+{
+	// the priority queue keeps its greatest element at the head, and we want the cheapest
+	return lhs.totalCost > rhs.totalCost;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool CNavHierarchy::BuildCorridor( CNavArea *startArea, CNavArea *goalArea, int teamID )
+{
+	VPROF_BUDGET( "CNavHierarchy::BuildCorridor", "NextBot" );
+
+	if ( !m_isBuilt )
+	{
+		if ( !TheNavMesh->IsLoaded() || TheNavAreas.Count() == 0 )
+			return false;
+
+		Build();
+	}
+
+	int startRegion = startArea->GetHierarchyRegion();
+	int goalRegion = goalArea->GetHierarchyRegion();
+
+	if ( startRegion < 0 || startRegion >= m_regions.Count() || goalRegion < 0 || goalRegion >= m_regions.Count() )
+		return false;
+
+	// a single region is already a small search
+	if ( startRegion == goalRegion )
+		return false;
+
+	int slot = ( teamID == TEAM_ANY ) ? MAX_NAV_TEAMS : ( teamID % MAX_NAV_TEAMS );
+	const Vector &goalCenter = m_regions[ goalRegion ].center;
+
+	++m_searchMarker;
+
+	CUtlPriorityQueue< OpenRegion > openList( 0, 64, IsOpenRegionLessThan );
+
+	Region &start = m_regions[ startRegion ];
+	start.searchMarker = m_searchMarker;
+	start.costSoFar = 0.0f;
+	start.parentEdge = -1;
+
+	OpenRegion open;
+	open.region = startRegion;
+	open.totalCost = ( start.center - goalCenter ).Length();
+	openList.Insert( open );
+
+	bool isFound = false;
+	while( openList.Count() )
+	{
+		int current = openList.ElementAtHead().region;
+		openList.RemoveAtHead();
+
+		Region &region = m_regions[ current ];
+		if ( region.closedMarker == m_searchMarker )
+			continue;
+		region.closedMarker = m_searchMarker;
+
+		if ( current == goalRegion )
+		{
+			isFound = true;
+			break;
+		}
+
+		for( int e=region.firstEdge; e<region.firstEdge + region.edgeCount; ++e )
+		{
+			const Edge &edge = m_edges[e];
+			if ( edge.cost[ slot ] < 0.0f )
+				continue;
+
+			Region &next = m_regions[ edge.toRegion ];
+			if ( next.closedMarker == m_searchMarker )
+				continue;
+
+			float costSoFar = region.costSoFar + edge.cost[ slot ];
+			if ( next.searchMarker == m_searchMarker && next.costSoFar <= costSoFar )
+				continue;
+
+			next.searchMarker = m_searchMarker;
+			next.costSoFar = costSoFar;
+			next.parentEdge = e;
+
+			open.region = edge.toRegion;
+			open.totalCost = costSoFar + ( next.center - goalCenter ).Length();
+			openList.Insert( open );
+		}
+	}
+
+	if ( !isFound )
+		return false;
+
+	// mark the route as the new corridor
+	++m_corridorMarker;
+	m_corridor.RemoveAll();
+
+	for( int region = goalRegion; ; )
+	{
+		m_regions[ region ].corridorMarker = m_corridorMarker;
+		m_corridor.AddToHead( region );
+
+		int parentEdge = m_regions[ region ].parentEdge;
+		if ( parentEdge < 0 )
+			break;
+
+		region = m_edges[ parentEdge ].fromRegion;
+	}
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool CNavHierarchy::IsOpenPortalLessThan( const OpenPortal &lhs, const OpenPortal &rhs )
+{
+	return lhs.totalCost > rhs.totalCost;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * A* over the portals, where going from one portal to the next costs the straight line across
+ * the region between them plus the step through the next portal. Any path on the mesh crosses
+ * some sequence of portals, and costs at least that much to do it.
+ */
+float CNavHierarchy::ComputePathCostLowerBound( CNavArea *startArea, CNavArea *goalArea )
+{
+	VPROF_BUDGET( "CNavHierarchy::ComputePathCostLowerBound", "NextBot" );
+
+	const Vector &goalCenter = goalArea->GetCenter();
+	float straightLine = ( goalCenter - startArea->GetCenter() ).Length();
+
+	if ( !m_isBuilt )
+		return straightLine;
+
+	int startRegion = startArea->GetHierarchyRegion();
+	int goalRegion = goalArea->GetHierarchyRegion();
+
+	if ( startRegion < 0 || startRegion >= m_regions.Count() || goalRegion < 0 || goalRegion >= m_regions.Count() )
+		return straightLine;
+
+	// the path can stay inside the start region
+	float bestCost = ( startRegion == goalRegion ) ? straightLine : FLT_MAX;
+
+	++m_portalSearchMarker;
+
+	CUtlPriorityQueue< OpenPortal > openList( 0, 64, IsOpenPortalLessThan );
+	OpenPortal open;
+
+	const Region &start = m_regions[ startRegion ];
+	for( int e=start.firstEdge; e<start.firstEdge + start.edgeCount; ++e )
+	{
+		const Edge &edge = m_edges[e];
+		for( int p=edge.firstPortal; p<edge.firstPortal + edge.portalCount; ++p )
+		{
+			Portal &portal = m_portals[p];
+			portal.searchMarker = m_portalSearchMarker;
+			portal.costSoFar = ( portal.from->GetCenter() - startArea->GetCenter() ).Length() + portal.length;
+
+			open.portal = p;
+			open.totalCost = portal.costSoFar + ( goalCenter - portal.to->GetCenter() ).Length();
+			openList.Insert( open );
+		}
+	}
+
+	while( openList.Count() )
+	{
+		open = openList.ElementAtHead();
+		openList.RemoveAtHead();
+
+		// nothing left can beat the best route to the goal
+		if ( open.totalCost >= bestCost )
+			break;
+
+		Portal &portal = m_portals[ open.portal ];
+		if ( portal.closedMarker == m_portalSearchMarker )
+			continue;
+		portal.closedMarker = m_portalSearchMarker;
+
+		const Vector &entry = portal.to->GetCenter();
+		int region = portal.to->GetHierarchyRegion();
+
+		if ( region == goalRegion )
+		{
+			bestCost = MIN( bestCost, portal.costSoFar + ( goalCenter - entry ).Length() );
+		}
+
+		const Region &info = m_regions[ region ];
+		for( int e=info.firstEdge; e<info.firstEdge + info.edgeCount; ++e )
+		{
+			const Edge &edge = m_edges[e];
+			for( int p=edge.firstPortal; p<edge.firstPortal + edge.portalCount; ++p )
+			{
+				Portal &next = m_portals[p];
+				if ( next.closedMarker == m_portalSearchMarker )
+					continue;
+
+				float costSoFar = portal.costSoFar + ( next.from->GetCenter() - entry ).Length() + next.length;
+				if ( next.searchMarker == m_portalSearchMarker && next.costSoFar <= costSoFar )
+					continue;
+
+				next.searchMarker = m_portalSearchMarker;
+				next.costSoFar = costSoFar;
+
+				open.portal = p;
+				open.totalCost = costSoFar + ( goalCenter - next.to->GetCenter() ).Length();
+				openList.Insert( open );
+			}
+		}
+	}
+
+	// no route at all, the caller's search will find that out
+	if ( bestCost == FLT_MAX )
+		return straightLine;
+
+	return MAX( bestCost, straightLine );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+unsigned int CNavHierarchy::GetMemoryUsage( void ) const
+{
+	unsigned int size = sizeof( *this );
+	size += m_regions.Count() * sizeof( Region );
+	size += m_edges.Count() * sizeof( Edge );
+	size += m_portals.Count() * sizeof( Portal );
+
+	FOR_EACH_VEC( m_regions, it )
+	{
+		size += m_regions[ it ].incomingEdges.Count() * sizeof( int );
+	}
+
+	return size;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+CON_COMMAND_F( nav_hierarchy_report, "Prints the size of the Navigation Mesh hierarchy, building it if needed.", FCVAR_GAMEDLL | FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	if ( !TheNavHierarchy.IsBuilt() && TheNavAreas.Count() >= 2 )
+	{
+		// plan a trivial corridor to force the build
+		TheNavHierarchy.BuildCorridor( TheNavAreas[0], TheNavAreas[ TheNavAreas.Count()-1 ] );
+	}
+
+	Msg( "%d areas in %d regions, %d edges, %d portals, %u bytes\n", TheNavAreas.Count(), TheNavHierarchy.GetRegionCount(),
+		TheNavHierarchy.GetEdgeCount(), TheNavHierarchy.GetPortalCount(), TheNavHierarchy.GetMemoryUsage() );
+}
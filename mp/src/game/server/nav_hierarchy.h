@@ -0,0 +1,210 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose:
+//
+// $NoKeywords: $
+//===========================================================================//
+
+// Region-level abstraction of the navigation mesh, for hierarchical path finding
+
+#ifndef _NAV_HIERARCHY_H_
+#define _NAV_HIERARCHY_H_
+
+#include "nav_pathfind.h"
+
+extern ConVar nav_hierarchy;
+extern ConVar nav_hierarchy_max_detour;
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The navigation mesh clustered into regions of connected areas that share a Place.
+ * Regions are joined by directed edges, each made of the portals (area to area
+ * transitions) that cross between the two regions. A long trip is planned by an A*
+ * over the region graph first, and the area level search is then confined to the
+ * corridor of regions on that route.
+ * Edge costs account for blocked portals, and are updated incrementally whenever
+ * CNavMesh is told an area has become blocked or unblocked (func_nav_blocker, doors).
+ * Any change to the mesh topology resets the hierarchy, which is rebuilt on next use.
+ */
+class CNavHierarchy
+{
+public:
+	CNavHierarchy( void );
+
+	void Reset( void );										///< discard the hierarchy, it will be rebuilt when next needed
+	bool IsBuilt( void ) const				{ return m_isBuilt; }
+
+	void OnAreaBlockedChanged( CNavArea *area );			///< update the costs of the edges crossing the given area
+
+	/**
+	 * Plan a route over the region graph from startArea to goalArea, and mark the regions
+	 * along it as the current corridor. Returns false if the areas are too close together
+	 * to benefit from a corridor, or if the region graph has no route between them.
+	 */
+	bool BuildCorridor( CNavArea *startArea, CNavArea *goalArea, int teamID = TEAM_ANY );
+	bool IsInCorridor( const CNavArea *area ) const;
+
+	/**
+	 * The least a path from startArea to goalArea can cost, if every step costs at least the
+	 * distance between area centers. Searches the portals between regions, ignoring blocked areas.
+	 */
+	float ComputePathCostLowerBound( CNavArea *startArea, CNavArea *goalArea );
+
+	int GetRegionCount( void ) const		{ return m_regions.Count(); }
+	int GetEdgeCount( void ) const			{ return m_edges.Count(); }
+	int GetPortalCount( void ) const		{ return m_portals.Count(); }
+	unsigned int GetMemoryUsage( void ) const;
+
+private:
+	enum { NUM_BLOCK_SLOTS = MAX_NAV_TEAMS + 1 };			// one per team, plus TEAM_ANY
+
+	struct Portal
+	{
+		CNavArea *from;
+		CNavArea *to;
+		float cost;											// from the center of the source region to the center of the destination region
+		float length;										// of the step from 'from' to 'to' alone
+
+		// lower bound search state
+		unsigned int searchMarker;
+		unsigned int closedMarker;
+		float costSoFar;
+	};
+
+	struct Edge
+	{
+		int fromRegion;
+		int toRegion;
+		int firstPortal;
+		int portalCount;
+		float cost[ NUM_BLOCK_SLOTS ];						// cheapest open portal for each block slot, or -1 if all are blocked
+	};
+
+	struct Region
+	{
+		Vector center;										// average of the area centers
+		Place place;
+		int areaCount;
+		int firstEdge;										// outgoing edges are contiguous
+		int edgeCount;
+		CUtlVector< int > incomingEdges;
+
+		// search state
+		unsigned int searchMarker;
+		unsigned int closedMarker;
+		unsigned int corridorMarker;
+		float costSoFar;
+		int parentEdge;
+	};
+
+	void Build( void );
+	void BuildRegions( void );
+	void BuildEdges( void );
+	void UpdateEdgeCost( Edge *edge );
+	static int ComparePortals( const Portal *lhs, const Portal *rhs );
+
+	struct OpenRegion
+	{
+		int region;
+		float totalCost;
+	};
+	static bool IsOpenRegionLessThan( const OpenRegion &lhs, const OpenRegion &rhs );
+
+	struct OpenPortal
+	{
+		int portal;
+		float totalCost;
+	};
+	static bool IsOpenPortalLessThan( const OpenPortal &lhs, const OpenPortal &rhs );
+
+	bool m_isBuilt;
+	CUtlVector< Region > m_regions;
+	CUtlVector< Edge > m_edges;
+	CUtlVector< Portal > m_portals;
+
+	unsigned int m_searchMarker;
+	unsigned int m_portalSearchMarker;
+	unsigned int m_corridorMarker;
+	CUtlVector< int > m_corridor;							// regions on the current corridor, from start to goal
+};
+
+extern CNavHierarchy TheNavHierarchy;
+
+
+//--------------------------------------------------------------------------------------------------------------
+inline bool CNavHierarchy::IsInCorridor( const CNavArea *area ) const
+{
+	int region = area->GetHierarchyRegion();
+	return region >= 0 && region < m_regions.Count() && m_regions[ region ].corridorMarker == m_corridorMarker;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Cost functor adapter that treats every area outside the current corridor as a dead end
+ */
+template< typename CostFunctor >
+class NavCorridorCost
+{
+public:
+	NavCorridorCost( CostFunctor &costFunc ) : m_costFunc( costFunc ) { }
+
+	float operator() ( CNavArea *area, CNavArea *fromArea, const CNavLadder *ladder, const CFuncElevator *elevator, float length )
+	{
+		if ( !TheNavHierarchy.IsInCorridor( area ) )
+			return -1.0f;
+
+		return m_costFunc( area, fromArea, ladder, elevator, length );
+	}
+
+private:
+	CostFunctor &m_costFunc;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Find a path from startArea to goalArea like NavAreaBuildPath(), planning over the region
+ * graph first and then searching only the areas inside the resulting corridor.
+ * The corridor can miss the cheapest route, so a corridor path is only kept while it costs no more
+ * than nav_hierarchy_max_detour times a lower bound on the cheapest path. The straight line distance
+ * is tried first, and the portal search in ComputePathCostLowerBound() only when that isn't enough.
+ * Otherwise, or when the corridor can't be used or doesn't contain a path, the full search is run
+ * and its (optimal) result is used.
+ */
+template< typename CostFunctor >
+bool NavAreaBuildHierarchicalPath( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos, CostFunctor &costFunc, CNavArea **closestArea = NULL, int teamID = TEAM_ANY )
+{
+	VPROF_BUDGET( "NavAreaBuildHierarchicalPath", "NextBotSpiky" );
+
+	if ( nav_hierarchy.GetBool() && startArea && goalArea && !goalArea->IsBlocked( teamID ) && TheNavHierarchy.BuildCorridor( startArea, goalArea, teamID ) )
+	{
+		NavCorridorCost< CostFunctor > corridorCost( costFunc );
+		if ( NavAreaBuildPath( startArea, goalArea, goalPos, corridorCost, closestArea, 0.0f, teamID ) )
+		{
+			// path costs are at least the distance travelled, so this bounds how far off the best path we can be
+			float maxCost = nav_hierarchy_max_detour.GetFloat() * ( goalArea->GetCenter() - startArea->GetCenter() ).Length();
+			if ( goalArea->GetCostSoFar() <= maxCost )
+				return true;
+
+			// a winding route can be the best there is, which the straight line can't tell
+			maxCost = nav_hierarchy_max_detour.GetFloat() * TheNavHierarchy.ComputePathCostLowerBound( startArea, goalArea );
+			if ( goalArea->GetCostSoFar() <= maxCost )
+				return true;
+
+			// the corridor forced a long way around - search everything
+			VPROF_INCREMENT_COUNTER( "NavAreaBuildHierarchicalPath detour fallbacks", 1 );
+		}
+		else
+		{
+			// something inside a region is blocked - search everything
+			VPROF_INCREMENT_COUNTER( "NavAreaBuildHierarchicalPath blocked fallbacks", 1 );
+		}
+	}
+
+	return NavAreaBuildPath( startArea, goalArea, goalPos, costFunc, closestArea, 0.0f, teamID );
+}
+
+
+#endif // _NAV_HIERARCHY_H_
@@ -0,0 +1,825 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose:
+//
+// $NoKeywords: $
+//=============================================================================//
+
+// Position-independent binary image of a navigation mesh, for fast loading
+
+#include "cbase.h"
+#include "filesystem.h"
+#include "tier0/vprof.h"
+#include "tier1/checksum_crc.h"
+#include "tier1/utlhashtable.h"
+#include "nav_mesh.h"
+#include "nav_image.h"
+
+// NOTE: This has to be the last file included!
+#include "tier0/memdbgon.h"
+
+
+ConVar nav_image( "nav_image", "1", FCVAR_GAMEDLL, "If nonzero, the Navigation Mesh is loaded from its binary image when the image matches the nav file, and the image is rewritten whenever the mesh is saved." );
+
+extern char *GetBspFilename( const char *navFilename );
+
+typedef CUtlHashtable< const void *, uint32, PointerHashFunctor, PointerEqualFunctor > NavImageIndexMap;
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The image of a nav file lives next to it, with the extension "navc"
+ */
+static void GetNavImageFilename( const char *navFilename, char *imageFilename, int imageFilenameSize )
+{
+	V_strncpy( imageFilename, navFilename, imageFilenameSize );
+	V_SetExtension( imageFilename, ".navc", imageFilenameSize );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Append a lump to the image, keeping lumps 4 byte aligned
+ */
+static void PutNavImageLump( CUtlBuffer &image, NavImageHeader_t *header, NavImageLumpType type, const void *data, int count, int elementSize )
+{
+	while( image.TellPut() & 3 )
+	{
+		image.PutUnsignedChar( 0 );
+	}
+
+	header->lumps[ type ].offset = image.TellPut();
+	header->lumps[ type ].count = count;
+
+	if ( count )
+	{
+		image.Put( data, count * elementSize );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static uint32 GetNavImageIndex( const NavImageIndexMap &indexMap, const void *object )
+{
+	return object ? indexMap.Get( object, NAV_IMAGE_INVALID_INDEX ) : NAV_IMAGE_INVALID_INDEX;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Store a binary image of the Navigation Mesh next to the given nav file.
+ * Everything the nav file would compute at load time is stored resolved, with references as indices.
+ */
+bool CNavMesh::SaveNavImage( const char *navFilename ) const
+{
+	VPROF_BUDGET( "CNavMesh::SaveNavImage", "NextBot" );
+
+	if ( IsX360() )
+	{
+		// images are little-endian only
+		return false;
+	}
+
+	if ( GetSubVersionNumber() != 0 )
+	{
+		// derived areas may store custom data the image can't represent
+		DevMsg( "Navigation Mesh has custom area data, not writing an image.\n" );
+		return false;
+	}
+
+	char imageFilename[ MAX_PATH ];
+	GetNavImageFilename( navFilename, imageFilename, sizeof( imageFilename ) );
+
+	NavImageIndexMap indexMap;
+	int i;
+
+	// areas are stored in TheNavAreas order, which is also the order the visibility matrix is saved in
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		indexMap.Insert( TheNavAreas[ it ], it );
+	}
+
+	for( i=0; i<m_ladders.Count(); ++i )
+	{
+		indexMap.Insert( m_ladders[i], i );
+	}
+
+	// hiding spots are owned by areas, and stored in area order
+	CUtlVector< NavImageHidingSpot_t > hidingSpots;
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		const HidingSpotVector *spots = TheNavAreas[ it ]->GetHidingSpots();
+		FOR_EACH_VEC( (*spots), sit )
+		{
+			const HidingSpot *spot = (*spots)[ sit ];
+
+			indexMap.Insert( spot, hidingSpots.Count() );
+
+			NavImageHidingSpot_t &record = hidingSpots[ hidingSpots.AddToTail() ];
+			record.id = spot->GetID();
+			record.pos[0] = spot->GetPosition().x;
+			record.pos[1] = spot->GetPosition().y;
+			record.pos[2] = spot->GetPosition().z;
+			record.flags = spot->GetFlags();
+
+			// this is what HidingSpot::PostLoad() would find
+			record.area = GetNavImageIndex( indexMap, GetNavArea( spot->GetPosition() + Vector( 0, 0, HalfHumanHeight ) ) );
+		}
+	}
+
+	PlaceDirectory places;
+	CUtlVector< NavImageArea_t > areas;
+	CUtlVector< NavImageConnection_t > connections;
+	CUtlVector< NavImageEncounter_t > encounters;
+	CUtlVector< NavImageSpotOrder_t > encounterSpots;
+	CUtlVector< uint32 > ladderConnections;
+
+	areas.SetCount( TheNavAreas.Count() );
+
+	int hidingSpotIndex = 0;
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		const CNavArea *area = TheNavAreas[ it ];
+		NavImageArea_t &record = areas[ it ];
+		V_memset( &record, 0, sizeof( record ) );
+
+		record.id = area->m_id;
+		record.attributeFlags = area->m_attributeFlags;
+		V_memcpy( record.nwCorner, &area->m_nwCorner, sizeof( record.nwCorner ) );
+		V_memcpy( record.seCorner, &area->m_seCorner, sizeof( record.seCorner ) );
+		record.neZ = area->m_neZ;
+		record.swZ = area->m_swZ;
+
+		for( i=0; i<MAX_NAV_TEAMS; ++i )
+		{
+			record.earliestOccupyTime[i] = area->m_earliestOccupyTime[i];
+		}
+
+		for( i=0; i<NUM_CORNERS; ++i )
+		{
+			record.lightIntensity[i] = area->m_lightIntensity[i];
+		}
+
+		places.AddPlace( area->GetPlace() );
+		record.place = places.GetIndex( area->GetPlace() );
+		record.flags = area->IsUnderwater() ? NAV_IMAGE_AREA_UNDERWATER : 0;
+
+		record.firstConnection = connections.Count();
+		for( int d=0; d<NUM_DIRECTIONS; ++d )
+		{
+			FOR_EACH_VEC( area->m_connect[d], cit )
+			{
+				const CNavArea *adjArea = area->m_connect[d][ cit ].area;
+				uint32 index = GetNavImageIndex( indexMap, adjArea );
+
+				// don't allow self-referential connections
+				if ( index == NAV_IMAGE_INVALID_INDEX || adjArea == area )
+					continue;
+
+				NavImageConnection_t &connect = connections[ connections.AddToTail() ];
+				connect.area = index;
+				connect.length = ( adjArea->GetCenter() - area->GetCenter() ).Length();
+				++record.connectionCount[d];
+			}
+		}
+
+		record.firstHidingSpot = hidingSpotIndex;
+		record.hidingSpotCount = area->m_hidingSpots.Count();
+		hidingSpotIndex += record.hidingSpotCount;
+
+		record.firstEncounter = encounters.Count();
+		record.encounterCount = area->m_spotEncounters.Count();
+		FOR_EACH_VEC( area->m_spotEncounters, eit )
+		{
+			const SpotEncounter *e = area->m_spotEncounters[ eit ];
+
+			NavImageEncounter_t &encounter = encounters[ encounters.AddToTail() ];
+			encounter.fromArea = GetNavImageIndex( indexMap, e->from.area );
+			encounter.fromDir = e->fromDir;
+			encounter.toArea = GetNavImageIndex( indexMap, e->to.area );
+			encounter.toDir = e->toDir;
+
+			// store the path as CNavArea::PostLoad() would compute it
+			SpotEncounter resolved;
+			resolved.from = e->from;
+			resolved.fromDir = e->fromDir;
+			resolved.to = e->to;
+			resolved.toDir = e->toDir;
+			resolved.path = e->path;
+			if ( e->from.area && e->to.area )
+			{
+				area->ComputeEncounterPath( &resolved );
+			}
+			V_memcpy( encounter.pathFrom, &resolved.path.from, sizeof( encounter.pathFrom ) );
+			V_memcpy( encounter.pathTo, &resolved.path.to, sizeof( encounter.pathTo ) );
+
+			encounter.firstSpot = encounterSpots.Count();
+			encounter.spotCount = e->spots.Count();
+			FOR_EACH_VEC( e->spots, sit )
+			{
+				NavImageSpotOrder_t &order = encounterSpots[ encounterSpots.AddToTail() ];
+
+				// order->spot may be NULL if we've loaded a nav mesh that has been edited but not re-analyzed
+				order.hidingSpot = GetNavImageIndex( indexMap, e->spots[ sit ].spot );
+				order.t = e->spots[ sit ].t;
+			}
+		}
+
+		record.firstLadderConnection = ladderConnections.Count();
+		for( int d=0; d<CNavLadder::NUM_LADDER_DIRECTIONS; ++d )
+		{
+			FOR_EACH_VEC( area->m_ladder[d], lit )
+			{
+				uint32 index = GetNavImageIndex( indexMap, area->m_ladder[d][ lit ].ladder );
+				if ( index == NAV_IMAGE_INVALID_INDEX )
+					continue;
+
+				ladderConnections.AddToTail( index );
+				++record.ladderConnectionCount[d];
+			}
+		}
+	}
+
+	Assert( hidingSpotIndex == hidingSpots.Count() );
+
+	CUtlVector< NavImageLadder_t > ladders;
+	ladders.SetCount( m_ladders.Count() );
+	for( i=0; i<m_ladders.Count(); ++i )
+	{
+		const CNavLadder *ladder = m_ladders[i];
+		NavImageLadder_t &record = ladders[i];
+
+		record.id = ladder->GetID();
+		record.width = ladder->m_width;
+		V_memcpy( record.top, &ladder->m_top, sizeof( record.top ) );
+		V_memcpy( record.bottom, &ladder->m_bottom, sizeof( record.bottom ) );
+		record.length = ladder->m_length;
+		record.dir = ladder->GetDir();
+		record.topForwardArea = GetNavImageIndex( indexMap, ladder->m_topForwardArea );
+		record.topLeftArea = GetNavImageIndex( indexMap, ladder->m_topLeftArea );
+		record.topRightArea = GetNavImageIndex( indexMap, ladder->m_topRightArea );
+		record.topBehindArea = GetNavImageIndex( indexMap, ladder->m_topBehindArea );
+		record.bottomArea = GetNavImageIndex( indexMap, ladder->m_bottomArea );
+	}
+
+	const CUtlVector< Place > *placeVector = places.GetPlaces();
+	CUtlVector< NavImagePlace_t > placeNames;
+	placeNames.SetCount( placeVector->Count() );
+	for( i=0; i<placeVector->Count(); ++i )
+	{
+		V_memset( placeNames[i].name, 0, sizeof( placeNames[i].name ) );
+		V_strncpy( placeNames[i].name, PlaceToName( placeVector->Element(i) ), sizeof( placeNames[i].name ) );
+	}
+
+	CUtlBuffer visibility, customPreArea, custom;
+	TheNavVisibility.Save( visibility );
+	SaveCustomDataPreArea( customPreArea );
+	SaveCustomData( custom );
+
+	//
+	// Lay out the image
+	//
+	NavImageHeader_t header;
+	V_memset( &header, 0, sizeof( header ) );
+
+	CUtlBuffer image( 4096, 1024*1024 );
+	image.Put( &header, sizeof( header ) );
+
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_AREAS, areas.Base(), areas.Count(), sizeof( NavImageArea_t ) );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_CONNECTIONS, connections.Base(), connections.Count(), sizeof( NavImageConnection_t ) );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_HIDING_SPOTS, hidingSpots.Base(), hidingSpots.Count(), sizeof( NavImageHidingSpot_t ) );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_ENCOUNTERS, encounters.Base(), encounters.Count(), sizeof( NavImageEncounter_t ) );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_ENCOUNTER_SPOTS, encounterSpots.Base(), encounterSpots.Count(), sizeof( NavImageSpotOrder_t ) );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_LADDER_CONNECTIONS, ladderConnections.Base(), ladderConnections.Count(), sizeof( uint32 ) );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_LADDERS, ladders.Base(), ladders.Count(), sizeof( NavImageLadder_t ) );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_PLACES, placeNames.Base(), placeNames.Count(), sizeof( NavImagePlace_t ) );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_VISIBILITY, visibility.Base(), visibility.TellPut(), 1 );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_CUSTOM_PRE_AREA, customPreArea.Base(), customPreArea.TellPut(), 1 );
+	PutNavImageLump( image, &header, NAV_IMAGE_LUMP_CUSTOM, custom.Base(), custom.TellPut(), 1 );
+
+	header.magic = NAV_IMAGE_MAGIC_NUMBER;
+	header.version = NavImageVersion;
+	header.navVersion = NavCurrentVersion;
+	header.subVersion = GetSubVersionNumber();
+	header.bspSize = filesystem->Size( GetBspFilename( navFilename ) );
+	header.navSize = filesystem->Size( navFilename );
+	header.imageSize = image.TellPut();
+	header.crc = CRC32_ProcessSingleBuffer( (unsigned char *)image.Base() + sizeof( header ), header.imageSize - sizeof( header ) );
+	header.flags = ( m_isAnalyzed ? NAV_IMAGE_ANALYZED : 0 ) | ( places.HasUnnamedPlaces() ? NAV_IMAGE_UNNAMED_AREAS : 0 );
+
+	V_memcpy( image.Base(), &header, sizeof( header ) );
+
+	if ( !filesystem->WriteFile( imageFilename, "MOD", image ) )
+	{
+		Warning( "Unable to save %d bytes to %s\n", image.Size(), imageFilename );
+		return false;
+	}
+
+	DevMsg( "Size of nav image '%s' is %u bytes.\n", imageFilename, header.imageSize );
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return a pointer to the records of the given lump, or NULL if the lump does not fit in the image
+ */
+static const void *GetNavImageLump( const byte *image, const NavImageHeader_t *header, NavImageLumpType type, int elementSize )
+{
+	const NavImageLump_t &lump = header->lumps[ type ];
+
+	if ( lump.offset & 3 || lump.offset < sizeof( NavImageHeader_t ) || lump.offset > header->imageSize )
+		return NULL;
+
+	if ( lump.count > ( header->imageSize - lump.offset ) / elementSize )
+		return NULL;
+
+	return image + lump.offset;
+}
+
+#define NAV_IMAGE_RANGE_IS_VALID( first, count, total ) ( (first) <= (total) && (count) <= (total) - (first) )
+#define NAV_IMAGE_REF_IS_VALID( index, total ) ( (index) == NAV_IMAGE_INVALID_INDEX || (index) < (total) )
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The pointers into a validated image
+ */
+struct NavImage_t
+{
+	const NavImageHeader_t *header;
+	const NavImageArea_t *areas;
+	const NavImageConnection_t *connections;
+	const NavImageHidingSpot_t *hidingSpots;
+	const NavImageEncounter_t *encounters;
+	const NavImageSpotOrder_t *encounterSpots;
+	const uint32 *ladderConnections;
+	const NavImageLadder_t *ladders;
+	const NavImagePlace_t *places;
+	const byte *visibility;
+	const byte *customPreArea;
+	const byte *custom;
+
+	uint32 Count( NavImageLumpType type ) const	{ return header->lumps[ type ].count; }
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Check that every lump fits in the image and every reference is in range, so the
+ * image can be used without further checks. This is the only pass over the data before it is used.
+ */
+static bool ValidateNavImage( const byte *image, unsigned int imageSize, NavImage_t *nav )
+{
+	if ( imageSize < sizeof( NavImageHeader_t ) )
+		return false;
+
+	const NavImageHeader_t *header = (const NavImageHeader_t *)image;
+	if ( header->magic != NAV_IMAGE_MAGIC_NUMBER || header->version != NavImageVersion || header->imageSize != imageSize )
+		return false;
+
+	if ( header->crc != CRC32_ProcessSingleBuffer( image + sizeof( NavImageHeader_t ), imageSize - sizeof( NavImageHeader_t ) ) )
+		return false;
+
+	nav->header = header;
+	nav->areas = (const NavImageArea_t *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_AREAS, sizeof( NavImageArea_t ) );
+	nav->connections = (const NavImageConnection_t *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_CONNECTIONS, sizeof( NavImageConnection_t ) );
+	nav->hidingSpots = (const NavImageHidingSpot_t *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_HIDING_SPOTS, sizeof( NavImageHidingSpot_t ) );
+	nav->encounters = (const NavImageEncounter_t *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_ENCOUNTERS, sizeof( NavImageEncounter_t ) );
+	nav->encounterSpots = (const NavImageSpotOrder_t *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_ENCOUNTER_SPOTS, sizeof( NavImageSpotOrder_t ) );
+	nav->ladderConnections = (const uint32 *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_LADDER_CONNECTIONS, sizeof( uint32 ) );
+	nav->ladders = (const NavImageLadder_t *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_LADDERS, sizeof( NavImageLadder_t ) );
+	nav->places = (const NavImagePlace_t *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_PLACES, sizeof( NavImagePlace_t ) );
+	nav->visibility = (const byte *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_VISIBILITY, 1 );
+	nav->customPreArea = (const byte *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_CUSTOM_PRE_AREA, 1 );
+	nav->custom = (const byte *)GetNavImageLump( image, header, NAV_IMAGE_LUMP_CUSTOM, 1 );
+
+	if ( !nav->areas || !nav->connections || !nav->hidingSpots || !nav->encounters || !nav->encounterSpots ||
+		 !nav->ladderConnections || !nav->ladders || !nav->places || !nav->visibility || !nav->customPreArea || !nav->custom )
+		return false;
+
+	uint32 areaCount = nav->Count( NAV_IMAGE_LUMP_AREAS );
+	uint32 hidingSpotCount = nav->Count( NAV_IMAGE_LUMP_HIDING_SPOTS );
+	uint32 ladderCount = nav->Count( NAV_IMAGE_LUMP_LADDERS );
+
+	if ( areaCount == 0 )
+		return false;
+
+	uint32 i, j;
+	for( i=0; i<areaCount; ++i )
+	{
+		const NavImageArea_t &area = nav->areas[i];
+
+		uint32 count = 0;
+		for( j=0; j<NUM_DIRECTIONS; ++j )
+		{
+			if ( area.connectionCount[j] > nav->Count( NAV_IMAGE_LUMP_CONNECTIONS ) )
+				return false;
+			count += area.connectionCount[j];
+		}
+
+		if ( !NAV_IMAGE_RANGE_IS_VALID( area.firstConnection, count, nav->Count( NAV_IMAGE_LUMP_CONNECTIONS ) ) )
+			return false;
+
+		for( j=0; j<count; ++j )
+		{
+			if ( nav->connections[ area.firstConnection + j ].area >= areaCount )
+				return false;
+		}
+
+		count = 0;
+		for( j=0; j<CNavLadder::NUM_LADDER_DIRECTIONS; ++j )
+		{
+			if ( area.ladderConnectionCount[j] > nav->Count( NAV_IMAGE_LUMP_LADDER_CONNECTIONS ) )
+				return false;
+			count += area.ladderConnectionCount[j];
+		}
+
+		if ( !NAV_IMAGE_RANGE_IS_VALID( area.firstLadderConnection, count, nav->Count( NAV_IMAGE_LUMP_LADDER_CONNECTIONS ) ) )
+			return false;
+
+		for( j=0; j<count; ++j )
+		{
+			if ( nav->ladderConnections[ area.firstLadderConnection + j ] >= ladderCount )
+				return false;
+		}
+
+		if ( !NAV_IMAGE_RANGE_IS_VALID( area.firstHidingSpot, area.hidingSpotCount, hidingSpotCount ) ||
+			 !NAV_IMAGE_RANGE_IS_VALID( area.firstEncounter, area.encounterCount, nav->Count( NAV_IMAGE_LUMP_ENCOUNTERS ) ) ||
+			 area.place > nav->Count( NAV_IMAGE_LUMP_PLACES ) )
+			return false;
+	}
+
+	for( i=0; i<hidingSpotCount; ++i )
+	{
+		if ( !NAV_IMAGE_REF_IS_VALID( nav->hidingSpots[i].area, areaCount ) )
+			return false;
+	}
+
+	for( i=0; i<nav->Count( NAV_IMAGE_LUMP_ENCOUNTERS ); ++i )
+	{
+		const NavImageEncounter_t &encounter = nav->encounters[i];
+
+		if ( !NAV_IMAGE_REF_IS_VALID( encounter.fromArea, areaCount ) || !NAV_IMAGE_REF_IS_VALID( encounter.toArea, areaCount ) ||
+			 encounter.fromDir >= NUM_DIRECTIONS || encounter.toDir >= NUM_DIRECTIONS ||
+			 !NAV_IMAGE_RANGE_IS_VALID( encounter.firstSpot, encounter.spotCount, nav->Count( NAV_IMAGE_LUMP_ENCOUNTER_SPOTS ) ) )
+			return false;
+	}
+
+	for( i=0; i<nav->Count( NAV_IMAGE_LUMP_ENCOUNTER_SPOTS ); ++i )
+	{
+		if ( !NAV_IMAGE_REF_IS_VALID( nav->encounterSpots[i].hidingSpot, hidingSpotCount ) )
+			return false;
+	}
+
+	for( i=0; i<ladderCount; ++i )
+	{
+		const NavImageLadder_t &ladder = nav->ladders[i];
+
+		if ( ladder.dir >= NUM_DIRECTIONS ||
+			 !NAV_IMAGE_REF_IS_VALID( ladder.topForwardArea, areaCount ) ||
+			 !NAV_IMAGE_REF_IS_VALID( ladder.topLeftArea, areaCount ) ||
+			 !NAV_IMAGE_REF_IS_VALID( ladder.topRightArea, areaCount ) ||
+			 !NAV_IMAGE_REF_IS_VALID( ladder.topBehindArea, areaCount ) ||
+			 !NAV_IMAGE_REF_IS_VALID( ladder.bottomArea, areaCount ) )
+			return false;
+	}
+
+	for( i=0; i<nav->Count( NAV_IMAGE_LUMP_PLACES ); ++i )
+	{
+		if ( nav->places[i].name[ NAV_IMAGE_PLACE_NAME_LENGTH-1 ] != '\0' )
+			return false;
+	}
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+template < typename T >
+static T *GetNavImageObject( const CUtlVector< T * > &objects, uint32 index )
+{
+	return ( index == NAV_IMAGE_INVALID_INDEX ) ? NULL : objects[ index ];
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Load the Navigation Mesh from the binary image of the given nav file.
+ * Returns an error without touching the mesh if the image is missing, stale or invalid,
+ * so the caller can fall back to the nav file. On success, areas are fully bound and
+ * only the mesh-wide part of PostLoad() remains to be done.
+ */
+NavErrorType CNavMesh::LoadNavImage( const char *navFilename )
+{
+	VPROF_BUDGET( "CNavMesh::LoadNavImage", "NextBot" );
+
+	if ( IsX360() || GetSubVersionNumber() != 0 )
+		return NAV_BAD_FILE_VERSION;
+
+	char imageFilename[ MAX_PATH ];
+	GetNavImageFilename( navFilename, imageFilename, sizeof( imageFilename ) );
+
+	if ( !filesystem->FileExists( imageFilename, "MOD" ) )
+		return NAV_CANT_ACCESS_FILE;
+
+	// the image must have been written from the current nav file
+	if ( filesystem->GetFileTime( imageFilename, "MOD" ) < filesystem->GetFileTime( navFilename, "MOD" ) )
+		return NAV_FILE_OUT_OF_DATE;
+
+	void *buffer = NULL;
+	int imageSize = filesystem->ReadFileEx( imageFilename, "MOD", &buffer, false, true );
+	if ( imageSize <= 0 || !buffer )
+		return NAV_CANT_ACCESS_FILE;
+
+	NavImage_t nav;
+	if ( !ValidateNavImage( (const byte *)buffer, imageSize, &nav ) )
+	{
+		DevWarning( "Navigation image '%s' is invalid, loading the nav file instead.\n", imageFilename );
+		filesystem->FreeOptimalReadBuffer( buffer );
+		return NAV_INVALID_FILE;
+	}
+
+	const char *bspFilename = GetBspFilename( navFilename );
+	if ( nav.header->navVersion != (uint32)NavCurrentVersion ||
+		 nav.header->navSize != filesystem->Size( navFilename, "MOD" ) ||
+		 !bspFilename || nav.header->bspSize != filesystem->Size( bspFilename ) )
+	{
+		// let the nav file decide if it is out of date with the map
+		filesystem->FreeOptimalReadBuffer( buffer );
+		return NAV_FILE_OUT_OF_DATE;
+	}
+
+	m_isAnalyzed = ( nav.header->flags & NAV_IMAGE_ANALYZED ) != 0;
+
+	uint32 i;
+	int d;
+
+	// the place directory, with zero meaning no place
+	CUtlVector< Place > places;
+	places.AddToTail( UNDEFINED_PLACE );
+	for( i=0; i<nav.Count( NAV_IMAGE_LUMP_PLACES ); ++i )
+	{
+		Place place = NameToPlace( nav.places[i].name );
+		if ( place == UNDEFINED_PLACE )
+		{
+			Warning( "Warning: NavMesh place %s is undefined?\n", nav.places[i].name );
+		}
+		placeDirectory.AddPlace( place );
+		places.AddToTail( place );
+	}
+
+	if ( nav.header->flags & NAV_IMAGE_UNNAMED_AREAS )
+	{
+		placeDirectory.AddPlace( UNDEFINED_PLACE );
+	}
+
+	CUtlBuffer customPreArea( nav.customPreArea, nav.Count( NAV_IMAGE_LUMP_CUSTOM_PRE_AREA ), CUtlBuffer::READ_ONLY );
+	LoadCustomDataPreArea( customPreArea, nav.header->subVersion );
+
+	//
+	// Create the objects first, so references can be bound by index
+	//
+	uint32 areaCount = nav.Count( NAV_IMAGE_LUMP_AREAS );
+	CUtlVector< CNavArea * > areas;
+	areas.SetCount( areaCount );
+
+	Extent extent;
+	extent.lo.x = 9999999999.9f;
+	extent.lo.y = 9999999999.9f;
+	extent.hi.x = -9999999999.9f;
+	extent.hi.y = -9999999999.9f;
+
+	TheNavMesh->PreLoadAreas( areaCount );
+	TheNavAreas.EnsureCapacity( areaCount );
+	for( i=0; i<areaCount; ++i )
+	{
+		const NavImageArea_t &record = nav.areas[i];
+		CNavArea *area = TheNavMesh->CreateArea();
+		areas[i] = area;
+
+		area->m_id = record.id;
+		if ( area->m_id >= CNavArea::m_nextID )
+			CNavArea::m_nextID = area->m_id+1;
+
+		area->m_attributeFlags = record.attributeFlags;
+		area->m_nwCorner.Init( record.nwCorner[0], record.nwCorner[1], record.nwCorner[2] );
+		area->m_seCorner.Init( record.seCorner[0], record.seCorner[1], record.seCorner[2] );
+		area->m_center = ( area->m_nwCorner + area->m_seCorner ) / 2.0f;
+
+		if ( ( area->m_seCorner.x - area->m_nwCorner.x ) > 0.0f && ( area->m_seCorner.y - area->m_nwCorner.y ) > 0.0f )
+		{
+			area->m_invDxCorners = 1.0f / ( area->m_seCorner.x - area->m_nwCorner.x );
+			area->m_invDyCorners = 1.0f / ( area->m_seCorner.y - area->m_nwCorner.y );
+		}
+		else
+		{
+			area->m_invDxCorners = area->m_invDyCorners = 0;
+		}
+
+		area->m_neZ = record.neZ;
+		area->m_swZ = record.swZ;
+		area->m_isUnderwater = ( record.flags & NAV_IMAGE_AREA_UNDERWATER ) != 0;
+
+		for( d=0; d<MAX_NAV_TEAMS; ++d )
+		{
+			area->m_earliestOccupyTime[d] = record.earliestOccupyTime[d];
+		}
+
+		for( d=0; d<NUM_CORNERS; ++d )
+		{
+			area->m_lightIntensity[d] = record.lightIntensity[d];
+		}
+
+		area->SetPlace( places[ record.place ] );
+
+		TheNavAreas.AddToTail( area );
+
+		Extent areaExtent;
+		area->GetExtent( &areaExtent );
+
+		if (areaExtent.lo.x < extent.lo.x)
+			extent.lo.x = areaExtent.lo.x;
+		if (areaExtent.lo.y < extent.lo.y)
+			extent.lo.y = areaExtent.lo.y;
+		if (areaExtent.hi.x > extent.hi.x)
+			extent.hi.x = areaExtent.hi.x;
+		if (areaExtent.hi.y > extent.hi.y)
+			extent.hi.y = areaExtent.hi.y;
+	}
+
+	uint32 hidingSpotCount = nav.Count( NAV_IMAGE_LUMP_HIDING_SPOTS );
+	CUtlVector< HidingSpot * > hidingSpots;
+	hidingSpots.SetCount( hidingSpotCount );
+	for( i=0; i<hidingSpotCount; ++i )
+	{
+		const NavImageHidingSpot_t &record = nav.hidingSpots[i];
+		HidingSpot *spot = TheNavMesh->CreateHidingSpot();
+		hidingSpots[i] = spot;
+
+		spot->m_id = record.id;
+		spot->m_pos.Init( record.pos[0], record.pos[1], record.pos[2] );
+		spot->m_flags = (unsigned char)record.flags;
+		spot->m_area = GetNavImageObject( areas, record.area );
+
+		if ( spot->m_id >= HidingSpot::m_nextID )
+			HidingSpot::m_nextID = spot->m_id+1;
+	}
+
+	uint32 ladderCount = nav.Count( NAV_IMAGE_LUMP_LADDERS );
+	CUtlVector< CNavLadder * > ladders;
+	ladders.SetCount( ladderCount );
+	m_ladders.EnsureCapacity( ladderCount );
+	for( i=0; i<ladderCount; ++i )
+	{
+		const NavImageLadder_t &record = nav.ladders[i];
+		CNavLadder *ladder = new CNavLadder;
+		ladders[i] = ladder;
+
+		ladder->m_id = record.id;
+		if ( ladder->m_id >= CNavLadder::m_nextID )
+			CNavLadder::m_nextID = ladder->m_id+1;
+
+		ladder->m_width = record.width;
+		ladder->m_top.Init( record.top[0], record.top[1], record.top[2] );
+		ladder->m_bottom.Init( record.bottom[0], record.bottom[1], record.bottom[2] );
+		ladder->m_length = record.length;
+		ladder->SetDir( (NavDirType)record.dir );
+		ladder->m_topForwardArea = GetNavImageObject( areas, record.topForwardArea );
+		ladder->m_topLeftArea = GetNavImageObject( areas, record.topLeftArea );
+		ladder->m_topRightArea = GetNavImageObject( areas, record.topRightArea );
+		ladder->m_topBehindArea = GetNavImageObject( areas, record.topBehindArea );
+		ladder->m_bottomArea = GetNavImageObject( areas, record.bottomArea );
+		ladder->FindLadderEntity();
+
+		m_ladders.AddToTail( ladder );
+	}
+
+	//
+	// Bind the per-area references
+	//
+	for( i=0; i<areaCount; ++i )
+	{
+		const NavImageArea_t &record = nav.areas[i];
+		CNavArea *area = areas[i];
+
+		const NavImageConnection_t *connection = &nav.connections[ record.firstConnection ];
+		for( d=0; d<NUM_DIRECTIONS; ++d )
+		{
+			area->m_connect[d].EnsureCapacity( record.connectionCount[d] );
+			for( uint32 c=0; c<record.connectionCount[d]; ++c, ++connection )
+			{
+				NavConnect connect;
+				connect.area = areas[ connection->area ];
+				connect.length = connection->length;
+				area->m_connect[d].AddToTail( connect );
+			}
+		}
+
+		const uint32 *ladderConnection = &nav.ladderConnections[ record.firstLadderConnection ];
+		for( d=0; d<CNavLadder::NUM_LADDER_DIRECTIONS; ++d )
+		{
+			area->m_ladder[d].EnsureCapacity( record.ladderConnectionCount[d] );
+			for( uint32 c=0; c<record.ladderConnectionCount[d]; ++c, ++ladderConnection )
+			{
+				NavLadderConnect connect;
+				connect.ladder = ladders[ *ladderConnection ];
+				area->m_ladder[d].AddToTail( connect );
+			}
+		}
+
+		area->m_hidingSpots.EnsureCapacity( record.hidingSpotCount );
+		for( uint32 h=0; h<record.hidingSpotCount; ++h )
+		{
+			area->m_hidingSpots.AddToTail( hidingSpots[ record.firstHidingSpot + h ] );
+		}
+
+		for( uint32 e=0; e<record.encounterCount; ++e )
+		{
+			const NavImageEncounter_t &encounterRecord = nav.encounters[ record.firstEncounter + e ];
+			SpotEncounter *encounter = new SpotEncounter;
+
+			encounter->from.area = GetNavImageObject( areas, encounterRecord.fromArea );
+			encounter->fromDir = (NavDirType)encounterRecord.fromDir;
+			encounter->to.area = GetNavImageObject( areas, encounterRecord.toArea );
+			encounter->toDir = (NavDirType)encounterRecord.toDir;
+			encounter->path.from.Init( encounterRecord.pathFrom[0], encounterRecord.pathFrom[1], encounterRecord.pathFrom[2] );
+			encounter->path.to.Init( encounterRecord.pathTo[0], encounterRecord.pathTo[1], encounterRecord.pathTo[2] );
+
+			encounter->spots.EnsureCapacity( encounterRecord.spotCount );
+			for( uint32 s=0; s<encounterRecord.spotCount; ++s )
+			{
+				const NavImageSpotOrder_t &orderRecord = nav.encounterSpots[ encounterRecord.firstSpot + s ];
+
+				SpotOrder order;
+				order.spot = GetNavImageObject( hidingSpots, orderRecord.hidingSpot );
+				order.t = orderRecord.t;
+				encounter->spots.AddToTail( order );
+			}
+
+			area->m_spotEncounters.AddToTail( encounter );
+		}
+
+		// func avoid/prefer attributes are controlled by func_nav_cost entities
+		area->ClearAllNavCostEntities();
+	}
+
+	// add the areas to the grid
+	AllocateGrid( extent.lo.x, extent.hi.x, extent.lo.y, extent.hi.y );
+
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		AddNavArea( TheNavAreas[ it ] );
+	}
+
+	// mark stairways (TODO: this can be removed once all maps are re-saved with this attribute in them)
+	MarkStairAreas();
+
+	CUtlBuffer custom( nav.custom, nav.Count( NAV_IMAGE_LUMP_CUSTOM ), CUtlBuffer::READ_ONLY );
+	LoadCustomData( custom, nav.header->subVersion );
+
+	CUtlBuffer visibility( nav.visibility, nav.Count( NAV_IMAGE_LUMP_VISIBILITY ), CUtlBuffer::READ_ONLY );
+	if ( !TheNavVisibility.Load( visibility ) )
+	{
+		m_isAnalyzed = false;
+	}
+
+	filesystem->FreeOptimalReadBuffer( buffer );
+
+	m_isBoundFromImage = true;
+
+	DevMsg( "Loaded Navigation Mesh from image '%s'.\n", imageFilename );
+
+	return NAV_OK;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Write the binary image of the current map's nav file, converting it for fast loading
+ */
+CON_COMMAND_F( nav_convert_image, "Writes a binary image of the current map's Navigation Mesh, for fast loading.", FCVAR_GAMEDLL | FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	if ( !TheNavMesh->IsLoaded() )
+	{
+		Warning( "No Navigation Mesh is loaded.\n" );
+		return;
+	}
+
+	char navFilename[ MAX_PATH ];
+	V_strncpy( navFilename, TheNavMesh->GetFilename(), sizeof( navFilename ) );
+	V_FixSlashes( navFilename );
+
+	if ( TheNavMesh->SaveNavImage( navFilename ) )
+	{
+		Msg( "Navigation Mesh image written for '%s'.\n", navFilename );
+	}
+	else
+	{
+		Warning( "Unable to write the Navigation Mesh image for '%s'.\n", navFilename );
+	}
+}
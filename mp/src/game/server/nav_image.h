@@ -0,0 +1,153 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose:
+//
+// $NoKeywords: $
+//===========================================================================//
+
+// Position-independent binary image of a navigation mesh
+//
+// The image is a header followed by lumps of fixed-size little-endian records. Records refer to
+// each other by index into their lump instead of by ID or pointer, so once the image has been
+// read and validated it is used in place, without a parse or any ID lookups.
+// Images are written alongside the .nav file and are only used while they match it.
+
+#ifndef _NAV_IMAGE_H_
+#define _NAV_IMAGE_H_
+
+#include "nav_area.h"
+
+#define NAV_IMAGE_MAGIC_NUMBER 0xFEEDF00D			// to help identify nav image files
+#define NAV_IMAGE_INVALID_INDEX 0xFFFFFFFF			// a reference to nothing
+#define NAV_IMAGE_PLACE_NAME_LENGTH 64
+
+/// The current version of the nav image format. Images of any other version are ignored.
+const unsigned int NavImageVersion = 1;
+
+extern const int NavCurrentVersion;					// defined in nav_file.cpp - images are only used by the nav version that wrote them
+
+enum NavImageLumpType
+{
+	NAV_IMAGE_LUMP_AREAS,							// NavImageArea_t
+	NAV_IMAGE_LUMP_CONNECTIONS,						// NavImageConnection_t, referenced by areas
+	NAV_IMAGE_LUMP_HIDING_SPOTS,					// NavImageHidingSpot_t, referenced by areas
+	NAV_IMAGE_LUMP_ENCOUNTERS,						// NavImageEncounter_t, referenced by areas
+	NAV_IMAGE_LUMP_ENCOUNTER_SPOTS,					// NavImageSpotOrder_t, referenced by encounters
+	NAV_IMAGE_LUMP_LADDER_CONNECTIONS,				// uint32 ladder indices, referenced by areas
+	NAV_IMAGE_LUMP_LADDERS,							// NavImageLadder_t
+	NAV_IMAGE_LUMP_PLACES,							// NavImagePlace_t, the place directory
+	NAV_IMAGE_LUMP_VISIBILITY,						// bytes, CNavVisibilityMatrix::Save()
+	NAV_IMAGE_LUMP_CUSTOM_PRE_AREA,					// bytes, CNavMesh::SaveCustomDataPreArea()
+	NAV_IMAGE_LUMP_CUSTOM,							// bytes, CNavMesh::SaveCustomData()
+
+	NAV_IMAGE_LUMP_COUNT
+};
+
+enum NavImageHeaderFlags
+{
+	NAV_IMAGE_ANALYZED			= 0x01,				// the mesh has been analyzed
+	NAV_IMAGE_UNNAMED_AREAS		= 0x02,				// some areas have no place
+};
+
+enum NavImageAreaFlags
+{
+	NAV_IMAGE_AREA_UNDERWATER	= 0x01,				// CNavArea::IsUnderwater()
+};
+
+struct NavImageLump_t
+{
+	uint32 offset;									// from the start of the image, 4 byte aligned
+	uint32 count;									// number of records, or bytes for byte lumps
+};
+
+struct NavImageHeader_t
+{
+	uint32 magic;
+	uint32 version;									// NavImageVersion
+	uint32 navVersion;								// NavCurrentVersion of the mesh this was written from
+	uint32 subVersion;								// CNavMesh::GetSubVersionNumber()
+	uint32 bspSize;									// size of the map, as stored in the .nav file
+	uint32 navSize;									// size of the .nav file this image was written with
+	uint32 imageSize;								// size of the whole image, including this header
+	uint32 crc;										// CRC32 of everything after this header
+	uint32 flags;									// NavImageHeaderFlags
+	NavImageLump_t lumps[ NAV_IMAGE_LUMP_COUNT ];
+};
+
+struct NavImageArea_t
+{
+	uint32 id;
+	int32 attributeFlags;
+	float nwCorner[3];
+	float seCorner[3];
+	float neZ;
+	float swZ;
+	float earliestOccupyTime[ MAX_NAV_TEAMS ];
+	float lightIntensity[ NUM_CORNERS ];
+	uint32 place;									// index into the place directory, or zero for no place
+	uint32 flags;									// NavImageAreaFlags
+
+	uint32 firstConnection;							// connections for each direction follow each other
+	uint32 connectionCount[ NUM_DIRECTIONS ];
+	uint32 firstHidingSpot;
+	uint32 hidingSpotCount;
+	uint32 firstEncounter;
+	uint32 encounterCount;
+	uint32 firstLadderConnection;					// ladder connections for each direction follow each other
+	uint32 ladderConnectionCount[ CNavLadder::NUM_LADDER_DIRECTIONS ];
+};
+
+struct NavImageConnection_t
+{
+	uint32 area;
+	float length;
+};
+
+struct NavImageHidingSpot_t
+{
+	uint32 id;
+	float pos[3];
+	uint32 flags;
+	uint32 area;									// the area containing the spot, which may not be the one that owns it
+};
+
+struct NavImageEncounter_t
+{
+	uint32 fromArea;
+	uint32 fromDir;
+	uint32 toArea;
+	uint32 toDir;
+	float pathFrom[3];
+	float pathTo[3];
+	uint32 firstSpot;
+	uint32 spotCount;
+};
+
+struct NavImageSpotOrder_t
+{
+	uint32 hidingSpot;								// index into the hiding spot lump, or NAV_IMAGE_INVALID_INDEX
+	float t;
+};
+
+struct NavImageLadder_t
+{
+	uint32 id;
+	float width;
+	float top[3];
+	float bottom[3];
+	float length;
+	uint32 dir;
+	uint32 topForwardArea;
+	uint32 topLeftArea;
+	uint32 topRightArea;
+	uint32 topBehindArea;
+	uint32 bottomArea;
+};
+
+struct NavImagePlace_t
+{
+	char name[ NAV_IMAGE_PLACE_NAME_LENGTH ];
+};
+
+
+#endif // _NAV_IMAGE_H_
@@ -93,6 +93,8 @@ public:
 	CBaseEntity *GetLadderEntity( void ) const;
 
 private:
+	friend class CNavMesh;										///< nav images are loaded directly into ladders
+
 	void FindLadderEntity( void );
 
 	EHANDLE m_ladderEntity;
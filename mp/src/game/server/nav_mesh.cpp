@@ -13,6 +13,7 @@
 #include "filesystem.h"
 #include "nav_mesh.h"
 #include "nav_node.h"
+#include "nav_hierarchy.h"
 #include "fmtstr.h"
 #include "utlbuffer.h"
 #include "tier0/vprof.h"
@@ -45,7 +46,6 @@ ConVar nav_show_player_counts( "nav_show_player_counts", "0", FCVAR_GAMEDLL | FC
 ConVar nav_show_func_nav_avoid( "nav_show_func_nav_avoid", "0", FCVAR_GAMEDLL | FCVAR_CHEAT, "Show areas of designer-placed bot avoidance due to func_nav_avoid entities" );
 ConVar nav_show_func_nav_prefer( "nav_show_func_nav_prefer", "0", FCVAR_GAMEDLL | FCVAR_CHEAT, "Show areas of designer-placed bot preference due to func_nav_prefer entities" );
 ConVar nav_show_func_nav_prerequisite( "nav_show_func_nav_prerequisite", "0", FCVAR_GAMEDLL | FCVAR_CHEAT, "Show areas of designer-placed bot preference due to func_nav_prerequisite entities" );
-ConVar nav_max_vis_delta_list_length( "nav_max_vis_delta_list_length", "64", FCVAR_CHEAT );
 
 extern ConVar nav_show_potentially_visible;
 
@@ -107,6 +107,7 @@ void CNavMesh::Reset( void )
 
 	m_isAnalyzed = false;
 	m_isOutOfDate = false;
+	m_isBoundFromImage = false;
 	m_isEditing = false;
 	m_navPlace = UNDEFINED_PLACE;
 	m_markedArea = NULL;
@@ -162,11 +163,15 @@ void CNavMesh::DestroyNavigationMesh( bool incremental )
 	m_avoidanceObstacleAreas.RemoveAll();
 	m_transientAreas.RemoveAll();
 
+	TheNavHierarchy.Reset();
+
 	if ( !incremental )
 	{
 		// destroy all areas
 		CNavArea::m_isReset = true;
 
+		TheNavVisibility.Reset();
+
 		// tell players to forget about the areas
 		FOR_EACH_VEC( TheNavAreas, it )
 		{
@@ -3129,6 +3134,8 @@ void CNavMesh::OnAreaBlocked( CNavArea *area )
 	{
 		m_blockedAreas.AddToTail( area );
 	}
+
+	TheNavHierarchy.OnAreaBlockedChanged( area );
 }
 
 
@@ -3137,6 +3144,8 @@ void CNavMesh::OnAreaBlocked( CNavArea *area )
 void CNavMesh::OnAreaUnblocked( CNavArea *area )
 {
 	m_blockedAreas.FindAndRemove( area );
+
+	TheNavHierarchy.OnAreaBlockedChanged( area );
 }
 
 
@@ -3213,6 +3222,9 @@ void CNavMesh::BeginVisibilityComputations( void )
 		g_pNavVisPairHash->RemoveAll();
 	}
 
+	// queries use the lists until the matrix is rebuilt
+	TheNavVisibility.Reset();
+
 	FOR_EACH_VEC( TheNavAreas, it )
 	{
 		CNavArea *area = TheNavAreas[ it ];
@@ -3233,9 +3245,6 @@ void CNavMesh::EndVisibilityComputations( void )
 	int maxVisLength = 0;
 	int minVisLength = 999999999;
 
-	// Optimize visibility storage of nav mesh by doing a kind of run-length encoding.
-	// Pick an "anchor" area and compare adjacent areas visibility lists to it. If the delta is
-	// small, point back to the anchor and just store the delta.
 	FOR_EACH_VEC( TheNavAreas, it )
 	{
 		CNavArea *area = (CNavArea *)TheNavAreas[ it ];
@@ -3250,59 +3259,6 @@ void CNavMesh::EndVisibilityComputations( void )
 		{
 			maxVisLength = visLength;
 		}
-
-		if ( area->m_isInheritedFrom )
-		{
-			// another area is inheriting from our vis data, we can't inherit
-			continue;
-		}
-
-		// find adjacent area with the smallest change from our visibility list
-		CNavArea::CAreaBindInfoArray bestDelta;
-		CNavArea *anchor = NULL;
-
-		for( int dir = NORTH; dir < NUM_DIRECTIONS; ++dir )
-		{
-			int count = area->GetAdjacentCount( (NavDirType)dir );
-			for( int i=0; i<count; ++i )
-			{
-				CNavArea *adjArea = (CNavArea *)area->GetAdjacentArea( (NavDirType)dir, i );
-
-				// do not inherit from an area that is inheriting - use its ultimate source
-				if ( adjArea->m_inheritVisibilityFrom.area != NULL )
-				{
-					adjArea = adjArea->m_inheritVisibilityFrom.area;
-					if ( adjArea == area )
-						continue;	// don't try to inherit visibility from ourselves
-				}
-
-				const CNavArea::CAreaBindInfoArray &delta = area->ComputeVisibilityDelta( adjArea );
-
-				// keep the smallest delta
-				if ( !anchor || ( anchor && delta.Count() < bestDelta.Count() ) )
-				{
-					bestDelta = delta;
-					anchor = adjArea;
-					Assert( anchor != area );
-				}
-			}
-		}
-
-		// if best delta is small enough, inherit our data from this anchor
-		if ( anchor && bestDelta.Count() <= nav_max_vis_delta_list_length.GetInt() && anchor != area )
-		{
-			// inherit from anchor area's visibility list
-			area->m_inheritVisibilityFrom.area = anchor;
-			area->m_potentiallyVisibleAreas = bestDelta;
-
-			// mark inherited-from area so it doesn't later try to inherit
-			anchor->m_isInheritedFrom = true;
-		}
-		else
-		{
-			// retain full list of visible areas
-			area->m_inheritVisibilityFrom.area = NULL;
-		}
 	}
 
 	if ( TheNavAreas.Count() )
@@ -3311,4 +3267,7 @@ void CNavMesh::EndVisibilityComputations( void )
 	}
 
 	Msg( "NavMesh Visibility List Lengths:  min = %d, avg = %d, max = %d\n", minVisLength, avgVisLength, maxVisLength );
+
+	// compress the lists into the visibility bit matrix
+	TheNavVisibility.BuildFromAreaLists();
 }
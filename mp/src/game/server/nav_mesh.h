@@ -36,6 +36,7 @@ extern ConVar nav_edit;
 extern ConVar nav_quicksave;
 extern ConVar nav_show_approach_points;
 extern ConVar nav_show_danger;
+extern ConVar nav_image;
 
 //--------------------------------------------------------------------------------------------------------
 class NavAreaCollector
@@ -285,6 +286,7 @@ public:
 	const CUtlVector< Place > *GetPlacesFromNavFile( bool *hasUnnamedPlaces );	// Reads the used place names from the nav file (can be used to selectively precache before the nav is loaded)
 
 	virtual bool Save( void ) const;									// store Navigation Mesh to a file
+	bool SaveNavImage( const char *navFilename ) const;					// store a binary image of the Navigation Mesh next to the given nav file, for fast loading
 	bool IsOutOfDate( void ) const	{ return m_isOutOfDate; }			// return true if the Navigation Mesh is older than the current map version
 
 	virtual unsigned int GetSubVersionNumber( void ) const;										// returns sub-version number of data format used by derived classes
@@ -1075,6 +1077,9 @@ private:
 	bool m_isLoaded;											// true if a Navigation Mesh has been loaded
 	bool m_isOutOfDate;											// true if the Navigation Mesh is older than the actual BSP
 	bool m_isAnalyzed;											// true if the Navigation Mesh needs analysis
+	bool m_isBoundFromImage;									// true if areas were bound directly from a nav image, and need no per-area PostLoad
+
+	NavErrorType LoadNavImage( const char *navFilename );		// load the Navigation Mesh from the binary image of the given nav file, if it is up to date
 
 	enum { HASH_TABLE_SIZE = 256 };
 	CNavArea *m_hashTable[ HASH_TABLE_SIZE ];					// hash table to optimize lookup by ID
@@ -1156,13 +1161,17 @@ private:
 
 	CNavNode *m_currentNode;									// the current node we are sampling from
 	NavDirType m_generationDir;
-	CNavNode *AddNode( const Vector &destPos, const Vector &destNormal, NavDirType dir, CNavNode *source, bool isOnDisplacement, float obstacleHeight, float flObstacleStartDist, float flObstacleEndDist );		// add a nav node and connect it, update current node
+	CNavNode *AddNode( const Vector &destPos, const Vector &destNormal, NavDirType dir, CNavNode *source, bool isOnDisplacement, float obstacleHeight, float flObstacleStartDist, float flObstacleEndDist, bool checkNode = true );		// add a nav node and connect it, update current node
+	void CheckSampledNode( CNavNode *&node );					// crouch and cliff checks for a sampled node
 
 	NavLadderVector m_ladders;									// list of ladder navigation representations
 	void BuildLadders( void );
 	void DestroyLadders( void );
 
 	bool SampleStep( void );									// sample the walkable areas of the map
+	bool SampleStepParallel( void );							// sample one wavefront of the walkable areas on worker threads
+	bool IsParallelGeneration( void ) const;					// true if generation work is spread over worker threads (nav_generate_parallel)
+	CUtlVector< CNavNode * > m_sampleFrontier;					// newly sampled nodes whose neighbors SampleStepParallel will explore next
 	void CreateNavAreasFromNodes( void );						// cover all of the sampled nodes with nav areas
 
 	bool TestArea( CNavNode *node, int width, int height );		// check if an area of size (width, height) can fit, starting from node as upper left corner
@@ -0,0 +1,515 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose:
+//
+// $NoKeywords: $
+//=============================================================================//
+
+// Compressed bit-matrix representation of the navigation mesh potentially visible set
+
+#include "cbase.h"
+#include "tier0/vprof.h"
+#include "nav_mesh.h"
+#include "nav_visibility.h"
+#include "team.h"
+
+// NOTE: This has to be the last file included!
+#include "tier0/memdbgon.h"
+
+
+CNavVisibilityMatrix TheNavVisibility;
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavBitMatrix::Reset( int size )
+{
+	m_size = size;
+	m_rows.Purge();
+	m_directory.Purge();
+	m_blocks.Purge();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavBitMatrix::AddRow( const CUtlVector< int > &sortedColumns )
+{
+	RowInfo &info = m_rows[ m_rows.AddToTail() ];
+	info.directory = m_directory.Count();
+
+	if ( sortedColumns.Count() == 0 )
+	{
+		info.firstBlock = 0;
+		info.blockCount = 0;
+		return;
+	}
+
+	info.firstBlock = sortedColumns[0] >> BLOCK_SHIFT;
+	info.blockCount = ( sortedColumns.Tail() >> BLOCK_SHIFT ) - info.firstBlock + 1;
+
+	int i;
+	for( i=0; i<info.blockCount; ++i )
+	{
+		m_directory.AddToTail( -1 );
+	}
+
+	for( i=0; i<sortedColumns.Count(); ++i )
+	{
+		int column = sortedColumns[i];
+		Assert( column >= 0 && column < m_size );
+		Assert( i == 0 || column > sortedColumns[i-1] );
+
+		int &block = m_directory[ info.directory + ( column >> BLOCK_SHIFT ) - info.firstBlock ];
+		if ( block < 0 )
+		{
+			block = m_blocks.Count() / BLOCK_WORDS;
+			m_blocks.AddMultipleToTail( BLOCK_WORDS );
+			V_memset( &m_blocks[ block * BLOCK_WORDS ], 0, BLOCK_WORDS * sizeof( uint32 ) );
+		}
+
+		int bit = column & ( BLOCK_BITS - 1 );
+		m_blocks[ block * BLOCK_WORDS + ( bit >> 5 ) ] |= ( 1 << ( bit & 31 ) );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool CNavBitMatrix::IsBitSet( int row, int column ) const
+{
+	const RowInfo &info = m_rows[ row ];
+
+	// unsigned compare rejects columns before and after the row's span at once
+	unsigned int entry = (unsigned int)( ( column >> BLOCK_SHIFT ) - info.firstBlock );
+	if ( entry >= (unsigned int)info.blockCount )
+		return false;
+
+	int block = m_directory[ info.directory + entry ];
+	if ( block < 0 )
+		return false;
+
+	int bit = column & ( BLOCK_BITS - 1 );
+	return ( m_blocks[ block * BLOCK_WORDS + ( bit >> 5 ) ] & ( 1 << ( bit & 31 ) ) ) != 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavBitMatrix::OrRowInto( int row, uint32 *bits ) const
+{
+	const RowInfo &info = m_rows[ row ];
+	for( int b=0; b<info.blockCount; ++b )
+	{
+		int block = m_directory[ info.directory + b ];
+		if ( block < 0 )
+			continue;
+
+		const uint32 *words = &m_blocks[ block * BLOCK_WORDS ];
+		uint32 *dest = &bits[ ( info.firstBlock + b ) * BLOCK_WORDS ];
+
+		// the last block may run past the end of the destination array
+		int count = MIN( (int)BLOCK_WORDS, ( ( m_size + 31 ) >> 5 ) - ( info.firstBlock + b ) * BLOCK_WORDS );
+		for( int w=0; w<count; ++w )
+		{
+			dest[w] |= words[w];
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+struct CollectBitColumns
+{
+	CollectBitColumns( CUtlVector< int > *columns ) : m_columns( columns ) { }
+
+	bool operator() ( int column )
+	{
+		m_columns->AddToTail( column );
+		return true;
+	}
+
+	CUtlVector< int > *m_columns;
+};
+
+void CNavBitMatrix::GetRow( int row, CUtlVector< int > *columns ) const
+{
+	columns->RemoveAll();
+
+	CollectBitColumns collect( columns );
+	ForEachInRow( row, collect );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The stored arrays are the in-memory arrays, so loading is a straight copy
+ */
+void CNavBitMatrix::Save( CUtlBuffer &fileBuffer ) const
+{
+	fileBuffer.PutInt( m_size );
+	fileBuffer.PutInt( m_rows.Count() );
+	fileBuffer.PutInt( m_directory.Count() );
+	fileBuffer.PutInt( m_blocks.Count() / BLOCK_WORDS );
+
+	int i;
+	for( i=0; i<m_rows.Count(); ++i )
+	{
+		fileBuffer.PutInt( m_rows[i].firstBlock );
+		fileBuffer.PutInt( m_rows[i].blockCount );
+	}
+
+	for( i=0; i<m_directory.Count(); ++i )
+	{
+		fileBuffer.PutInt( m_directory[i] );
+	}
+
+	for( i=0; i<m_blocks.Count(); ++i )
+	{
+		fileBuffer.PutUnsignedInt( m_blocks[i] );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Read a matrix written by Save(). On failure the matrix is left empty and the buffer is positioned
+ * at the end of the block, so whatever follows it can still be read.
+ */
+bool CNavBitMatrix::Load( CUtlBuffer &fileBuffer )
+{
+	int size = fileBuffer.GetInt();
+	int rowCount = fileBuffer.GetInt();
+	int directoryCount = fileBuffer.GetInt();
+	int blockCount = fileBuffer.GetInt();
+
+	Reset( 0 );
+
+	// don't trust the counts enough to allocate before checking them against the data available
+	int64 wordCount = 2 * (int64)rowCount + directoryCount + (int64)blockCount * BLOCK_WORDS;
+	if ( !fileBuffer.IsValid() || size < 0 || rowCount < 0 || directoryCount < 0 || blockCount < 0 ||
+		 fileBuffer.GetBytesRemaining() < wordCount * (int64)sizeof( int ) )
+	{
+		// the end of the block can't be found from these counts, nothing after it is readable either
+		fileBuffer.SeekGet( CUtlBuffer::SEEK_TAIL, 0 );
+		return false;
+	}
+
+	int blockEnd = fileBuffer.TellGet() + (int)( wordCount * sizeof( int ) );
+
+	Reset( size );
+	if ( !LoadData( fileBuffer, rowCount, directoryCount, blockCount ) )
+	{
+		Reset( 0 );
+		fileBuffer.SeekGet( CUtlBuffer::SEEK_HEAD, blockEnd );
+		return false;
+	}
+
+	Assert( fileBuffer.TellGet() == blockEnd );
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool CNavBitMatrix::LoadData( CUtlBuffer &fileBuffer, int rowCount, int directoryCount, int blockCount )
+{
+	m_rows.SetCount( rowCount );
+	int i, directory = 0;
+	for( i=0; i<rowCount; ++i )
+	{
+		m_rows[i].firstBlock = fileBuffer.GetInt();
+		m_rows[i].blockCount = fileBuffer.GetInt();
+		m_rows[i].directory = directory;
+
+		if ( m_rows[i].firstBlock < 0 || m_rows[i].blockCount < 0 ||
+			 m_rows[i].firstBlock + m_rows[i].blockCount > ( m_size + BLOCK_BITS - 1 ) >> BLOCK_SHIFT )
+			return false;
+
+		directory += m_rows[i].blockCount;
+	}
+
+	if ( directory != directoryCount )
+		return false;
+
+	m_directory.SetCount( directoryCount );
+	for( i=0; i<directoryCount; ++i )
+	{
+		m_directory[i] = fileBuffer.GetInt();
+		if ( m_directory[i] < -1 || m_directory[i] >= blockCount )
+			return false;
+	}
+
+	m_blocks.SetCount( blockCount * BLOCK_WORDS );
+	for( i=0; i<m_blocks.Count(); ++i )
+	{
+		m_blocks[i] = fileBuffer.GetUnsignedInt();
+	}
+
+	return fileBuffer.IsValid();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+unsigned int CNavBitMatrix::GetMemoryUsage( void ) const
+{
+	return m_rows.Count() * sizeof( RowInfo ) + m_directory.Count() * sizeof( int ) + m_blocks.Count() * sizeof( uint32 );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------------------------
+CNavVisibilityMatrix::CNavVisibilityMatrix( void )
+{
+	m_isBuilt = false;
+
+	for( int t=0; t<MAX_TEAMS; ++t )
+	{
+		m_teamVisibility[t][0].tickcount = -1;
+		m_teamVisibility[t][1].tickcount = -1;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavVisibilityMatrix::Reset( void )
+{
+	m_isBuilt = false;
+
+	// areas keep their index until the next build, but it is meaningless while we are not built
+	m_areas.Purge();
+	m_potentiallyVisible.Reset( 0 );
+	m_completelyVisible.Reset( 0 );
+
+	for( int t=0; t<MAX_TEAMS; ++t )
+	{
+		for( int c=0; c<2; ++c )
+		{
+			m_teamVisibility[t][c].tickcount = -1;
+			m_teamVisibility[t][c].bits.Purge();
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Give every area a dense index matching its position in TheNavAreas
+ */
+static void AssignVisibilityIndices( CUtlVector< CNavArea * > *areas )
+{
+	areas->SetCount( TheNavAreas.Count() );
+
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		CNavArea *area = TheNavAreas[ it ];
+		area->SetVisibilityIndex( it );
+		(*areas)[ it ] = area;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+struct CollectVisibleIndices
+{
+	CollectVisibleIndices( CUtlVector< int > *indices ) : m_indices( indices ) { }
+
+	bool operator() ( CNavArea *area )
+	{
+		if ( area->GetVisibilityIndex() >= 0 )
+		{
+			m_indices->AddToTail( area->GetVisibilityIndex() );
+		}
+		return true;
+	}
+
+	CUtlVector< int > *m_indices;
+};
+
+static int CompareIndices( const int *a, const int *b )
+{
+	return *a - *b;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Resolve the per-area visibility lists (including inherited lists) into the matrix.
+ * The lists are freed afterwards, since the matrix is now the definitive representation.
+ */
+void CNavVisibilityMatrix::BuildFromAreaLists( void )
+{
+	VPROF_BUDGET( "CNavVisibilityMatrix::BuildFromAreaLists", "NextBot" );
+
+	Reset();
+	AssignVisibilityIndices( &m_areas );
+
+	m_potentiallyVisible.Reset( m_areas.Count() );
+	m_completelyVisible.Reset( m_areas.Count() );
+
+	CUtlVector< int > columns;
+	CollectVisibleIndices collect( &columns );
+
+	// the area iterators use the lists until we are built
+	for( int i=0; i<m_areas.Count(); ++i )
+	{
+		columns.RemoveAll();
+		m_areas[i]->ForAllPotentiallyVisibleAreas( collect );
+		columns.Sort( CompareIndices );
+		m_potentiallyVisible.AddRow( columns );
+
+		columns.RemoveAll();
+		m_areas[i]->ForAllCompletelyVisibleAreas( collect );
+		columns.Sort( CompareIndices );
+		m_completelyVisible.AddRow( columns );
+	}
+
+	for( int i=0; i<m_areas.Count(); ++i )
+	{
+		m_areas[i]->PurgePotentiallyVisibleAreas();
+	}
+
+	m_isBuilt = true;
+
+	DevMsg( "Nav visibility matrix: %d areas, %d bytes\n", m_areas.Count(), GetMemoryUsage() );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if the area with the given index is visible from any area occupied by a
+ * living member of the given team. The union of the team's rows is computed once per tick.
+ */
+bool CNavVisibilityMatrix::IsVisibleToTeam( int index, int teamIndex, bool completely )
+{
+	if ( teamIndex < 0 || teamIndex >= MAX_TEAMS )
+		return false;
+
+	TeamVisibility &vis = m_teamVisibility[ teamIndex ][ completely ? 1 : 0 ];
+
+	if ( vis.tickcount != gpGlobals->tickcount )
+	{
+		VPROF_BUDGET( "CNavVisibilityMatrix::IsVisibleToTeam", "NextBot" );
+
+		vis.tickcount = gpGlobals->tickcount;
+		vis.bits.SetCount( ( m_areas.Count() + 31 ) >> 5 );
+		if ( vis.bits.Count() )
+		{
+			V_memset( vis.bits.Base(), 0, vis.bits.Count() * sizeof( uint32 ) );
+		}
+
+		const CNavBitMatrix &matrix = completely ? m_completelyVisible : m_potentiallyVisible;
+
+		CTeam *team = GetGlobalTeam( teamIndex );
+		for( int i = 0; team && i < team->GetNumPlayers(); ++i )
+		{
+			CBasePlayer *player = team->GetPlayer(i);
+			if ( !player || !player->IsAlive() )
+				continue;
+
+			CNavArea *from = (CNavArea *)player->GetLastKnownArea();
+			if ( !from || from->GetVisibilityIndex() < 0 )
+				continue;
+
+			int fromIndex = from->GetVisibilityIndex();
+			matrix.OrRowInto( fromIndex, vis.bits.Base() );
+
+			// can always see ourselves
+			vis.bits[ fromIndex >> 5 ] |= ( 1 << ( fromIndex & 31 ) );
+		}
+	}
+
+	return ( vis.bits[ index >> 5 ] & ( 1 << ( index & 31 ) ) ) != 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Write the matrix. Areas may have been added since it was built, so it is re-indexed
+ * to match TheNavAreas, which is the order areas will have when the file is loaded.
+ */
+void CNavVisibilityMatrix::Save( CUtlBuffer &fileBuffer ) const
+{
+	if ( !m_isBuilt )
+	{
+		// empty matrix
+		fileBuffer.PutUnsignedInt( 0 );
+		return;
+	}
+
+	CNavBitMatrix potentiallyVisible, completelyVisible;
+	potentiallyVisible.Reset( TheNavAreas.Count() );
+	completelyVisible.Reset( TheNavAreas.Count() );
+
+	// map our indices to save indices
+	CUtlVector< int > remap;
+	remap.SetCount( m_areas.Count() );
+	int i;
+	for( i=0; i<remap.Count(); ++i )
+	{
+		remap[i] = TheNavAreas.Find( m_areas[i] );
+	}
+
+	CUtlVector< int > columns;
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		int index = TheNavAreas[ it ]->GetVisibilityIndex();
+
+		for( int c=0; c<2; ++c )
+		{
+			const CNavBitMatrix &source = c ? m_completelyVisible : m_potentiallyVisible;
+			CNavBitMatrix &dest = c ? completelyVisible : potentiallyVisible;
+
+			columns.RemoveAll();
+			if ( index >= 0 && index < m_areas.Count() && m_areas[ index ] == TheNavAreas[ it ] )
+			{
+				source.GetRow( index, &columns );
+				for( i=0; i<columns.Count(); ++i )
+				{
+					columns[i] = remap[ columns[i] ];
+				}
+				columns.Sort( CompareIndices );
+			}
+			dest.AddRow( columns );
+		}
+	}
+
+	fileBuffer.PutUnsignedInt( TheNavAreas.Count() );
+	potentiallyVisible.Save( fileBuffer );
+	completelyVisible.Save( fileBuffer );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool CNavVisibilityMatrix::Load( CUtlBuffer &fileBuffer )
+{
+	Reset();
+
+	unsigned int count = fileBuffer.GetUnsignedInt();
+	if ( count == 0 )
+	{
+		// no visibility data was saved
+		return fileBuffer.IsValid();
+	}
+
+	// always read both matrices, each leaves the buffer at its end even if it is rejected,
+	// so the rest of the file can be loaded when we discard them
+	bool isValid = m_potentiallyVisible.Load( fileBuffer );
+	isValid = m_completelyVisible.Load( fileBuffer ) && isValid;
+
+	if ( !isValid || count != (unsigned int)TheNavAreas.Count() ||
+		 m_potentiallyVisible.GetSize() != (int)count || m_potentiallyVisible.GetRowCount() != (int)count ||
+		 m_completelyVisible.GetSize() != (int)count || m_completelyVisible.GetRowCount() != (int)count )
+	{
+		Warning( "Navigation mesh visibility data does not match the mesh, ignoring it. Run nav_analyze to rebuild it.\n" );
+		Reset();
+		return false;
+	}
+
+	AssignVisibilityIndices( &m_areas );
+	m_isBuilt = true;
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+unsigned int CNavVisibilityMatrix::GetMemoryUsage( void ) const
+{
+	return m_areas.Count() * sizeof( CNavArea * ) + m_potentiallyVisible.GetMemoryUsage() + m_completelyVisible.GetMemoryUsage();
+}
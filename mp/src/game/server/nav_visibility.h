@@ -0,0 +1,182 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose:
+//
+// $NoKeywords: $
+//===========================================================================//
+
+// Compressed bit-matrix representation of the navigation mesh potentially visible set
+
+#ifndef _NAV_VISIBILITY_H_
+#define _NAV_VISIBILITY_H_
+
+#include "utlvector.h"
+#include "utlbuffer.h"
+#include "bitvec.h"
+
+class CNavArea;
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * A square bit matrix stored as sparse rows of fixed size dense blocks.
+ * Each row keeps a directory covering only the span of blocks between its first and
+ * last set bit, so lookups are a constant number of array reads, while rows that see
+ * only a local neighborhood of the mesh cost a handful of blocks.
+ * Rows must be appended in order with AddRow().
+ */
+class CNavBitMatrix
+{
+public:
+	enum
+	{
+		BLOCK_SHIFT = 8,
+		BLOCK_BITS = 1 << BLOCK_SHIFT,		// bits per dense block
+		BLOCK_WORDS = BLOCK_BITS / 32,		// uint32 words per dense block
+	};
+
+	CNavBitMatrix( void )					{ Reset( 0 ); }
+
+	void Reset( int size );							///< discard all rows and set the column count
+	void AddRow( const CUtlVector< int > &sortedColumns );	///< append the next row, given its set columns in ascending order
+
+	int GetSize( void ) const				{ return m_size; }
+	int GetRowCount( void ) const			{ return m_rows.Count(); }
+
+	bool IsBitSet( int row, int column ) const;
+	void OrRowInto( int row, uint32 *bits ) const;	///< OR the row into a bit array of (GetSize()+31)/32 words
+	void GetRow( int row, CUtlVector< int > *columns ) const;
+
+	/**
+	 * Invoke the functor for each set column in the given row, in ascending order.
+	 * If the functor returns false, stop iterating and return false.
+	 */
+	template < typename Functor >
+	bool ForEachInRow( int row, Functor &func ) const
+	{
+		const RowInfo &info = m_rows[ row ];
+		for( int b=0; b<info.blockCount; ++b )
+		{
+			int block = m_directory[ info.directory + b ];
+			if ( block < 0 )
+				continue;
+
+			const uint32 *words = &m_blocks[ block * BLOCK_WORDS ];
+			int base = ( info.firstBlock + b ) << BLOCK_SHIFT;
+
+			for( int w=0; w<BLOCK_WORDS; ++w )
+			{
+				uint32 word = words[w];
+				while( word )
+				{
+					int bit = FirstBitInWord( word, 0 );
+					word &= word - 1;
+
+					if ( func( base + ( w << 5 ) + bit ) == false )
+						return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void Save( CUtlBuffer &fileBuffer ) const;
+	bool Load( CUtlBuffer &fileBuffer );			///< on failure the matrix is empty and the buffer is past the block
+
+	unsigned int GetMemoryUsage( void ) const;
+
+private:
+	bool LoadData( CUtlBuffer &fileBuffer, int rowCount, int directoryCount, int blockCount );
+
+	struct RowInfo
+	{
+		int firstBlock;						// block index of the first directory entry
+		int blockCount;						// number of directory entries
+		int directory;						// offset of this row's entries in m_directory
+	};
+
+	int m_size;
+	CUtlVector< RowInfo > m_rows;
+	CUtlVector< int > m_directory;			// index of a block in m_blocks, or -1 if the block is empty
+	CUtlVector< uint32 > m_blocks;			// pool of BLOCK_WORDS sized dense blocks
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The potentially visible set of the whole mesh, indexed by each area's dense visibility index.
+ * Once built, this replaces the per-area visibility lists: queries are O(1) and team
+ * visibility is a word-parallel union of the rows of the areas the team occupies.
+ * Any edit that destroys an area resets the matrix, as the per-area lists always did.
+ */
+class CNavVisibilityMatrix
+{
+public:
+	CNavVisibilityMatrix( void );
+
+	void Reset( void );								///< discard all visibility data and forget area indices
+	void BuildFromAreaLists( void );				///< resolve the per-area visibility lists into the matrix, then free the lists
+
+	bool IsBuilt( void ) const				{ return m_isBuilt; }
+	int GetAreaCount( void ) const			{ return m_areas.Count(); }
+	CNavArea *GetArea( int index ) const	{ return m_areas[ index ]; }
+
+	bool IsPotentiallyVisible( int fromIndex, int toIndex ) const	{ return m_potentiallyVisible.IsBitSet( fromIndex, toIndex ); }
+	bool IsCompletelyVisible( int fromIndex, int toIndex ) const	{ return m_completelyVisible.IsBitSet( fromIndex, toIndex ); }
+
+	bool IsPotentiallyVisibleToTeam( int index, int teamIndex )		{ return IsVisibleToTeam( index, teamIndex, false ); }
+	bool IsCompletelyVisibleToTeam( int index, int teamIndex )		{ return IsVisibleToTeam( index, teamIndex, true ); }
+
+	template < typename Functor >
+	bool ForAllPotentiallyVisibleAreas( int fromIndex, Functor &func ) const
+	{
+		AreaFunctor< Functor > areaFunc( m_areas, func );
+		return m_potentiallyVisible.ForEachInRow( fromIndex, areaFunc );
+	}
+
+	template < typename Functor >
+	bool ForAllCompletelyVisibleAreas( int fromIndex, Functor &func ) const
+	{
+		AreaFunctor< Functor > areaFunc( m_areas, func );
+		return m_completelyVisible.ForEachInRow( fromIndex, areaFunc );
+	}
+
+	void Save( CUtlBuffer &fileBuffer ) const;		///< write the matrix with rows and columns in TheNavAreas order
+	bool Load( CUtlBuffer &fileBuffer );			///< read the matrix written by Save(), after all areas have been loaded
+
+	unsigned int GetMemoryUsage( void ) const;
+
+private:
+	template < typename Functor >
+	struct AreaFunctor
+	{
+		AreaFunctor( const CUtlVector< CNavArea * > &areas, Functor &func ) : m_areas( areas ), m_func( func ) { }
+
+		bool operator() ( int index )
+		{
+			return m_func( m_areas[ index ] );
+		}
+
+		const CUtlVector< CNavArea * > &m_areas;
+		Functor &m_func;
+	};
+
+	bool IsVisibleToTeam( int index, int teamIndex, bool completely );
+
+	bool m_isBuilt;
+	CUtlVector< CNavArea * > m_areas;				// dense visibility index to area
+	CNavBitMatrix m_potentiallyVisible;
+	CNavBitMatrix m_completelyVisible;
+
+	struct TeamVisibility
+	{
+		int tickcount;								// tick the union was computed on
+		CUtlVector< uint32 > bits;					// union of the rows of every area occupied by a living team member
+	};
+	TeamVisibility m_teamVisibility[ MAX_TEAMS ][ 2 ];	// [ team ][ completely ]
+};
+
+extern CNavVisibilityMatrix TheNavVisibility;
+
+
+#endif // _NAV_VISIBILITY_H_
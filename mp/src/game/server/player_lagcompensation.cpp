@@ -13,6 +13,7 @@
 #include "utllinkedlist.h"
 #include "BaseAnimatingOverlay.h"
 #include "tier0/vprof.h"
+#include "vstdlib/jobthread.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -36,6 +37,7 @@ ConVar sv_lagflushbonecache( "sv_lagflushbonecache", "1", FCVAR_DEVELOPMENTONLY,
 ConVar sv_showlagcompensation( "sv_showlagcompensation", "0", FCVAR_CHEAT, "Show lag compensated hitboxes whenever a player is lag compensated." );
 
 ConVar sv_unlag_fixstuck( "sv_unlag_fixstuck", "0", FCVAR_DEVELOPMENTONLY, "Disallow backtracking a player for lag compensation if it will cause them to become stuck" );
+ConVar sv_unlag_setupbones( "sv_unlag_setupbones", "1", FCVAR_GAMEDLL | FCVAR_CHEAT, "Set up the hitbox bones of every living player at the end of each tick, across worker threads, and keep them with the lag compensation history." );
 
 //-----------------------------------------------------------------------------
 // Purpose: 
@@ -79,8 +81,13 @@ public:
 		m_flSimulationTime = -1;
 		m_masterSequence = 0;
 		m_masterCycle = 0;
+		m_pHitboxBones = NULL;
+		m_nHitboxBones = 0;
+		m_nHitboxBonesAllocated = 0;
+		m_nHitboxBonesModel = -1;
 	}
 
+	// Only records in the history own their bones, copies never get any
 	LagRecord( const LagRecord& src )
 	{
 		m_fFlags = src.m_fFlags;
@@ -95,6 +102,34 @@ public:
 		}
 		m_masterSequence = src.m_masterSequence;
 		m_masterCycle = src.m_masterCycle;
+		m_pHitboxBones = NULL;
+		m_nHitboxBones = 0;
+		m_nHitboxBonesAllocated = 0;
+		m_nHitboxBonesModel = -1;
+	}
+
+	~LagRecord()
+	{
+		delete [] m_pHitboxBones;
+	}
+
+	// Back to a new record, but keeping the bone buffer for the next set up
+	void Reset()
+	{
+		m_fFlags = 0;
+		m_vecOrigin.Init();
+		m_vecAngles.Init();
+		m_vecMinsPreScaled.Init();
+		m_vecMaxsPreScaled.Init();
+		m_flSimulationTime = -1;
+		for( int layerIndex = 0; layerIndex < MAX_LAYER_RECORDS; ++layerIndex )
+		{
+			m_layerRecords[layerIndex] = LayerRecord();
+		}
+		m_masterSequence = 0;
+		m_masterCycle = 0;
+		m_nHitboxBones = 0;
+		m_nHitboxBonesModel = -1;
 	}
 
 	// Did player die this frame
@@ -112,6 +147,20 @@ public:
 	LayerRecord				m_layerRecords[MAX_LAYER_RECORDS];
 	int						m_masterSequence;
 	float					m_masterCycle;
+
+	// The bone cache bones as of this record, just the ones in GetBoneCacheMask()
+	// in bone order. m_nHitboxBonesModel is -1 if they weren't set up.
+	matrix3x4_t				*m_pHitboxBones;
+	int						m_nHitboxBones;
+	int						m_nHitboxBonesAllocated;
+	int						m_nHitboxBonesModel;
+};
+
+// A record that gets its hitbox bones set up at the end of the tick
+struct LagBoneSetup_t
+{
+	CBasePlayer				*m_pPlayer;
+	LagRecord				*m_pRecord;
 };
 
 
@@ -200,6 +249,10 @@ public:
 private:
 	void			BacktrackPlayer( CBasePlayer *player, float flTargetTime );
 
+	void			SetupRecordBones();
+	void			SetupBonesForRecord( LagBoneSetup_t &setup );
+	bool			RestoreRecordBones( CBasePlayer *pPlayer, const LagRecord &record );
+
 	void ClearHistory()
 	{
 		for ( int i=0; i<MAX_PLAYERS; i++ )
@@ -220,6 +273,8 @@ private:
 
 	float					m_flTeleportDistanceSqr;
 
+	CUtlVector< LagBoneSetup_t >	m_BoneSetups;	// records added this tick that need bones
+
 	bool					m_isCurrentlyDoingCompensation;	// Sentinel to prevent calling StartLagCompensation a second time before a Finish.
 };
 
@@ -245,6 +300,8 @@ void CLagCompensationManager::FrameUpdatePostEntityThink()
 	// remove all records before that time:
 	int flDeadtime = gpGlobals->curtime - sv_maxunlag.GetFloat();
 
+	m_BoneSetups.RemoveAll();
+
 	// Iterate all active players
 	for ( int i = 1; i <= gpGlobals->maxClients; i++ )
 	{
@@ -264,7 +321,9 @@ void CLagCompensationManager::FrameUpdatePostEntityThink()
 
 		Assert( track->Count() < 1000 ); // insanity check
 
-		// remove tail records that are too old
+		// remove tail records that are too old, but hang on to the last one
+		// so a new record can reuse it and its bone buffer
+		int reuseIndex = track->InvalidIndex();
 		int tailIndex = track->Tail();
 		while ( track->IsValidIndex( tailIndex ) )
 		{
@@ -275,7 +334,11 @@ void CLagCompensationManager::FrameUpdatePostEntityThink()
 				break;
 			
 			// remove tail, get new tail
-			track->Remove( tailIndex );
+			if ( reuseIndex != track->InvalidIndex() )
+				track->Remove( reuseIndex );
+
+			track->Unlink( tailIndex );
+			reuseIndex = tailIndex;
 			tailIndex = track->Tail();
 		}
 
@@ -286,11 +349,28 @@ void CLagCompensationManager::FrameUpdatePostEntityThink()
 
 			// check if player changed simulation time since last time updated
 			if ( head.m_flSimulationTime >= pPlayer->GetSimulationTime() )
+			{
+				if ( reuseIndex != track->InvalidIndex() )
+					track->Remove( reuseIndex );
+
 				continue; // don't add new entry for same or older time
+			}
 		}
 
 		// add new record to player track
-		LagRecord &record = track->Element( track->AddToHead() );
+		int recordIndex;
+		if ( reuseIndex != track->InvalidIndex() )
+		{
+			track->LinkToHead( reuseIndex );
+			recordIndex = reuseIndex;
+		}
+		else
+		{
+			recordIndex = track->AddToHead();
+		}
+
+		LagRecord &record = track->Element( recordIndex );
+		record.Reset();
 
 		record.m_fFlags = 0;
 		if ( pPlayer->IsAlive() )
@@ -318,12 +398,133 @@ void CLagCompensationManager::FrameUpdatePostEntityThink()
 		}
 		record.m_masterSequence = pPlayer->GetSequence();
 		record.m_masterCycle = pPlayer->GetCycle();
+
+		// Server IK traces and moves IK locks, and a parented player's bones
+		// need its parent's, so those still set up lazily
+		if ( ( record.m_fFlags & LC_ALIVE ) && !pPlayer->IsServerIKEnabled() && !pPlayer->GetMoveParent() && pPlayer->GetModelPtr() )
+		{
+			LagBoneSetup_t &setup = m_BoneSetups[ m_BoneSetups.AddToTail() ];
+			setup.m_pPlayer = pPlayer;
+			setup.m_pRecord = &record;
+		}
+	}
+
+	if ( sv_unlag_setupbones.GetBool() )
+	{
+		SetupRecordBones();
 	}
 
 	//Clear the current player.
 	m_pCurrentPlayer = NULL;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Sets up the hitbox bones of the records added this tick all at once,
+//			rather than one at a time the first time a trace hits each player
+//-----------------------------------------------------------------------------
+void CLagCompensationManager::SetupRecordBones()
+{
+	if ( !m_BoneSetups.Count() )
+		return;
+
+	VPROF_BUDGET( "SetupRecordBones", "CLagCompensationManager" );
+
+	for ( int i = 0; i < m_BoneSetups.Count(); i++ )
+	{
+		CBasePlayer *pPlayer = m_BoneSetups[i].m_pPlayer;
+		LagRecord *pRecord = m_BoneSetups[i].m_pRecord;
+
+		// Settle the abs transform here, SetupBones would otherwise work it out on the worker
+		pPlayer->GetAbsOrigin();
+		pPlayer->GetAbsAngles();
+
+		CStudioHdr *pStudioHdr = pPlayer->GetModelPtr();
+		int boneMask = pPlayer->GetBoneCacheMask();
+		int nBones = 0;
+		for ( int iBone = 0; iBone < pStudioHdr->numbones(); iBone++ )
+		{
+			if ( pStudioHdr->boneFlags( iBone ) & boneMask )
+				nBones++;
+		}
+
+		if ( pRecord->m_nHitboxBonesAllocated < nBones )
+		{
+			delete [] pRecord->m_pHitboxBones;
+			pRecord->m_pHitboxBones = new matrix3x4_t[ nBones ];
+			pRecord->m_nHitboxBonesAllocated = nBones;
+		}
+
+		pRecord->m_nHitboxBones = nBones;
+		pRecord->m_nHitboxBonesModel = pPlayer->GetModelIndex();
+	}
+
+	ParallelProcess( "CLagCompensationManager::SetupRecordBones", m_BoneSetups.Base(), m_BoneSetups.Count(), this, &CLagCompensationManager::SetupBonesForRecord );
+
+	// These are the players as they are now, so anything that traces
+	// against them before they next move can use the bones too
+	for ( int i = 0; i < m_BoneSetups.Count(); i++ )
+	{
+		RestoreRecordBones( m_BoneSetups[i].m_pPlayer, *m_BoneSetups[i].m_pRecord );
+	}
+
+	m_BoneSetups.RemoveAll();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Runs on a worker. Only touches the player's own bone setup.
+//-----------------------------------------------------------------------------
+void CLagCompensationManager::SetupBonesForRecord( LagBoneSetup_t &setup )
+{
+	CBasePlayer *pPlayer = setup.m_pPlayer;
+	LagRecord *pRecord = setup.m_pRecord;
+
+	int boneMask = pPlayer->GetBoneCacheMask();
+	matrix3x4_t boneToWorld[ MAXSTUDIOBONES ];
+	pPlayer->SetupBones( boneToWorld, boneMask );
+
+	CStudioHdr *pStudioHdr = pPlayer->GetModelPtr();
+	int nBones = 0;
+	for ( int iBone = 0; iBone < pStudioHdr->numbones(); iBone++ )
+	{
+		if ( pStudioHdr->boneFlags( iBone ) & boneMask )
+		{
+			MatrixCopy( boneToWorld[ iBone ], pRecord->m_pHitboxBones[ nBones++ ] );
+		}
+	}
+	Assert( nBones == pRecord->m_nHitboxBones );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Puts a record's bones in the player's bone cache, returns false if
+//			the record has none for the player's current model
+//-----------------------------------------------------------------------------
+bool CLagCompensationManager::RestoreRecordBones( CBasePlayer *pPlayer, const LagRecord &record )
+{
+	if ( record.m_nHitboxBonesModel == -1 || record.m_nHitboxBonesModel != pPlayer->GetModelIndex() )
+		return false;
+
+	CStudioHdr *pStudioHdr = pPlayer->GetModelPtr();
+	if ( !pStudioHdr )
+		return false;
+
+	int boneMask = pPlayer->GetBoneCacheMask();
+	matrix3x4_t boneToWorld[ MAXSTUDIOBONES ];
+	int nBones = 0;
+	for ( int iBone = 0; iBone < pStudioHdr->numbones(); iBone++ )
+	{
+		if ( pStudioHdr->boneFlags( iBone ) & boneMask )
+		{
+			if ( nBones >= record.m_nHitboxBones )
+				return false;
+
+			MatrixCopy( record.m_pHitboxBones[ nBones++ ], boneToWorld[ iBone ] );
+		}
+	}
+
+	pPlayer->SetBoneCache( boneToWorld );
+	return true;
+}
+
 // Called during player movement to set up/restore after lag compensation
 void CLagCompensationManager::StartLagCompensation( CBasePlayer *player, CUserCmd *cmd )
 {
@@ -717,7 +918,14 @@ void CLagCompensationManager::BacktrackPlayer( CBasePlayer *pPlayer, float flTar
 		return; // we didn't change anything
 
 	if ( sv_lagflushbonecache.GetBool() )
-		pPlayer->InvalidateBoneCache();
+	{
+		// Landing right on a record, the bones set up at the end of its tick are the ones we want
+		bool bOnRecord = ( frac == 0.0f ) && ( org == record->m_vecOrigin );
+		if ( !bOnRecord || !RestoreRecordBones( pPlayer, *record ) )
+		{
+			pPlayer->InvalidateBoneCache();
+		}
+	}
 
 	/*char text[256]; Q_snprintf( text, sizeof(text), "time %.2f", flTargetTime );
 	pPlayer->DrawServerHitboxes( 10 );
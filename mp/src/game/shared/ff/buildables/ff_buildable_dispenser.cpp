@@ -61,6 +61,7 @@
 	#include "omnibot_interface.h"
 
 	#include "te_effect_dispatch.h"
+	#include "ff_transmitpolicy.h"
 #endif
 
 #include "tier0/vprof.h"
@@ -75,7 +76,8 @@
 //=============================================================================
 IMPLEMENT_NETWORKCLASS_ALIASED( FFDispenser, DT_FFDispenser )
 
-BEGIN_NETWORK_TABLE( CFFDispenser, DT_FFDispenser )
+// What's left inside is only the owner's team's business
+BEGIN_NETWORK_TABLE_NOBASE( CFFDispenser, DT_FFDispenserTeamData )
 #ifdef CLIENT_DLL
 	RecvPropInt( RECVINFO( m_iAmmoPercent ) ),
 	RecvPropInt( RECVINFO( m_iCells ) ),
@@ -93,6 +95,14 @@ BEGIN_NETWORK_TABLE( CFFDispenser, DT_FFDispenser )
 #endif
 END_NETWORK_TABLE()
 
+BEGIN_NETWORK_TABLE( CFFDispenser, DT_FFDispenser )
+#ifdef CLIENT_DLL
+	RecvPropDataTable( "teamdata", 0, 0, &REFERENCE_RECV_TABLE( DT_FFDispenserTeamData ) ),
+#elif GAME_DLL
+	SendPropDataTable( "teamdata", 0, &REFERENCE_SEND_TABLE( DT_FFDispenserTeamData ), SendProxy_SendBuildableTeamDataTable ),
+#endif
+END_NETWORK_TABLE()
+
 // Start of our data description for the class
 BEGIN_DATADESC( CFFDispenser )
 #ifdef GAME_DLL
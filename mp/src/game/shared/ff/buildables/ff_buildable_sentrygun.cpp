@@ -57,6 +57,7 @@
 	#include "omnibot_interface.h"
 	#include "te_effect_dispatch.h" 
 	#include "smoke_trail.h"
+	#include "ff_transmitpolicy.h"
 #endif
 
 #include "tier0/vprof.h"
@@ -201,19 +202,16 @@
 
 IMPLEMENT_NETWORKCLASS_ALIASED( FFSentryGun, DT_FFSentryGun )
 
-BEGIN_NETWORK_TABLE( CFFSentryGun, DT_FFSentryGun )
+// Ammo only goes to the owner's team
+BEGIN_NETWORK_TABLE_NOBASE( CFFSentryGun, DT_FFSentryGunTeamData )
 #ifdef CLIENT_DLL
-RecvPropInt( RECVINFO( m_iAmmoPercent ) ),
-	//RecvPropFloat( RECVINFO( m_flRange ) ),
-	RecvPropInt( RECVINFO( m_iLevel ) ),
+	RecvPropInt( RECVINFO( m_iAmmoPercent ) ),
 	RecvPropInt( RECVINFO( m_iShells ) ),
 	RecvPropInt( RECVINFO( m_iRockets ) ),
 	RecvPropInt( RECVINFO( m_iMaxShells ) ),
 	RecvPropInt( RECVINFO( m_iMaxRockets ) ),
 #elif GAME_DLL
 	SendPropInt( SENDINFO( m_iAmmoPercent), 8, SPROP_UNSIGNED ), 
-	//SendPropFloat( SENDINFO( m_flRange ) ), //AfterShock: surely the client knows it's range?
-	SendPropInt( SENDINFO( m_iLevel ), 2, SPROP_UNSIGNED ), //AfterShock: max level 3
 	SendPropInt( SENDINFO( m_iShells ), 8, SPROP_UNSIGNED ), //AfterShock: max 150 shells for level 3
 	SendPropInt( SENDINFO( m_iRockets ), 5, SPROP_UNSIGNED ), //AfterShock: max 20 rockets for level 3
 	SendPropInt( SENDINFO( m_iMaxShells ) ), //AfterShock: this should be inferred from level
@@ -221,6 +219,18 @@ RecvPropInt( RECVINFO( m_iAmmoPercent ) ),
 #endif
 END_NETWORK_TABLE()
 
+BEGIN_NETWORK_TABLE( CFFSentryGun, DT_FFSentryGun )
+#ifdef CLIENT_DLL
+	//RecvPropFloat( RECVINFO( m_flRange ) ),
+	RecvPropInt( RECVINFO( m_iLevel ) ),
+	RecvPropDataTable( "teamdata", 0, 0, &REFERENCE_RECV_TABLE( DT_FFSentryGunTeamData ) ),
+#elif GAME_DLL
+	//SendPropFloat( SENDINFO( m_flRange ) ), //AfterShock: surely the client knows it's range?
+	SendPropInt( SENDINFO( m_iLevel ), 2, SPROP_UNSIGNED ), //AfterShock: max level 3
+	SendPropDataTable( "teamdata", 0, &REFERENCE_SEND_TABLE( DT_FFSentryGunTeamData ), SendProxy_SendBuildableTeamDataTable ),
+#endif
+END_NETWORK_TABLE()
+
 // Datatable
 BEGIN_DATADESC( CFFSentryGun )
 #ifdef GAME_DLL
@@ -474,6 +484,8 @@ void CFFSentryGun::Spawn( void )
 	m_angSpeed_yaw = 0.0;
 	m_angSpeed_pitch = 0.0;
 	// caes
+
+	m_flNextIdlePoseUpdate = 0.0f;
 }
 
 //-----------------------------------------------------------------------------
@@ -1653,7 +1665,12 @@ bool CFFSentryGun::UpdateFacing( void )
 
 	m_angAiming.y = new_yaw + src_yaw;
 
-	SetPoseParameter( m_iYawPoseParameter, TO_YAW( new_yaw ) );
+	// The search sweep is only cosmetic, so an idle sg doesn't need to
+	// send it every tick. Clients interpolate between the updates. The
+	// server's pose is always current, the attachments below come from it.
+	bool bSendPose = GetEnemy() || FFTransmit_IdleUpdateDue( m_flNextIdlePoseUpdate );
+
+	SetPoseParameterUnsent( m_iYawPoseParameter, TO_YAW( new_yaw ) );
 
 	// Calculate the real pitch target, this depends on the angle at the point we are at now
 	Vector vecMuzzle;
@@ -1730,7 +1747,13 @@ bool CFFSentryGun::UpdateFacing( void )
 // caes
 
 
-	SetPoseParameter( m_iPitchPoseParameter, ( clamp( new_pitch, SG_MIN_ANIMATED_PITCH, SG_MAX_PITCH ) / 2.0f ) ); //AfterShock: (90 + 33) / 45.. bad bad hack, seems to work tho. sgs can only look down about 33 degrees.
+	SetPoseParameterUnsent( m_iPitchPoseParameter, ( clamp( new_pitch, SG_MIN_ANIMATED_PITCH, SG_MAX_PITCH ) / 2.0f ) ); //AfterShock: (90 + 33) / 45.. bad bad hack, seems to work tho. sgs can only look down about 33 degrees.
+
+	if ( bSendPose )
+	{
+		NetworkPoseParameter( m_iYawPoseParameter );
+		NetworkPoseParameter( m_iPitchPoseParameter );
+	}
 
 	m_angAiming.x = FROM_PITCH( new_pitch + src_pitch );
 
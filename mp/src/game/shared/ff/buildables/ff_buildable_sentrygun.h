@@ -285,6 +285,9 @@ public:
 	float m_angSpeed_yaw;
 	float m_angSpeed_pitch;
 	// caes
+
+	// Next time a searching sg sends its aim to clients
+	float m_flNextIdlePoseUpdate;
 #endif
 };
 
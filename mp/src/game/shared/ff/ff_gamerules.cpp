@@ -595,33 +595,10 @@ ConVar mp_friendlyfire_armorstrip( "mp_friendlyfire_armorstrip",
 
 			// Mulch: 9/6/2007: New code per: http://developer.valvesoftware.com/wiki/Resetting_Maps_and_Entities
 			
-			// Recreate all the map entities from the map data (preserving their indices),
-			// then remove everything else except the players.
-
-			// Get rid of all entities except players.
-			CBaseEntity *pCur = gEntList.FirstEnt();
-			while( pCur )
-			{
-				if( !FindInList( g_MapEntityFilterKeepList, pCur->GetClassname() ) )
-				{
-					CBaseEntity *pTemp = gEntList.NextEnt( pCur );
-					UTIL_Remove( pCur );
-					pCur = pTemp;
-				}
-				else
-				{
-					pCur = gEntList.NextEnt( pCur );
-				}
-			}
-
-			// Really remove the entities so we can have access to their slots below.
-			gEntList.CleanupDeleteList();
-
-			CFFMapEntityFilter filter;
-			filter.m_iIterator = g_MapEntityRefs.Head();
-
-			// final task, trigger the recreation of any entities that need it.
-			MapEntity_ParseAllEntities( engine->GetMapEntitiesString(), &filter, true );
+			// Recreate the map entities from the map data (preserving their indices),
+			// and remove everything else except the players. Map entities that haven't
+			// changed since the round started are left alone unless sv_fastroundreset is off.
+			g_FFMapSnapshot.ResetMapEntities( sv_fastroundreset.GetBool() );
 
 			// Send event
 			IGameEvent *pEvent = gameeventmanager->CreateEvent( "ff_restartround" );
@@ -1514,6 +1491,9 @@ ConVar mp_friendlyfire_armorstrip( "mp_friendlyfire_armorstrip",
 	// --> Mirv: Hodgepodge of different checks (from the base functions) inc. prematch
 	void CFFGameRules::Think()
 	{
+		// the map entities have settled since the map loaded or the round was reset
+		g_FFMapSnapshot.Update();
+
 #ifdef FF_BETA
 		// Special stuff for beta!
 		g_FFBetaList.Validate();
@@ -14,6 +14,10 @@
 #include "cbase.h"
 #include "ff_radiotagdata.h"
 
+#ifdef GAME_DLL
+#include "ff_transmitpolicy.h"
+#endif
+
 #ifdef CLIENT_DLL 
 #undef CFFRadioTagData
 IMPLEMENT_CLIENTCLASS_DT_NOBASE( C_FFRadioTagData, DT_FFRadioTagData, CFFRadioTagData )
@@ -141,12 +145,19 @@ Vector CFFRadioTagData::GetOrigin( int iIndex ) const
 
 #else
 //-----------------------------------------------------------------------------
-// Purpose: Always transmit to clients
+// Purpose: Check who to send to
 //-----------------------------------------------------------------------------
 int CFFRadioTagData::UpdateTransmitState( void )
 {
-	// always transmit to the client
-	return SetTransmitState( FL_EDICT_ALWAYS );
+	return SetTransmitState( FL_EDICT_FULLCHECK );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Only the player it belongs to reads it, so only send it to them
+//-----------------------------------------------------------------------------
+int CFFRadioTagData::ShouldTransmit( const CCheckTransmitInfo *pInfo )
+{
+	return FFTransmit_OwnerOnlyShouldTransmit( this, pInfo );
 }
 
 //-----------------------------------------------------------------------------
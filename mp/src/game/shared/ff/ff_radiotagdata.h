@@ -54,6 +54,7 @@ public:
 	Vector			GetOrigin( int iIndex ) const;
 #else
 	virtual int		UpdateTransmitState( void );	
+	virtual int		ShouldTransmit( const CCheckTransmitInfo *pInfo );
 	virtual	int		ObjectCaps( void ) { return BaseClass::ObjectCaps() | FCAP_DONT_SAVE; }
 	void			ClearVisible( void );
 	void			Set( int iIndex, bool bVisible, int iClass, int iTeam, bool bDucking, const Vector& vecOrigin );
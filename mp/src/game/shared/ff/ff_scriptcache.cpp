@@ -0,0 +1,469 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_scriptcache.cpp
+/// @brief Compiled copies of the weapon, class and grenade scripts
+///
+/// REVISIONS
+/// ---------
+/// A compiled script is a header, the nodes of the KeyValues tree in
+/// depth first order and a table of the strings they use. It's read with
+/// one ReadFile and checked once up front, so building the tree from it
+/// is just following indices. Scripts from .ctx files are kept encrypted
+/// with the same key.
+///
+/// The compiled copies are in the writable mod directory, where sv_pure
+/// can't check them, and nothing ties a copy's tree to the script CRC in its
+/// header. So they're only used where the scripts themselves aren't checked
+/// either: by the server, and by a client playing on its own listen server.
+/// Clients of other servers always parse the scripts.
+
+#include "cbase.h"
+#include "ff_scriptcache.h"
+#include <KeyValues.h>
+#include "filesystem.h"
+#include "utlbuffer.h"
+#include "utldict.h"
+#include "checksum_crc.h"
+#include "mathlib/IceKey.H"
+#include "tier0/vprof.h"
+#ifdef CLIENT_DLL
+#include "inetchannelinfo.h"
+#endif
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+ConVar ff_scriptcache( "ff_scriptcache", "1", 0, "Load the weapon, class and grenade scripts from compiled copies in scriptcache/, compiling them when the scripts change." );
+
+#define SCRIPTCACHE_MAGIC		MAKEID( 'F', 'F', 'S', 'C' )
+#define SCRIPTCACHE_VERSION		1
+#define SCRIPTCACHE_PATH		"scriptcache"
+
+struct ScriptCacheHeader_t
+{
+	uint32	m_nMagic;
+	uint32	m_nVersion;
+	uint32	m_nSourceSize;
+	CRC32_t	m_nSourceCRC;		// of the script file as it is on disk
+	uint32	m_nNodes;
+	uint32	m_nStringBytes;
+	uint32	m_nBodySize;		// nodes and strings, padded to the ICE block size
+	CRC32_t	m_nBodyCRC;			// before encrypting
+};
+
+struct ScriptCacheNode_t
+{
+	int32	m_iName;			// into the string table
+	int32	m_nType;			// KeyValues::types_t
+	union
+	{
+		int32	m_iValue;
+		float	m_flValue;
+		int32	m_iString;		// into the string table
+	};
+	int32	m_iFirstChild;		// -1 for none
+	int32	m_iNextPeer;
+};
+
+COMPILE_TIME_ASSERT( sizeof( ScriptCacheHeader_t ) == 32 );
+COMPILE_TIME_ASSERT( sizeof( ScriptCacheNode_t ) == 20 );
+
+// the ICE blocks the body gets encrypted in
+#define SCRIPTCACHE_BLOCK_SIZE	8
+
+bool ScriptCache_IsEnabled()
+{
+	return ff_scriptcache.GetBool();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Whether compiled copies can stand in for the scripts here. sv_pure
+//			checks the scripts a client reads from a remote server, but it
+//			can't check the copies, so those clients have to use the text.
+//-----------------------------------------------------------------------------
+static bool ScriptCache_IsTrusted()
+{
+#ifdef CLIENT_DLL
+	INetChannelInfo *nci = engine->GetNetChannelInfo();
+	return nci && nci->IsLoopback();
+#else
+	return true;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Where the compiled copy of a script lives
+//-----------------------------------------------------------------------------
+static void ScriptCache_GetFilename( const char *pszFilename, char *pszCacheFilename, int nCacheFilenameSize )
+{
+	Q_snprintf( pszCacheFilename, nCacheFilenameSize, SCRIPTCACHE_PATH "/%s.bin", pszFilename );
+	Q_FixSlashes( pszCacheFilename );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: The other half of UTIL_DecodeICE
+//-----------------------------------------------------------------------------
+static void ScriptCache_EncodeICE( unsigned char *pBuffer, int nSize, const unsigned char *pICEKey )
+{
+	IceKey ice( 0 ); // level 0 = 64bit key
+	ice.set( pICEKey );
+
+	Assert( ice.blockSize() == SCRIPTCACHE_BLOCK_SIZE );
+
+	unsigned char block[SCRIPTCACHE_BLOCK_SIZE];
+	for ( int i = 0; i + SCRIPTCACHE_BLOCK_SIZE <= nSize; i += SCRIPTCACHE_BLOCK_SIZE )
+	{
+		ice.encrypt( pBuffer + i, block );
+		Q_memcpy( pBuffer + i, block, SCRIPTCACHE_BLOCK_SIZE );
+	}
+}
+
+//=============================================================================
+// Compiling
+//=============================================================================
+class CScriptCacheCompiler
+{
+public:
+	CScriptCacheCompiler() : m_StringOffsets( k_eDictCompareTypeCaseSensitive ) {}
+
+	bool	Compile( KeyValues *pKV );
+	bool	Write( IFileSystem *filesystem, const char *pszCacheFilename, uint32 nSourceSize, CRC32_t nSourceCRC, const unsigned char *pICEKey );
+
+private:
+	int		CompileKey( KeyValues *pKey );
+	int		AddString( const char *pszString );
+
+	CUtlVector< ScriptCacheNode_t >	m_Nodes;
+	CUtlBuffer				m_Strings;
+	CUtlDict< int, int >	m_StringOffsets;
+	bool					m_bFailed;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: Flattens the tree. pKV and its peers are all top level keys.
+//-----------------------------------------------------------------------------
+bool CScriptCacheCompiler::Compile( KeyValues *pKV )
+{
+	m_bFailed = false;
+
+	int iPrevious = -1;
+	for ( KeyValues *pKey = pKV; pKey && !m_bFailed; pKey = pKey->GetNextKey() )
+	{
+		int iNode = CompileKey( pKey );
+		if ( iPrevious >= 0 )
+			m_Nodes[iPrevious].m_iNextPeer = iNode;
+		iPrevious = iNode;
+	}
+
+	return !m_bFailed;
+}
+
+int CScriptCacheCompiler::CompileKey( KeyValues *pKey )
+{
+	// children are added as we go, so no holding on to references into m_Nodes
+	int iNode = m_Nodes.AddToTail();
+	int iName = AddString( pKey->GetName() );
+	m_Nodes[iNode].m_iName = iName;
+	m_Nodes[iNode].m_nType = pKey->GetDataType();
+	m_Nodes[iNode].m_iValue = 0;
+	m_Nodes[iNode].m_iFirstChild = -1;
+	m_Nodes[iNode].m_iNextPeer = -1;
+
+	switch ( pKey->GetDataType() )
+	{
+	case KeyValues::TYPE_NONE:
+		{
+			int iPrevious = -1;
+			for ( KeyValues *pSubKey = pKey->GetFirstSubKey(); pSubKey && !m_bFailed; pSubKey = pSubKey->GetNextKey() )
+			{
+				int iChild = CompileKey( pSubKey );
+				if ( iPrevious >= 0 )
+					m_Nodes[iPrevious].m_iNextPeer = iChild;
+				else
+					m_Nodes[iNode].m_iFirstChild = iChild;
+				iPrevious = iChild;
+			}
+		}
+		break;
+
+	case KeyValues::TYPE_STRING:
+		{
+			int iString = AddString( pKey->GetString() );
+			m_Nodes[iNode].m_iString = iString;
+		}
+		break;
+
+	case KeyValues::TYPE_INT:
+		m_Nodes[iNode].m_iValue = pKey->GetInt();
+		break;
+
+	case KeyValues::TYPE_FLOAT:
+		m_Nodes[iNode].m_flValue = pKey->GetFloat();
+		break;
+
+	default:
+		// 64 bit values and the like don't come up in scripts, leave them to the text
+		m_bFailed = true;
+		break;
+	}
+
+	return iNode;
+}
+
+int CScriptCacheCompiler::AddString( const char *pszString )
+{
+	int iString = m_StringOffsets.Find( pszString );
+	if ( iString != m_StringOffsets.InvalidIndex() )
+		return m_StringOffsets[iString];
+
+	int iOffset = m_Strings.TellPut();
+	m_Strings.PutString( pszString );		// null terminated, it's a binary buffer
+	m_StringOffsets.Insert( pszString, iOffset );
+	return iOffset;
+}
+
+bool CScriptCacheCompiler::Write( IFileSystem *filesystem, const char *pszCacheFilename, uint32 nSourceSize, CRC32_t nSourceCRC, const unsigned char *pICEKey )
+{
+	CUtlBuffer body;
+	body.Put( m_Nodes.Base(), m_Nodes.Count() * sizeof( ScriptCacheNode_t ) );
+	body.Put( m_Strings.Base(), m_Strings.TellPut() );
+	while ( body.TellPut() % SCRIPTCACHE_BLOCK_SIZE )
+		body.PutChar( 0 );
+
+	ScriptCacheHeader_t header;
+	header.m_nMagic = SCRIPTCACHE_MAGIC;
+	header.m_nVersion = SCRIPTCACHE_VERSION;
+	header.m_nSourceSize = nSourceSize;
+	header.m_nSourceCRC = nSourceCRC;
+	header.m_nNodes = m_Nodes.Count();
+	header.m_nStringBytes = m_Strings.TellPut();
+	header.m_nBodySize = body.TellPut();
+	header.m_nBodyCRC = CRC32_ProcessSingleBuffer( body.Base(), body.TellPut() );
+
+	if ( pICEKey )
+		ScriptCache_EncodeICE( (unsigned char *)body.Base(), body.TellPut(), pICEKey );
+
+	CUtlBuffer file;
+	file.Put( &header, sizeof( header ) );
+	file.Put( body.Base(), body.TellPut() );
+
+	char szPath[MAX_PATH];
+	Q_strncpy( szPath, pszCacheFilename, sizeof( szPath ) );
+	Q_StripFilename( szPath );
+	filesystem->CreateDirHierarchy( szPath, "MOD" );
+
+	return filesystem->WriteFile( pszCacheFilename, "MOD", file );
+}
+
+//=============================================================================
+// Loading
+//=============================================================================
+
+//-----------------------------------------------------------------------------
+// Purpose: Checks everything the tree building will rely on, so it can
+//			trust the indices. Children and peers always come after the
+//			node that points at them, so there can't be any loops.
+//-----------------------------------------------------------------------------
+static bool ScriptCache_Validate( const ScriptCacheNode_t *pNodes, int nNodes, const char *pStrings, int nStringBytes )
+{
+	if ( nNodes <= 0 || nStringBytes <= 0 || pStrings[nStringBytes - 1] != 0 )
+		return false;
+
+	for ( int i = 0; i < nNodes; i++ )
+	{
+		const ScriptCacheNode_t &node = pNodes[i];
+
+		if ( node.m_iName < 0 || node.m_iName >= nStringBytes )
+			return false;
+
+		if ( node.m_iNextPeer != -1 && ( node.m_iNextPeer <= i || node.m_iNextPeer >= nNodes ) )
+			return false;
+
+		switch ( node.m_nType )
+		{
+		case KeyValues::TYPE_NONE:
+			if ( node.m_iFirstChild != -1 && ( node.m_iFirstChild <= i || node.m_iFirstChild >= nNodes ) )
+				return false;
+			break;
+
+		case KeyValues::TYPE_STRING:
+			if ( node.m_iString < 0 || node.m_iString >= nStringBytes )
+				return false;
+			// fall through
+		case KeyValues::TYPE_INT:
+		case KeyValues::TYPE_FLOAT:
+			if ( node.m_iFirstChild != -1 )
+				return false;
+			break;
+
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Fills in pKey from a node, and its children after it
+//-----------------------------------------------------------------------------
+static void ScriptCache_BuildKey( KeyValues *pKey, const ScriptCacheNode_t *pNodes, int iNode, const char *pStrings )
+{
+	const ScriptCacheNode_t &node = pNodes[iNode];
+
+	switch ( node.m_nType )
+	{
+	case KeyValues::TYPE_NONE:
+		{
+			KeyValues *pPrevious = NULL;
+			for ( int iChild = node.m_iFirstChild; iChild != -1; iChild = pNodes[iChild].m_iNextPeer )
+			{
+				KeyValues *pChild = new KeyValues( pStrings + pNodes[iChild].m_iName );
+				ScriptCache_BuildKey( pChild, pNodes, iChild, pStrings );
+
+				// linking to the last one saves AddSubKey walking the list each time
+				if ( pPrevious )
+					pPrevious->SetNextKey( pChild );
+				else
+					pKey->AddSubKey( pChild );
+				pPrevious = pChild;
+			}
+		}
+		break;
+
+	case KeyValues::TYPE_STRING:
+		pKey->SetStringValue( pStrings + node.m_iString );
+		break;
+
+	case KeyValues::TYPE_INT:
+		pKey->SetInt( NULL, node.m_iValue );
+		break;
+
+	case KeyValues::TYPE_FLOAT:
+		pKey->SetFloat( NULL, node.m_flValue );
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Loads the compiled copy of a script, NULL if there isn't one made
+//			from the script as it is now
+//-----------------------------------------------------------------------------
+static KeyValues *ScriptCache_Load( IFileSystem *filesystem, const char *pszCacheFilename, uint32 nSourceSize, CRC32_t nSourceCRC,
+									const unsigned char *pICEKey, const char *pszRootName )
+{
+	CUtlBuffer file;
+	if ( !filesystem->ReadFile( pszCacheFilename, "MOD", file ) )
+		return NULL;
+
+	if ( file.TellPut() < (int)sizeof( ScriptCacheHeader_t ) )
+		return NULL;
+
+	ScriptCacheHeader_t *pHeader = (ScriptCacheHeader_t *)file.Base();
+	if ( pHeader->m_nMagic != SCRIPTCACHE_MAGIC || pHeader->m_nVersion != SCRIPTCACHE_VERSION )
+		return NULL;
+
+	// the script has changed since
+	if ( pHeader->m_nSourceSize != nSourceSize || pHeader->m_nSourceCRC != nSourceCRC )
+		return NULL;
+
+	uint32 nNodeBytes = pHeader->m_nNodes * sizeof( ScriptCacheNode_t );
+	if ( pHeader->m_nNodes > pHeader->m_nBodySize / sizeof( ScriptCacheNode_t ) ||
+		 nNodeBytes + pHeader->m_nStringBytes > pHeader->m_nBodySize ||
+		 pHeader->m_nBodySize % SCRIPTCACHE_BLOCK_SIZE ||
+		 pHeader->m_nBodySize != file.TellPut() - sizeof( ScriptCacheHeader_t ) )
+		return NULL;
+
+	unsigned char *pBody = (unsigned char *)file.Base() + sizeof( ScriptCacheHeader_t );
+	if ( pICEKey )
+		UTIL_DecodeICE( pBody, pHeader->m_nBodySize, pICEKey );
+
+	if ( CRC32_ProcessSingleBuffer( pBody, pHeader->m_nBodySize ) != pHeader->m_nBodyCRC )
+		return NULL;
+
+	const ScriptCacheNode_t *pNodes = (const ScriptCacheNode_t *)pBody;
+	const char *pStrings = (const char *)pBody + nNodeBytes;
+	if ( !ScriptCache_Validate( pNodes, pHeader->m_nNodes, pStrings, pHeader->m_nStringBytes ) )
+		return NULL;
+
+	// top level keys are peers of the root, like LoadFromBuffer makes them
+	KeyValues *pKV = new KeyValues( pszRootName );
+	KeyValues *pPrevious = NULL;
+	for ( int iNode = 0; iNode != -1; iNode = pNodes[iNode].m_iNextPeer )
+	{
+		KeyValues *pKey = pKV;
+		if ( pPrevious )
+		{
+			pKey = new KeyValues( pStrings + pNodes[iNode].m_iName );
+			pPrevious->SetNextKey( pKey );
+		}
+		else
+		{
+			pKey->SetName( pStrings + pNodes[iNode].m_iName );
+		}
+
+		ScriptCache_BuildKey( pKey, pNodes, iNode, pStrings );
+		pPrevious = pKey;
+	}
+
+	return pKV;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads a KeyValues script file through the cache
+//-----------------------------------------------------------------------------
+KeyValues *ScriptCache_ReadKVFile( IFileSystem *filesystem, const char *pszFilename, const char *pszPathID,
+								   const unsigned char *pICEKey, const char *pszRootName )
+{
+	VPROF_BUDGET( "ScriptCache_ReadKVFile", VPROF_BUDGETGROUP_OTHER_FILESYSTEM );
+
+	// the script itself is still read, it's what the cache is checked against
+	CUtlBuffer source;
+	if ( !filesystem->ReadFile( pszFilename, pszPathID, source ) )
+		return NULL;
+
+	uint32 nSourceSize = source.TellPut();
+	CRC32_t nSourceCRC = CRC32_ProcessSingleBuffer( source.Base(), nSourceSize );
+
+	char szCacheFilename[MAX_PATH];
+	ScriptCache_GetFilename( pszFilename, szCacheFilename, sizeof( szCacheFilename ) );
+
+	bool bTrusted = ScriptCache_IsTrusted();
+
+	KeyValues *pKV = bTrusted ? ScriptCache_Load( filesystem, szCacheFilename, nSourceSize, nSourceCRC, pICEKey, pszRootName ) : NULL;
+	if ( pKV )
+		return pKV;
+
+	// out of date or not there, parse the text
+	if ( pICEKey )
+		UTIL_DecodeICE( (unsigned char *)source.Base(), nSourceSize, pICEKey );
+
+	// null terminated twice in case it's a unicode file, like LoadFromFile does
+	source.PutChar( 0 );
+	source.PutChar( 0 );
+
+	pKV = new KeyValues( pszRootName );
+	if ( !pKV->LoadFromBuffer( pszFilename, (const char *)source.Base(), filesystem ) )
+	{
+		pKV->deleteThis();
+		return NULL;
+	}
+
+	// Only this file's CRC is checked, so anything that pulls in other files or
+	// depends on the platform it's parsed on has to stay as text
+	const char *pszText = (const char *)source.Base();
+	if ( !bTrusted || Q_strstr( pszText, "#include" ) || Q_strstr( pszText, "#base" ) || Q_strstr( pszText, "[$" ) )
+		return pKV;
+
+	CScriptCacheCompiler compiler;
+	if ( compiler.Compile( pKV ) )
+	{
+		if ( compiler.Write( filesystem, szCacheFilename, nSourceSize, nSourceCRC, pICEKey ) )
+			DevMsg( 2, "Compiled %s to %s\n", pszFilename, szCacheFilename );
+		else
+			DevWarning( "Couldn't write %s\n", szCacheFilename );
+	}
+
+	return pKV;
+}
@@ -0,0 +1,34 @@
+/// =============== Fortress Forever ==============
+/// ======== A modification for Half-Life 2 =======
+///
+/// @file ff_scriptcache.h
+/// @brief Compiled copies of the weapon, class and grenade scripts
+///
+/// REVISIONS
+/// ---------
+/// Scripts read through ReadEncryptedKVFile are compiled to a flat array of
+/// nodes and a string table the first time they're parsed. After that the
+/// compiled copy is loaded instead of tokenizing the text, for as long as
+/// the CRC of the script file still matches the one it was compiled from.
+/// Clients of remote servers, whose scripts sv_pure checks, always use the
+/// text.
+
+#ifndef FF_SCRIPTCACHE_H
+#define FF_SCRIPTCACHE_H
+
+#ifdef _WIN32
+#pragma once
+#endif
+
+class IFileSystem;
+class KeyValues;
+
+bool ScriptCache_IsEnabled();
+
+// Reads a KeyValues script file, from the cache if it's up to date and from
+// the text otherwise, compiling it for next time. pICEKey is for .ctx files,
+// NULL for plain text ones. Returns NULL if the file is missing or bad.
+KeyValues *ScriptCache_ReadKVFile( IFileSystem *filesystem, const char *pszFilename, const char *pszPathID,
+								   const unsigned char *pICEKey, const char *pszRootName );
+
+#endif // FF_SCRIPTCACHE_H
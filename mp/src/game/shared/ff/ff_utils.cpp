@@ -776,24 +776,18 @@ void FF_LuaHudBox(CFFPlayer *pPlayer, const char *pszIdentifier, int x, int y, i
 	CSingleUserRecipientFilter user(pPlayer);
 	user.MakeReliable();
 
+	int values[] =
+	{
+		_scriptman.GetOrAddHudElementIndex(pszIdentifier),
+		x, y, iWidth, iHeight,
+		clr.r(), clr.g(), clr.b(), clr.a(),
+		clrBorder.r(), clrBorder.g(), clrBorder.b(), clrBorder.a(),
+		iBorderWidth, iAlignX, iAlignY
+	};
+
 	UserMessageBegin(user, "FF_HudLua");
 		WRITE_BYTE(HUD_BOX);
-		WRITE_SHORT(_scriptman.GetOrAddHudElementIndex(pszIdentifier));
-		WRITE_SHORT(x);
-		WRITE_SHORT(y);
-		WRITE_SHORT(iWidth);
-		WRITE_SHORT(iHeight);
-		WRITE_SHORT(clr.r());
-		WRITE_SHORT(clr.g());
-		WRITE_SHORT(clr.b());
-		WRITE_SHORT(clr.a());
-		WRITE_SHORT(clrBorder.r());
-		WRITE_SHORT(clrBorder.g());
-		WRITE_SHORT(clrBorder.b());
-		WRITE_SHORT(clrBorder.a());
-		WRITE_SHORT(iBorderWidth);
-		WRITE_SHORT(iAlignX);
-		WRITE_SHORT(iAlignY);
+		WRITE_SHORTS(values, ARRAYSIZE(values));
 	MessageEnd();
 }
 
@@ -846,13 +840,8 @@ void FF_LuaHudTextColored(CFFPlayer* pPlayer, const char* pszIdentifier, const c
 	WRITE_SHORT(x);
 	WRITE_SHORT(y);
 	WRITE_STRING(pszText);
-	WRITE_SHORT(r);
-	WRITE_SHORT(g);
-	WRITE_SHORT(b);
-	WRITE_SHORT(a);
-	WRITE_SHORT(iAlignX);
-	WRITE_SHORT(iAlignY);
-	WRITE_SHORT(iSize);
+	int values[] = { r, g, b, a, iAlignX, iAlignY, iSize };
+	WRITE_SHORTS(values, ARRAYSIZE(values));
 	MessageEnd();
 }
 
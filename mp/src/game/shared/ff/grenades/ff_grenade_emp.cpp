@@ -24,6 +24,7 @@
 	#include "beam_flags.h"
 	#include "ff_entity_system.h"
 	#include "te_effect_dispatch.h"
+	#include "ff_nailmanager.h"
 #endif
 
 extern short g_sModelIndexFireball;
@@ -45,6 +46,7 @@ int g_iEmpRingTexture = -1;
 	ConVar emp_amplitude("ffdev_emp_amplitude","1",FCVAR_FF_FFDEV_CLIENT,"amplitude of the emp shockwave");
 	ConVar emp_speed("ffdev_emp_speed","0",FCVAR_FF_FFDEV_CLIENT,"speed of the emp shockwave");
 	ConVar emp_buildable_damage("ffdev_emp_buildable_damage","10.0",FCVAR_FF_FFDEV_CLIENT,"Amount of damage to deal to sentryguns and dispensers in the emp radius.");
+	ConVar sv_emp_detonatenails("sv_emp_detonatenails","1",FCVAR_NOTIFY,"Nails caught in an emp blow up like other projectiles. 0 just removes them, as pooled nails (ffdev_nail_pooled) otherwise would.");
 #endif
 
 IMPLEMENT_NETWORKCLASS_ALIASED(FFGrenadeEmp, DT_FFGrenadeEmp)
@@ -113,66 +115,91 @@ PRECACHE_WEAPON_REGISTER( ff_grenade_emp );
 					// For all other projectiles or objects that return
 					// something from TakeEmp we gotta add the explosions
 					// ourselves
-
-					trace_t		tr;						
-					Vector		vecOrigin = pEntity->GetAbsOrigin();
-
-					// Traceline to check if we should do scorch marks on the floor						
-					UTIL_TraceLine( vecOrigin + Vector( 0, 0, 2.0f ), vecOrigin - Vector( 0, 0, FF_DECALTRACE_TRACE_DIST ), MASK_SHOT_HULL, pEntity, COLLISION_GROUP_NONE, &tr);
-
-					// Explode now
-					if( tr.fraction != 1.0 )
-					{
-						Vector vecNormal = tr.plane.normal;
-						surfacedata_t *pdata = physprops->GetSurfaceData( tr.surface.surfaceProps );	
-						CPASFilter filter( vecOrigin );
-
-						te->Explosion( filter, -1.0, // don't apply cl_interp delay
-							&vecOrigin,
-							!pEntity->GetWaterLevel() ? g_sModelIndexFireball : g_sModelIndexWExplosion,
-							m_DmgRadius * .03, 
-							25,
-							TE_EXPLFLAG_NONE,
-							m_DmgRadius,
-							m_flDamage,
-							&vecNormal,
-							( char )pdata->game.material );
-
-						// Normal decals since trace hit something
-						UTIL_DecalTrace( &tr, "Scorch" );
-					}
-					else
-					{
-						CPASFilter filter( vecOrigin );
-
-						te->Explosion( filter, -1.0, // don't apply cl_interp delay
-							&vecOrigin, 
-							!pEntity->GetWaterLevel() != 0 ? g_sModelIndexFireball : g_sModelIndexWExplosion,
-							m_DmgRadius * .03, 
-							25,
-							TE_EXPLFLAG_NONE,
-							m_DmgRadius,
-							m_flDamage );
-
-						// Trace hit nothing so do custom scorch mark finding
-						FF_DecalTrace( pEntity, FF_DECALTRACE_TRACE_DIST, "Scorch" );
-					}
-
-					CTakeDamageInfo info( this, GetOwnerEntity(), GetBlastForce(), pEntity->GetAbsOrigin(), explode, DMG_SHOCK, 0, &vecOrigin );
-					RadiusDamage( info, pEntity->GetAbsOrigin(), m_DmgRadius, CLASS_NONE, NULL );
-						
-					EmitSound( "BaseGrenade.Explode" );
-
-					UTIL_ScreenShake( pEntity->GetAbsOrigin(), explode, 150.0, 1.0, radius, SHAKE_START );
-
+					EmpExplosion( pEntity, pEntity->GetAbsOrigin(), explode, pEntity->GetWaterLevel() != 0, radius );
 					break;
 				}
 			}
 		}
 
+		// Pooled nails aren't entities so the sphere query can't find them
+		if( sv_emp_detonatenails.GetBool() )
+		{
+			CUtlVector< CFFNailManager::RemovedNail_t > nails;
+			FFNailManager()->RemoveNailsInSphere( GetAbsOrigin(), radius, &nails );
+
+			for( int i = 0; i < nails.Count(); i++ )
+			{
+				// Same as what the entity nails' TakeEmp() gave back
+				if( int explode = (int)nails[i].m_flDamage )
+					EmpExplosion( NULL, nails[i].m_vecOrigin, explode, ( UTIL_PointContents( nails[i].m_vecOrigin ) & MASK_WATER ) != 0, radius );
+			}
+		}
+		else
+		{
+			FFNailManager()->RemoveNailsInSphere( GetAbsOrigin(), radius );
+		}
+
 		UTIL_Remove(this);
 	}
 
+	//-----------------------------------------------------------------------------
+	// Purpose: Blow up something the emp set off. pEntity is NULL for a
+	//			pooled nail, which has no entity.
+	//-----------------------------------------------------------------------------
+	void CFFGrenadeEmp::EmpExplosion( CBaseEntity *pEntity, const Vector &vecOrigin, int explode, bool bInWater, float radius )
+	{
+		trace_t		tr;
+
+		// Traceline to check if we should do scorch marks on the floor						
+		UTIL_TraceLine( vecOrigin + Vector( 0, 0, 2.0f ), vecOrigin - Vector( 0, 0, FF_DECALTRACE_TRACE_DIST ), MASK_SHOT_HULL, pEntity, COLLISION_GROUP_NONE, &tr);
+
+		// Explode now
+		if( tr.fraction != 1.0 )
+		{
+			Vector vecNormal = tr.plane.normal;
+			surfacedata_t *pdata = physprops->GetSurfaceData( tr.surface.surfaceProps );	
+			CPASFilter filter( vecOrigin );
+
+			te->Explosion( filter, -1.0, // don't apply cl_interp delay
+				&vecOrigin,
+				!bInWater ? g_sModelIndexFireball : g_sModelIndexWExplosion,
+				m_DmgRadius * .03, 
+				25,
+				TE_EXPLFLAG_NONE,
+				m_DmgRadius,
+				m_flDamage,
+				&vecNormal,
+				( char )pdata->game.material );
+
+			// Normal decals since trace hit something
+			UTIL_DecalTrace( &tr, "Scorch" );
+		}
+		else
+		{
+			CPASFilter filter( vecOrigin );
+
+			te->Explosion( filter, -1.0, // don't apply cl_interp delay
+				&vecOrigin, 
+				!bInWater ? g_sModelIndexFireball : g_sModelIndexWExplosion,
+				m_DmgRadius * .03, 
+				25,
+				TE_EXPLFLAG_NONE,
+				m_DmgRadius,
+				m_flDamage );
+
+			// Trace hit nothing so do custom scorch mark finding
+			if( pEntity )
+				FF_DecalTrace( pEntity, FF_DECALTRACE_TRACE_DIST, "Scorch" );
+		}
+
+		CTakeDamageInfo info( this, GetOwnerEntity(), GetBlastForce(), vecOrigin, explode, DMG_SHOCK, 0, &vecOrigin );
+		RadiusDamage( info, vecOrigin, m_DmgRadius, CLASS_NONE, NULL );
+			
+		EmitSound( "BaseGrenade.Explode" );
+
+		UTIL_ScreenShake( vecOrigin, explode, 150.0, 1.0, radius, SHAKE_START );
+	}
+
 	//----------------------------------------------------------------------------
 	// Purpose: Fire explosion sound early
 	//----------------------------------------------------------------------------
@@ -51,6 +51,7 @@ public:
 #else
 	virtual void Spawn();
 	virtual void Explode(trace_t *pTrace, int bitsDamageType);
+	void EmpExplosion( CBaseEntity *pEntity, const Vector &vecOrigin, int explode, bool bInWater, float radius );
 	void SetWarned( void ) { m_bWarned = true; }
 
 	void GrenadeThink( void );
@@ -29,6 +29,7 @@
 	#include "te_effect_dispatch.h"
 	#include "ff_entity_system.h"
 	#include "ai_basenpc.h"
+	#include "ff_areaeffectmanager.h"
 #endif
 
 
@@ -55,13 +56,14 @@ public:
 
 	virtual color32 GetColour() { color32 col = { 20, 168, 20, GREN_ALPHA_DEFAULT }; return col; }
 
+	virtual void UpdateOnRemove( void );
+
 #ifdef CLIENT_DLL
 	CFFGrenadeGas() {}
 	CFFGrenadeGas( const CFFGrenadeGas& ) {}
 
 	virtual void ClientThink();
 	virtual void OnDataChanged(DataUpdateType_t updateType);
-	virtual void UpdateOnRemove( void );
 
 	CSmartPtr<CGasCloud>	m_pGasEmitter;
 
@@ -79,6 +81,8 @@ protected:
 	float m_flNextPuff;
 
 	Vector	m_vecLastPosition;
+
+	AreaEffectHandle_t	m_hAreaEffect;
 #endif
 };
 
@@ -124,6 +128,18 @@ END_NETWORK_TABLE()
 		m_bIsEmitting = 0;
 
 		m_vecLastPosition = vec3_origin;
+
+		m_hAreaEffect = AREAEFFECT_INVALID_HANDLE;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: Stop gassing
+	//-----------------------------------------------------------------------------
+	void CFFGrenadeGas::UpdateOnRemove( void )
+	{
+		FFAreaEffectManager()->RemoveVolume( m_hAreaEffect );
+
+		BaseClass::UpdateOnRemove();
 	}
 
 	//-----------------------------------------------------------------------------
@@ -207,16 +223,19 @@ END_NETWORK_TABLE()
 				EmitSound(GAS_SOUND);
 			}
 
-			CBaseEntity *pEntity = NULL;
-			for( CEntitySphereQuery sphere( GetAbsOrigin(), GetGrenadeRadius() ); ( pEntity = sphere.GetCurrentEntity() ) != NULL; sphere.NextEntity() )
+			if( m_hAreaEffect == AREAEFFECT_INVALID_HANDLE )
 			{
-				if( !pEntity )
-					continue;
+				AreaEffectDesc_t desc;
+				desc.m_flRadius = GetGrenadeRadius();
+				m_hAreaEffect = FFAreaEffectManager()->AddVolume( this, desc );
+			}
 
-				if( !pEntity->IsPlayer() )
-					continue;
+			CUtlVector<CBaseEntity *> inside;
+			FFAreaEffectManager()->GetEntitiesInVolume( m_hAreaEffect, inside );
 
-				CFFPlayer *pPlayer = ToFFPlayer( pEntity );
+			for( int i = 0; i < inside.Count(); i++ )
+			{
+				CFFPlayer *pPlayer = ToFFPlayer( inside[i] );
 				CFFPlayer *pGasser = ToFFPlayer( GetOwnerEntity() );
 
 				if( !pPlayer || pPlayer->IsObserver() || !pGasser)
@@ -23,6 +23,8 @@
 #ifdef GAME_DLL
 	#include "ff_entity_system.h"
 	#include "te_effect_dispatch.h"
+	#include "mathlib/ssemath.h"
+	#include "tier0/vprof.h"
 #else
 	#include "c_te_effect_dispatch.h"
 #endif
@@ -97,6 +99,15 @@
 	#define LASERGREN_EXPLOSIONRADIUS 180.0f
 	//ConVar ffdev_lasergren_hitdelay("ffdev_lasergren_hitdelay", "0.15", FCVAR_FF_FFDEV, "Delay between ticks of damage");
 	#define LASERGREN_HITDELAY 0.15f //ffdev_lasergren_hitdelay.GetFloat()
+
+	// A beam's world clip is traced again once it's turned or moved this far
+	#define LASERGREN_CLIP_YAW_TOLERANCE 2.0f
+	#define LASERGREN_CLIP_MOVE_TOLERANCE 4.0f
+	// Targets this far past the clip are still traced, in case it's gone stale
+	#define LASERGREN_CLIP_SLACK 16.0f
+
+	// Players and the three buildables each of them can own
+	#define LASERGREN_MAX_TARGETS (MAX_PLAYERS * 4)
 #endif
 
 class CFFGrenadeLaser : public CFFGrenadeBase
@@ -136,16 +147,32 @@ public:
 	virtual float GetGrenadeDamage()		{ return LASERGREN_EXPLOSIONDAMAGE; }
 	virtual float GetGrenadeRadius()		{ return LASERGREN_EXPLOSIONRADIUS; }
 
+	bool CanHitYet( CBaseEntity *pEntity ) const;
 	bool SetNextHitTime( CBaseEntity *pEntity, float flDelay );
 	void ClearHitTimes();
 
 protected:
+	float GetBeamClip( int iBeam, const Vector &vecOrigin, float flYaw, const Vector &vecDirection );
+
+	struct LaserHitTime_t
+	{
+		EHANDLE	m_hEntity;
+		float	m_flNextHit;
+	};
+
 	float	m_flBeams;
 	float	m_flNailSpit;
 	float	m_flAngleOffset;
 	int		m_iOffset;
 	float	m_flLastThinkTime;
-	CUtlMap<CBaseEntity*, float>	m_HitEntities;
+
+	// Damage cooldowns, indexed by entindex
+	CUtlVector<LaserHitTime_t>	m_HitTimes;
+
+	// How far each beam gets before hitting the world, negative if it needs tracing
+	float	m_flBeamClip[MAX_BEAMS];
+	float	m_flBeamClipYaw[MAX_BEAMS];
+	Vector	m_vecBeamClipOrigin[MAX_BEAMS];
 
 #endif
 };
@@ -237,11 +264,28 @@ float CFFGrenadeLaser::getLengthPercent()
 		m_iOffset = 0;
 		SetLocalAngularVelocity(QAngle(0, 0, 0));
 
-		SetDefLessFunc( m_HitEntities );
 		ClearHitTimes();
 		m_bPlayingDeploySound = 0;
 	}
 
+	//-----------------------------------------------------------------------------
+	// Purpose: Whether the entity's damage cooldown has run out
+	//-----------------------------------------------------------------------------
+	bool CFFGrenadeLaser::CanHitYet( CBaseEntity *pEntity ) const
+	{
+		int iSlot = pEntity->entindex();
+
+		if (iSlot < 0 || iSlot >= m_HitTimes.Count())
+			return true;
+
+		// The slot could have been reused by something else since
+		const LaserHitTime_t &hit = m_HitTimes[iSlot];
+		if (hit.m_hEntity.Get() != pEntity)
+			return true;
+
+		return gpGlobals->curtime >= hit.m_flNextHit;
+	}
+
 	//-----------------------------------------------------------------------------
 	// Purpose: Set the next time a player is able to be damaged
 	//			Doubles as a check if we can hit them
@@ -251,25 +295,50 @@ float CFFGrenadeLaser::getLengthPercent()
 		if (!pEntity)
 			return false;
 
-		int index = m_HitEntities.Find(pEntity);
+		// not able to hit yet
+		if (!CanHitYet(pEntity))
+			return false;
 
-		// already added
-		if (index != m_HitEntities.InvalidIndex())
-		{
-			float flNextHit = m_HitEntities.Element( index );
+		int iSlot = pEntity->entindex();
+		if (iSlot < 0)
+			return false;
 
-			// not able to hit yet
-			if (gpGlobals->curtime < flNextHit)
-				return false;
-		}
-		
-		m_HitEntities.InsertOrReplace(pEntity, gpGlobals->curtime + flDelay);
+		if (iSlot >= m_HitTimes.Count())
+			m_HitTimes.AddMultipleToTail(iSlot + 1 - m_HitTimes.Count());
+
+		m_HitTimes[iSlot].m_hEntity = pEntity;
+		m_HitTimes[iSlot].m_flNextHit = gpGlobals->curtime + flDelay;
 		return true;
 	}
 
 	void CFFGrenadeLaser::ClearHitTimes( void )
 	{
-		m_HitEntities.RemoveAll();
+		m_HitTimes.RemoveAll();
+
+		for (int i = 0; i < MAX_BEAMS; i++)
+			m_flBeamClip[i] = -1.0f;
+	}
+
+	//-----------------------------------------------------------------------------
+	// Purpose: How far along the beam the world is. The grenade turns a little
+	//			each tick, so this is only traced again once the beam has moved
+	//			far enough that the last trace might not hold any more.
+	//-----------------------------------------------------------------------------
+	float CFFGrenadeLaser::GetBeamClip( int iBeam, const Vector &vecOrigin, float flYaw, const Vector &vecDirection )
+	{
+		if (m_flBeamClip[iBeam] < 0.0f ||
+			fabs(AngleDiff(flYaw, m_flBeamClipYaw[iBeam])) > LASERGREN_CLIP_YAW_TOLERANCE ||
+			vecOrigin.DistToSqr(m_vecBeamClipOrigin[iBeam]) > LASERGREN_CLIP_MOVE_TOLERANCE * LASERGREN_CLIP_MOVE_TOLERANCE)
+		{
+			trace_t tr;
+			UTIL_TraceLine( vecOrigin, vecOrigin + vecDirection * LASERGREN_DISTANCE, MASK_SOLID_BRUSHONLY, this, COLLISION_GROUP_NONE, &tr );
+
+			m_flBeamClip[iBeam] = tr.fraction * LASERGREN_DISTANCE;
+			m_flBeamClipYaw[iBeam] = flYaw;
+			m_vecBeamClipOrigin[iBeam] = vecOrigin;
+		}
+
+		return m_flBeamClip[iBeam];
 	}
 
 	//-----------------------------------------------------------------------------
@@ -324,144 +393,234 @@ float CFFGrenadeLaser::getLengthPercent()
 		SetAbsVelocity(Vector(0, 0, flRisingheight + LASERGREN_BOB * sin(DEG2RAD(gpGlobals->curtime * 360 * LASERGREN_BOBFREQ))));
 		SetAbsAngles(GetAbsAngles() + QAngle(0, LASERGREN_ROTATION_PER_TICK, 0));
 
-		Vector vecDirection;
-		Vector vecOrigin = GetAbsOrigin();
-		QAngle angRadial = GetAbsAngles();
+		VPROF_BUDGET( "CFFGrenadeLaser::BeamEmit", VPROF_BUDGETGROUP_GAME );
+
+		float flLengthPercent = getLengthPercent();
 
-		//float flSize = 20.0f;
-		trace_t tr;
-		char i;
+		// don't allow dividing by zero
+		if (flLengthPercent == 0.0f)
+		{
+			SetNextThink( gpGlobals->curtime );
+			return;
+		}
 
+		Vector vecOrigin = GetAbsOrigin();
+		QAngle angRadial = GetAbsAngles();
+		float flLength = LASERGREN_DISTANCE * flLengthPercent;
 		float flDeltaAngle = 360.0f / LASERGREN_BEAMS;
 
-		CBaseEntity *pEntity = NULL;
-		for (CEntitySphereQuery sphere(vecOrigin, LASERGREN_DISTANCE * getLengthPercent()); (pEntity = sphere.GetCurrentEntity()) != NULL; sphere.NextEntity()) 
+		// The whole fan for this tick
+		Vector vecBeamDir[LASERGREN_BEAMS];
+		float flBeamYaw[LASERGREN_BEAMS];
+
+		for (int i = 0; i < LASERGREN_BEAMS; i++)
 		{
-			if (!pEntity)
-				continue;
+			AngleVectors(angRadial, &vecBeamDir[i]);
+			VectorNormalizeFast(vecBeamDir[i]);
+			flBeamYaw[i] = angRadial.y;
 
-			if (pEntity->m_takedamage == DAMAGE_NO) 
-				continue;
+			angRadial.y += flDeltaAngle;
+		}
 
-			// only interested in players, dispensers & sentry guns
-			if ( !(pEntity->IsPlayer() || pEntity->Classify() == CLASS_DISPENSER || pEntity->Classify() == CLASS_SENTRYGUN || pEntity->Classify() == CLASS_MANCANNON) )
+		// Gather everything that could be hit. Players come straight from the
+		// player list and buildables from their owners, rather than a sphere query.
+		CFFPlayer *pOwner = ToFFPlayer( GetOwnerEntity() );
+
+		CBaseEntity *pTargets[LASERGREN_MAX_TARGETS];
+		ALIGN16 float flOriginX[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		ALIGN16 float flOriginY[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		ALIGN16 float flOriginZ[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		ALIGN16 float flMinsX[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		ALIGN16 float flMinsY[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		ALIGN16 float flMinsZ[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		ALIGN16 float flMaxsX[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		ALIGN16 float flMaxsY[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		ALIGN16 float flMaxsZ[LASERGREN_MAX_TARGETS + 3] ALIGN16_POST;
+		int nTargets = 0;
+
+		for (int iPlayer = 1; iPlayer <= gpGlobals->maxClients; iPlayer++)
+		{
+			CFFPlayer *pPlayer = ToFFPlayer( UTIL_PlayerByIndex( iPlayer ) );
+			if (!pPlayer)
 				continue;
 
-			// If pTarget can take damage from nails...
-			if ( !g_pGameRules->FCanTakeDamage( pEntity, ToFFPlayer( GetOwnerEntity() ) ) )
-				continue;
+			CBaseEntity *pCandidates[] = { pPlayer, pPlayer->GetDispenser(), pPlayer->GetSentryGun(), pPlayer->GetManCannon() };
 
-			if (pEntity->IsPlayer())
+			for (int iCandidate = 0; iCandidate < ARRAYSIZE( pCandidates ); iCandidate++)
 			{
-				CFFPlayer *pPlayer = ToFFPlayer(pEntity);
+				CBaseEntity *pEntity = pCandidates[iCandidate];
 
-				if( pPlayer && (!pPlayer->IsAlive() || pPlayer->IsObserver()) )
+				if (!pEntity)
 					continue;
-			}
-			if (FF_IsBuildableObject(pEntity))
-			{
-				// Is this a buildable of some sort
-				CFFBuildableObject *pBuildable = FF_ToBuildableObject(pEntity);
 
-				// Skip objects that are building
-				if(pBuildable && !pBuildable->IsBuilt())
+				if (pEntity->m_takedamage == DAMAGE_NO)
 					continue;
-			}
 
-			Vector vecMin = pEntity->WorldAlignMins();
-			Vector vecMax = pEntity->WorldAlignMaxs();
+				// If pTarget can take damage from nails...
+				if ( !g_pGameRules->FCanTakeDamage( pEntity, pOwner ) )
+					continue;
 
-			// check if the entity is below all the lasers
-			if (pEntity->GetAbsOrigin().z + vecMax.z < vecOrigin.z - LASERGREN_LASERRADIUS)
-				continue;
+				if (pEntity == pPlayer)
+				{
+					if (!pPlayer->IsAlive() || pPlayer->IsObserver())
+						continue;
+				}
+				else
+				{
+					// Skip objects that are building
+					CFFBuildableObject *pBuildable = FF_ToBuildableObject(pEntity);
+					if (pBuildable && !pBuildable->IsBuilt())
+						continue;
+				}
 
-			// check if the entity is above all the lasers
-			if (pEntity->GetAbsOrigin().z + vecMin.z > vecOrigin.z + LASERGREN_LASERRADIUS)
-				continue;
+				Vector vecMins, vecMaxs;
+				pEntity->CollisionProp()->WorldSpaceAABB( &vecMins, &vecMaxs );
 
-			Vector vecDirection;
-			QAngle angRadial = GetAbsAngles();
-			// check each laser
-			for( i = 0; i < LASERGREN_BEAMS; i++ )
-			{
-				AngleVectors(angRadial, &vecDirection);
-				VectorNormalizeFast(vecDirection);
+				// check if the entity is below or above all the lasers
+				if (vecMaxs.z < vecOrigin.z - LASERGREN_LASERRADIUS || vecMins.z > vecOrigin.z + LASERGREN_LASERRADIUS)
+					continue;
 
-				Vector vecToEnt = pEntity->GetAbsOrigin() - vecOrigin;
+				const Vector &vecEntOrigin = pEntity->GetAbsOrigin();
 
-				if (vecToEnt.Length2D() > LASERGREN_DISTANCE * getLengthPercent() + 2*LASERGREN_LASERRADIUS)
-				{
-					angRadial.y += flDeltaAngle;
+				// too far away for any of the lasers
+				if ((vecEntOrigin - vecOrigin).Length2DSqr() > Square( flLength + 2*LASERGREN_LASERRADIUS ))
 					continue;
-				}
 
-				float dot = DotProduct( vecDirection, vecToEnt );
+				pTargets[nTargets] = pEntity;
+				flOriginX[nTargets] = vecEntOrigin.x;
+				flOriginY[nTargets] = vecEntOrigin.y;
+				flOriginZ[nTargets] = vecEntOrigin.z;
+				flMinsX[nTargets] = vecMins.x;
+				flMinsY[nTargets] = vecMins.y;
+				flMinsZ[nTargets] = vecMins.z;
+				flMaxsX[nTargets] = vecMaxs.x;
+				flMaxsY[nTargets] = vecMaxs.y;
+				flMaxsZ[nTargets] = vecMaxs.z;
+				nTargets++;
+			}
+		}
+
+		if (nTargets == 0)
+		{
+			SetNextThink( gpGlobals->curtime );
+			return;
+		}
+
+		// Pad out the last group of four, the mask below ignores these
+		for (int i = nTargets; i < ((nTargets + 3) & ~3); i++)
+		{
+			flOriginX[i] = flOriginY[i] = flOriginZ[i] = 0.0f;
+			flMinsX[i] = flMinsY[i] = flMinsZ[i] = 0.0f;
+			flMaxsX[i] = flMaxsY[i] = flMaxsZ[i] = 0.0f;
+		}
+
+		fltx4 fl4OriginX = ReplicateX4( vecOrigin.x );
+		fltx4 fl4OriginY = ReplicateX4( vecOrigin.y );
+		fltx4 fl4OriginZ = ReplicateX4( vecOrigin.z );
+		fltx4 fl4GapMinSqr = ReplicateX4( Square( LASERGREN_CENTERGAP - LASERGREN_LASERRADIUS ) );
+		fltx4 fl4RadiusSqr = ReplicateX4( Square( LASERGREN_LASERRADIUS ) );
+
+		// Test all the targets against each laser, four at a time. This is the
+		// same test as it's always been (closest point on the laser to the
+		// entity, then the nearest point on the entity's box to that), just
+		// done for four entities at once.
+		for (int iBeam = 0; iBeam < LASERGREN_BEAMS; iBeam++)
+		{
+			const Vector &vecDirection = vecBeamDir[iBeam];
+			Vector vecLaser = vecDirection * flLength;
+			Vector vecLaserGap = vecDirection * LASERGREN_CENTERGAP;
+
+			fltx4 fl4DirX = ReplicateX4( vecDirection.x );
+			fltx4 fl4DirY = ReplicateX4( vecDirection.y );
+			fltx4 fl4DirZ = ReplicateX4( vecDirection.z );
+			fltx4 fl4LaserX = ReplicateX4( vecLaser.x );
+			fltx4 fl4LaserY = ReplicateX4( vecLaser.y );
+			fltx4 fl4LaserZ = ReplicateX4( vecLaser.z );
+			fltx4 fl4InvLaserSqr = ReplicateX4( 1.0f / DotProduct( vecLaser, vecLaser ) );
+			fltx4 fl4GapX = ReplicateX4( vecLaserGap.x );
+			fltx4 fl4GapY = ReplicateX4( vecLaserGap.y );
+			fltx4 fl4GapZ = ReplicateX4( vecLaserGap.z );
+			fltx4 fl4InvGapSqr = ReplicateX4( 1.0f / DotProduct( vecLaserGap, vecLaserGap ) );
+
+			for (int iGroup = 0; iGroup < nTargets; iGroup += 4)
+			{
+				fltx4 fl4MinsX = LoadAlignedSIMD( &flMinsX[iGroup] );
+				fltx4 fl4MinsY = LoadAlignedSIMD( &flMinsY[iGroup] );
+				fltx4 fl4MinsZ = LoadAlignedSIMD( &flMinsZ[iGroup] );
+				fltx4 fl4MaxsX = LoadAlignedSIMD( &flMaxsX[iGroup] );
+				fltx4 fl4MaxsY = LoadAlignedSIMD( &flMaxsY[iGroup] );
+				fltx4 fl4MaxsZ = LoadAlignedSIMD( &flMaxsZ[iGroup] );
+
+				// vecToEnt
+				fltx4 fl4ToEntX = SubSIMD( LoadAlignedSIMD( &flOriginX[iGroup] ), fl4OriginX );
+				fltx4 fl4ToEntY = SubSIMD( LoadAlignedSIMD( &flOriginY[iGroup] ), fl4OriginY );
+				fltx4 fl4ToEntZ = SubSIMD( LoadAlignedSIMD( &flOriginZ[iGroup] ), fl4OriginZ );
 
 				// player is behind the laser
-				if (dot < 0)
-				{
-					angRadial.y += flDeltaAngle;
-					continue;
-				}
+				fltx4 fl4Dot = MaddSIMD( fl4ToEntX, fl4DirX, MaddSIMD( fl4ToEntY, fl4DirY, MulSIMD( fl4ToEntZ, fl4DirZ ) ) );
+				fltx4 fl4Hit = CmpGeSIMD( fl4Dot, Four_Zeros );
 
-				// don't allow dividing by zero
-				if (getLengthPercent() == 0.0f)
-				{
-					angRadial.y += flDeltaAngle;
-					continue;
-				}
-				
 				// check if inside the center gap
-				if (LASERGREN_CENTERGAP > 0)
+				fltx4 fl4Ratio = MulSIMD( MaddSIMD( fl4ToEntX, fl4GapX, MaddSIMD( fl4ToEntY, fl4GapY, MulSIMD( fl4ToEntZ, fl4GapZ ) ) ), fl4InvGapSqr );
+				fltx4 fl4PointX = MinSIMD( MaxSIMD( MaddSIMD( fl4Ratio, fl4GapX, fl4OriginX ), fl4MinsX ), fl4MaxsX );
+				fltx4 fl4PointY = MinSIMD( MaxSIMD( MaddSIMD( fl4Ratio, fl4GapY, fl4OriginY ), fl4MinsY ), fl4MaxsY );
+				fltx4 fl4PointZ = MinSIMD( MaxSIMD( MaddSIMD( fl4Ratio, fl4GapZ, fl4OriginZ ), fl4MinsZ ), fl4MaxsZ );
+				fltx4 fl4DeltaX = SubSIMD( fl4PointX, fl4OriginX );
+				fltx4 fl4DeltaY = SubSIMD( fl4PointY, fl4OriginY );
+				fltx4 fl4DeltaZ = SubSIMD( fl4PointZ, fl4OriginZ );
+				fltx4 fl4DistSqr = MaddSIMD( fl4DeltaX, fl4DeltaX, MaddSIMD( fl4DeltaY, fl4DeltaY, MulSIMD( fl4DeltaZ, fl4DeltaZ ) ) );
+				fl4Hit = AndSIMD( fl4Hit, CmpGeSIMD( fl4DistSqr, fl4GapMinSqr ) );
+
+				// outside of the laser radius
+				fl4Ratio = MulSIMD( MaddSIMD( fl4ToEntX, fl4LaserX, MaddSIMD( fl4ToEntY, fl4LaserY, MulSIMD( fl4ToEntZ, fl4LaserZ ) ) ), fl4InvLaserSqr );
+				fltx4 fl4ClosestX = MaddSIMD( fl4Ratio, fl4LaserX, fl4OriginX );
+				fltx4 fl4ClosestY = MaddSIMD( fl4Ratio, fl4LaserY, fl4OriginY );
+				fl4DeltaX = SubSIMD( MinSIMD( MaxSIMD( fl4ClosestX, fl4MinsX ), fl4MaxsX ), fl4ClosestX );
+				fl4DeltaY = SubSIMD( MinSIMD( MaxSIMD( fl4ClosestY, fl4MinsY ), fl4MaxsY ), fl4ClosestY );
+				fl4DistSqr = MaddSIMD( fl4DeltaX, fl4DeltaX, MulSIMD( fl4DeltaY, fl4DeltaY ) );
+				fl4Hit = AndSIMD( fl4Hit, CmpLeSIMD( fl4DistSqr, fl4RadiusSqr ) );
+
+				int iHitMask = TestSignSIMD( fl4Hit );
+				if (nTargets - iGroup < 4)
+					iHitMask &= ( 1 << ( nTargets - iGroup ) ) - 1;
+
+				for (int iLane = 0; iHitMask; iLane++, iHitMask >>= 1)
 				{
-					Vector vecLaserGap = vecDirection * LASERGREN_CENTERGAP;
-					float gapratio = DotProduct( vecToEnt, vecLaserGap ) / DotProduct( vecLaserGap, vecLaserGap );
-					Vector vecLaserGapClosestPoint = vecOrigin + (gapratio * vecLaserGap);
-					
-					Vector gappoint;
-					pEntity->CollisionProp()->CalcNearestPoint( vecLaserGapClosestPoint, &gappoint );
-					Vector DistFromOrigin = gappoint - vecOrigin;
+					if (!(iHitMask & 1))
+						continue;
 
-					if (DistFromOrigin.Length() < LASERGREN_CENTERGAP - LASERGREN_LASERRADIUS)
-					{
-						angRadial.y += flDeltaAngle;
+					int iTarget = iGroup + iLane;
+					CBaseEntity *pEntity = pTargets[iTarget];
+
+					// No point tracing if it can't be hurt yet anyway
+					if (!CanHitYet( pEntity ))
 						continue;
-					}
-				}
-				
-				Vector vecLaser = vecDirection * LASERGREN_DISTANCE * getLengthPercent();
-				float ratio = DotProduct( vecToEnt, vecLaser ) / DotProduct( vecLaser, vecLaser );
-				Vector vecLaserClosestPoint = vecOrigin + (ratio * vecLaser);
-				
-				Vector point;
-				pEntity->CollisionProp()->CalcNearestPoint( vecLaserClosestPoint, &point );
-				Vector vecDistFromLaser = point - vecLaserClosestPoint;
-				vecDistFromLaser.z = 0;
 
-				//NDebugOverlay::Box(vecLaserClosestPoint, Vector(-2, -2, -2), Vector(2, 2, 2), 0, 0, 255, 127, 4);
-				//NDebugOverlay::Box(point, Vector(-2, -2, -2), Vector(2, 2, 2), 255, 0, 0, 127, 4);
+					Vector vecToEnt( flOriginX[iTarget] - vecOrigin.x, flOriginY[iTarget] - vecOrigin.y, flOriginZ[iTarget] - vecOrigin.z );
+					float ratio = DotProduct( vecToEnt, vecLaser ) / DotProduct( vecLaser, vecLaser );
+					Vector vecLaserClosestPoint = vecOrigin + (ratio * vecLaser);
 
-				float dist = vecDistFromLaser.Length();
+					Vector point;
+					pEntity->CollisionProp()->CalcNearestPoint( vecLaserClosestPoint, &point );
 
-				// outside of the laser radius
-				if (dist > LASERGREN_LASERRADIUS)
-				{
-					angRadial.y += flDeltaAngle;
-					continue;
-				}
+					//NDebugOverlay::Box(vecLaserClosestPoint, Vector(-2, -2, -2), Vector(2, 2, 2), 0, 0, 255, 127, 4);
+					//NDebugOverlay::Box(point, Vector(-2, -2, -2), Vector(2, 2, 2), 255, 0, 0, 127, 4);
 
-				Vector startpos = vecOrigin + vecDirection * LASERGREN_CENTERGAP;
+					// behind a wall
+					if (DotProduct( point - vecOrigin, vecDirection ) > GetBeamClip( iBeam, vecOrigin, flBeamYaw[iBeam], vecDirection ) + LASERGREN_CLIP_SLACK)
+						continue;
 
-				//make sure theres nothing in the way
-				trace_t tr;
-				UTIL_TraceLine( startpos, 
-								point, 
-								MASK_SHOT, this, COLLISION_GROUP_PLAYER, &tr );
-				
-				if (!tr.m_pEnt || tr.m_pEnt == pEntity)
-					DoDamage( pEntity );
+					Vector startpos = vecOrigin + vecDirection * LASERGREN_CENTERGAP;
 
-				angRadial.y += flDeltaAngle;
+					//make sure theres nothing in the way
+					trace_t tr;
+					UTIL_TraceLine( startpos,
+									point,
+									MASK_SHOT, this, COLLISION_GROUP_PLAYER, &tr );
+
+					if (!tr.m_pEnt || tr.m_pEnt == pEntity)
+						DoDamage( pEntity );
+				}
 			}
 		}
 
@@ -28,6 +28,7 @@
 	#include "ff_entity_system.h"
 	#include "te_effect_dispatch.h"
 	#include "ai_basenpc.h"
+	#include "ff_areaeffectmanager.h"
 #else
 	#include "c_te_effect_dispatch.h"
 #endif
@@ -203,6 +204,8 @@ protected:
 	int m_iSequence;
 	Activity m_Activity;
 
+	AreaEffectHandle_t m_hAreaEffect;
+
 #endif
 };
 
@@ -250,12 +253,16 @@ void CFFGrenadeSlowfield::StopLoopingSounds()
 void CFFGrenadeSlowfield::UpdateOnRemove()
 {
 #ifdef GAME_DLL
-	// loop through all players
-	for(int i = 1 ; i <= gpGlobals->maxClients; i++)
+	// Only players that were inside the field last think can be slowed by it
+	CUtlVector<CBaseEntity *> inside;
+	FFAreaEffectManager()->GetLastEntitiesInVolume( m_hAreaEffect, inside );
+	FFAreaEffectManager()->RemoveVolume( m_hAreaEffect );
+
+	for(int i = 0 ; i < inside.Count(); i++)
 	{
-		CFFPlayer* pPlayer = ToFFPlayer(UTIL_EntityByIndex(i));
+		CFFPlayer* pPlayer = ToFFPlayer(inside[i]);
 
-		if( !pPlayer || pPlayer->IsObserver() )
+		if( pPlayer->IsObserver() )
 			continue;
 
 		if (pPlayer->GetActiveSlowfield() == this)
@@ -298,6 +305,7 @@ void CFFGrenadeSlowfield::UpdateOnRemove()
 		m_Activity = ( Activity )ACT_GAS_IDLE;
 		m_iSequence = SelectWeightedSequence( m_Activity );
 		m_bBeamLoopPlaying = false;
+		m_hAreaEffect = AREAEFFECT_INVALID_HANDLE;
 		SetSequence( m_iSequence );		
 	}
 
@@ -343,6 +351,11 @@ void CFFGrenadeSlowfield::UpdateOnRemove()
 		SetDetonateTimerLength(SLOWFIELD_DURATION);
 		m_bIsOn = true;
 
+		AreaEffectDesc_t desc;
+		desc.m_flRadius = GetGrenadeRadius();
+		desc.m_iFlags = AREAEFFECT_ORIGINONLY;
+		m_hAreaEffect = FFAreaEffectManager()->AddVolume( this, desc );
+
 		// Should this maybe be noclip?
 		SetMoveType(MOVETYPE_FLY);
 
@@ -415,99 +428,105 @@ void CFFGrenadeSlowfield::UpdateOnRemove()
 
 		bool bHitPlayer = false;
 
-		for (int i=1; i<=gpGlobals->maxClients; i++)
+		CFFPlayer *pSlower = ToFFPlayer( GetOwnerEntity() );
+
+		// Only the players the area effect manager says are inside the
+		// radius of the gren, plus any that have just left it
+		CUtlVector<CBaseEntity *> inside, exited;
+		if( pSlower )
+			FFAreaEffectManager()->GetEntitiesInVolume( m_hAreaEffect, inside, &exited );
+
+		for (int i=0; i<inside.Count(); i++)
 		{
-			CFFPlayer *pPlayer = ToFFPlayer( UTIL_PlayerByIndex(i) );
-			CFFPlayer *pSlower = ToFFPlayer( GetOwnerEntity() );
-				
-			if( !pPlayer || pPlayer->IsObserver() || !pSlower)
-				continue;
+			CFFPlayer *pPlayer = ToFFPlayer( inside[i] );
 
 			Vector vecDisplacement = pPlayer->GetAbsOrigin() - vecOrigin;
 			float flDistance = vecDisplacement.Length();
 
-			// inside the radius of the gren
-			if (flDistance < GetGrenadeRadius())
+			if( SLOWFIELD_FRIENDLYIGNORE && !g_pGameRules->FCanTakeDamage( pPlayer, GetOwnerEntity() ) )
+				continue;
+			
+			if( SLOWFIELD_SELFIGNORE && pPlayer == pSlower )
+				continue;
+
+			float flFriendlyScale = 1.0f;
+
+			// Check if is a teammate and scale accordingly
+			if (pPlayer != pSlower && g_pGameRules->PlayerRelationship(pPlayer, pSlower) == GR_TEAMMATE)
+				flFriendlyScale = SLOWFIELD_FRIENDLYSCALE;
+			else if (pPlayer == pSlower)
+				flFriendlyScale = SLOWFIELD_SELFSCALE;
+
+			float flDistanceMult = 1.0f;
+			//if we're scaling between outer and inner radius (linear!!)
+			//don't allow divide by zero or for inner/outer to be reversed
+			if(flDistance > (flInnerRadius * flInnerRadiusShrink) && ( flOuterRadius - flInnerRadius ) > 0.0f)
 			{
-				if( SLOWFIELD_FRIENDLYIGNORE && !g_pGameRules->FCanTakeDamage( pPlayer, GetOwnerEntity() ) )
-					continue;
-				
-				if( SLOWFIELD_SELFIGNORE && pPlayer == pSlower )
-					continue;
-
-				float flFriendlyScale = 1.0f;
-
-				// Check if is a teammate and scale accordingly
-				if (pPlayer != pSlower && g_pGameRules->PlayerRelationship(pPlayer, pSlower) == GR_TEAMMATE)
-					flFriendlyScale = SLOWFIELD_FRIENDLYSCALE;
-				else if (pPlayer == pSlower)
-					flFriendlyScale = SLOWFIELD_SELFSCALE;
-
-				float flDistanceMult = 1.0f;
-				//if we're scaling between outer and inner radius (linear!!)
-				//don't allow divide by zero or for inner/outer to be reversed
-				if(flDistance > (flInnerRadius * flInnerRadiusShrink) && ( flOuterRadius - flInnerRadius ) > 0.0f)
-				{
-					flDistanceMult = clamp(1.0f - ( flDistance - flInnerRadius ) / ( flOuterRadius - flInnerRadius ), 0.0f, 1.0f);
-				}
-
-				float flSpeed = pPlayer->GetAbsVelocity().Length();
-				float flSpeedReduction = flSpeed - ( pow( flSpeed, SLOWFIELD_POWER ) * SLOWFIELD_MULTIPLIER );
-				flSpeedReduction *= pow( flDistanceMult, SLOWFIELD_RADIUS_POWER );
-				flSpeedReduction *= flFriendlyScale;
-
-				float flLaggedMovement = 1.0f;
-				if(flSpeed > 0.0f)
-				//no divide by zero
-				{
-					flLaggedMovement = clamp( (flSpeed - flSpeedReduction), 1.0f, flSpeed ) / flSpeed;
-				}
-
-				// only change players active slowfield if they will be going slower
-				if ( pPlayer->GetActiveSlowfield() != this && ( pPlayer->GetLaggedMovementValue() > flLaggedMovement || pPlayer->GetActiveSlowfield() == NULL ) )
-				{
-					pPlayer->SetLaggedMovementValue(flLaggedMovement);
-					pPlayer->SetActiveSlowfield( this );
-
-					// add status icon
-					CSingleUserRecipientFilter user( ( CBasePlayer * )pPlayer );
-					user.MakeReliable();
-
-					UserMessageBegin( user, "StatusIconUpdate" );
-						WRITE_BYTE( FF_STATUSICON_SLOWMOTION );
-						WRITE_FLOAT( -1.0f );
-					MessageEnd();
-				}
-				// else just give them an updated laggedmovement value
-				else if (pPlayer->GetActiveSlowfield() == this)
-				{
-					pPlayer->SetLaggedMovementValue(flLaggedMovement);
-				}		
-
-				CFFPlayer *pGrenOwner = ToFFPlayer( this->GetOwnerEntity() );
-
-				bHitPlayer = true;
-	
-				CBeam *pBeam = CBeam::BeamCreate( GRENADE_BEAM_SPRITE, 1 );
-				pBeam->SetWidth( SLOWFIELD_BEAM_WIDTHSTART );
-				pBeam->SetEndWidth( SLOWFIELD_BEAM_WIDTHEND );
-				pBeam->LiveForTime(gpGlobals->interval_per_tick);
-				pBeam->SetNoise( SLOWFIELD_BEAM_NOISE );
-				pBeam->SetBrightness( (1 - flLaggedMovement) * 128 + 128 );
-				if(pGrenOwner->GetTeamNumber() == TEAM_RED)
-					pBeam->SetColor( 255, 64, 64 );
-				else if(pGrenOwner->GetTeamNumber() == TEAM_BLUE)
-					pBeam->SetColor( 64, 128, 255 );
-				else if(pGrenOwner->GetTeamNumber() == TEAM_GREEN)
-					pBeam->SetColor( 153, 255, 153 );
-				else if(pGrenOwner->GetTeamNumber() == TEAM_YELLOW)
-					pBeam->SetColor( 255, 178, 0 );
-				else // just in case
-					pBeam->SetColor( 204, 204, 204 );
-				pBeam->PointsInit( vecOrigin, pPlayer->GetAbsOrigin() );
+				flDistanceMult = clamp(1.0f - ( flDistance - flInnerRadius ) / ( flOuterRadius - flInnerRadius ), 0.0f, 1.0f);
 			}
-			// outside the radius of the gren
+
+			float flSpeed = pPlayer->GetAbsVelocity().Length();
+			float flSpeedReduction = flSpeed - ( pow( flSpeed, SLOWFIELD_POWER ) * SLOWFIELD_MULTIPLIER );
+			flSpeedReduction *= pow( flDistanceMult, SLOWFIELD_RADIUS_POWER );
+			flSpeedReduction *= flFriendlyScale;
+
+			float flLaggedMovement = 1.0f;
+			if(flSpeed > 0.0f)
+			//no divide by zero
+			{
+				flLaggedMovement = clamp( (flSpeed - flSpeedReduction), 1.0f, flSpeed ) / flSpeed;
+			}
+
+			// only change players active slowfield if they will be going slower
+			if ( pPlayer->GetActiveSlowfield() != this && ( pPlayer->GetLaggedMovementValue() > flLaggedMovement || pPlayer->GetActiveSlowfield() == NULL ) )
+			{
+				pPlayer->SetLaggedMovementValue(flLaggedMovement);
+				pPlayer->SetActiveSlowfield( this );
+
+				// add status icon
+				CSingleUserRecipientFilter user( ( CBasePlayer * )pPlayer );
+				user.MakeReliable();
+
+				UserMessageBegin( user, "StatusIconUpdate" );
+					WRITE_BYTE( FF_STATUSICON_SLOWMOTION );
+					WRITE_FLOAT( -1.0f );
+				MessageEnd();
+			}
+			// else just give them an updated laggedmovement value
 			else if (pPlayer->GetActiveSlowfield() == this)
+			{
+				pPlayer->SetLaggedMovementValue(flLaggedMovement);
+			}		
+
+			CFFPlayer *pGrenOwner = ToFFPlayer( this->GetOwnerEntity() );
+
+			bHitPlayer = true;
+
+			CBeam *pBeam = CBeam::BeamCreate( GRENADE_BEAM_SPRITE, 1 );
+			pBeam->SetWidth( SLOWFIELD_BEAM_WIDTHSTART );
+			pBeam->SetEndWidth( SLOWFIELD_BEAM_WIDTHEND );
+			pBeam->LiveForTime(gpGlobals->interval_per_tick);
+			pBeam->SetNoise( SLOWFIELD_BEAM_NOISE );
+			pBeam->SetBrightness( (1 - flLaggedMovement) * 128 + 128 );
+			if(pGrenOwner->GetTeamNumber() == TEAM_RED)
+				pBeam->SetColor( 255, 64, 64 );
+			else if(pGrenOwner->GetTeamNumber() == TEAM_BLUE)
+				pBeam->SetColor( 64, 128, 255 );
+			else if(pGrenOwner->GetTeamNumber() == TEAM_GREEN)
+				pBeam->SetColor( 153, 255, 153 );
+			else if(pGrenOwner->GetTeamNumber() == TEAM_YELLOW)
+				pBeam->SetColor( 255, 178, 0 );
+			else // just in case
+				pBeam->SetColor( 204, 204, 204 );
+			pBeam->PointsInit( vecOrigin, pPlayer->GetAbsOrigin() );
+		}
+
+		// outside the radius of the gren
+		for (int i=0; i<exited.Count(); i++)
+		{
+			CFFPlayer *pPlayer = ToFFPlayer( exited[i] );
+
+			if (pPlayer->GetActiveSlowfield() == this)
 			{
 				pPlayer->SetLaggedMovementValue( 1.0f );
 				pPlayer->SetActiveSlowfield( NULL );
@@ -18,6 +18,7 @@
 	#include "ff_player.h"
 	#include "soundent.h"
 	#include "util.h"
+	#include "ff_transmitpolicy.h"
 #else
 	#include "c_ff_player.h"
 	#include "iinput.h"
@@ -214,6 +215,22 @@ END_NETWORK_TABLE()
 
 		return true;
 	}
+
+	//----------------------------------------------------------------------------
+	// Purpose: Need ShouldTransmit to be called for the distance check
+	//----------------------------------------------------------------------------
+	int CFFProjectileBase::UpdateTransmitState()
+	{
+		return SetTransmitState( FL_EDICT_FULLCHECK );
+	}
+
+	//----------------------------------------------------------------------------
+	// Purpose: Don't send projectiles to players nowhere near them
+	//----------------------------------------------------------------------------
+	int CFFProjectileBase::ShouldTransmit( const CCheckTransmitInfo *pInfo )
+	{
+		return FFTransmit_ProjectileShouldTransmit( this, pInfo, BaseClass::ShouldTransmit( pInfo ) );
+	}
 #endif
 
 //----------------------------------------------------------------------------
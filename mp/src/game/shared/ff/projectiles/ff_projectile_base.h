@@ -83,6 +83,10 @@ private:
 	int TakeEmp();
 	virtual bool IsInWorld( void ) const;
 
+	// Far away projectiles aren't sent (see ff_transmitpolicy)
+	virtual int UpdateTransmitState();
+	virtual int ShouldTransmit( const CCheckTransmitInfo *pInfo );
+
 #endif
 
 protected:
@@ -25,17 +25,20 @@
 
 //ConVar ffdev_nail_speed("ffdev_nail_speed", "1000.0", FCVAR_FF_FFDEV_REPLICATED , "Nail speed");
 //ConVar ffdev_nail_pushmultiplier("ffdev_nail_pushmultiplier", "0.05", FCVAR_FF_FFDEV_REPLICATED, "Nail pushforce multiplier - was 0.1 for 2.1 release");
-#define FF_NAIL_PUSHMULTIPLIER 0.05f //ffdev_nail_pushmultiplier.GetFloat()
-#define NAIL_SPEED 1000.0f //ffdev_nail_speed.GetFloat() //2000.0f
+// FF_NAIL_PUSHMULTIPLIER was ffdev_nail_pushmultiplier.GetFloat()
+#define NAIL_SPEED FF_NAIL_SPEED //ffdev_nail_speed.GetFloat() //2000.0f
 //ConVar ffdev_nail_bbox("ffdev_nail_bbox", "2.0", FCVAR_FF_FFDEV_REPLICATED, "Nail bbox");
-#define NAIL_BBOX 2.0f
+#define NAIL_BBOX FF_NAIL_BBOX
 //ConVar ffdev_nail_sgmod( "ffdev_nail_sgmod", "10.0", FCVAR_FF_FFDEV_REPLICATED, "Added to nail damage when hitting a SG so SG's take more damage" );
 #define NAIL_SGMOD 10.0f
 
+ConVar ffdev_nail_pooled("ffdev_nail_pooled", "1", FCVAR_FF_FFDEV_REPLICATED, "Simulate nails as pooled records swept once a tick instead of an entity each");
+
 #ifdef CLIENT_DLL
 	#include "c_te_effect_dispatch.h"
 #else
 	#include "te_effect_dispatch.h"
+	#include "ff_nailmanager.h"
 
 //=============================================================================
 // CFFProjectileNail tables
@@ -188,10 +191,43 @@ void CFFProjectileNail::BubbleThink()
 }
 
 //----------------------------------------------------------------------------
-// Purpose: Create a new nail
+// Purpose: Tell clients to draw a nail
+//----------------------------------------------------------------------------
+static void DispatchNailEffect(const Vector &vecOrigin, const QAngle &angAngles, CBaseEntity *pentOwner)
+{
+	CEffectData data;
+	data.m_vOrigin = vecOrigin;
+	data.m_vAngles = angAngles;
+	data.m_nDamageType = NAIL_SPEED;//iSpeed; // AfterShock: HACK: use m_nDamageType to pass the nail speed int
+
+#ifdef GAME_DLL
+	data.m_nEntIndex = pentOwner->entindex();
+#else
+	data.m_hEntity = pentOwner;
+#endif
+
+	DispatchEffect("Projectile_Nail", data);
+}
+
+//----------------------------------------------------------------------------
+// Purpose: Create a new nail. When the nails are pooled there's no entity
+//			and NULL is returned.
 //----------------------------------------------------------------------------
 CFFProjectileNail *CFFProjectileNail::CreateNail(const CBaseEntity *pSource, const Vector &vecOrigin, const QAngle &angAngles, CBaseEntity *pentOwner, const int iDamage, const int iSpeed, bool bNotClientSide) 
 {
+	if (ffdev_nail_pooled.GetBool())
+	{
+#ifdef GAME_DLL
+		// Everyone but a predicting owner is sent the nail at the end of the tick
+		FFNailManager()->AddNail(const_cast<CBaseEntity *>(pSource), pentOwner, vecOrigin, angAngles, iDamage, !bNotClientSide);
+#else
+		// Draw our own nail straight away, the server won't send it to us
+		if (!bNotClientSide)
+			DispatchNailEffect(vecOrigin, angAngles, pentOwner);
+#endif
+		return NULL;
+	}
+
 	CFFProjectileNail *pNail = (CFFProjectileNail *) CreateEntityByName("ff_projectile_nail");
 
 	UTIL_SetOrigin(pNail, vecOrigin);
@@ -210,20 +246,7 @@ CFFProjectileNail *CFFProjectileNail::CreateNail(const CBaseEntity *pSource, con
 	pNail->SetAbsVelocity(vecForward);
 
 	if (!bNotClientSide)
-	{
-		CEffectData data;
-		data.m_vOrigin = vecOrigin;
-		data.m_vAngles = angAngles;
-		data.m_nDamageType = NAIL_SPEED;//iSpeed; // AfterShock: HACK: use m_nDamageType to pass the nail speed int
-
-	#ifdef GAME_DLL
-		data.m_nEntIndex = pentOwner->entindex();
-	#else
-		data.m_hEntity = pentOwner;
-	#endif
-
-		DispatchEffect("Projectile_Nail", data);
-	}
+		DispatchNailEffect(vecOrigin, angAngles, pentOwner);
 
 #ifdef GAME_DLL
 	pNail->SetupInitialTransmittedVelocity(vecForward);
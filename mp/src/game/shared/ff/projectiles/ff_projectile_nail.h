@@ -25,6 +25,14 @@
 
 class NailTrail;
 
+// Shared with the pooled nails (ff_nailmanager.cpp) and their client replay
+#define FF_NAIL_SPEED			1000.0f
+#define FF_NAIL_BBOX			2.0f
+#define FF_NAIL_PUSHMULTIPLIER	0.05f
+
+// Most nails that can be sent in one FF Nails temp entity
+#define FF_NAIL_EVENT_MAX		8
+
 //=============================================================================
 // CFFProjectileNail
 //=============================================================================
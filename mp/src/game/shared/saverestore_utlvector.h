@@ -18,8 +18,22 @@
 
 //-------------------------------------
 
+// --> FF
+// Lets code outside of save/restore read the elements of a DEFINE_UTLVECTOR
+// field, since the field itself only describes the vector's own members
+abstract_class IUtlVectorFieldInfo
+{
+public:
+	virtual int			GetElementType() const = 0;
+	virtual datamap_t	*GetElementDataMap() const = 0;	// FIELD_EMBEDDED only
+	virtual int			GetElementSize() const = 0;
+	virtual int			Count( const void *pField ) const = 0;
+	virtual const void	*Base( const void *pField ) const = 0;
+};
+// <-- FF
+
 template <class UTLVECTOR, int FIELD_TYPE>
-class CUtlVectorDataOps : public CDefSaveRestoreOps
+class CUtlVectorDataOps : public CDefSaveRestoreOps, public IUtlVectorFieldInfo
 {
 public:
 	CUtlVectorDataOps()
@@ -27,6 +41,14 @@ public:
 		UTLCLASS_SAVERESTORE_VALIDATE_TYPE( FIELD_TYPE );
 	}
 
+	// --> FF
+	virtual int GetElementType() const { return FIELD_TYPE; }
+	virtual datamap_t *GetElementDataMap() const { return CTypedescDeducer<FIELD_TYPE>::Deduce( (UTLVECTOR *)NULL ); }
+	virtual int GetElementSize() const { return sizeof( typename UTLVECTOR::ElemType_t ); }
+	virtual int Count( const void *pField ) const { return ( (const UTLVECTOR *)pField )->Count(); }
+	virtual const void *Base( const void *pField ) const { return ( (const UTLVECTOR *)pField )->Base(); }
+	// <-- FF
+
 	virtual void Save( const SaveRestoreFieldInfo_t &fieldInfo, ISave *pSave )
 	{		
 		datamap_t *pArrayTypeDatamap = CTypedescDeducer<FIELD_TYPE>::Deduce( (UTLVECTOR *)NULL );
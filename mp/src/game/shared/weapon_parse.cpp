@@ -11,6 +11,10 @@
 #include "utldict.h"
 #include "ammodef.h"
 
+#ifdef FF
+#include "ff_scriptcache.h"
+#endif
+
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
@@ -207,6 +211,27 @@ KeyValues* ReadEncryptedKVFile( IFileSystem *filesystem, const char *szFilenameW
 		pSearchPath = "GAME";
 	}
 
+#ifdef FF
+	// The text file or, failing that, the encrypted one, through the compiled script cache
+	if ( ScriptCache_IsEnabled() )
+	{
+		KeyValues *pKV = NULL;
+		if ( !bForceReadEncryptedFile )
+		{
+			Q_snprintf( szFullName, sizeof( szFullName ), "%s.txt", szFilenameWithoutExtension );
+			pKV = ScriptCache_ReadKVFile( filesystem, szFullName, pSearchPath, NULL, "WeaponDatafile" );
+		}
+
+		if ( !pKV && pICEKey )
+		{
+			Q_snprintf( szFullName, sizeof( szFullName ), "%s.ctx", szFilenameWithoutExtension );
+			pKV = ScriptCache_ReadKVFile( filesystem, szFullName, pSearchPath, pICEKey, "WeaponDatafile" );
+		}
+
+		return pKV;
+	}
+#endif
+
 	// Open the weapon data file, and abort if we can't
 	KeyValues *pKV = new KeyValues( "WeaponDatafile" );
 
@@ -1216,6 +1216,21 @@ FORCEINLINE fltx4 QuaternionMASIMD( const fltx4 &p, float s, const fltx4 &q )
 }
 #endif
 
+#ifndef _X360
+//-----------------------------------------------------------------------------
+// Purpose: QuaternionSM and QuaternionMA for four quaternions at once
+//-----------------------------------------------------------------------------
+FORCEINLINE FourQuaternions QuaternionSMSIMD( const fltx4 &s, const FourQuaternions &p, const FourQuaternions &q )
+{
+	return QuaternionNormalizeSIMD( QuaternionMultSIMD( QuaternionScaleSIMD( p, s ), q ) );
+}
+
+FORCEINLINE FourQuaternions QuaternionMASIMD( const FourQuaternions &p, const fltx4 &s, const FourQuaternions &q )
+{
+	return QuaternionNormalizeSIMD( QuaternionMultSIMD( p, QuaternionScaleSIMD( q, s ) ) );
+}
+#endif
+
 
 //-----------------------------------------------------------------------------
 // Purpose: qt = p + s * q
@@ -1369,6 +1384,136 @@ void WorldSpaceSlerp(
 }
 
 
+#ifndef _X360
+static ConVar anim_simdblend( "anim_simdblend", "1", 0, "Blend bones four at a time with SSE in SlerpBones, BlendBones and ScaleBones." );
+
+//-----------------------------------------------------------------------------
+// Purpose: Up to four bones to blend together with FourQuaternions. A short
+//			batch is padded out with copies of its last bone, which then just
+//			gets the same result stored more than once.
+//-----------------------------------------------------------------------------
+class CBoneBatch
+{
+public:
+	CBoneBatch() : m_nBones( 0 ) {}
+
+	// returns true once the batch is full
+	bool Add( int iBone )
+	{
+		m_iBone[m_nBones++] = iBone;
+		return m_nBones == 4;
+	}
+
+	// pads out a partial batch, returns false if there's nothing in it
+	bool Finish()
+	{
+		if ( !m_nBones )
+			return false;
+
+		for ( int k = m_nBones; k < 4; k++ )
+		{
+			m_iBone[k] = m_iBone[m_nBones - 1];
+		}
+		return true;
+	}
+
+	void Clear() { m_nBones = 0; }
+
+	template< class T >
+	FORCEINLINE void Load( FourQuaternions &q, const T *pQ ) const
+	{
+		q.LoadAndSwizzle( pQ[m_iBone[0]], pQ[m_iBone[1]], pQ[m_iBone[2]], pQ[m_iBone[3]] );
+	}
+
+	FORCEINLINE void Store( const FourQuaternions &q, Quaternion *pQ ) const
+	{
+		q.SwizzleAndStore( pQ[m_iBone[0]], pQ[m_iBone[1]], pQ[m_iBone[2]], pQ[m_iBone[3]] );
+	}
+
+	FORCEINLINE fltx4 Gather( const float *pValues ) const
+	{
+		fltx4 result;
+		for ( int k = 0; k < 4; k++ )
+		{
+			SubFloat( result, k ) = pValues[m_iBone[k]];
+		}
+		return result;
+	}
+
+	// q aligned to p, except for the bones flagged BONE_FIXED_ALIGNMENT
+	FORCEINLINE FourQuaternions Align( const CStudioHdr *pStudioHdr, const FourQuaternions &p, const FourQuaternions &q ) const
+	{
+		fltx4 fixed;
+		for ( int k = 0; k < 4; k++ )
+		{
+			SubFloat( fixed, k ) = ( pStudioHdr->boneFlags( m_iBone[k] ) & BONE_FIXED_ALIGNMENT ) ? 1.0f : 0.0f;
+		}
+		fltx4 mask = CmpGtSIMD( fixed, Four_Zeros );
+
+		FourQuaternions aligned = QuaternionAlignSIMD( p, q );
+		aligned.x = MaskedAssign( mask, q.x, aligned.x );
+		aligned.y = MaskedAssign( mask, q.y, aligned.y );
+		aligned.z = MaskedAssign( mask, q.z, aligned.z );
+		aligned.w = MaskedAssign( mask, q.w, aligned.w );
+		return aligned;
+	}
+
+private:
+	int m_iBone[4];
+	int m_nBones;
+};
+
+//-----------------------------------------------------------------------------
+// Purpose: the per bone work of SlerpBones, BlendBones and ScaleBones for a batch
+//-----------------------------------------------------------------------------
+static void DeltaBoneBatch( CBoneBatch &batch, Quaternion q1[MAXSTUDIOBONES], const QuaternionAligned q2[MAXSTUDIOBONES], const float *pS2, bool bPost )
+{
+	FourQuaternions fq1, fq2;
+	batch.Load( fq1, q1 );
+	batch.Load( fq2, q2 );
+	fltx4 s2 = batch.Gather( pS2 );
+
+	if ( bPost )
+	{
+		batch.Store( QuaternionMASIMD( fq1, s2, fq2 ), q1 );
+	}
+	else
+	{
+		batch.Store( QuaternionSMSIMD( s2, fq2, fq1 ), q1 );
+	}
+	batch.Clear();
+}
+
+static void SlerpBoneBatch( CBoneBatch &batch, const CStudioHdr *pStudioHdr, Quaternion q1[MAXSTUDIOBONES], const QuaternionAligned q2[MAXSTUDIOBONES], const float *pS2 )
+{
+	FourQuaternions fq1, fq2;
+	batch.Load( fq1, q1 );
+	batch.Load( fq2, q2 );
+	fltx4 s1 = SubSIMD( Four_Ones, batch.Gather( pS2 ) );
+
+	batch.Store( QuaternionSlerpNoAlignSIMD( fq2, batch.Align( pStudioHdr, fq2, fq1 ), s1 ), q1 );
+	batch.Clear();
+}
+
+static void BlendBoneBatch( CBoneBatch &batch, const CStudioHdr *pStudioHdr, Quaternion q1[MAXSTUDIOBONES], const Quaternion q2[MAXSTUDIOBONES], const fltx4 &s1 )
+{
+	FourQuaternions fq1, fq2;
+	batch.Load( fq1, q1 );
+	batch.Load( fq2, q2 );
+
+	batch.Store( QuaternionBlendNoAlignSIMD( fq2, batch.Align( pStudioHdr, fq2, fq1 ), s1 ), q1 );
+	batch.Clear();
+}
+
+static void ScaleBoneBatch( CBoneBatch &batch, Quaternion q1[MAXSTUDIOBONES], const fltx4 &s1 )
+{
+	FourQuaternions fq1;
+	batch.Load( fq1, q1 );
+
+	batch.Store( QuaternionIdentityBlendSIMD( fq1, s1 ), q1 );
+	batch.Clear();
+}
+#endif
 
 //-----------------------------------------------------------------------------
 // Purpose: blend together q1,pos1 with q2,pos2.  Return result in q1,pos1.  
@@ -1438,6 +1583,35 @@ void SlerpBones(
 	float s1, s2;
 	if ( seqdesc.flags & STUDIO_DELTA )
 	{
+#ifndef _X360
+		if ( anim_simdblend.GetBool() )
+		{
+			bool bPost = ( seqdesc.flags & STUDIO_POST ) != 0;
+			CBoneBatch batch;
+			for ( i = 0; i < nBoneCount; i++ )
+			{
+				s2 = pS2[i];
+				if ( s2 <= 0.0f )
+					continue;
+
+				// FIXME: are these correct?
+				pos1[i][0] = pos1[i][0] + pos2[i][0] * s2;
+				pos1[i][1] = pos1[i][1] + pos2[i][1] * s2;
+				pos1[i][2] = pos1[i][2] + pos2[i][2] * s2;
+
+				if ( batch.Add( i ) )
+				{
+					DeltaBoneBatch( batch, q1, q2, pS2, bPost );
+				}
+			}
+			if ( batch.Finish() )
+			{
+				DeltaBoneBatch( batch, q1, q2, pS2, bPost );
+			}
+			return;
+		}
+#endif
+
 		for ( i = 0; i < nBoneCount; i++ )
 		{
 			s2 = pS2[i];
@@ -1479,6 +1653,35 @@ void SlerpBones(
 		return;
 	}
 
+#ifndef _X360
+	if ( anim_simdblend.GetBool() )
+	{
+		CBoneBatch batch;
+		for ( i = 0; i < nBoneCount; i++ )
+		{
+			s2 = pS2[i];
+			if ( s2 <= 0.0f )
+				continue;
+
+			s1 = 1.0 - s2;
+
+			pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s2;
+			pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s2;
+			pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s2;
+
+			if ( batch.Add( i ) )
+			{
+				SlerpBoneBatch( batch, pStudioHdr, q1, q2, pS2 );
+			}
+		}
+		if ( batch.Finish() )
+		{
+			SlerpBoneBatch( batch, pStudioHdr, q1, q2, pS2 );
+		}
+		return;
+	}
+#endif
+
 	QuaternionAligned q3;
 	for (i = 0; i < nBoneCount; i++)
 	{
@@ -1590,6 +1793,12 @@ void BlendBones(
 	float s2 = s;
 	float s1 = 1.0 - s2;
 
+#ifndef _X360
+	bool bSIMD = anim_simdblend.GetBool();
+	fltx4 s1SIMD = ReplicateX4( s1 );
+	CBoneBatch batch;
+#endif
+
 	for (i = 0; i < pStudioHdr->numbones(); i++)
 	{
 		// skip unused bones
@@ -1609,6 +1818,21 @@ void BlendBones(
 
 		if (j >= 0 && seqdesc.weight( j ) > 0.0)
 		{
+#ifndef _X360
+			if ( bSIMD )
+			{
+				pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s2;
+				pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s2;
+				pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s2;
+
+				if ( batch.Add( i ) )
+				{
+					BlendBoneBatch( batch, pStudioHdr, q1, q2, s1SIMD );
+				}
+				continue;
+			}
+#endif
+
 			if (pStudioHdr->boneFlags(i) & BONE_FIXED_ALIGNMENT)
 			{
 				QuaternionBlendNoAlign( q2[i], q1[i], s1, q3 );
@@ -1626,6 +1850,13 @@ void BlendBones(
 			pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s2;
 		}
 	}
+
+#ifndef _X360
+	if ( bSIMD && batch.Finish() )
+	{
+		BlendBoneBatch( batch, pStudioHdr, q1, q2, s1SIMD );
+	}
+#endif
 }
 
 
@@ -1656,6 +1887,12 @@ void ScaleBones(
 	float s2 = s;
 	float s1 = 1.0 - s2;
 
+#ifndef _X360
+	bool bSIMD = anim_simdblend.GetBool();
+	fltx4 s1SIMD = ReplicateX4( s1 );
+	CBoneBatch batch;
+#endif
+
 	for (i = 0; i < pStudioHdr->numbones(); i++)
 	{
 		// skip unused bones
@@ -1675,10 +1912,29 @@ void ScaleBones(
 
 		if (j >= 0 && seqdesc.weight( j ) > 0.0)
 		{
-			QuaternionIdentityBlend( q1[i], s1, q1[i] );
 			VectorScale( pos1[i], s2, pos1[i] );
+
+#ifndef _X360
+			if ( bSIMD )
+			{
+				if ( batch.Add( i ) )
+				{
+					ScaleBoneBatch( batch, q1, s1SIMD );
+				}
+				continue;
+			}
+#endif
+
+			QuaternionIdentityBlend( q1[i], s1, q1[i] );
 		}
 	}
+
+#ifndef _X360
+	if ( bSIMD && batch.Finish() )
+	{
+		ScaleBoneBatch( batch, q1, s1SIMD );
+	}
+#endif
 }
 
 //-----------------------------------------------------------------------------
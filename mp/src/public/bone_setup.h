@@ -74,12 +74,39 @@ void SlerpBones(
 	Vector pos1[MAXSTUDIOBONES], 
 	mstudioseqdesc_t &seqdesc, // source of q2 and pos2
 	int sequence, 
+	const QuaternionAligned q2[MAXSTUDIOBONES], 
+	const Vector pos2[MAXSTUDIOBONES], 
+	float s,
+	int boneMask
+	);
+
+//-----------------------------------------------------------------------------
+// Purpose: blends q1,pos1 with q2,pos2 by s, for the bones the sequence uses
+//-----------------------------------------------------------------------------
+void BlendBones( 
+	const CStudioHdr *pStudioHdr,
+	Quaternion q1[MAXSTUDIOBONES], 
+	Vector pos1[MAXSTUDIOBONES], 
+	mstudioseqdesc_t &seqdesc, 
+	int sequence,
 	const Quaternion q2[MAXSTUDIOBONES], 
 	const Vector pos2[MAXSTUDIOBONES], 
 	float s,
 	int boneMask
 	);
 
+//-----------------------------------------------------------------------------
+// Purpose: scales a delta pose by s, for the bones the sequence uses
+//-----------------------------------------------------------------------------
+void ScaleBones( 
+	const CStudioHdr *pStudioHdr,
+	Quaternion q1[MAXSTUDIOBONES], 
+	Vector pos1[MAXSTUDIOBONES], 
+	int sequence,
+	float s,
+	int boneMask
+	);
+
 // Given two samples of a bone separated in time by dt, 
 // compute the velocity and angular velocity of that bone
 void CalcBoneDerivatives( Vector &velocity, AngularImpulse &angVel, const matrix3x4_t &prev, const matrix3x4_t &current, float dt );
@@ -1016,6 +1016,242 @@ bool FASTCALL IsBoxIntersectingRay( const fltx4& boxMin, const fltx4& boxMax,
 }
 
 
+//-----------------------------------------------------------------------------
+// Sets up a ray for the batched IsBoxIntersectingRay
+//-----------------------------------------------------------------------------
+void BatchRay_t::Init( const Vector &vecStart, const Vector &vecDelta, float flTolerance )
+{
+	m_Start.DuplicateVector( vecStart );
+	m_Delta.DuplicateVector( vecDelta );
+
+	// Same saturating reciprocal as the Vector overload of IsBoxIntersectingRay, so the two
+	// agree exactly. The Ray_t overload uses ReciprocalSIMD, so it can differ from these
+	// by a rounding step on rays that graze a box.
+	for ( int i = 0; i < 3; i++ )
+		m_InvDelta[i] = ReciprocalSaturateSIMD( m_Delta[i] );
+
+	m_Tolerance = ReplicateX4( flTolerance );
+}
+
+void FourRays_t::Init( const Vector *pStarts, const Vector *pDeltas, int nRays, float flTolerance )
+{
+	Assert( nRays >= 1 && nRays <= 4 );
+	m_nRays = nRays;
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		int iRay = MIN( i, nRays - 1 );
+		m_Start.X( i ) = pStarts[iRay].x;
+		m_Start.Y( i ) = pStarts[iRay].y;
+		m_Start.Z( i ) = pStarts[iRay].z;
+		m_Delta.X( i ) = pDeltas[iRay].x;
+		m_Delta.Y( i ) = pDeltas[iRay].y;
+		m_Delta.Z( i ) = pDeltas[iRay].z;
+	}
+
+	for ( int i = 0; i < 3; i++ )
+		m_InvDelta[i] = ReciprocalSaturateSIMD( m_Delta[i] );
+
+	m_Tolerance = ReplicateX4( flTolerance );
+}
+
+//-----------------------------------------------------------------------------
+// The SIMD IsBoxIntersectingRay, turned on its side: each lane is a ray and
+// a box of its own, and each axis is a separate register. Returns the lanes
+// that hit, and the t each of them enters the box at.
+//-----------------------------------------------------------------------------
+static FORCEINLINE fltx4 IntersectRaysWithBoxes( const FourVectors &start, const FourVectors &delta, const FourVectors &invDelta, 
+												 const FourVectors &boxMin, const FourVectors &boxMax, const fltx4 &epsilon, fltx4 &lastIn )
+{
+	fltx4 miss = LoadZeroSIMD();
+	fltx4 firstOut = Four_Ones;
+	lastIn = Four_Zeros;
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		fltx4 offsetMinsExpanded = SubSIMD( SubSIMD( boxMin[i], start[i] ), epsilon );
+		fltx4 offsetMaxsExpanded = AddSIMD( SubSIMD( boxMax[i], start[i] ), epsilon );
+
+		// both ends in front of the same side can't hit
+		fltx4 startOutMins = CmpLtSIMD( Four_Zeros, offsetMinsExpanded );
+		fltx4 endOutMins = CmpLtSIMD( delta[i], offsetMinsExpanded );
+		fltx4 startOutMaxs = CmpGtSIMD( Four_Zeros, offsetMaxsExpanded );
+		fltx4 endOutMaxs = CmpGtSIMD( delta[i], offsetMaxsExpanded );
+		miss = OrSIMD( miss, OrSIMD( AndSIMD( startOutMins, endOutMins ), AndSIMD( startOutMaxs, endOutMaxs ) ) );
+
+		fltx4 tmins = MulSIMD( offsetMinsExpanded, invDelta[i] );
+		fltx4 tmaxs = MulSIMD( offsetMaxsExpanded, invDelta[i] );
+		fltx4 crossPlane = OrSIMD( XorSIMD( startOutMins, endOutMins ), XorSIMD( startOutMaxs, endOutMaxs ) );
+		tmins = MaskedAssign( crossPlane, tmins, Four_Negative_FLT_MAX );
+		tmaxs = MaskedAssign( crossPlane, tmaxs, Four_FLT_MAX );
+
+		lastIn = MaxSIMD( lastIn, MinSIMD( tmins, tmaxs ) );
+		firstOut = MinSIMD( firstOut, MaxSIMD( tmins, tmaxs ) );
+	}
+
+	return AndNotSIMD( OrSIMD( miss, CmpGtSIMD( lastIn, firstOut ) ), LoadAlignedSIMD( g_SIMD_AllOnesMask ) );
+}
+
+//-----------------------------------------------------------------------------
+// Four of an array of vectors, swizzled. LoadAndSwizzle reads a float past
+// each vector, which is only safe when there's another vector after it.
+//-----------------------------------------------------------------------------
+static FORCEINLINE void LoadFourVectors( FourVectors &out, const Vector *pVectors, int iFirst, int nVectors )
+{
+	if ( iFirst + 4 < nVectors )
+	{
+		out.LoadAndSwizzle( pVectors[iFirst], pVectors[iFirst+1], pVectors[iFirst+2], pVectors[iFirst+3] );
+		return;
+	}
+
+	// the end of the array, repeat the last one
+	for ( int i = 0; i < 4; i++ )
+	{
+		const Vector &v = pVectors[ MIN( iFirst + i, nVectors - 1 ) ];
+		out.X( i ) = v.x;
+		out.Y( i ) = v.y;
+		out.Z( i ) = v.z;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Moves rays into the space of OBBs, like VectorITransform/VectorIRotate.
+// The matrices are one row of each box per register, transposed to give a
+// register for each element across the four boxes.
+//-----------------------------------------------------------------------------
+static FORCEINLINE void TransformRaysToOBBs( const matrix3x4_t &mat0, const matrix3x4_t &mat1, const matrix3x4_t &mat2, const matrix3x4_t &mat3, 
+											 const FourVectors &start, const FourVectors &delta, FourVectors &localStart, FourVectors &localDelta )
+{
+	FourVectors rows[3];
+	for ( int i = 0; i < 3; i++ )
+	{
+		fltx4 row0 = LoadUnalignedSIMD( mat0[i] );
+		fltx4 row1 = LoadUnalignedSIMD( mat1[i] );
+		fltx4 row2 = LoadUnalignedSIMD( mat2[i] );
+		fltx4 row3 = LoadUnalignedSIMD( mat3[i] );
+		TransposeSIMD( row0, row1, row2, row3 );
+
+		// row3 is now the origin
+		rows[i].x = row0;
+		rows[i].y = row1;
+		rows[i].z = row2;
+		localStart[i] = SubSIMD( start[i], row3 );
+	}
+
+	fltx4 offset[3] = { localStart.x, localStart.y, localStart.z };
+	for ( int j = 0; j < 3; j++ )
+	{
+		localStart[j] = MaddSIMD( offset[2], rows[2][j], MaddSIMD( offset[1], rows[1][j], MulSIMD( offset[0], rows[0][j] ) ) );
+		localDelta[j] = MaddSIMD( delta[2], rows[2][j], MaddSIMD( delta[1], rows[1][j], MulSIMD( delta[0], rows[0][j] ) ) );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Hands the lanes of a batch of four back to the caller
+//-----------------------------------------------------------------------------
+static FORCEINLINE int StoreBatchHits( const fltx4 &hit, const fltx4 &lastIn, int iFirst, int nBoxes, bool *pHits, float *pFractions )
+{
+	int nHitMask = TestSignSIMD( hit );
+	int nCount = MIN( 4, nBoxes - iFirst );
+	int nHits = 0;
+	for ( int i = 0; i < nCount; i++ )
+	{
+		bool bHit = ( nHitMask & ( 1 << i ) ) != 0;
+		pHits[iFirst + i] = bHit;
+		nHits += bHit;
+		if ( pFractions )
+		{
+			pFractions[iFirst + i] = SubFloat( lastIn, i );
+		}
+	}
+	return nHits;
+}
+
+//-----------------------------------------------------------------------------
+// One ray against many boxes, four at a time
+//-----------------------------------------------------------------------------
+int FASTCALL IsBoxIntersectingRay( const BatchRay_t &ray, const Vector *pBoxMins, const Vector *pBoxMaxs, 
+								   int nBoxes, bool *pHits, float *pFractions )
+{
+	int nHits = 0;
+	for ( int i = 0; i < nBoxes; i += 4 )
+	{
+		FourVectors boxMin, boxMax;
+		LoadFourVectors( boxMin, pBoxMins, i, nBoxes );
+		LoadFourVectors( boxMax, pBoxMaxs, i, nBoxes );
+
+		fltx4 lastIn;
+		fltx4 hit = IntersectRaysWithBoxes( ray.m_Start, ray.m_Delta, ray.m_InvDelta, boxMin, boxMax, ray.m_Tolerance, lastIn );
+		nHits += StoreBatchHits( hit, lastIn, i, nBoxes, pHits, pFractions );
+	}
+	return nHits;
+}
+
+int FASTCALL IsOBBIntersectingRay( const BatchRay_t &ray, const matrix3x4_t *pOBBToWorld, 
+								   const Vector *pOBBMins, const Vector *pOBBMaxs, 
+								   int nBoxes, bool *pHits, float *pFractions )
+{
+	int nHits = 0;
+	for ( int i = 0; i < nBoxes; i += 4 )
+	{
+		int iLast = nBoxes - 1;
+		FourVectors localStart, localDelta, localInvDelta;
+		TransformRaysToOBBs( pOBBToWorld[i], pOBBToWorld[ MIN( i + 1, iLast ) ], pOBBToWorld[ MIN( i + 2, iLast ) ], pOBBToWorld[ MIN( i + 3, iLast ) ], 
+			ray.m_Start, ray.m_Delta, localStart, localDelta );
+		for ( int j = 0; j < 3; j++ )
+			localInvDelta[j] = ReciprocalSaturateSIMD( localDelta[j] );
+
+		FourVectors boxMin, boxMax;
+		LoadFourVectors( boxMin, pOBBMins, i, nBoxes );
+		LoadFourVectors( boxMax, pOBBMaxs, i, nBoxes );
+
+		fltx4 lastIn;
+		fltx4 hit = IntersectRaysWithBoxes( localStart, localDelta, localInvDelta, boxMin, boxMax, ray.m_Tolerance, lastIn );
+		nHits += StoreBatchHits( hit, lastIn, i, nBoxes, pHits, pFractions );
+	}
+	return nHits;
+}
+
+//-----------------------------------------------------------------------------
+// Four rays against one box
+//-----------------------------------------------------------------------------
+int FASTCALL IsBoxIntersectingRays( const FourRays_t &rays, const Vector &boxMin, const Vector &boxMax, fltx4 *pFractions )
+{
+	FourVectors fourBoxMin, fourBoxMax;
+	fourBoxMin.DuplicateVector( boxMin );
+	fourBoxMax.DuplicateVector( boxMax );
+
+	fltx4 lastIn;
+	fltx4 hit = IntersectRaysWithBoxes( rays.m_Start, rays.m_Delta, rays.m_InvDelta, fourBoxMin, fourBoxMax, rays.m_Tolerance, lastIn );
+	if ( pFractions )
+	{
+		*pFractions = lastIn;
+	}
+	return TestSignSIMD( hit ) & ( ( 1 << rays.m_nRays ) - 1 );
+}
+
+int FASTCALL IsOBBIntersectingRays( const FourRays_t &rays, const matrix3x4_t &matOBBToWorld, 
+								    const Vector &vecOBBMins, const Vector &vecOBBMaxs, fltx4 *pFractions )
+{
+	FourVectors localStart, localDelta, localInvDelta;
+	TransformRaysToOBBs( matOBBToWorld, matOBBToWorld, matOBBToWorld, matOBBToWorld, rays.m_Start, rays.m_Delta, localStart, localDelta );
+	for ( int j = 0; j < 3; j++ )
+		localInvDelta[j] = ReciprocalSaturateSIMD( localDelta[j] );
+
+	FourVectors fourBoxMin, fourBoxMax;
+	fourBoxMin.DuplicateVector( vecOBBMins );
+	fourBoxMax.DuplicateVector( vecOBBMaxs );
+
+	fltx4 lastIn;
+	fltx4 hit = IntersectRaysWithBoxes( localStart, localDelta, localInvDelta, fourBoxMin, fourBoxMax, rays.m_Tolerance, lastIn );
+	if ( pFractions )
+	{
+		*pFractions = lastIn;
+	}
+	return TestSignSIMD( hit ) & ( ( 1 << rays.m_nRays ) - 1 );
+}
+
+
 //-----------------------------------------------------------------------------
 // Intersects a ray with a ray, return true if they intersect
 // t, s = parameters of closest approach (if not intersecting!)
@@ -285,6 +285,60 @@ bool FASTCALL IsBoxIntersectingRay( const fltx4& boxMin, const fltx4& boxMax,
 
 
 
+//-----------------------------------------------------------------------------
+// 
+// Batched IsBoxIntersectingRay
+//
+// The same test as IsBoxIntersectingRay, four boxes or four rays at a time.
+// The rays are set up once, reciprocal delta and all, and can then be tested
+// against as many boxes as needed. pFractions gets where along the ray each
+// hit box is entered (0 if the ray starts inside it).
+//
+//-----------------------------------------------------------------------------
+
+// One ray, for testing against many boxes
+struct BatchRay_t
+{
+	void Init( const Vector &vecStart, const Vector &vecDelta, float flTolerance = 0.0f );
+
+	FourVectors	m_Start;			// each replicated four times
+	FourVectors	m_Delta;
+	FourVectors	m_InvDelta;
+	fltx4		m_Tolerance;
+};
+
+// Up to four rays, for testing against one box at a time
+struct FourRays_t
+{
+	// Fewer than four rays leaves the last one repeated
+	void Init( const Vector *pStarts, const Vector *pDeltas, int nRays, float flTolerance = 0.0f );
+
+	FourVectors	m_Start;
+	FourVectors	m_Delta;
+	FourVectors	m_InvDelta;
+	fltx4		m_Tolerance;
+	int			m_nRays;
+};
+
+// One ray against nBoxes boxes, returns how many it hits
+int FASTCALL IsBoxIntersectingRay( const BatchRay_t &ray, const Vector *pBoxMins, const Vector *pBoxMaxs, 
+								   int nBoxes, bool *pHits, float *pFractions = NULL );
+
+// The same for OBBs, which are tested like IsRayIntersectingOBB does: the ray
+// is moved into the space of each box and tested against its mins and maxs
+int FASTCALL IsOBBIntersectingRay( const BatchRay_t &ray, const matrix3x4_t *pOBBToWorld, 
+								   const Vector *pOBBMins, const Vector *pOBBMaxs, 
+								   int nBoxes, bool *pHits, float *pFractions = NULL );
+
+// Four rays against one box, returns a bit for each ray that hits it
+int FASTCALL IsBoxIntersectingRays( const FourRays_t &rays, const Vector &boxMin, const Vector &boxMax, 
+								    fltx4 *pFractions = NULL );
+
+int FASTCALL IsOBBIntersectingRays( const FourRays_t &rays, const matrix3x4_t &matOBBToWorld, 
+								    const Vector &vecOBBMins, const Vector &vecOBBMaxs, fltx4 *pFractions = NULL );
+
+
+
 //-----------------------------------------------------------------------------
 // 
 // IsPointInBox
@@ -363,5 +363,262 @@ FORCEINLINE fltx4 QuaternionSlerpSIMD( const fltx4 &p, const fltx4 &q, float t )
 
 #endif // ALLOW_SIMD_QUATERNION_MATH
 
+
+//---------------------------------------------------------------------
+// FourQuaternions stores 4 independent quaternions in x x x x y y y y
+// z z z z w w w w form. Unlike the single quaternion functions above,
+// this never needs a horizontal operation, so it's fine on PC too: each
+// function does the same math as its scalar version for 4 quaternions
+// at once. Used by bone_setup to blend bones four at a time.
+//---------------------------------------------------------------------
+class ALIGN16 FourQuaternions
+{
+public:
+	fltx4 x, y, z, w;
+
+	FORCEINLINE void LoadAndSwizzle( const Quaternion &a, const Quaternion &b, const Quaternion &c, const Quaternion &d )
+	{
+		x = LoadUnalignedSIMD( a.Base() );
+		y = LoadUnalignedSIMD( b.Base() );
+		z = LoadUnalignedSIMD( c.Base() );
+		w = LoadUnalignedSIMD( d.Base() );
+		TransposeSIMD( x, y, z, w );
+	}
+
+	FORCEINLINE void SwizzleAndStore( Quaternion &a, Quaternion &b, Quaternion &c, Quaternion &d ) const
+	{
+		fltx4 qa = x, qb = y, qc = z, qd = w;
+		TransposeSIMD( qa, qb, qc, qd );
+		StoreUnalignedSIMD( a.Base(), qa );
+		StoreUnalignedSIMD( b.Base(), qb );
+		StoreUnalignedSIMD( c.Base(), qc );
+		StoreUnalignedSIMD( d.Base(), qd );
+	}
+};
+
+
+//---------------------------------------------------------------------
+// The fltx4 ArcCosSIMD/SinSIMD are scalar per element on PC, so the
+// FourQuaternions slerp uses these polynomial versions instead. Both
+// are good to about 1e-7.
+//---------------------------------------------------------------------
+
+// acos( x ) for -1 <= x <= 1 (Abramowitz & Stegun 4.4.46)
+FORCEINLINE fltx4 ArcCosPolySIMD( const fltx4 &x )
+{
+	fltx4 ax = MinSIMD( MaxSIMD( x, NegSIMD( x ) ), Four_Ones );
+	fltx4 poly = ReplicateX4( -0.0012624911f );
+	poly = MaddSIMD( poly, ax, ReplicateX4( 0.0066700901f ) );
+	poly = MaddSIMD( poly, ax, ReplicateX4( -0.0170881256f ) );
+	poly = MaddSIMD( poly, ax, ReplicateX4( 0.0308918810f ) );
+	poly = MaddSIMD( poly, ax, ReplicateX4( -0.0501743046f ) );
+	poly = MaddSIMD( poly, ax, ReplicateX4( 0.0889789874f ) );
+	poly = MaddSIMD( poly, ax, ReplicateX4( -0.2145988016f ) );
+	poly = MaddSIMD( poly, ax, ReplicateX4( 1.5707963050f ) );
+	fltx4 result = MulSIMD( SqrtSIMD( SubSIMD( Four_Ones, ax ) ), poly );
+
+	// acos( -x ) = pi - acos( x )
+	return MaskedAssign( CmpLtSIMD( x, Four_Zeros ), SubSIMD( ReplicateX4( M_PI_F ), result ), result );
+}
+
+// asin( x ) for -1 <= x <= 1
+FORCEINLINE fltx4 ArcSinPolySIMD( const fltx4 &x )
+{
+	return SubSIMD( ReplicateX4( 0.5f * M_PI_F ), ArcCosPolySIMD( x ) );
+}
+
+// sin( x ) for -pi <= x <= pi
+FORCEINLINE fltx4 SinPolySIMD( const fltx4 &x )
+{
+	// fold into 0..pi/2, where the series converges quickly
+	fltx4 ax = MaxSIMD( x, NegSIMD( x ) );
+	ax = MinSIMD( ax, SubSIMD( ReplicateX4( M_PI_F ), ax ) );
+	fltx4 ax2 = MulSIMD( ax, ax );
+	fltx4 poly = ReplicateX4( -1.0f / 39916800.0f );
+	poly = MaddSIMD( poly, ax2, ReplicateX4( 1.0f / 362880.0f ) );
+	poly = MaddSIMD( poly, ax2, ReplicateX4( -1.0f / 5040.0f ) );
+	poly = MaddSIMD( poly, ax2, ReplicateX4( 1.0f / 120.0f ) );
+	poly = MaddSIMD( poly, ax2, ReplicateX4( -1.0f / 6.0f ) );
+	poly = MaddSIMD( poly, ax2, Four_Ones );
+	fltx4 result = MulSIMD( ax, poly );
+
+	return MaskedAssign( CmpLtSIMD( x, Four_Zeros ), NegSIMD( result ), result );
+}
+
+
+//---------------------------------------------------------------------
+// Make sure quaternions are within 180 degrees of one another, if not, reverse q
+//---------------------------------------------------------------------
+FORCEINLINE FourQuaternions QuaternionAlignSIMD( const FourQuaternions &p, const FourQuaternions &q )
+{
+	// decide if one of the quaternions is backwards
+	fltx4 dx = SubSIMD( p.x, q.x ), dy = SubSIMD( p.y, q.y ), dz = SubSIMD( p.z, q.z ), dw = SubSIMD( p.w, q.w );
+	fltx4 a = MulSIMD( dx, dx );
+	a = MaddSIMD( dy, dy, a );
+	a = MaddSIMD( dz, dz, a );
+	a = MaddSIMD( dw, dw, a );
+
+	fltx4 sx = AddSIMD( p.x, q.x ), sy = AddSIMD( p.y, q.y ), sz = AddSIMD( p.z, q.z ), sw = AddSIMD( p.w, q.w );
+	fltx4 b = MulSIMD( sx, sx );
+	b = MaddSIMD( sy, sy, b );
+	b = MaddSIMD( sz, sz, b );
+	b = MaddSIMD( sw, sw, b );
+
+	fltx4 cmp = CmpGtSIMD( a, b );
+	FourQuaternions result;
+	result.x = MaskedAssign( cmp, NegSIMD( q.x ), q.x );
+	result.y = MaskedAssign( cmp, NegSIMD( q.y ), q.y );
+	result.z = MaskedAssign( cmp, NegSIMD( q.z ), q.z );
+	result.w = MaskedAssign( cmp, NegSIMD( q.w ), q.w );
+	return result;
+}
+
+FORCEINLINE fltx4 QuaternionDotProductSIMD( const FourQuaternions &p, const FourQuaternions &q )
+{
+	fltx4 result = MulSIMD( p.x, q.x );
+	result = MaddSIMD( p.y, q.y, result );
+	result = MaddSIMD( p.z, q.z, result );
+	return MaddSIMD( p.w, q.w, result );
+}
+
+//---------------------------------------------------------------------
+// Normalize Quaternion, leaving any of zero length alone
+//---------------------------------------------------------------------
+FORCEINLINE FourQuaternions QuaternionNormalizeSIMD( const FourQuaternions &q )
+{
+	fltx4 radius = QuaternionDotProductSIMD( q, q );
+	fltx4 mask = CmpEqSIMD( radius, Four_Zeros );
+	fltx4 iradius = MaskedAssign( mask, Four_Ones, DivSIMD( Four_Ones, SqrtSIMD( radius ) ) );
+
+	FourQuaternions result;
+	result.x = MulSIMD( q.x, iradius );
+	result.y = MulSIMD( q.y, iradius );
+	result.z = MulSIMD( q.z, iradius );
+	result.w = MulSIMD( q.w, iradius );
+	return result;
+}
+
+//---------------------------------------------------------------------
+// 0.0 returns p, 1.0 return q.
+//---------------------------------------------------------------------
+FORCEINLINE FourQuaternions QuaternionBlendNoAlignSIMD( const FourQuaternions &p, const FourQuaternions &q, const fltx4 &t )
+{
+	fltx4 sclp = SubSIMD( Four_Ones, t );
+	FourQuaternions result;
+	result.x = MaddSIMD( t, q.x, MulSIMD( sclp, p.x ) );
+	result.y = MaddSIMD( t, q.y, MulSIMD( sclp, p.y ) );
+	result.z = MaddSIMD( t, q.z, MulSIMD( sclp, p.z ) );
+	result.w = MaddSIMD( t, q.w, MulSIMD( sclp, p.w ) );
+	return QuaternionNormalizeSIMD( result );
+}
+
+FORCEINLINE FourQuaternions QuaternionBlendSIMD( const FourQuaternions &p, const FourQuaternions &q, const fltx4 &t )
+{
+	return QuaternionBlendNoAlignSIMD( p, QuaternionAlignSIMD( p, q ), t );
+}
+
+//---------------------------------------------------------------------
+// Blend p toward the identity quaternion by t
+//---------------------------------------------------------------------
+FORCEINLINE FourQuaternions QuaternionIdentityBlendSIMD( const FourQuaternions &p, const fltx4 &t )
+{
+	fltx4 sclp = SubSIMD( Four_Ones, t );
+	FourQuaternions result;
+	result.x = MulSIMD( p.x, sclp );
+	result.y = MulSIMD( p.y, sclp );
+	result.z = MulSIMD( p.z, sclp );
+	fltx4 w = MulSIMD( p.w, sclp );
+	result.w = MaskedAssign( CmpLtSIMD( p.w, Four_Zeros ), SubSIMD( w, t ), AddSIMD( w, t ) );
+	return QuaternionNormalizeSIMD( result );
+}
+
+//---------------------------------------------------------------------
+// Quaternion sphereical linear interpolation
+//---------------------------------------------------------------------
+FORCEINLINE FourQuaternions QuaternionSlerpNoAlignSIMD( const FourQuaternions &p, const FourQuaternions &q, const fltx4 &t )
+{
+	// 0.0 returns p, 1.0 return q.
+	fltx4 cosom = QuaternionDotProductSIMD( p, q );
+	fltx4 eps = ReplicateX4( 0.000001f );
+	fltx4 sclp = SubSIMD( Four_Ones, t );
+	fltx4 sclq = t;
+
+	// far enough apart to slerp, otherwise it's just a lerp
+	fltx4 slerpMask = CmpGtSIMD( SubSIMD( Four_Ones, cosom ), eps );
+	fltx4 omega = ArcCosPolySIMD( cosom );
+	fltx4 sinom = MaxSIMD( SinPolySIMD( omega ), Four_Epsilons );
+	sclp = MaskedAssign( slerpMask, DivSIMD( SinPolySIMD( MulSIMD( sclp, omega ) ), sinom ), sclp );
+	sclq = MaskedAssign( slerpMask, DivSIMD( SinPolySIMD( MulSIMD( t, omega ) ), sinom ), sclq );
+
+	FourQuaternions result;
+	result.x = MaddSIMD( sclq, q.x, MulSIMD( sclp, p.x ) );
+	result.y = MaddSIMD( sclq, q.y, MulSIMD( sclp, p.y ) );
+	result.z = MaddSIMD( sclq, q.z, MulSIMD( sclp, p.z ) );
+	result.w = MaddSIMD( sclq, q.w, MulSIMD( sclp, p.w ) );
+
+	// nearly opposite, go by way of a quaternion perpendicular to q
+	fltx4 oppositeMask = CmpLeSIMD( AddSIMD( Four_Ones, cosom ), eps );
+	if ( !IsAllZeros( oppositeMask ) )
+	{
+		fltx4 halfPi = ReplicateX4( 0.5f * M_PI_F );
+		fltx4 sclpOpp = SinPolySIMD( MulSIMD( SubSIMD( Four_Ones, t ), halfPi ) );
+		fltx4 sclqOpp = SinPolySIMD( MulSIMD( t, halfPi ) );
+		result.x = MaskedAssign( oppositeMask, MsubSIMD( sclqOpp, q.y, MulSIMD( sclpOpp, p.x ) ), result.x );
+		result.y = MaskedAssign( oppositeMask, MaddSIMD( sclqOpp, q.x, MulSIMD( sclpOpp, p.y ) ), result.y );
+		result.z = MaskedAssign( oppositeMask, MsubSIMD( sclqOpp, q.w, MulSIMD( sclpOpp, p.z ) ), result.z );
+		result.w = MaskedAssign( oppositeMask, q.z, result.w );
+	}
+
+	return result;
+}
+
+FORCEINLINE FourQuaternions QuaternionSlerpSIMD( const FourQuaternions &p, const FourQuaternions &q, const fltx4 &t )
+{
+	return QuaternionSlerpNoAlignSIMD( p, QuaternionAlignSIMD( p, q ), t );
+}
+
+//---------------------------------------------------------------------
+// Scale the rotation of p by t, 0 <= t <= 1
+//---------------------------------------------------------------------
+FORCEINLINE FourQuaternions QuaternionScaleSIMD( const FourQuaternions &p, const fltx4 &t )
+{
+	// FIXME: nick, this isn't overly sensitive to accuracy, and it may be faster to 
+	// use the cos part (w) of the quaternion (sin(omega)*N,cos(omega)) to figure the new scale.
+	fltx4 sinom = MulSIMD( p.x, p.x );
+	sinom = MaddSIMD( p.y, p.y, sinom );
+	sinom = MaddSIMD( p.z, p.z, sinom );
+	sinom = MinSIMD( SqrtSIMD( sinom ), Four_Ones );
+
+	fltx4 sinsom = SinPolySIMD( MulSIMD( ArcSinPolySIMD( sinom ), t ) );
+	fltx4 scale = DivSIMD( sinsom, AddSIMD( sinom, ReplicateX4( FLT_EPSILON ) ) );
+
+	FourQuaternions result;
+	result.x = MulSIMD( p.x, scale );
+	result.y = MulSIMD( p.y, scale );
+	result.z = MulSIMD( p.z, scale );
+
+	// rescale rotation
+	fltx4 r = SqrtSIMD( MaxSIMD( MsubSIMD( sinsom, sinsom, Four_Ones ), Four_Zeros ) );
+
+	// keep sign of rotation
+	result.w = MaskedAssign( CmpLtSIMD( p.w, Four_Zeros ), NegSIMD( r ), r );
+	return result;
+}
+
+//---------------------------------------------------------------------
+// Multiply Quaternions, aligning q to p first
+//---------------------------------------------------------------------
+FORCEINLINE FourQuaternions QuaternionMultSIMD( const FourQuaternions &p, const FourQuaternions &q )
+{
+	FourQuaternions q2 = QuaternionAlignSIMD( p, q );
+
+	FourQuaternions result;
+	result.x = AddSIMD( MaddSIMD( p.x, q2.w, MulSIMD( p.y, q2.z ) ), MsubSIMD( p.z, q2.y, MulSIMD( p.w, q2.x ) ) );
+	result.y = AddSIMD( MsubSIMD( p.x, q2.z, MulSIMD( p.y, q2.w ) ), MaddSIMD( p.z, q2.x, MulSIMD( p.w, q2.y ) ) );
+	result.z = AddSIMD( MsubSIMD( p.y, q2.x, MulSIMD( p.x, q2.y ) ), MaddSIMD( p.z, q2.w, MulSIMD( p.w, q2.z ) ) );
+	result.w = SubSIMD( MsubSIMD( p.x, q2.x, MulSIMD( p.w, q2.w ) ), MaddSIMD( p.y, q2.y, MulSIMD( p.z, q2.z ) ) );
+	return result;
+}
+
 #endif // SSEQUATMATH_H
 
@@ -131,6 +131,15 @@ namespace bitbuf
 
 	const int kMaxVarintBytes = 10;
 	const int kMaxVarint32Bytes = 5;
+
+	// The bits WriteSBitLong puts in the stream for data. The sign bit is
+	// kept even if data doesn't fit in numbits.
+	inline uint32 SBitLongToUBitLong( int32 data, int numbits )
+	{
+		int32 nPreserveBits = ( 0x7FFFFFFF >> ( 32 - numbits ) );
+		int32 nSignExtension = ( data >> 31 ) & ~nPreserveBits;
+		return (uint32)( ( data & nPreserveBits ) | nSignExtension );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -191,8 +200,16 @@ public:
 	// Write a list of bits in.
 	bool			WriteBits(const void *pIn, int nBits);
 
+	// Write nCount values of numbits each. The stream is the same as calling
+	// WriteUBitLong/WriteSBitLong for each one, but the bits are packed a dword
+	// at a time, and byte, word and dword fields are stored straight to memory
+	// when the buffer is byte aligned.
+	void			WriteUBitLongs( const unsigned int *pData, int nCount, int numbits );
+	void			WriteSBitLongs( const int *pData, int nCount, int numbits );
+
 	// writes an unsigned integer with variable bit length
 	void			WriteUBitVar( unsigned int data );
+	void			WriteUBitVars( const unsigned int *pData, int nCount );
 
 	// writes a varint encoded integer
 	void			WriteVarInt32( uint32 data );
@@ -488,6 +505,88 @@ public:
 };
 
 
+//-----------------------------------------------------------------------------
+// Writes to a bf_write through a 64 bit accumulator. Values are shifted into
+// the accumulator and stored a whole dword at a time, instead of each one
+// loading, masking and storing the dwords it touches like WriteUBitLong does.
+// The bf_write mustn't be used directly until Flush(), which the destructor
+// also calls. The bits in the stream are the same either way.
+//-----------------------------------------------------------------------------
+
+class bf_write_accumulator
+{
+public:
+	bf_write_accumulator( bf_write &buf );
+	~bf_write_accumulator() { Flush(); }
+
+	void			WriteOneBit( int nValue ) { WriteUBitLong( nValue ? 1 : 0, 1 ); }
+	void			WriteUBitLong( unsigned int data, int numbits );
+	void			WriteSBitLong( int data, int numbits ) { WriteUBitLong( bitbuf::SBitLongToUBitLong( data, numbits ), numbits ); }
+	void			WriteUBitVar( unsigned int data );
+	void			WriteBitFloat( float val );
+
+	void			WriteChar( int val ) { WriteSBitLong( val, sizeof( char ) << 3 ); }
+	void			WriteByte( int val ) { WriteUBitLong( val, sizeof( unsigned char ) << 3 ); }
+	void			WriteShort( int val ) { WriteSBitLong( val, sizeof( short ) << 3 ); }
+	void			WriteWord( int val ) { WriteUBitLong( val, sizeof( unsigned short ) << 3 ); }
+
+	// Stores what's left in the accumulator and moves the bf_write up to it.
+	void			Flush();
+
+	int				GetNumBitsWritten() const { return m_iCurBit; }
+	bool			IsOverflowed() const { return m_Buf.IsOverflowed(); }
+
+private:
+	void			Overflow();
+
+	bf_write		&m_Buf;
+	unsigned long	*m_pOut;		// dword the accumulator starts at
+	uint64			m_nAccum;
+	int				m_nAccumBits;	// bits in m_nAccum, always less than 32 between writes
+	int				m_iCurBit;
+};
+
+BITBUF_INLINE void bf_write_accumulator::WriteUBitLong( unsigned int data, int numbits )
+{
+	Assert( numbits >= 0 && numbits <= 32 );
+
+	if ( m_iCurBit + numbits > m_Buf.m_nDataBits )
+	{
+		Overflow();
+		return;
+	}
+
+	m_nAccum |= ( (uint64)data & ( ( (uint64)1 << numbits ) - 1 ) ) << m_nAccumBits;
+	m_nAccumBits += numbits;
+	m_iCurBit += numbits;
+
+	if ( m_nAccumBits >= 32 )
+	{
+		StoreLittleDWord( m_pOut, 0, (unsigned long)(uint32)m_nAccum );
+		++m_pOut;
+		m_nAccum >>= 32;
+		m_nAccumBits -= 32;
+	}
+}
+
+BITBUF_INLINE void bf_write_accumulator::WriteUBitVar( unsigned int data )
+{
+	// same encoding as bf_write::WriteUBitVar
+	int n = (data < 0x10u ? -1 : 0) + (data < 0x100u ? -1 : 0) + (data < 0x1000u ? -1 : 0);
+	WriteUBitLong( data*4 + n + 3, 6 + n*4 + 12 );
+	if ( data >= 0x1000u )
+	{
+		WriteUBitLong( data >> 16, 16 );
+	}
+}
+
+BITBUF_INLINE void bf_write_accumulator::WriteBitFloat( float val )
+{
+	union { float f; uint32 u; } c = { val };
+	WriteUBitLong( c.u, 32 );
+}
+
+
 
 //-----------------------------------------------------------------------------
 // Used for unserialization
@@ -570,9 +669,15 @@ public:
 	unsigned int	PeekUBitLong( int numbits );
 	int				ReadSBitLong( int numbits );
 
+	// Read nCount values of numbits each, the same as calling ReadUBitLong/ReadSBitLong
+	// for each one, through a 64 bit window that's refilled a dword at a time.
+	void			ReadUBitLongs( unsigned int *pOut, int nCount, int numbits );
+	void			ReadSBitLongs( int *pOut, int nCount, int numbits );
+
 	// reads an unsigned integer with variable bit length
 	unsigned int	ReadUBitVar();
 	unsigned int	ReadUBitVarInternal( int encodingType );
+	void			ReadUBitVars( unsigned int *pOut, int nCount );
 
 	// reads a varint encoded integer
 	uint32			ReadVarInt32();
@@ -111,6 +111,9 @@ public:
 		return m_Lookup.Count();
 	}
 
+	// Bytes used by the lookup and the string pools
+	size_t GetMemoryUsage() const;
+
 protected:
 	class CStringPoolIndex
 	{
@@ -212,6 +215,100 @@ private:
 };
 
 
+//-----------------------------------------------------------------------------
+// CUtlHashedSymbolTable:
+// description:
+//    A drop-in for CUtlSymbolTableMT that finds symbols through an open
+//    addressing hash table rather than a tree. Each string is hashed once,
+//    when it's added. AddString serializes on a mutex, but Find and String
+//    take no locks at all: nothing they read is moved or freed until
+//    RemoveAll, which mustn't be called while other threads use the table.
+//-----------------------------------------------------------------------------
+
+class CUtlHashedSymbolTable
+{
+public:
+	// constructor, destructor
+	CUtlHashedSymbolTable( int initSize = 32, bool caseInsensitive = false );
+	~CUtlHashedSymbolTable();
+
+	// Finds and/or creates a symbol based on the string
+	CUtlSymbol AddString( const char* pString );
+
+	// Finds the symbol for pString
+	CUtlSymbol Find( const char* pString ) const;
+
+	// Look up the string associated with a particular symbol
+	const char* String( CUtlSymbol id ) const;
+
+	// Remove all symbols in the table.
+	void  RemoveAll();
+
+	int GetNumStrings( void ) const
+	{
+		return m_nSymbols;
+	}
+
+	// Bytes used by the hash tables, symbols and the string pools
+	size_t GetMemoryUsage() const;
+
+private:
+	enum
+	{
+		SYMBOL_BLOCK_BITS = 8,
+		SYMBOL_BLOCK_SIZE = 1 << SYMBOL_BLOCK_BITS,
+		MAX_SYMBOL_BLOCKS = 0x10000 / SYMBOL_BLOCK_SIZE,
+	};
+
+	struct Symbol_t
+	{
+		const char *m_pString;
+		unsigned int m_nHash;
+	};
+
+	// A slot is the symbol + 1 in the low 16 bits, 0 for empty, and
+	// the top of its hash in the high 16 to skip most string compares
+	struct HashTable_t
+	{
+		HashTable_t *m_pPrevious;	// kept until RemoveAll, a reader may still be in it
+		unsigned int m_nMask;
+		unsigned int m_Slots[1];
+	};
+
+	struct StringPool_t
+	{
+		StringPool_t *m_pNext;
+		int m_TotalLen;
+		int m_SpaceUsed;
+		char m_Data[1];
+	};
+
+	unsigned int HashString( const char *pString ) const;
+	CUtlSymbol FindInTable( const HashTable_t *pTable, const char *pString, unsigned int nHash ) const;
+	void InsertIntoTable( HashTable_t *pTable, UtlSymId_t id, unsigned int nHash );
+	void GrowTable();
+	const char *CopyString( const char *pString );
+
+	const Symbol_t &GetSymbol( UtlSymId_t id ) const
+	{
+		return m_pSymbolBlocks[id >> SYMBOL_BLOCK_BITS][id & ( SYMBOL_BLOCK_SIZE - 1 )];
+	}
+
+	HashTable_t * volatile m_pTable;
+
+	// Symbols by id, in blocks that never move once they're made
+	Symbol_t * volatile m_pSymbolBlocks[MAX_SYMBOL_BLOCKS];
+	volatile int m_nSymbols;
+
+	bool m_bInsensitive;
+	int m_nInitSize;
+
+	// stores the string data, newest pool first
+	StringPool_t *m_pStringPools;
+
+	CThreadFastMutex m_AddMutex;
+};
+
 
 //-----------------------------------------------------------------------------
 // CUtlFilenameSymbolTable:
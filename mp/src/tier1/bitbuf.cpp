@@ -118,6 +118,16 @@ public:
 };
 static CBitWriteMasksInit g_BitWriteMasksInit;
 
+// Tops up a 64 bit read window with the next dword of the stream. Only called
+// when the window is short of bits that are going to be read, so it never
+// loads a dword ReadUBitLong wouldn't have.
+static FORCEINLINE void RefillBitWindow( uint64 &nWindow, int &nWindowBits, const unsigned long *&pIn )
+{
+	nWindow |= (uint64)(uint32)LoadLittleDWord( pIn, 0 ) << nWindowBits;
+	nWindowBits += 32;
+	++pIn;
+}
+
 
 // ---------------------------------------------------------------------------------------- //
 // bf_write
@@ -209,11 +219,7 @@ void bf_write::SeekToBit( int bitPos )
 void bf_write::WriteSBitLong( int data, int numbits )
 {
 	// Force the sign-extension bit to be correct even in the case of overflow.
-	int nValue = data;
-	int nPreserveBits = ( 0x7FFFFFFF >> ( 32 - numbits ) );
-	int nSignExtension = ( nValue >> 31 ) & ~nPreserveBits;
-	nValue &= nPreserveBits;
-	nValue |= nSignExtension;
+	int nValue = bitbuf::SBitLongToUBitLong( data, numbits );
 	
 	AssertMsg2( nValue == data, "WriteSBitLong: 0x%08x does not fit in %d bits", data, numbits );
 
@@ -547,6 +553,100 @@ bool bf_write::WriteBitsFromBuffer( bf_read *pIn, int nBits )
 	return !IsOverflowed() && !pIn->IsOverflowed();
 }
 
+void bf_write::WriteUBitLongs( const unsigned int *pData, int nCount, int numbits )
+{
+	Assert( numbits >= 0 && numbits <= 32 );
+
+#ifdef _DEBUG
+	for ( int i = 0; i < nCount; i++ )
+	{
+		if ( numbits < 32 && pData[i] >= (unsigned long)(1 << numbits) )
+		{
+			CallErrorHandler( BITBUFERROR_VALUE_OUT_OF_RANGE, GetDebugName() );
+		}
+	}
+#endif
+
+	// Write the values that fit, then overflow like WriteUBitLong would on the next one
+	int nFit = nCount;
+	if ( numbits && GetNumBitsLeft() < nCount * numbits )
+		nFit = MAX( GetNumBitsLeft(), 0 ) / numbits;
+
+	if ( (m_iCurBit & 7) == 0 && (numbits == 8 || numbits == 16 || numbits == 32) )
+	{
+		// Byte aligned whole bytes. The stream is little endian, so these are plain stores.
+		unsigned char *pOut = (unsigned char*)m_pData + (m_iCurBit >> 3);
+		switch ( numbits )
+		{
+		case 8:
+			for ( int i = 0; i < nFit; i++ )
+				pOut[i] = (unsigned char)pData[i];
+			break;
+
+		case 16:
+			for ( int i = 0; i < nFit; i++ )
+			{
+				pOut[i*2] = (unsigned char)pData[i];
+				pOut[i*2 + 1] = (unsigned char)(pData[i] >> 8);
+			}
+			break;
+
+		default:
+#if VALVE_LITTLE_ENDIAN
+			Q_memcpy( pOut, pData, nFit * sizeof(unsigned int) );
+#else
+			for ( int i = 0; i < nFit; i++ )
+			{
+				unsigned int data = LittleDWord( pData[i] );
+				Q_memcpy( pOut + i*4, &data, sizeof(data) );
+			}
+#endif
+			break;
+		}
+
+		m_iCurBit += nFit * numbits;
+	}
+	else if ( nFit )
+	{
+		bf_write_accumulator accum( *this );
+		for ( int i = 0; i < nFit; i++ )
+			accum.WriteUBitLong( pData[i], numbits );
+	}
+
+	if ( nFit < nCount )
+	{
+		m_iCurBit = m_nDataBits;
+		SetOverflowFlag();
+		CallErrorHandler( BITBUFERROR_BUFFER_OVERRUN, GetDebugName() );
+	}
+}
+
+void bf_write::WriteSBitLongs( const int *pData, int nCount, int numbits )
+{
+	// Convert a batch at a time to what WriteSBitLong would write
+	unsigned int bits[64];
+	while ( nCount > 0 )
+	{
+		int nBatch = MIN( nCount, (int)ARRAYSIZE( bits ) );
+		for ( int i = 0; i < nBatch; i++ )
+		{
+			bits[i] = bitbuf::SBitLongToUBitLong( pData[i], numbits );
+			AssertMsg2( (int)bits[i] == pData[i], "WriteSBitLongs: 0x%08x does not fit in %d bits", pData[i], numbits );
+		}
+
+		WriteUBitLongs( bits, nBatch, numbits );
+		pData += nBatch;
+		nCount -= nBatch;
+	}
+}
+
+void bf_write::WriteUBitVars( const unsigned int *pData, int nCount )
+{
+	bf_write_accumulator accum( *this );
+	for ( int i = 0; i < nCount; i++ )
+		accum.WriteUBitVar( pData[i] );
+}
+
 
 void bf_write::WriteBitAngle( float fAngle, int numbits )
 {
@@ -783,6 +883,48 @@ bool bf_write::WriteString(const char *pStr)
 	return !IsOverflowed();
 }
 
+// ---------------------------------------------------------------------------------------- //
+// bf_write_accumulator
+// ---------------------------------------------------------------------------------------- //
+
+bf_write_accumulator::bf_write_accumulator( bf_write &buf ) : m_Buf( buf )
+{
+	m_iCurBit = buf.m_iCurBit;
+	m_pOut = buf.m_pData + (m_iCurBit >> 5);
+	m_nAccumBits = m_iCurBit & 31;
+
+	// The bits already written to the first dword go back out with it
+	m_nAccum = m_nAccumBits ? ( (uint32)LoadLittleDWord( m_pOut, 0 ) & ( (1u << m_nAccumBits) - 1 ) ) : 0;
+}
+
+void bf_write_accumulator::Flush()
+{
+	if ( m_nAccumBits )
+	{
+		// Keep the rest of the last dword, the same as WriteUBitLong does
+		unsigned long mask = (1u << m_nAccumBits) - 1;
+		unsigned long dword = LoadLittleDWord( m_pOut, 0 );
+		StoreLittleDWord( m_pOut, 0, (dword & ~mask) | ((unsigned long)m_nAccum & mask) );
+	}
+
+	m_Buf.m_iCurBit = m_iCurBit;
+}
+
+void bf_write_accumulator::Overflow()
+{
+	// Store what's written so far, then leave the buffer at the end like WriteUBitLong does
+	Flush();
+
+	m_iCurBit = m_Buf.m_nDataBits;
+	m_nAccum = 0;
+	m_nAccumBits = 0;
+
+	m_Buf.m_iCurBit = m_iCurBit;
+	m_Buf.SetOverflowFlag();
+	CallErrorHandler( BITBUFERROR_BUFFER_OVERRUN, m_Buf.GetDebugName() );
+}
+
+
 // ---------------------------------------------------------------------------------------- //
 // bf_read
 // ---------------------------------------------------------------------------------------- //
@@ -883,6 +1025,17 @@ void bf_read::ReadBits(void *pOutData, int nBits)
 	unsigned char *pOut = (unsigned char*)pOutData;
 	int nBitsLeft = nBits;
 
+	if ( IsPC() && (nBitsLeft >= 32) && (m_iCurBit & 7) == 0 && GetNumBitsLeft() >= nBitsLeft )
+	{
+		// current bit is byte aligned, do block copy
+		int numbytes = nBitsLeft >> 3;
+		int numbits = numbytes << 3;
+
+		Q_memcpy( pOut, m_pData + (m_iCurBit >> 3), numbytes );
+		pOut += numbytes;
+		nBitsLeft -= numbits;
+		m_iCurBit += numbits;
+	}
 	
 	// align output to dword boundary
 	while( ((size_t)pOut & 3) != 0 && nBitsLeft >= 8 )
@@ -1005,6 +1158,44 @@ unsigned int bf_read::ReadUBitVarInternal( int encodingType )
 	return ReadUBitLong( bits );
 }
 
+void bf_read::ReadUBitVars( unsigned int *pOut, int nCount )
+{
+	int i = 0;
+
+	// A value takes at most 34 bits. Read through a window while they're sure to be there.
+	if ( nCount > 0 && GetNumBitsLeft() >= 34 )
+	{
+		const unsigned long *pIn = (const unsigned long *)m_pData + (m_iCurBit >> 5);
+		uint64 nWindow = (uint32)LoadLittleDWord( pIn, 0 ) >> (m_iCurBit & 31);
+		int nWindowBits = 32 - (m_iCurBit & 31);
+		++pIn;
+
+		for ( ; i < nCount && GetNumBitsLeft() >= 34; i++ )
+		{
+			if ( nWindowBits < 2 )
+				RefillBitWindow( nWindow, nWindowBits, pIn );
+
+			int encodingType = (int)(nWindow & 3);
+			nWindow >>= 2;
+			nWindowBits -= 2;
+
+			// int bits = { 4, 8, 12, 32 }[ encodingType ];
+			int bits = 4 + encodingType*4 + (((2 - encodingType) >> 31) & 16);
+			if ( nWindowBits < bits )
+				RefillBitWindow( nWindow, nWindowBits, pIn );
+
+			pOut[i] = (unsigned int)(nWindow & (((uint64)1 << bits) - 1));
+			nWindow >>= bits;
+			nWindowBits -= bits;
+			m_iCurBit += 2 + bits;
+		}
+	}
+
+	// The last few, which might overflow
+	for ( ; i < nCount; i++ )
+		pOut[i] = ReadUBitVar();
+}
+
 // Append numbits least significant bits from data to the current bit stream
 int bf_read::ReadSBitLong( int numbits )
 {
@@ -1018,6 +1209,85 @@ int bf_read::ReadSBitLong( int numbits )
 	return r;
 }
 
+void bf_read::ReadUBitLongs( unsigned int *pOut, int nCount, int numbits )
+{
+	Assert( numbits > 0 && numbits <= 32 );
+
+	// Read the values that are there, then zeros like ReadUBitLong gives once it overflows
+	int nFit = nCount;
+	if ( GetNumBitsLeft() < nCount * numbits )
+		nFit = MAX( GetNumBitsLeft(), 0 ) / numbits;
+
+	if ( (m_iCurBit & 7) == 0 && (numbits == 8 || numbits == 16 || numbits == 32) )
+	{
+		// Byte aligned whole bytes. The stream is little endian, so these are plain loads.
+		const unsigned char *pIn = m_pData + (m_iCurBit >> 3);
+		switch ( numbits )
+		{
+		case 8:
+			for ( int i = 0; i < nFit; i++ )
+				pOut[i] = pIn[i];
+			break;
+
+		case 16:
+			for ( int i = 0; i < nFit; i++ )
+				pOut[i] = pIn[i*2] | (pIn[i*2 + 1] << 8);
+			break;
+
+		default:
+			Q_memcpy( pOut, pIn, nFit * sizeof(unsigned int) );
+#if !VALVE_LITTLE_ENDIAN
+			for ( int i = 0; i < nFit; i++ )
+				pOut[i] = LittleDWord( pOut[i] );
+#endif
+			break;
+		}
+	}
+	else if ( nFit )
+	{
+		const unsigned long *pIn = (const unsigned long *)m_pData + (m_iCurBit >> 5);
+		uint64 nWindow = (uint32)LoadLittleDWord( pIn, 0 ) >> (m_iCurBit & 31);
+		int nWindowBits = 32 - (m_iCurBit & 31);
+		++pIn;
+
+		uint64 nMask = ((uint64)1 << numbits) - 1;
+		for ( int i = 0; i < nFit; i++ )
+		{
+			if ( nWindowBits < numbits )
+				RefillBitWindow( nWindow, nWindowBits, pIn );
+
+			pOut[i] = (unsigned int)(nWindow & nMask);
+			nWindow >>= numbits;
+			nWindowBits -= numbits;
+		}
+	}
+
+	m_iCurBit += nFit * numbits;
+
+	if ( nFit < nCount )
+	{
+		m_iCurBit = m_nDataBits;
+		SetOverflowFlag();
+		CallErrorHandler( BITBUFERROR_BUFFER_OVERRUN, GetDebugName() );
+		Q_memset( pOut + nFit, 0, (nCount - nFit) * sizeof(unsigned int) );
+	}
+}
+
+void bf_read::ReadSBitLongs( int *pOut, int nCount, int numbits )
+{
+	ReadUBitLongs( (unsigned int *)pOut, nCount, numbits );
+
+	// sign-extend the same way ReadSBitLong does
+	unsigned int s = 1 << (numbits-1);
+	for ( int i = 0; i < nCount; i++ )
+	{
+		unsigned int r = pOut[i];
+		if ( r >= s )
+			r = r - s - s;
+		pOut[i] = r;
+	}
+}
+
 uint32 bf_read::ReadVarInt32()
 {
 	uint32 result = 0;
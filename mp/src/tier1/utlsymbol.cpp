@@ -15,6 +15,7 @@
 #include "stringpool.h"
 #include "utlhashtable.h"
 #include "utlstring.h"
+#include "generichash.h"
 
 // Ensure that everybody has the right compiler version installed. The version
 // number can be obtained by looking at the compiler output when you type 'cl'
@@ -288,6 +289,287 @@ void CUtlSymbolTable::RemoveAll()
 }
 
 
+//-----------------------------------------------------------------------------
+// Bytes used by the lookup and the string pools
+//-----------------------------------------------------------------------------
+
+size_t CUtlSymbolTable::GetMemoryUsage() const
+{
+	size_t nBytes = m_Lookup.MaxElement() * sizeof( UtlRBTreeNode_t< CStringPoolIndex, unsigned short > ) + m_StringPools.NumAllocated() * sizeof( StringPool_t * );
+	for ( int i=0; i < m_StringPools.Count(); i++ )
+		nBytes += sizeof( StringPool_t ) + m_StringPools[i]->m_TotalLen - 1;
+
+	return nBytes;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Hashed symbol table
+//-----------------------------------------------------------------------------
+
+CUtlHashedSymbolTable::CUtlHashedSymbolTable( int initSize, bool caseInsensitive ) :
+	m_pTable( NULL ), m_nSymbols( 0 ), m_bInsensitive( caseInsensitive ), m_nInitSize( initSize ), m_pStringPools( NULL )
+{
+	memset( (void *)m_pSymbolBlocks, 0, sizeof( m_pSymbolBlocks ) );
+}
+
+CUtlHashedSymbolTable::~CUtlHashedSymbolTable()
+{
+	RemoveAll();
+}
+
+
+// HashString is only 16 bits, the tags in the slots need the top half
+#define HASHED_SYMBOL_SEED	0x5F3759DF
+
+inline unsigned int CUtlHashedSymbolTable::HashString( const char *pString ) const
+{
+	return m_bInsensitive ? MurmurHash2LowerCase( pString, HASHED_SYMBOL_SEED ) : MurmurHash2( pString, V_strlen( pString ), HASHED_SYMBOL_SEED );
+}
+
+
+//-----------------------------------------------------------------------------
+// Linear probing from the hash. The slot is read once and then only what
+// it points at, which was all written before the slot was.
+//-----------------------------------------------------------------------------
+
+CUtlSymbol CUtlHashedSymbolTable::FindInTable( const HashTable_t *pTable, const char *pString, unsigned int nHash ) const
+{
+	unsigned int nTag = nHash & 0xFFFF0000;
+	for ( unsigned int i = nHash & pTable->m_nMask; ; i = ( i + 1 ) & pTable->m_nMask )
+	{
+		unsigned int nSlot = *(volatile const unsigned int *)&pTable->m_Slots[i];
+		if ( !nSlot )
+			return CUtlSymbol();
+
+		if ( ( nSlot & 0xFFFF0000 ) != nTag )
+			continue;
+
+		UtlSymId_t id = (UtlSymId_t)( ( nSlot & 0xFFFF ) - 1 );
+		const char *pSymbolString = GetSymbol( id ).m_pString;
+		if ( m_bInsensitive ? !V_stricmp( pSymbolString, pString ) : !V_strcmp( pSymbolString, pString ) )
+			return CUtlSymbol( id );
+	}
+}
+
+
+CUtlSymbol CUtlHashedSymbolTable::Find( const char* pString ) const
+{
+	if (!pString)
+		return CUtlSymbol();
+
+	const HashTable_t *pTable = m_pTable;
+	if ( !pTable )
+		return CUtlSymbol();
+
+	return FindInTable( pTable, pString, HashString( pString ) );
+}
+
+
+void CUtlHashedSymbolTable::InsertIntoTable( HashTable_t *pTable, UtlSymId_t id, unsigned int nHash )
+{
+	unsigned int i = nHash & pTable->m_nMask;
+	while ( pTable->m_Slots[i] )
+	{
+		i = ( i + 1 ) & pTable->m_nMask;
+	}
+
+	*(volatile unsigned int *)&pTable->m_Slots[i] = ( nHash & 0xFFFF0000 ) | ( id + 1 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Moves to a table twice the size. Readers already in the old one carry on
+// in it, so it isn't freed until RemoveAll.
+//-----------------------------------------------------------------------------
+
+void CUtlHashedSymbolTable::GrowTable()
+{
+	HashTable_t *pOldTable = m_pTable;
+
+	unsigned int nSlots = pOldTable ? ( pOldTable->m_nMask + 1 ) * 2 : 16;
+	while ( !pOldTable && nSlots < (unsigned int)m_nInitSize * 2 )
+	{
+		nSlots *= 2;
+	}
+
+	HashTable_t *pTable = (HashTable_t *)malloc( sizeof( HashTable_t ) + ( nSlots - 1 ) * sizeof( unsigned int ) );
+	pTable->m_pPrevious = pOldTable;
+	pTable->m_nMask = nSlots - 1;
+	memset( pTable->m_Slots, 0, nSlots * sizeof( unsigned int ) );
+
+	// the hashes were kept, so no strings need hashing again
+	for ( int i = 0; i < m_nSymbols; i++ )
+	{
+		InsertIntoTable( pTable, (UtlSymId_t)i, GetSymbol( (UtlSymId_t)i ).m_nHash );
+	}
+
+	ThreadMemoryBarrier();
+	m_pTable = pTable;
+}
+
+
+const char *CUtlHashedSymbolTable::CopyString( const char *pString )
+{
+	int len = V_strlen( pString ) + 1;
+
+	StringPool_t *pPool = m_pStringPools;
+	if ( !pPool || pPool->m_TotalLen - pPool->m_SpaceUsed < len )
+	{
+		int newPoolSize = max( len, MIN_STRING_POOL_SIZE );
+		pPool = (StringPool_t*)malloc( sizeof( StringPool_t ) + newPoolSize - 1 );
+		pPool->m_TotalLen = newPoolSize;
+		pPool->m_SpaceUsed = 0;
+
+		// a string that needs a pool to itself goes behind the current one, so its space isn't lost
+		if ( m_pStringPools && len > MIN_STRING_POOL_SIZE / 2 )
+		{
+			pPool->m_pNext = m_pStringPools->m_pNext;
+			m_pStringPools->m_pNext = pPool;
+		}
+		else
+		{
+			pPool->m_pNext = m_pStringPools;
+			m_pStringPools = pPool;
+		}
+	}
+
+	char *pCopy = &pPool->m_Data[pPool->m_SpaceUsed];
+	memcpy( pCopy, pString, len );
+	pPool->m_SpaceUsed += len;
+	return pCopy;
+}
+
+
+//-----------------------------------------------------------------------------
+// Finds and/or creates a symbol based on the string
+//-----------------------------------------------------------------------------
+
+CUtlSymbol CUtlHashedSymbolTable::AddString( const char* pString )
+{
+	if (!pString) 
+		return CUtlSymbol( UTL_INVAL_SYMBOL );
+
+	unsigned int nHash = HashString( pString );
+
+	// most of the time it's there already, and that doesn't need the lock
+	const HashTable_t *pTable = m_pTable;
+	if ( pTable )
+	{
+		CUtlSymbol id = FindInTable( pTable, pString, nHash );
+		if ( id.IsValid() )
+			return id;
+	}
+
+	AUTO_LOCK( m_AddMutex );
+
+	// someone else may have added it while we waited
+	if ( m_pTable )
+	{
+		CUtlSymbol id = FindInTable( m_pTable, pString, nHash );
+		if ( id.IsValid() )
+			return id;
+	}
+
+	int iSymbol = m_nSymbols;
+	if ( iSymbol >= UTL_INVAL_SYMBOL )
+	{
+		AssertMsg( 0, "CUtlHashedSymbolTable is full" );
+		return CUtlSymbol( UTL_INVAL_SYMBOL );
+	}
+
+	// keep the table at most three quarters full, the tags keep the probes cheap
+	if ( !m_pTable || ( iSymbol + 1 ) * 4 > (int)( m_pTable->m_nMask + 1 ) * 3 )
+	{
+		GrowTable();
+	}
+
+	int iBlock = iSymbol >> SYMBOL_BLOCK_BITS;
+	if ( !m_pSymbolBlocks[iBlock] )
+	{
+		m_pSymbolBlocks[iBlock] = (Symbol_t *)malloc( SYMBOL_BLOCK_SIZE * sizeof( Symbol_t ) );
+	}
+
+	Symbol_t &symbol = m_pSymbolBlocks[iBlock][iSymbol & ( SYMBOL_BLOCK_SIZE - 1 )];
+	symbol.m_pString = CopyString( pString );
+	symbol.m_nHash = nHash;
+
+	// the symbol has to be there before a reader can find the slot pointing at it
+	ThreadMemoryBarrier();
+	InsertIntoTable( m_pTable, (UtlSymId_t)iSymbol, nHash );
+	m_nSymbols = iSymbol + 1;
+
+	return CUtlSymbol( (UtlSymId_t)iSymbol );
+}
+
+
+//-----------------------------------------------------------------------------
+// Look up the string associated with a particular symbol
+//-----------------------------------------------------------------------------
+
+const char* CUtlHashedSymbolTable::String( CUtlSymbol id ) const
+{
+	if (!id.IsValid()) 
+		return "";
+
+	Assert( (UtlSymId_t)id < m_nSymbols );
+	return GetSymbol( id ).m_pString;
+}
+
+
+//-----------------------------------------------------------------------------
+// Remove all symbols in the table.
+//-----------------------------------------------------------------------------
+
+void CUtlHashedSymbolTable::RemoveAll()
+{
+	while ( m_pTable )
+	{
+		HashTable_t *pPrevious = m_pTable->m_pPrevious;
+		free( m_pTable );
+		m_pTable = pPrevious;
+	}
+
+	for ( int i = 0; i < MAX_SYMBOL_BLOCKS; i++ )
+	{
+		free( m_pSymbolBlocks[i] );
+		m_pSymbolBlocks[i] = NULL;
+	}
+	m_nSymbols = 0;
+
+	while ( m_pStringPools )
+	{
+		StringPool_t *pNext = m_pStringPools->m_pNext;
+		free( m_pStringPools );
+		m_pStringPools = pNext;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Bytes used by the hash tables, symbols and the string pools
+//-----------------------------------------------------------------------------
+
+size_t CUtlHashedSymbolTable::GetMemoryUsage() const
+{
+	size_t nBytes = 0;
+	for ( const HashTable_t *pTable = m_pTable; pTable; pTable = pTable->m_pPrevious )
+		nBytes += sizeof( HashTable_t ) + pTable->m_nMask * sizeof( unsigned int );
+
+	for ( int i = 0; i < MAX_SYMBOL_BLOCKS; i++ )
+	{
+		if ( m_pSymbolBlocks[i] )
+			nBytes += SYMBOL_BLOCK_SIZE * sizeof( Symbol_t );
+	}
+
+	for ( const StringPool_t *pPool = m_pStringPools; pPool; pPool = pPool->m_pNext )
+		nBytes += sizeof( StringPool_t ) + pPool->m_TotalLen - 1;
+
+	return nBytes;
+}
+
+
 
 class CUtlFilenameSymbolTable::HashTable : public CUtlStableHashtable<CUtlConstString>
 {
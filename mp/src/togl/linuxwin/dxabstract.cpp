@@ -33,6 +33,7 @@
 #include "tier1/strtools.h"
 #include "tier1/utlbuffer.h"
 #include "dx9asmtogl2.h"
+#include "glsltranslationcache.h"
 #include "mathlib/vmatrix.h"
 #include "materialsystem/IShader.h"
 
@@ -2923,6 +2924,21 @@ static ConCommand gl_dump_textures( "gl_dump_textures", gl_dump_textures_func );
 
 #endif
 
+static void gl_shadercache_stats_func( const CCommand &args )
+{
+	g_GLSLTranslationCache.PrintStats();
+}
+static ConCommand gl_shadercache_stats( "gl_shadercache_stats", gl_shadercache_stats_func, "Print hit rate and timings for the GLSL translation cache." );
+
+static void gl_shadercache_pretranslate_func( const CCommand &args )
+{
+	// a translator of our own, the device's may be in use
+	D3DToGL *pTranslator = new D3DToGL;
+	g_GLSLTranslationCache.Pretranslate( pTranslator );
+	delete pTranslator;
+}
+static ConCommand gl_shadercache_pretranslate( "gl_shadercache_pretranslate", gl_shadercache_pretranslate_func, "Retranslate every shader in the GLSL translation cache with the current translator, timing it, and rewrite the cache." );
+
 ConVar gl_blitmode( "gl_blitmode", "1" );
 ConVar dxa_nullrefresh_capslock( "dxa_nullrefresh_capslock", "0" );
 
@@ -3901,7 +3917,7 @@ HRESULT IDirect3DDevice9::CreatePixelShader(CONST DWORD* pFunction,IDirect3DPixe
 			}
 		}
 
-		g_D3DToOpenGLTranslatorGLSL.TranslateShader( (uint32 *) pFunction, &tempbuf, &bVertexShader, glslPixelShaderOptions, nShadowDepthSamplerMask, nCentroidMask, pDebugLabel );
+		g_GLSLTranslationCache.TranslateShader( &g_D3DToOpenGLTranslatorGLSL, (uint32 *) pFunction, &tempbuf, &bVertexShader, glslPixelShaderOptions, nShadowDepthSamplerMask, nCentroidMask, pDebugLabel );
 			
 		transbuf.PutString( (char*)tempbuf.Base() );
 		transbuf.PutString( "\n\n" );	// whitespace
@@ -4187,7 +4203,7 @@ HRESULT IDirect3DDevice9::CreateVertexShader(CONST DWORD* pFunction, IDirect3DVe
 			glslVertexShaderOptions |= D3DToGL_OptionGenerateBoneUniformBuffer;
 		}
 
-		g_D3DToOpenGLTranslatorGLSL.TranslateShader( (uint32 *) pFunction, &tempbuf, &bVertexShader, glslVertexShaderOptions, -1, nCentroidMask, pDebugLabel );
+		g_GLSLTranslationCache.TranslateShader( &g_D3DToOpenGLTranslatorGLSL, (uint32 *) pFunction, &tempbuf, &bVertexShader, glslVertexShaderOptions, -1, nCentroidMask, pDebugLabel );
 			
 		transbuf.PutString( (char*)tempbuf.Base() );
 		transbuf.PutString( "\n\n" );	// whitespace
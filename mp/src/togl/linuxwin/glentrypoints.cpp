@@ -42,6 +42,8 @@
 #include "inputsystem/ButtonCode.h"
 #include "tier1.h"
 #include "tier2/tier2.h"
+#include "dx9asmtogl2.h"
+#include "glsltranslationcache.h"
 
 #ifdef _LINUX
 #include <GL/glx.h>
@@ -196,6 +198,8 @@ COpenGLEntryPoints *ToGLConnectLibraries( CreateInterfaceFn factory )
 
 void ToGLDisconnectLibraries()
 {
+	g_GLSLTranslationCache.Shutdown();
+
 	DisconnectTier2Libraries();
 	ConVar_Unregister();
 	DisconnectTier1Libraries();
@@ -0,0 +1,664 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//                       TOGL CODE LICENSE
+//
+//  Copyright 2011-2014 Valve Corporation
+//  All Rights Reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+// glsltranslationcache.cpp
+//
+//==================================================================================================
+
+#include "togl/rendermechanism.h"
+
+#include "filesystem.h"
+#include "tier0/platform.h"
+#include "tier0/icommandline.h"
+#include "dx9asmtogl2.h"
+#include "glsltranslationcache.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// memdbgon -must- be the last include file in a .cpp file.
+#include "tier0/memdbgon.h"
+
+ConVar gl_shadercache( "gl_shadercache", "1", 0, "Keep translated GLSL shaders in " GLSL_TRANSLATION_CACHE_FILE " so they only have to be translated once." );
+
+CGLSLTranslationCache g_GLSLTranslationCache;
+
+#define D3DSIO_END_TOKEN		0x0000FFFF
+#define D3DSIO_COMMENT_TOKEN	0x0000FFFE
+#define MAX_BYTECODE_TOKENS		( 1 << 20 )
+
+static inline uint32 AlignTo4( uint32 n )
+{
+	return ( n + 3 ) & ~3;
+}
+
+//------------------------------------------------------------------------------
+// FNV-1a, a word at a time for the bytecode
+//------------------------------------------------------------------------------
+static uint64 HashBytecode( const uint32 *code, uint32 nTokens )
+{
+	uint64 nHash = 14695981039346656037ull;
+	for ( uint32 i = 0; i < nTokens; i++ )
+	{
+		nHash ^= code[i];
+		nHash *= 1099511628211ull;
+	}
+	return nHash;
+}
+
+static uint32 HashLabel( const char *pLabel )
+{
+	uint32 nHash = 2166136261u;
+	for ( const char *p = pLabel; p && *p; p++ )
+	{
+		nHash ^= (uint8)*p;
+		nHash *= 16777619u;
+	}
+	return nHash;
+}
+
+//------------------------------------------------------------------------------
+// GetBytecodeSize()
+//
+// Walks the instruction stream to the end token. Only shader model 2 and up encode the
+// instruction length in the opcode token, so older bytecode is left uncached rather than
+// risk finding an end token inside an instruction's operands.
+//------------------------------------------------------------------------------
+uint32 CGLSLTranslationCache::GetBytecodeSize( const uint32 *code )
+{
+	uint32 nMajorVersion = ( code[0] >> 8 ) & 0xFF;
+	if ( nMajorVersion < 2 )
+		return 0;
+
+	uint32 i = 1;
+	while ( i < MAX_BYTECODE_TOKENS )
+	{
+		uint32 dwToken = code[i];
+		if ( dwToken == D3DSIO_END_TOKEN )
+			return ( i + 1 ) * sizeof( uint32 );
+
+		if ( ( dwToken & 0xFFFF ) == D3DSIO_COMMENT_TOKEN )
+			i += 1 + ( ( dwToken >> 16 ) & 0x7FFF );
+		else
+			i += 1 + ( ( dwToken >> 24 ) & 0x0F );
+	}
+
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+CGLSLTranslationCache::CGLSLTranslationCache()
+{
+	m_bInitialized = false;
+	m_szFileName[0] = 0;
+	m_pMapped = NULL;
+	m_nMappedSize = 0;
+	m_nValidSize = 0;
+	m_hWriter = NULL;
+	m_bWriterExit = false;
+
+	m_nHits = m_nMisses = m_nUncacheable = m_nStale = m_nPruned = m_nCollisions = 0;
+	m_flLookupTime = m_flTranslateTime = 0.0;
+}
+
+CGLSLTranslationCache::~CGLSLTranslationCache()
+{
+	Shutdown();
+}
+
+void CGLSLTranslationCache::Shutdown()
+{
+	StopWriter();
+
+	AUTO_LOCK( m_Mutex );
+	ReleaseEntries();
+	UnmapFile();
+	m_bInitialized = false;
+}
+
+//------------------------------------------------------------------------------
+// Init()
+//
+// Maps the cache file from the mod directory and indexes its records. Only the
+// offline mode (no writer) keeps records made by other translator versions.
+//------------------------------------------------------------------------------
+void CGLSLTranslationCache::Init( bool bStartWriter )
+{
+	m_bInitialized = true;
+
+	char szPath[ MAX_PATH ] = "";
+	if ( g_pFullFileSystem )
+	{
+		// the first MOD path is the one files are written to
+		g_pFullFileSystem->GetSearchPath( "MOD", false, szPath, sizeof( szPath ) );
+		char *pSeparator = V_strstr( szPath, ";" );
+		if ( pSeparator )
+			*pSeparator = 0;
+	}
+
+	if ( szPath[0] )
+		V_ComposeFileName( szPath, GLSL_TRANSLATION_CACHE_FILE, m_szFileName, sizeof( m_szFileName ) );
+	else
+		V_strncpy( m_szFileName, GLSL_TRANSLATION_CACHE_FILE, sizeof( m_szFileName ) );
+
+	MapFile( !bStartWriter );
+
+	if ( bStartWriter )
+		StartWriter();
+}
+
+//------------------------------------------------------------------------------
+// MapFile()
+//
+// Every complete record is indexed in place. A record cut short (the game exited
+// mid-append) ends the walk and is dropped when the writer starts, as are records
+// made by another translator version unless bKeepStale is set.
+//------------------------------------------------------------------------------
+void CGLSLTranslationCache::MapFile( bool bKeepStale )
+{
+#ifdef _WIN32
+	FILE *fp = fopen( m_szFileName, "rb" );
+	if ( !fp )
+		return;
+
+	fseek( fp, 0, SEEK_END );
+	long nSize = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+	if ( nSize > 0 )
+	{
+		m_pMapped = (uint8 *)malloc( nSize );
+		if ( fread( m_pMapped, 1, nSize, fp ) == (size_t)nSize )
+		{
+			m_nMappedSize = nSize;
+		}
+		else
+		{
+			free( m_pMapped );
+			m_pMapped = NULL;
+		}
+	}
+	fclose( fp );
+#else
+	int fd = open( m_szFileName, O_RDONLY );
+	if ( fd < 0 )
+		return;
+
+	struct stat st;
+	if ( fstat( fd, &st ) == 0 && st.st_size > 0 )
+	{
+		void *pData = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+		if ( pData != MAP_FAILED )
+		{
+			m_pMapped = (uint8 *)pData;
+			m_nMappedSize = st.st_size;
+		}
+	}
+	close( fd );
+#endif
+
+	if ( !m_pMapped )
+		return;
+
+	const GLSLTranslationFileHeader_t *pHeader = (const GLSLTranslationFileHeader_t *)m_pMapped;
+	if ( m_nMappedSize < sizeof( *pHeader ) || pHeader->m_nMagic != GLSL_TRANSLATION_CACHE_MAGIC || pHeader->m_nVersion != GLSL_TRANSLATION_CACHE_VERSION )
+		return;
+
+	uint32 nOffset = sizeof( *pHeader );
+	while ( nOffset + sizeof( GLSLTranslationRecord_t ) <= m_nMappedSize )
+	{
+		const GLSLTranslationRecord_t *pRecord = (const GLSLTranslationRecord_t *)( m_pMapped + nOffset );
+
+		// sizes are checked one at a time so a garbage record can't overflow the sum
+		uint32 nRemaining = m_nMappedSize - nOffset - sizeof( *pRecord );
+		if ( ( pRecord->m_nTextSize & 3 ) || ( pRecord->m_nLabelSize & 3 ) || ( pRecord->m_Key.m_nCodeSize & 3 ) ||
+			pRecord->m_nTextSize == 0 || pRecord->m_nLabelSize == 0 ||
+			pRecord->m_nTextSize > nRemaining ||
+			pRecord->m_nLabelSize > nRemaining - pRecord->m_nTextSize ||
+			pRecord->m_Key.m_nCodeSize > nRemaining - pRecord->m_nTextSize - pRecord->m_nLabelSize )
+		{
+			break;
+		}
+
+		const char *pText = (const char *)( pRecord + 1 );
+		const char *pLabel = pText + pRecord->m_nTextSize;
+		if ( pText[ pRecord->m_nTextSize - 1 ] != 0 || pLabel[ pRecord->m_nLabelSize - 1 ] != 0 )
+			break;
+
+		uint32 nRecordSize = sizeof( *pRecord ) + pRecord->m_nTextSize + pRecord->m_nLabelSize + pRecord->m_Key.m_nCodeSize;
+		if ( bKeepStale || pRecord->m_Key.m_nTranslatorVersion == GLSL_TRANSLATOR_VERSION )
+			AddEntry( pRecord, nRecordSize, false );
+		else
+			m_nPruned++;
+
+		nOffset += nRecordSize;
+	}
+
+	m_nValidSize = nOffset;
+}
+
+void CGLSLTranslationCache::UnmapFile()
+{
+	if ( m_pMapped )
+	{
+#ifdef _WIN32
+		free( m_pMapped );
+#else
+		munmap( m_pMapped, m_nMappedSize );
+#endif
+	}
+
+	m_pMapped = NULL;
+	m_nMappedSize = 0;
+	m_nValidSize = 0;
+}
+
+void CGLSLTranslationCache::ReleaseEntries()
+{
+	FOR_EACH_VEC( m_Entries, i )
+	{
+		if ( m_Entries[i].m_bOwned )
+			free( (void *)m_Entries[i].m_pRecord );
+	}
+
+	m_Entries.Purge();
+	m_Index.Purge();
+	m_nStale = 0;
+	m_nPruned = 0;
+}
+
+int CGLSLTranslationCache::AddEntry( const GLSLTranslationRecord_t *pRecord, uint32 nRecordSize, bool bOwned )
+{
+	int i = m_Entries.AddToTail();
+	Entry_t &entry = m_Entries[i];
+	entry.m_pRecord = pRecord;
+	entry.m_pText = (const char *)( pRecord + 1 );
+	entry.m_pLabel = entry.m_pText + pRecord->m_nTextSize;
+	entry.m_pCode = (const uint32 *)( entry.m_pLabel + pRecord->m_nLabelSize );
+	entry.m_nRecordSize = nRecordSize;
+	entry.m_bOwned = bOwned;
+
+	if ( pRecord->m_Key.m_nTranslatorVersion == GLSL_TRANSLATOR_VERSION )
+	{
+		// the newest record for a key wins, it replaces one whose bytecode only collided with it
+		UtlHashHandle_t h = m_Index.Insert( pRecord->m_Key, i );
+		m_Index.Element( h ) = i;
+	}
+	else
+	{
+		m_nStale++;
+	}
+
+	return i;
+}
+
+GLSLTranslationRecord_t *CGLSLTranslationCache::BuildRecord( const GLSLTranslationKey_t &key, const uint32 *code, const char *pText, const char *pLabel, bool bVertexShader, int nResult, uint32 *pRecordSize )
+{
+	uint32 nTextSize = AlignTo4( V_strlen( pText ) + 1 );
+	uint32 nLabelSize = AlignTo4( V_strlen( pLabel ) + 1 );
+	uint32 nRecordSize = sizeof( GLSLTranslationRecord_t ) + nTextSize + nLabelSize + key.m_nCodeSize;
+
+	GLSLTranslationRecord_t *pRecord = (GLSLTranslationRecord_t *)malloc( nRecordSize );
+	V_memset( pRecord, 0, nRecordSize );
+	pRecord->m_Key = key;
+	pRecord->m_nFlags = bVertexShader ? GLSL_TRANSLATION_VERTEX_SHADER : 0;
+	pRecord->m_nResult = nResult;
+	pRecord->m_nTextSize = nTextSize;
+	pRecord->m_nLabelSize = nLabelSize;
+
+	char *pData = (char *)( pRecord + 1 );
+	V_memcpy( pData, pText, V_strlen( pText ) );
+	V_memcpy( pData + nTextSize, pLabel, V_strlen( pLabel ) );
+	V_memcpy( pData + nTextSize + nLabelSize, code, key.m_nCodeSize );
+
+	*pRecordSize = nRecordSize;
+	return pRecord;
+}
+
+void CGLSLTranslationCache::CopyText( const Entry_t &entry, CUtlBuffer *pBuf, bool *bVertexShader )
+{
+	int nLength = V_strlen( entry.m_pText );
+	pBuf->EnsureCapacity( nLength + 1 );
+	V_memcpy( pBuf->Base(), entry.m_pText, nLength + 1 );
+	pBuf->SeekPut( CUtlBuffer::SEEK_HEAD, nLength );
+
+	*bVertexShader = ( entry.m_pRecord->m_nFlags & GLSL_TRANSLATION_VERTEX_SHADER ) != 0;
+}
+
+bool CGLSLTranslationCache::MakeKey( const uint32 *code, uint32 options, int32 nShadowDepthSamplerMask, uint32 nCentroidMask, const char *debugLabel, GLSLTranslationKey_t *pKey )
+{
+	uint32 nCodeSize = GetBytecodeSize( code );
+	if ( !nCodeSize )
+		return false;
+
+	V_memset( pKey, 0, sizeof( *pKey ) );
+	pKey->m_nCodeHash = HashBytecode( code, nCodeSize / sizeof( uint32 ) );
+	pKey->m_nCodeSize = nCodeSize;
+	pKey->m_nOptions = options;
+	pKey->m_nShadowDepthSamplerMask = nShadowDepthSamplerMask;
+	pKey->m_nCentroidMask = nCentroidMask;
+	pKey->m_nLabelHash = HashLabel( debugLabel );
+	pKey->m_nTranslatorVersion = GLSL_TRANSLATOR_VERSION;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// TranslateShader()
+//------------------------------------------------------------------------------
+int CGLSLTranslationCache::TranslateShader( D3DToGL *pTranslator, uint32 *code, CUtlBuffer *pBufDisassembledCode, bool *bVertexShader, uint32 options, int32 nShadowDepthSamplerMask, uint32 nCentroidMask, char *debugLabel )
+{
+	GLSLTranslationKey_t key;
+	if ( !gl_shadercache.GetBool() || !MakeKey( code, options, nShadowDepthSamplerMask, nCentroidMask, debugLabel, &key ) )
+	{
+		m_nUncacheable++;
+		return pTranslator->TranslateShader( code, pBufDisassembledCode, bVertexShader, options, nShadowDepthSamplerMask, nCentroidMask, debugLabel );
+	}
+
+	if ( !m_bInitialized && CommandLine()->FindParm( "-gl_shadercache_pretranslate" ) )
+	{
+		// Bring the whole cache up to date before anything uses it. Nothing here touches GL,
+		// so the timings it prints are the translator's alone.
+		Pretranslate( pTranslator );
+	}
+
+	double flStart = Plat_FloatTime();
+	{
+		AUTO_LOCK( m_Mutex );
+		if ( !m_bInitialized )
+			Init( true );
+
+		UtlHashHandle_t h = m_Index.Find( key );
+		if ( h != m_Index.InvalidHandle() )
+		{
+			// the key only holds hashes, so check this really is the shader the record was made from
+			const Entry_t &entry = m_Entries[ m_Index.Element( h ) ];
+			if ( V_memcmp( entry.m_pCode, code, key.m_nCodeSize ) == 0 && V_strcmp( entry.m_pLabel, debugLabel ? debugLabel : "" ) == 0 )
+			{
+				CopyText( entry, pBufDisassembledCode, bVertexShader );
+
+				m_nHits++;
+				m_flLookupTime += Plat_FloatTime() - flStart;
+				return entry.m_pRecord->m_nResult;
+			}
+
+			m_nCollisions++;
+		}
+	}
+
+	flStart = Plat_FloatTime();
+	int nResult = pTranslator->TranslateShader( code, pBufDisassembledCode, bVertexShader, options, nShadowDepthSamplerMask, nCentroidMask, debugLabel );
+	double flTranslateTime = Plat_FloatTime() - flStart;
+
+	uint32 nRecordSize;
+	GLSLTranslationRecord_t *pRecord = BuildRecord( key, code, (const char *)pBufDisassembledCode->Base(), debugLabel ? debugLabel : "", *bVertexShader, nResult, &nRecordSize );
+
+	int iEntry;
+	{
+		AUTO_LOCK( m_Mutex );
+		iEntry = AddEntry( pRecord, nRecordSize, true );
+
+		m_nMisses++;
+		m_flTranslateTime += flTranslateTime;
+	}
+
+	{
+		AUTO_LOCK( m_WriteMutex );
+		m_PendingWrites.AddToTail( iEntry );
+	}
+	m_WriteEvent.Set();
+
+	return nResult;
+}
+
+//------------------------------------------------------------------------------
+// WriteFile()
+//
+// Writes every entry out to a new file and swaps it in
+//------------------------------------------------------------------------------
+bool CGLSLTranslationCache::WriteFile()
+{
+	char szTempName[ MAX_PATH ];
+	V_snprintf( szTempName, sizeof( szTempName ), "%s.tmp", m_szFileName );
+
+	FILE *fp = fopen( szTempName, "wb" );
+	if ( !fp )
+	{
+		Warning( "Couldn't write %s\n", szTempName );
+		return false;
+	}
+
+	GLSLTranslationFileHeader_t header;
+	header.m_nMagic = GLSL_TRANSLATION_CACHE_MAGIC;
+	header.m_nVersion = GLSL_TRANSLATION_CACHE_VERSION;
+
+	bool bOk = fwrite( &header, sizeof( header ), 1, fp ) == 1;
+	FOR_EACH_VEC( m_Entries, i )
+	{
+		bOk = bOk && fwrite( m_Entries[i].m_pRecord, m_Entries[i].m_nRecordSize, 1, fp ) == 1;
+	}
+	bOk = ( fclose( fp ) == 0 ) && bOk;
+
+	if ( bOk )
+	{
+#ifdef _WIN32
+		remove( m_szFileName );
+#endif
+		bOk = rename( szTempName, m_szFileName ) == 0;
+	}
+
+	if ( !bOk )
+	{
+		Warning( "Couldn't write %s\n", m_szFileName );
+		remove( szTempName );
+	}
+
+	return bOk;
+}
+
+//------------------------------------------------------------------------------
+// StartWriter()
+//
+// Appending needs the file to end on a complete record, so a missing, outdated or
+// truncated file is rewritten from what was loaded first. So is one that had
+// records pruned from it.
+//------------------------------------------------------------------------------
+void CGLSLTranslationCache::StartWriter()
+{
+	if ( m_hWriter )
+		return;
+
+	if ( !m_pMapped || m_nValidSize != m_nMappedSize || m_nPruned )
+	{
+		if ( !WriteFile() )
+			return;
+	}
+
+	m_bWriterExit = false;
+	m_hWriter = CreateSimpleThread( WriterThread, this );
+}
+
+void CGLSLTranslationCache::StopWriter()
+{
+	if ( !m_hWriter )
+		return;
+
+	m_bWriterExit = true;
+	m_WriteEvent.Set();
+	ThreadJoin( m_hWriter );
+	ReleaseThreadHandle( m_hWriter );
+	m_hWriter = NULL;
+}
+
+unsigned CGLSLTranslationCache::WriterThread( void *pParam )
+{
+	ThreadSetDebugName( "GLSLCacheWriter" );
+	( (CGLSLTranslationCache *)pParam )->WriterLoop();
+	return 0;
+}
+
+void CGLSLTranslationCache::WriterLoop()
+{
+	CUtlVector< int > pending;
+	for ( ;; )
+	{
+		m_WriteEvent.Wait();
+
+		bool bExit = m_bWriterExit;
+		{
+			AUTO_LOCK( m_WriteMutex );
+			pending.Swap( m_PendingWrites );
+		}
+
+		if ( pending.Count() )
+		{
+			FILE *fp = fopen( m_szFileName, "ab" );
+			if ( fp )
+			{
+				FOR_EACH_VEC( pending, i )
+				{
+					const void *pRecord;
+					uint32 nRecordSize;
+					{
+						// the records don't move, but m_Entries can
+						AUTO_LOCK( m_Mutex );
+						pRecord = m_Entries[ pending[i] ].m_pRecord;
+						nRecordSize = m_Entries[ pending[i] ].m_nRecordSize;
+					}
+					fwrite( pRecord, nRecordSize, 1, fp );
+				}
+				fclose( fp );
+			}
+			pending.RemoveAll();
+		}
+
+		if ( bExit )
+			break;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Pretranslate()
+//------------------------------------------------------------------------------
+void CGLSLTranslationCache::Pretranslate( D3DToGL *pTranslator )
+{
+	StopWriter();
+
+	AUTO_LOCK( m_Mutex );
+	if ( !m_bInitialized )
+		Init( false );
+
+	// anything still queued is in m_Entries and goes out with the rewrite
+	{
+		AUTO_LOCK( m_WriteMutex );
+		m_PendingWrites.RemoveAll();
+	}
+
+	CUtlVector< Entry_t > entries;
+	IndexTable_t index;
+
+	int nShaders = 0, nHits = 0, nMismatches = 0, nErrors = 0;
+	double flTranslateTime = 0.0;
+	uint32 nBytecodeSize = 0, nTextSize = 0;
+
+	CUtlBuffer buf( 1000, 500000, CUtlBuffer::TEXT_BUFFER );
+	CUtlVector< uint32 > code;
+
+	FOR_EACH_VEC( m_Entries, i )
+	{
+		const Entry_t &source = m_Entries[i];
+
+		GLSLTranslationKey_t key = source.m_pRecord->m_Key;
+		key.m_nTranslatorVersion = GLSL_TRANSLATOR_VERSION;
+		if ( index.HasElement( key ) )
+			continue;
+
+		nShaders++;
+
+		UtlHashHandle_t h = m_Index.Find( key );
+		const Entry_t *pCached = ( h != m_Index.InvalidHandle() ) ? &m_Entries[ m_Index.Element( h ) ] : NULL;
+		if ( pCached )
+			nHits++;
+
+		// the translator wants a writable copy
+		code.CopyArray( source.m_pCode, key.m_nCodeSize / sizeof( uint32 ) );
+		buf.EnsureCapacity( 500000 );
+		bool bVertexShader = false;
+
+		double flStart = Plat_FloatTime();
+		int nResult = pTranslator->TranslateShader( code.Base(), &buf, &bVertexShader, key.m_nOptions, key.m_nShadowDepthSamplerMask, key.m_nCentroidMask, (char *)source.m_pLabel );
+		flTranslateTime += Plat_FloatTime() - flStart;
+
+		if ( nResult != DISASM_OK )
+			nErrors++;
+
+		// the translator changed without GLSL_TRANSLATOR_VERSION being bumped
+		if ( pCached && V_strcmp( pCached->m_pText, (const char *)buf.Base() ) )
+			nMismatches++;
+
+		uint32 nRecordSize;
+		GLSLTranslationRecord_t *pRecord = BuildRecord( key, code.Base(), (const char *)buf.Base(), source.m_pLabel, bVertexShader, nResult, &nRecordSize );
+
+		int iEntry = entries.AddToTail();
+		entries[iEntry].m_pRecord = pRecord;
+		entries[iEntry].m_pText = (const char *)( pRecord + 1 );
+		entries[iEntry].m_pLabel = entries[iEntry].m_pText + pRecord->m_nTextSize;
+		entries[iEntry].m_pCode = (const uint32 *)( entries[iEntry].m_pLabel + pRecord->m_nLabelSize );
+		entries[iEntry].m_nRecordSize = nRecordSize;
+		entries[iEntry].m_bOwned = true;
+		index.Insert( key, iEntry );
+
+		nBytecodeSize += key.m_nCodeSize;
+		nTextSize += V_strlen( (const char *)buf.Base() );
+	}
+
+	ReleaseEntries();
+	UnmapFile();
+
+	m_Entries.Swap( entries );
+	m_Index.Swap( index );
+
+	WriteFile();
+	StartWriter();
+
+	Msg( "GLSL translation cache: %d shaders (%u KB bytecode -> %u KB GLSL)\n", nShaders, nBytecodeSize / 1024, nTextSize / 1024 );
+	Msg( "  %d were already translated by this version (%.1f%% hit rate), %d were not\n", nHits, nShaders ? 100.0f * nHits / nShaders : 0.0f, nShaders - nHits );
+	Msg( "  translated all in %.1f ms, %.3f ms per shader\n", flTranslateTime * 1000.0, nShaders ? flTranslateTime * 1000.0 / nShaders : 0.0 );
+	if ( nErrors )
+		Warning( "  %d shaders failed to translate\n", nErrors );
+	if ( nMismatches )
+		Warning( "  %d cached translations differ from the current translator's output - GLSL_TRANSLATOR_VERSION needs bumping\n", nMismatches );
+}
+
+void CGLSLTranslationCache::PrintStats()
+{
+	AUTO_LOCK( m_Mutex );
+
+	int nLookups = m_nHits + m_nMisses;
+	Msg( "GLSL translation cache %s: %d entries (%d from other translator versions, %d pruned), %u KB mapped\n", m_szFileName[0] ? m_szFileName : GLSL_TRANSLATION_CACHE_FILE, m_Entries.Count(), m_nStale, m_nPruned, m_nMappedSize / 1024 );
+	Msg( "  %d hits, %d misses (%.1f%% hit rate), %d uncacheable, %d hash collisions\n", m_nHits, m_nMisses, nLookups ? 100.0f * m_nHits / nLookups : 0.0f, m_nUncacheable, m_nCollisions );
+	Msg( "  lookups %.2f ms total, translation %.1f ms total (%.3f ms per miss)\n", m_flLookupTime * 1000.0, m_flTranslateTime * 1000.0, m_nMisses ? m_flTranslateTime * 1000.0 / m_nMisses : 0.0 );
+}
@@ -0,0 +1,180 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//                       TOGL CODE LICENSE
+//
+//  Copyright 2011-2014 Valve Corporation
+//  All Rights Reserved.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//------------------------------------------------------------------------------
+// GLSLTranslationCache.h
+//
+// Persistent, content addressed cache of D3DToGL translations. Entries are keyed
+// by a hash of the shader bytecode plus every input that changes the GLSL, so the
+// cache never needs to be told when shaders change. The cache file is mapped in
+// once at startup and new translations are appended to it by a writer thread.
+//------------------------------------------------------------------------------
+
+#ifndef GLSL_TRANSLATION_CACHE_H
+#define GLSL_TRANSLATION_CACHE_H
+
+#include "tier0/threadtools.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/utlhashtable.h"
+#include "tier1/utlvector.h"
+
+class D3DToGL;
+
+#define GLSL_TRANSLATION_CACHE_FILE		"glshadercache.bin"
+#define GLSL_TRANSLATION_CACHE_MAGIC	0x43544C47		// 'GLTC'
+#define GLSL_TRANSLATION_CACHE_VERSION	1				// file layout
+
+// Bump this whenever a change to D3DToGL changes the GLSL it generates. Translations
+// made by any other version are pruned from the file when it is opened, except by
+// gl_shadercache_pretranslate, which retranslates their bytecode to bring them up to date.
+#define GLSL_TRANSLATOR_VERSION			1
+
+struct GLSLTranslationKey_t
+{
+	uint64	m_nCodeHash;					// of the shader bytecode
+	uint32	m_nCodeSize;					// bytes of bytecode, up to and including the end token
+	uint32	m_nOptions;						// D3DToGL_Option* bits
+	int32	m_nShadowDepthSamplerMask;
+	uint32	m_nCentroidMask;
+	uint32	m_nLabelHash;					// the debug label ends up in the translation
+	uint32	m_nTranslatorVersion;
+};
+
+#define GLSL_TRANSLATION_VERTEX_SHADER	0x0001
+
+struct GLSLTranslationFileHeader_t
+{
+	uint32	m_nMagic;
+	uint32	m_nVersion;
+};
+
+// Records follow the file header back to back. Each is followed by m_nTextSize bytes of
+// GLSL, m_nLabelSize bytes of debug label (both terminated and padded to 4 bytes) and
+// then the bytecode it was made from.
+struct GLSLTranslationRecord_t
+{
+	GLSLTranslationKey_t	m_Key;
+	uint32					m_nFlags;		// GLSL_TRANSLATION_*
+	int32					m_nResult;		// what D3DToGL::TranslateShader returned
+	uint32					m_nTextSize;
+	uint32					m_nLabelSize;
+};
+
+class CGLSLTranslationCache
+{
+public:
+	CGLSLTranslationCache();
+	~CGLSLTranslationCache();
+
+	// Finishes writing anything queued and releases the file
+	void Shutdown();
+
+	// Same contract as D3DToGL::TranslateShader, but only calls through to the translator on a miss
+	int TranslateShader( D3DToGL *pTranslator, uint32 *code, CUtlBuffer *pBufDisassembledCode, bool *bVertexShader, uint32 options, int32 nShadowDepthSamplerMask, uint32 nCentroidMask, char *debugLabel );
+
+	// Offline mode: retranslates the bytecode of every entry in the cache with the
+	// current translator, timing it, and rewrites the file with only current entries.
+	// Doesn't touch GL, so it can be run before a context exists.
+	void Pretranslate( D3DToGL *pTranslator );
+
+	void PrintStats();
+
+	// Length of SM2+ bytecode, or 0 if it can't be determined (in which case the shader isn't cached)
+	static uint32 GetBytecodeSize( const uint32 *code );
+
+private:
+	struct Entry_t
+	{
+		const GLSLTranslationRecord_t	*m_pRecord;
+		const char						*m_pText;
+		const char						*m_pLabel;
+		const uint32					*m_pCode;
+		uint32							m_nRecordSize;
+		bool							m_bOwned;		// made this session, m_pRecord was allocated rather than mapped
+	};
+
+	struct KeyHashFunctor
+	{
+		unsigned int operator()( const GLSLTranslationKey_t &key ) const
+		{
+			return (uint32)key.m_nCodeHash ^ (uint32)( key.m_nCodeHash >> 32 ) ^ ( key.m_nOptions * 0x9E3779B1 ) ^ key.m_nLabelHash;
+		}
+	};
+
+	struct KeyEqualFunctor
+	{
+		bool operator()( const GLSLTranslationKey_t &lhs, const GLSLTranslationKey_t &rhs ) const
+		{
+			return V_memcmp( &lhs, &rhs, sizeof( lhs ) ) == 0;
+		}
+	};
+
+	typedef CUtlHashtable< GLSLTranslationKey_t, int, KeyHashFunctor, KeyEqualFunctor > IndexTable_t;
+
+	void	Init( bool bStartWriter );
+	void	MapFile( bool bKeepStale );
+	void	UnmapFile();
+	void	ReleaseEntries();
+	int		AddEntry( const GLSLTranslationRecord_t *pRecord, uint32 nRecordSize, bool bOwned );
+	GLSLTranslationRecord_t *BuildRecord( const GLSLTranslationKey_t &key, const uint32 *code, const char *pText, const char *pLabel, bool bVertexShader, int nResult, uint32 *pRecordSize );
+	void	CopyText( const Entry_t &entry, CUtlBuffer *pBuf, bool *bVertexShader );
+	bool	MakeKey( const uint32 *code, uint32 options, int32 nShadowDepthSamplerMask, uint32 nCentroidMask, const char *debugLabel, GLSLTranslationKey_t *pKey );
+
+	bool	WriteFile();
+	void	StartWriter();
+	void	StopWriter();
+	static unsigned WriterThread( void *pParam );
+	void	WriterLoop();
+
+	CThreadFastMutex	m_Mutex;				// guards the file, entries, index and stats
+	bool				m_bInitialized;
+	char				m_szFileName[ MAX_PATH ];
+
+	uint8				*m_pMapped;
+	uint32				m_nMappedSize;
+	uint32				m_nValidSize;			// bytes of the mapped file holding complete records
+
+	CUtlVector< Entry_t >	m_Entries;			// every record, including ones for other translator versions
+	IndexTable_t			m_Index;			// current version records only
+
+	// Appending
+	ThreadHandle_t			m_hWriter;
+	CThreadEvent			m_WriteEvent;
+	CThreadFastMutex		m_WriteMutex;		// guards m_PendingWrites
+	CUtlVector< int >		m_PendingWrites;	// indices into m_Entries
+	volatile bool			m_bWriterExit;
+
+	// Stats for this session
+	int		m_nHits;
+	int		m_nMisses;
+	int		m_nUncacheable;
+	int		m_nStale;						// loaded records made by another translator version
+	int		m_nPruned;						// records made by another translator version, dropped on load
+	int		m_nCollisions;					// key matched but the bytecode or label didn't
+	double	m_flLookupTime;
+	double	m_flTranslateTime;
+};
+
+extern CGLSLTranslationCache g_GLSLTranslationCache;
+
+#endif // GLSL_TRANSLATION_CACHE_H
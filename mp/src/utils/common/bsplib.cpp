@@ -4454,6 +4454,17 @@ bool CompressGameLump( dheader_t *pInBSPHeader, dheader_t *pOutBSPHeader, CUtlBu
 		byteSwap.SwapFieldsToTargetEndian( pInGameLump, pInGameLumpHeader->lumpCount );
 	}
 
+	// The directory and the offsets in it come from the file, every lump they describe has to
+	// lie inside the game lump
+	int64 nGameLumpStart = pInBSPHeader->lumps[LUMP_GAME_LUMP].fileofs;
+	int64 nGameLumpEnd = nGameLumpStart + pInBSPHeader->lumps[LUMP_GAME_LUMP].filelen;
+	if ( pInGameLumpHeader->lumpCount < 0 ||
+		 (int64)sizeof( dgamelumpheader_t ) + (int64)pInGameLumpHeader->lumpCount * (int64)sizeof( dgamelump_t ) > nGameLumpEnd - nGameLumpStart )
+	{
+		Warning( "Game lump directory is out of bounds, BSP is corrupt\n" );
+		return false;
+	}
+
 	unsigned int newOffset = outputBuffer.TellPut();
 	// Make room for gamelump header and gamelump structs, which we'll write at the end
 	outputBuffer.SeekPut( CUtlBuffer::SEEK_CURRENT, sizeof( dgamelumpheader_t ) );
@@ -4481,23 +4492,29 @@ bool CompressGameLump( dheader_t *pInBSPHeader, dheader_t *pOutBSPHeader, CUtlBu
 
 		if ( pInGameLump[i].filelen )
 		{
+			// Compressed game lumps are sized by the next entry's offset, the last real one
+			// is followed by the dummy terminal lump
+			int64 nLumpStart = pInGameLump[i].fileofs;
+			int64 nLumpEnd = nLumpStart + pInGameLump[i].filelen;
+			if ( ( pInGameLump[i].flags & GAMELUMPFLAG_COMPRESSED ) && i + 1 < pInGameLumpHeader->lumpCount )
+			{
+				nLumpEnd = pInGameLump[i + 1].fileofs;
+			}
+
+			if ( pInGameLump[i].filelen < 0 || nLumpStart < nGameLumpStart || nLumpEnd < nLumpStart || nLumpEnd > nGameLumpEnd )
+			{
+				Warning( "Game lump %d is out of bounds, BSP is corrupt\n", i );
+				return false;
+			}
+
 			if ( pInGameLump[i].flags & GAMELUMPFLAG_COMPRESSED )
 			{
-				byte *pCompressedLump = ((byte *)pInBSPHeader) + pInGameLump[i].fileofs;
-				if ( CLZMA::IsCompressed( pCompressedLump ) )
+				byte *pCompressedLump = ((byte *)pInBSPHeader) + nLumpStart;
+				unsigned int nCompressedSize = (unsigned int)( nLumpEnd - nLumpStart );
+				if ( !UncompressBSPLump( pCompressedLump, nCompressedSize, 0, inputBuffer ) )
 				{
-					inputBuffer.EnsureCapacity( CLZMA::GetActualSize( pCompressedLump ) );
-					unsigned int outSize = CLZMA::Uncompress( pCompressedLump, (unsigned char *)inputBuffer.Base() );
-					inputBuffer.SeekPut( CUtlBuffer::SEEK_CURRENT, outSize );
-					if ( outSize != CLZMA::GetActualSize( pCompressedLump ) )
-					{
-						Warning( "Decompressed size differs from header, BSP may be corrupt\n" );
-					}
-				}
-				else
-				{
-					Assert( CLZMA::IsCompressed( pCompressedLump ) );
 					Warning( "Unsupported BSP: Unrecognized compressed game lump\n" );
+					return false;
 				}
 
 			}
@@ -4578,6 +4595,38 @@ bool RepackBSPCallback_LZMA( CUtlBuffer &inputBuffer, CUtlBuffer &outputBuffer )
 }
 
 
+//-----------------------------------------------------------------------------
+// Decompress an LZMA lump into outputBuffer. nCompressedSize
+// is the number of bytes on disk, nothing past it is read. nExpectedSize is the
+// lump header's uncompressedSize, or 0 to skip the check.
+//-----------------------------------------------------------------------------
+bool UncompressBSPLump( unsigned char *pCompressedLump, unsigned int nCompressedSize, unsigned int nExpectedSize, CUtlBuffer &outputBuffer )
+{
+	if ( nCompressedSize >= sizeof( lzma_header_t ) && CLZMA::IsCompressed( pCompressedLump ) )
+	{
+		if ( LittleLong( ((lzma_header_t *)pCompressedLump)->lzmaSize ) > nCompressedSize - sizeof( lzma_header_t ) )
+		{
+			Warning( "Compressed lump is truncated, BSP is corrupt\n" );
+			return false;
+		}
+
+		unsigned int nActualSize = CLZMA::GetActualSize( pCompressedLump );
+		if ( nExpectedSize && nExpectedSize != nActualSize )
+			return false;
+
+		outputBuffer.EnsureCapacity( outputBuffer.TellPut() + nActualSize );
+		unsigned int outSize = CLZMA::Uncompress( pCompressedLump, (unsigned char *)outputBuffer.Base() + outputBuffer.TellPut() );
+		outputBuffer.SeekPut( CUtlBuffer::SEEK_CURRENT, outSize );
+		if ( outSize != nActualSize )
+		{
+			Warning( "Decompressed size differs from header, BSP may be corrupt\n" );
+		}
+		return true;
+	}
+
+	return false;
+}
+
 bool RepackBSP( CUtlBuffer &inputBuffer, CUtlBuffer &outputBuffer, CompressFunc_t pCompressFunc, IZip::eCompressionType packfileCompression )
 {
 	dheader_t *pInBSPHeader = (dheader_t *)inputBuffer.Base();
@@ -4638,21 +4687,10 @@ bool RepackBSP( CUtlBuffer &inputBuffer, CUtlBuffer &outputBuffer, CompressFunc_
 			if ( pSortedLump->pLump->uncompressedSize )
 			{
 				byte *pCompressedLump = ((byte *)pInBSPHeader) + pSortedLump->pLump->fileofs;
-				if ( CLZMA::IsCompressed( pCompressedLump ) && pSortedLump->pLump->uncompressedSize == CLZMA::GetActualSize( pCompressedLump ) )
-				{
-					inputBuffer.EnsureCapacity( CLZMA::GetActualSize( pCompressedLump ) );
-					unsigned int outSize = CLZMA::Uncompress( pCompressedLump, (unsigned char *)inputBuffer.Base() );
-					inputBuffer.SeekPut( CUtlBuffer::SEEK_CURRENT, outSize );
-					if ( outSize != pSortedLump->pLump->uncompressedSize )
-					{
-						Warning( "Decompressed size differs from header, BSP may be corrupt\n" );
-					}
-				}
-				else
+				if ( !UncompressBSPLump( pCompressedLump, pSortedLump->pLump->filelen, pSortedLump->pLump->uncompressedSize, inputBuffer ) )
 				{
-					Assert( CLZMA::IsCompressed( pCompressedLump ) &&
-					        pSortedLump->pLump->uncompressedSize == CLZMA::GetActualSize( pCompressedLump ) );
 					Warning( "Unsupported BSP: Unrecognized compressed lump\n" );
+					return false;
 				}
 			}
 			else
@@ -4665,7 +4703,8 @@ bool RepackBSP( CUtlBuffer &inputBuffer, CUtlBuffer &outputBuffer, CompressFunc_
 			if ( lumpNum == LUMP_GAME_LUMP )
 			{
 				// the game lump has to have each of its components individually compressed
-				CompressGameLump( pInBSPHeader, &sOutBSPHeader, outputBuffer, pCompressFunc );
+				if ( !CompressGameLump( pInBSPHeader, &sOutBSPHeader, outputBuffer, pCompressFunc ) )
+					return false;
 			}
 			else if ( lumpNum == LUMP_PAKFILE )
 			{
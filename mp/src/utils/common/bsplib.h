@@ -298,6 +298,8 @@ void	PrintBSPPackDirectory(void);
 void	ReleasePakFileLumps(void);
 
 bool	RepackBSPCallback_LZMA( CUtlBuffer &inputBuffer, CUtlBuffer &outputBuffer );
+// Checks an LZMA lump against the bytes it has on disk before decoding it.
+bool	UncompressBSPLump( unsigned char *pCompressedLump, unsigned int nCompressedSize, unsigned int nExpectedSize, CUtlBuffer &outputBuffer );
 bool	RepackBSP( CUtlBuffer &inputBuffer, CUtlBuffer &outputBuffer, CompressFunc_t pCompressFunc, IZip::eCompressionType packfileCompression );
 bool	SwapBSPFile( const char *filename, const char *swapFilename, bool bSwapOnLoad, VTFConvertFunc_t pVTFConvertFunc, VHVFixupFunc_t pVHVFixupFunc, CompressFunc_t pCompressFunc );
 